@@ -0,0 +1,45 @@
+#ifndef SIPM_SIPMBENCHMARK_H
+#define SIPM_SIPMBENCHMARK_H
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace sipm {
+namespace bench {
+/// @brief Runs f n times and returns elapsed wall-clock time in seconds
+template <typename F> double timeit(F&& f, const uint32_t n) {
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < n; ++i) {
+    f();
+  }
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+/// @brief Prints a line of a benchmark report
+inline void report(const std::string& name, const uint32_t nEvents, const double seconds) {
+  std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(14) << nEvents / seconds << " events/s" << std::setw(12) << 1e6 * seconds / nEvents
+            << " us/event\n";
+}
+
+/// @brief Prints a line of a benchmark report with the time per hit
+inline void reportHits(const std::string& name, const uint32_t nEvents, const uint64_t nHits, const double seconds) {
+  std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(14) << nEvents / seconds << " events/s" << std::setw(12) << 1e9 * seconds / nHits
+            << " ns/hit" << std::setw(12) << static_cast<double>(nHits) / nEvents << " hits/event\n";
+}
+
+/// @brief Prints a line with tail latencies of a benchmark report
+template <typename L> void reportTail(const std::string& name, const L& latency) {
+  std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(1)
+            << "  p50 " << std::setw(9) << latency.quantile(0.5) * 1e-3 << "  p99 " << std::setw(9)
+            << latency.quantile(0.99) * 1e-3 << "  p999 " << std::setw(9) << latency.quantile(0.999) * 1e-3
+            << "  max " << std::setw(9) << latency.max() * 1e-3 << " us\n";
+}
+} // namespace bench
+} // namespace sipm
+#endif /* SIPM_SIPMBENCHMARK_H */
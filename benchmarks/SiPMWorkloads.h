@@ -0,0 +1,140 @@
+// Reference workloads used to compare performance between versions and
+// machines. Each workload is a named configuration of the sensor with a
+// generator of its input, run with a fixed seed so that everyone runs
+// exactly the same events.
+#ifndef SIPM_SIPMWORKLOADS_H
+#define SIPM_SIPMWORKLOADS_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "SiPM.h"
+#include "SiPMBenchmark.h"
+
+namespace sipm {
+namespace bench {
+/// @brief Named configuration of the sensor and generator of its input
+struct Workload {
+  std::string name;
+  std::string description;
+  SiPMProperties properties;
+  uint32_t nEvents; ///< Default number of events of a run
+  // Sets the input of an event on a sensor that has just been reset
+  std::function<void(SiPMSensor&)> setInput;
+};
+
+/// @brief Result of a run of a workload
+struct WorkloadResult {
+  uint32_t nEvents = 0;
+  uint64_t nHits = 0;
+  double seconds = 0;
+};
+
+/// @brief Default seed of all workloads
+static constexpr uint64_t workloadSeed = 1234567890ULL;
+
+/// @brief Returns all reference workloads
+inline std::vector<Workload> workloads() {
+  std::vector<Workload> out;
+
+  // examples/noise.py: long window with high noise and no photons
+  {
+    SiPMProperties p;
+    p.setSignalLength(5000);
+    p.setSampling(0.1);
+    p.setFallTimeFast(20);
+    p.setDcr(5e6);
+    p.setXt(0.5);
+    p.setDXt(0.5);
+    p.setAp(0.5);
+    p.setSnr(40);
+    out.push_back({"noise", "5000 ns at 0.1 ns, 5 MHz DCR, 50% XT/DXT/AP", p, 500, [](SiPMSensor&) {}});
+  }
+
+  // examples/saturation.py: 0-2000 photons in a narrow pulse for three pitches
+  for (const double pitch : {10., 25., 50.}) {
+    SiPMProperties p;
+    p.setPitch(pitch);
+    const std::string name = "saturation-" + std::to_string(static_cast<int>(pitch)) + "um";
+    out.push_back({name, "0-2000 photons at 25 ns, 1 mm with " + std::to_string(static_cast<int>(pitch)) + " um cells",
+                   p, 1000, [](SiPMSensor& sensor) {
+                     const uint32_t n = sensor.rng().randInteger(2000);
+                     if (n > 0) {
+                       sensor.addPhotons(sensor.rng().randGaussian(25, 0.01, n));
+                     }
+                   }});
+  }
+
+  // Calorimeter shower: many photons on a large sensor with small cells
+  {
+    SiPMProperties p;
+    p.setSize(6);
+    p.setPitch(15);
+    p.setSignalLength(300);
+    const SiPMScintillatorSource shower(1e5, 20, 0.5, 10);
+    out.push_back({"calorimeter", "1e5 photons, 6 mm with 15 um cells, 10 ns decay", p, 3,
+                   [shower](SiPMSensor& sensor) { sensor.addPhotons(shower); }});
+  }
+
+  // LIDAR: weak return pulse over 1 GHz of background photons
+  {
+    SiPMProperties p;
+    p.setSignalLength(2000);
+    p.setSampling(0.5);
+    p.setFallTimeFast(10);
+    p.setRecoveryTime(10);
+    const SiPMBackgroundSource background(1e9, 0, 2000);
+    const SiPMPulseSource echo(20, 1000, 0.5);
+    out.push_back({"lidar", "1 GHz background over 2000 ns with a 20 photons echo", p, 200,
+                   [background, echo](SiPMSensor& sensor) {
+                     sensor.addPhotons(background);
+                     sensor.appendPhotons(echo.generate(sensor.rng()));
+                   }});
+  }
+
+  // PET: 511 keV in LYSO read by a 3 mm sensor sampled for timing
+  {
+    SiPMProperties p;
+    p.setSize(3);
+    p.setSampling(0.1);
+    p.setSptr(0.1);
+    SiPMScintillatorSource lyso(4000, 20, 0.07, 40);
+    lyso.setTransitTimeSpread(0.1);
+    out.push_back({"pet", "511 keV in LYSO, 4000 photons on 3 mm at 0.1 ns", p, 200,
+                   [lyso](SiPMSensor& sensor) { sensor.addPhotons(lyso); }});
+  }
+  return out;
+}
+
+/// @brief Runs events of a workload on a sensor seeded with seed
+/** Each event is reset, filled by the workload, run and its waveform built.
+ */
+inline WorkloadResult runWorkload(const Workload& w, SiPMSensor& sensor, const uint32_t nEvents,
+                                  const uint64_t seed = workloadSeed) {
+  WorkloadResult result;
+  result.nEvents = nEvents;
+  sensor.rng().rng().seed(seed);
+  result.seconds = timeit(
+    [&] {
+      sensor.resetState();
+      w.setInput(sensor);
+      sensor.runEvent();
+      sensor.signal();
+      // Photoelectrons include dark counts and crosstalk, not afterpulses
+      const SiPMDebugInfo debug = sensor.debug();
+      result.nHits += debug.nPhotoelectrons + debug.nAp;
+    },
+    nEvents);
+  return result;
+}
+
+/// @brief Runs events of a workload on a new sensor with its properties
+inline WorkloadResult runWorkload(const Workload& w, const uint32_t nEvents, const uint64_t seed = workloadSeed) {
+  SiPMSensor sensor(w.properties);
+  return runWorkload(w, sensor, nEvents, seed);
+}
+} // namespace bench
+} // namespace sipm
+#endif /* SIPM_SIPMWORKLOADS_H */
@@ -0,0 +1,56 @@
+// Comparison of ASIC records obtained from the waveform and directly from
+// hits. The waveform path builds a 0.1 ns sampled signal for each event and
+// runs the discriminator on each sample, the hit path evaluates the pulse
+// analytically only between consecutive hits.
+#include "SiPM.h"
+#include "SiPMBenchmark.h"
+
+#include <cstdint>
+#include <iostream>
+
+using namespace sipm;
+
+int main(int argc, char** argv) {
+  static constexpr uint64_t seed = 1234567890ULL;
+  const uint32_t nEvents = (argc > 1) ? std::stoul(argv[1]) : 2000;
+  const double nPhotons = (argc > 2) ? std::stod(argv[2]) : 1000;
+
+  SiPMProperties properties;
+  properties.setSampling(0.1);
+  SiPMScintillatorSource source(nPhotons, 20, 0.1, 40);
+  SiPMSensor sensor(properties);
+  SiPMAsic fromWaveform(1, properties);
+  SiPMAsic fromHits(1, properties);
+  for (SiPMAsic* asic : {&fromWaveform, &fromHits}) {
+    asic->setThresholds(0.5, 2.5);
+    asic->setQdc(200, 10, 16);
+  }
+
+  std::cout << "Events: " << nEvents << " - average photons: " << nPhotons << "\n";
+  sensor.rng().rng().seed(seed);
+  const double tWaveform = bench::timeit(
+    [&] {
+      sensor.resetState();
+      sensor.addPhotons(source);
+      sensor.runEvent();
+      fromWaveform.process(sensor.signal(), 0);
+    },
+    nEvents);
+  bench::report("Waveform", nEvents, tWaveform);
+
+  sensor.rng().rng().seed(seed);
+  double t0 = 0;
+  const double tHits = bench::timeit(
+    [&] {
+      sensor.resetState();
+      sensor.addPhotons(source);
+      sensor.runEvent();
+      fromHits.process(sensor, 0, t0);
+      t0 += properties.signalLength();
+    },
+    nEvents);
+  bench::report("Hits", nEvents, tHits);
+  std::cout << "Records: " << fromWaveform.nRecords() << " (waveform) " << fromHits.nRecords() << " (hits)\n";
+  std::cout << "Speedup hits/waveform: " << tWaveform / tHits << "\n";
+  return 0;
+}
@@ -0,0 +1,50 @@
+// Comparison of analog and digital readout.
+// Analog readout computes amplitudes of all hits and builds the waveform,
+// digital readout only produces timestamps of fired cells.
+#include "SiPM.h"
+#include "SiPMBenchmark.h"
+
+#include <cstdint>
+#include <iostream>
+
+using namespace sipm;
+
+int main(int argc, char** argv) {
+  static constexpr uint64_t seed = 1234567890ULL;
+  const uint32_t nEvents = (argc > 1) ? std::stoul(argv[1]) : 2000;
+  const double nPhotons = (argc > 2) ? std::stod(argv[2]) : 1000;
+
+  SiPMProperties properties;
+  properties.setSampling(0.1);
+  properties.setDeadTime(20);
+  SiPMPulseSource source(nPhotons, 25, 0.1);
+
+  SiPMSensor sensorAnalog(properties);
+  SiPMSensor sensorDigital(properties);
+  sensorDigital.setReadout(SiPMSensor::Readout::kDigital);
+
+  std::cout << "Events: " << nEvents << " - average photons: " << nPhotons << "\n";
+  sensorAnalog.rng().rng().seed(seed);
+  const double tAnalog = bench::timeit(
+    [&] {
+      sensorAnalog.resetState();
+      sensorAnalog.addPhotons(source);
+      sensorAnalog.runEvent();
+      sensorAnalog.signal();
+    },
+    nEvents);
+  bench::report("Readout: analog", nEvents, tAnalog);
+
+  sensorDigital.rng().rng().seed(seed);
+  const double tDigital = bench::timeit(
+    [&] {
+      sensorDigital.resetState();
+      sensorDigital.addPhotons(source);
+      sensorDigital.runEvent();
+      sensorDigital.digitalSignal().frames(50, 1, 5, 2);
+    },
+    nEvents);
+  bench::report("Readout: digital", nEvents, tDigital);
+  std::cout << "Speedup digital/analog: " << tAnalog / tDigital << "\n";
+  return 0;
+}
@@ -0,0 +1,48 @@
+// Cost of the electronic noise of a waveform: white noise only and white
+// noise shaped by the recursive filters of SiPMNoiseModel. Each component
+// adds a gaussian value and two multiply-adds per pole to every sample.
+//   BenchSiPMNoise [nWindows] [nSamples]
+#include "SiPM.h"
+#include "SiPMBenchmark.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace sipm;
+
+int main(int argc, char** argv) {
+  const uint32_t nWindows = (argc > 1) ? std::stoul(argv[1]) : 20000;
+  const uint32_t nSamples = (argc > 2) ? std::stoul(argv[2]) : 5000;
+  static constexpr double sampling = 0.1;
+
+  SiPMRandom rng;
+  SiPMVector<float> signal(nSamples);
+  SiPMVector<float> scratch(nSamples);
+  std::cout << "Windows: " << nWindows << " - samples per window: " << nSamples << "\n";
+
+  const double tWhite =
+    bench::timeit([&] { rng.randGaussianBoxMuller(0, 0.01, signal.data(), nSamples); }, nWindows);
+  bench::report("White", nWindows, tWhite);
+
+  SiPMNoiseModel pink, band, both;
+  pink.addPink(0.01, 1e5, 1e9);
+  band.addBand(0.01, 1e7, 1e8);
+  both.addPink(0.01, 1e5, 1e9);
+  both.addBand(0.01, 1e7, 1e8);
+  const std::vector<std::pair<std::string, SiPMNoiseModel*>> models = {
+    {"Pink", &pink}, {"CR-RC", &band}, {"Pink + CR-RC", &both}};
+  for (const auto& m : models) {
+    m.second->prepare(sampling);
+    const double t = bench::timeit(
+      [&] {
+        rng.randGaussianBoxMuller(0, 0.01, signal.data(), nSamples);
+        m.second->addNoise(signal.data(), nSamples, rng, scratch);
+      },
+      nWindows);
+    bench::report(m.first + " (" + std::to_string(m.second->nPoles()) + " poles)", nWindows, t);
+  }
+  std::cout << "Checksum: " << signal[nSamples / 2] << "\n";
+  return 0;
+}
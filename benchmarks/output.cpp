@@ -0,0 +1,64 @@
+// Batches of events written to a file after each batch, synchronously with
+// an ofstream and with the asynchronous writer. With the writer the disk
+// write of a batch overlaps with the simulation of the next one.
+//   BenchSiPMOutput [nBatches] [eventsPerBatch] [file]
+#include "SiPM.h"
+#include "SiPMBenchmark.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace sipm;
+
+int main(int argc, char** argv) {
+  static constexpr uint64_t seed = 1234567890ULL;
+  const uint32_t nBatches = (argc > 1) ? std::stoul(argv[1]) : 20;
+  const uint32_t nEvents = (argc > 2) ? std::stoul(argv[2]) : 5000;
+  const std::string fname = (argc > 3) ? argv[3] : "BenchSiPMOutput.bin";
+
+  SiPMProperties properties;
+  properties.setSampling(0.1);
+  SiPMBatchRunner runner(properties);
+  runner.setSeed(seed);
+  const SiPMScintillatorSource source(100, 20, 0.1, 40);
+
+  std::cout << "Batches: " << nBatches << " - events per batch: " << nEvents << " - file: " << fname << "\n";
+  runner.run(source, nEvents);
+  const double mb = 1e-6 * nBatches * nEvents * runner.nSignalPoints() * sizeof(float);
+
+  const double tSim = bench::timeit([&] { runner.run(source, nEvents); }, nBatches);
+  bench::report("Simulation only", nBatches * nEvents, tSim);
+
+  {
+    std::ofstream file(fname, std::ios::binary);
+    const double t = bench::timeit(
+      [&] {
+        runner.run(source, nEvents);
+        file.write(reinterpret_cast<const char*>(runner.waveform(0)),
+                   static_cast<size_t>(nEvents) * runner.nSignalPoints() * sizeof(float));
+        file.flush();
+      },
+      nBatches);
+    bench::report("Synchronous ofstream", nBatches * nEvents, t);
+  }
+
+  for (const bool direct : {false, true}) {
+    SiPMOutputWriter writer(fname, 64 << 20, 3, direct);
+    const double t = bench::timeit(
+      [&] {
+        runner.run(source, nEvents);
+        writer.write(runner);
+      },
+      nBatches);
+    writer.close();
+    bench::report(direct ? (writer.direct() ? "Async writer (O_DIRECT)" : "Async writer (no O_DIRECT)") : "Async writer",
+                  nBatches * nEvents, t);
+    std::cout << "  " << mb << " MB - disk " << 1e-6 * writer.bandwidth() << " MB/s - stalled "
+              << writer.stallSeconds() << " s\n";
+  }
+  std::remove(fname.c_str());
+  return 0;
+}
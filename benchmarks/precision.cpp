@@ -0,0 +1,64 @@
+// A/B comparison of double and single precision pipelines.
+// Same seed is used for both runs so the only difference in the
+// waveforms comes from the precision of hits and accumulation.
+#include "SiPM.h"
+#include "SiPMBenchmark.h"
+
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+using namespace sipm;
+
+int main(int argc, char** argv) {
+  static constexpr uint64_t seed = 1234567890ULL;
+  const uint32_t nEvents = (argc > 1) ? std::stoul(argv[1]) : 2000;
+  const double nPhotons = (argc > 2) ? std::stod(argv[2]) : 1000;
+
+  SiPMProperties properties;
+  properties.setSampling(0.1);
+  SiPMPulseSource source(nPhotons, 25, 0.1);
+
+  SiPMSensor sensorDouble(properties);
+  SiPMSensor sensorSingle(properties);
+  sensorSingle.setPrecision(SiPMSensor::Precision::kSingle);
+
+  auto run = [&source](SiPMSensor& sensor) {
+    sensor.resetState();
+    sensor.addPhotons(source);
+    sensor.runEvent();
+    // Waveform is built lazily: build it so that noise and accumulation are timed
+    sensor.signalView();
+  };
+
+  std::cout << "Events: " << nEvents << " - average photons: " << nPhotons << "\n";
+  sensorDouble.rng().rng().seed(seed);
+  const double tDouble = bench::timeit([&] { run(sensorDouble); }, nEvents);
+  bench::report("Precision: double", nEvents, tDouble);
+
+  sensorSingle.rng().rng().seed(seed);
+  const double tSingle = bench::timeit([&] { run(sensorSingle); }, nEvents);
+  bench::report("Precision: single", nEvents, tSingle);
+  std::cout << "Speedup single/double: " << tDouble / tSingle << "\n";
+
+  // Accuracy on identical events
+  double maxDiff = 0;
+  double integralDiff = 0;
+  sensorDouble.rng().rng().seed(seed);
+  sensorSingle.rng().rng().seed(seed);
+  for (uint32_t i = 0; i < 100; ++i) {
+    run(sensorDouble);
+    run(sensorSingle);
+    const SiPMAnalogSignal a = sensorDouble.signal();
+    const SiPMAnalogSignal b = sensorSingle.signal();
+    for (uint32_t j = 0; j < a.size(); ++j) {
+      maxDiff = std::max(maxDiff, (double)std::abs(a[j] - b[j]));
+    }
+    integralDiff += std::abs(a.integral(20, 250, -1) - b.integral(20, 250, -1)) / a.integral(20, 250, -1);
+  }
+  std::cout << std::scientific << std::setprecision(3);
+  std::cout << "Max sample difference: " << maxDiff << "\n";
+  std::cout << "Average relative integral difference: " << integralDiff / 100 << "\n";
+  return 0;
+}
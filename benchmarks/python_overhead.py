@@ -0,0 +1,85 @@
+# Per-call cost of the Python bindings and of a complete event loop written
+# with the plain calls and with the low-overhead paths (numpy input, signal
+# without copy, single call per event or per batch).
+#   python benchmarks/python_overhead.py [nEvents] [nPhotons]
+import sys
+import timeit
+
+import numpy as np
+import SiPM
+
+N = int(sys.argv[1]) if len(sys.argv) > 1 else 2000
+NPHOTONS = int(sys.argv[2]) if len(sys.argv) > 2 else 100
+INTSTART, INTGATE, THRESHOLD = 10, 250, 0.5
+
+rng = np.random.default_rng(1234567890)
+events = [rng.normal(20, 0.1, NPHOTONS) for _ in range(N)]
+lists = [e.tolist() for e in events]
+
+sensor = SiPM.SiPMSensor()
+sensor.addPhotons(events[0])
+sensor.runEvent()
+
+
+def report(name, seconds, n):
+    print(f"{name:<40}{1e6 * seconds / n:12.2f} us/call")
+
+
+def per_call(name, stmt, n=N):
+    report(name, timeit.timeit(stmt, number=n), n)
+
+
+print(f"Events: {N} - photons per event: {NPHOTONS}")
+print("--- Single calls")
+per_call("resetState", sensor.resetState)
+per_call("addPhotons(list)", lambda: sensor.addPhotons(lists[0]))
+per_call("addPhotons(numpy)", lambda: sensor.addPhotons(events[0]))
+sensor.runEvent()
+per_call("signal() (copy)", sensor.signal)
+per_call("signalView() (no copy)", sensor.signalView)
+per_call("signalCopy() (single copy)", sensor.signalCopy)
+signal = sensor.signal()
+per_call("signal.integral", lambda: signal.integral(INTSTART, INTGATE, THRESHOLD))
+per_call("signal.waveform() (list)", signal.waveform)
+per_call("numpy.asarray(signal)", lambda: np.asarray(signal))
+
+
+def naive():
+    out = np.empty(N)
+    for i in range(N):
+        sensor.resetState()
+        sensor.addPhotons(lists[i])
+        sensor.runEvent()
+        out[i] = sensor.signal().integral(INTSTART, INTGATE, THRESHOLD)
+    return out
+
+
+def numpy_input():
+    out = np.empty(N)
+    for i in range(N):
+        sensor.resetState()
+        sensor.addPhotons(events[i])
+        sensor.runEvent()
+        out[i] = sensor.signal().integral(INTSTART, INTGATE, THRESHOLD)
+    return out
+
+
+def single_call():
+    out = np.empty(N)
+    for i in range(N):
+        out[i] = sensor.runAndExtract(events[i], INTSTART, INTGATE, THRESHOLD)[0]
+    return out
+
+
+def batch():
+    return sensor.runAndExtract(events, INTSTART, INTGATE, THRESHOLD)[:, 0]
+
+
+print("--- Event loop")
+loops = [("Naive (list, signal copy)", naive), ("Numpy input", numpy_input),
+         ("runAndExtract per event", single_call), ("runAndExtract per batch", batch)]
+tNaive = None
+for name, f in loops:
+    t = timeit.timeit(f, number=1)
+    tNaive = tNaive or t
+    print(f"{name:<40}{1e6 * t / N:12.2f} us/event{tNaive / t:8.2f}x")
@@ -0,0 +1,61 @@
+// Per-event latency of the default and of the real-time mode. Most events
+// have a few hundred photons but one in a hundred is a burst with many
+// thousands: in the default mode the amplitude pass is quadratic in the
+// number of hits and the tail explodes, in real-time mode hits are capped
+// and the tail stays close to the cost of a full event.
+#include "SiPM.h"
+#include "SiPMBenchmark.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+using namespace sipm;
+
+int main(int argc, char** argv) {
+  static constexpr uint64_t seed = 1234567890ULL;
+  const uint32_t nEvents = (argc > 1) ? std::stoul(argv[1]) : 20000;
+  const uint32_t maxHits = (argc > 2) ? std::stoul(argv[2]) : 2000;
+
+  SiPMProperties properties;
+  properties.setHitDistribution(SiPMProperties::HitDistribution::kCircle);
+  SiPMScintillatorSource source(300, 20, 0.1, 40);
+  SiPMScintillatorSource burst(20000, 20, 0.1, 40);
+
+  SiPMSensor sensor(properties);
+  SiPMSensor sensorRealTime(properties);
+  sensorRealTime.setRealTime(maxHits);
+
+  std::cout << "Events: " << nEvents << " - max hits in real-time mode: " << maxHits << "\n";
+  SiPMRandom rng;
+  rng.rng().seed(seed);
+  sensor.rng().rng().seed(seed);
+  SiPMLatency latency;
+  for (uint32_t i = 0; i < nEvents; ++i) {
+    const bool isBurst = rng.Rand() < 0.01;
+    sensor.resetState();
+    sensor.addPhotons(isBurst ? burst : source);
+    // Same interval measured by the sensor in real-time mode
+    const auto start = std::chrono::steady_clock::now();
+    sensor.runEvent();
+    sensor.signal();
+    const auto stop = std::chrono::steady_clock::now();
+    latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+  }
+  bench::reportTail("Default (runEvent + signal)", latency);
+
+  rng.rng().seed(seed);
+  sensorRealTime.rng().rng().seed(seed);
+  for (uint32_t i = 0; i < nEvents; ++i) {
+    const bool isBurst = rng.Rand() < 0.01;
+    sensorRealTime.resetState();
+    sensorRealTime.addPhotons(isBurst ? burst : source);
+    sensorRealTime.runEvent();
+  }
+  bench::reportTail("Real-time (runEvent)", sensorRealTime.latency());
+  std::cout << "Tail ratio p999/p50: " << static_cast<double>(latency.quantile(0.999)) / latency.quantile(0.5)
+            << " (default) "
+            << static_cast<double>(sensorRealTime.latency().quantile(0.999)) / sensorRealTime.latency().quantile(0.5)
+            << " (real-time)\n";
+  return 0;
+}
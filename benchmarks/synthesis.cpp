@@ -0,0 +1,45 @@
+// Waveform synthesis on the reference workloads (see SiPMWorkloads.h) with
+// the direct and the recursive algorithm, and with the threshold chosen by
+// the auto-tuner for the properties of each workload. The tuning is cached
+// (see SiPMAutoTuner::cacheFile) so only the first run measures it.
+//   BenchSiPMSynthesis [scale] [workload...]
+#include "SiPM.h"
+#include "SiPMBenchmark.h"
+#include "SiPMWorkloads.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace sipm;
+
+int main(int argc, char** argv) {
+  const double scale = (argc > 1) ? std::stod(argv[1]) : 1;
+  const std::vector<std::string> selected(argv + std::min(argc, 2), argv + argc);
+
+  std::cout << "CPU: " << SiPMAutoTuner::cpuModel() << " - tuning cache: " << SiPMAutoTuner::cacheFile() << "\n";
+  for (const bench::Workload& w : bench::workloads()) {
+    if (!selected.empty() && std::find(selected.begin(), selected.end(), w.name) == selected.end()) {
+      continue;
+    }
+    const uint32_t nEvents = std::max<uint32_t>(w.nEvents * scale, 1);
+    const SiPMTuning tuning = SiPMAutoTuner::tuning(w.properties);
+    SiPMSensor sensor(w.properties);
+
+    sensor.setSynthesis(SiPMSensor::Synthesis::kDirect);
+    bench::WorkloadResult r = bench::runWorkload(w, sensor, nEvents);
+    bench::reportHits(w.name + " direct", r.nEvents, r.nHits, r.seconds);
+
+    sensor.setSynthesis(SiPMSensor::Synthesis::kRecursive);
+    r = bench::runWorkload(w, sensor, nEvents);
+    bench::reportHits(w.name + " recursive", r.nEvents, r.nHits, r.seconds);
+
+    SiPMAutoTuner::apply(tuning, sensor);
+    r = bench::runWorkload(w, sensor, nEvents);
+    bench::reportHits(w.name + " auto (" + std::to_string(tuning.synthesisThreshold) + ")", r.nEvents, r.nHits,
+                      r.seconds);
+  }
+  return 0;
+}
@@ -0,0 +1,51 @@
+// Comparison of time of arrival from the waveform and from order statistics.
+// The analog readout builds a 0.1 ns sampled waveform and uses toa, the
+// timing readout selects the k-th hit time without sorting hits.
+#include "SiPM.h"
+#include "SiPMBenchmark.h"
+
+#include <cstdint>
+#include <iostream>
+
+using namespace sipm;
+
+int main(int argc, char** argv) {
+  static constexpr uint64_t seed = 1234567890ULL;
+  const uint32_t nEvents = (argc > 1) ? std::stoul(argv[1]) : 2000;
+  const double nPhotons = (argc > 2) ? std::stod(argv[2]) : 1000;
+  const uint32_t k = (argc > 3) ? std::stoul(argv[3]) : 5;
+
+  SiPMProperties properties;
+  properties.setSampling(0.1);
+  properties.setSptr(0.1);
+  SiPMScintillatorSource source(nPhotons, 20, 0.1, 40);
+
+  SiPMSensor sensorAnalog(properties);
+  SiPMSensor sensorTiming(properties);
+  sensorTiming.setReadout(SiPMSensor::Readout::kTiming);
+
+  std::cout << "Events: " << nEvents << " - average photons: " << nPhotons << " - k: " << k << "\n";
+  sensorAnalog.rng().rng().seed(seed);
+  const double tAnalog = bench::timeit(
+    [&] {
+      sensorAnalog.resetState();
+      sensorAnalog.addPhotons(source);
+      sensorAnalog.runEvent();
+      sensorAnalog.signal().toa(0, 100, k - 0.5);
+    },
+    nEvents);
+  bench::report("Waveform toa", nEvents, tAnalog);
+
+  sensorTiming.rng().rng().seed(seed);
+  const double tTiming = bench::timeit(
+    [&] {
+      sensorTiming.resetState();
+      sensorTiming.addPhotons(source);
+      sensorTiming.runEvent();
+      sensorTiming.orderStatistic(k);
+    },
+    nEvents);
+  bench::report("Order statistic", nEvents, tTiming);
+  std::cout << "Speedup timing/analog: " << tAnalog / tTiming << "\n";
+  return 0;
+}
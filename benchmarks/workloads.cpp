@@ -0,0 +1,31 @@
+// Reference workloads (see SiPMWorkloads.h). Runs all workloads, or only the
+// ones given on the command line, and reports events/s and ns/hit. The
+// number of events can be scaled to get quicker or more stable results.
+//   BenchSiPMWorkloads [scale] [workload...]
+#include "SiPM.h"
+#include "SiPMBenchmark.h"
+#include "SiPMWorkloads.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace sipm;
+
+int main(int argc, char** argv) {
+  const double scale = (argc > 1) ? std::stod(argv[1]) : 1;
+  const std::vector<std::string> selected(argv + std::min(argc, 2), argv + argc);
+
+  std::cout << "Seed: " << bench::workloadSeed << " - events scaled by " << scale << "\n";
+  for (const bench::Workload& w : bench::workloads()) {
+    if (!selected.empty() && std::find(selected.begin(), selected.end(), w.name) == selected.end()) {
+      continue;
+    }
+    const uint32_t nEvents = std::max<uint32_t>(w.nEvents * scale, 1);
+    const bench::WorkloadResult r = bench::runWorkload(w, nEvents);
+    bench::reportHits(w.name, r.nEvents, r.nHits, r.seconds);
+  }
+  return 0;
+}
@@ -4,12 +4,29 @@
 #define SIPM_VERSION "2.2.1"
 
 #include "SiPMAnalogSignal.h"
+#include "SiPMAsic.h"
+#include "SiPMAutoTuner.h"
+#include "SiPMBatchRunner.h"
+#include "SiPMChannelTable.h"
 #include "SiPMDebugInfo.h"
+#include "SiPMDigitalSignal.h"
+#include "SiPMDistribution.h"
+#include "SiPMExecutor.h"
 #include "SiPMHit.h"
+#include "SiPMLatency.h"
 #include "SiPMMath.h"
+#include "SiPMMetrics.h"
+#include "SiPMNoiseModel.h"
+#include "SiPMOccupancy.h"
+#include "SiPMOutputWriter.h"
+#include "SiPMPhotonSource.h"
+#include "SiPMPileUp.h"
+#include "SiPMPrecision.h"
 #include "SiPMProperties.h"
 #include "SiPMRandom.h"
+#include "SiPMReplay.h"
 #include "SiPMSensor.h"
+#include "SiPMTrigger.h"
 #include "SiPMTypes.h"
 
 #endif
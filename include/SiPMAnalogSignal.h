@@ -3,8 +3,9 @@
  *
  *  @brief Class containing the waveform of the generated signal.
  *
- *  This class stores the generated signal as a SiPMVector<float>
- *  representing the sampled analog waveform.
+ *  This class stores the generated signal as a vector of float
+ *  representing the sampled analog waveform. Its memory is obtained with
+ *  the policy @ref BufferMemory::signal.
  *  It also has some methods that can be used to extract some simple features
  *  from the signal.
  *
@@ -36,7 +37,7 @@ public:
   SiPMAnalogSignal() = default;
 
   SiPMAnalogSignal(const SiPMVector<float>& wav, const double sampling) noexcept
-    : m_Waveform(wav), m_Sampling(sampling){};
+    : m_Waveform(wav.begin(), wav.end()), m_Sampling(sampling){};
 
   inline float& operator[](const uint32_t i) noexcept { return m_Waveform[i]; }
   inline float operator[](const uint32_t i) const noexcept { return m_Waveform[i]; }
@@ -47,8 +48,17 @@ public:
   void clear() {
     m_Waveform.clear();
   }
+  /// @brief Sets the number of points in the waveform (no allocation within capacity)
+  void resize(const uint32_t n) { m_Waveform.resize(n); }
+  /// @brief Copies a waveform in place (no allocation within capacity)
+  void assign(const SiPMVector<float>& wav, const double sampling) {
+    m_Waveform.assign(wav.begin(), wav.end());
+    m_Sampling = sampling;
+  }
   /// @brief Returns the sampling time of the signal in ns
   constexpr double sampling() const { return m_Sampling; }
+  /// @brief Returns pointer to the samples of the waveform
+  const float* data() const { return m_Waveform.data(); }
   /// @brief Returns the waveform in an accessible data structure
   template <typename T = SiPMVector<float>> T waveform() const;
 
@@ -71,7 +81,7 @@ public:
   friend std::ostream& operator<<(std::ostream&, const SiPMAnalogSignal&);
 
 private:
-  SiPMVector<float> m_Waveform;
+  SiPMMappedVector<float, BufferMemory::signal> m_Waveform;
   double m_Sampling = 1;
 } /* SiPMAnalogSignal */;
 } /* namespace sipm */
@@ -0,0 +1,193 @@
+/** @class sipm::SiPMAsic SimSiPM/SimSiPM/SiPMAsic.h SiPMAsic.h
+ *
+ *  @brief Emulation of a front-end ASIC producing one compact record per hit.
+ *
+ *  Models a TOFPET-like readout chip: each channel has a timing threshold,
+ *  used for the timestamp and for the time over threshold, and a higher
+ *  validation threshold that the pulse must cross before going back below
+ *  the timing threshold, otherwise the hit is discarded. The charge is
+ *  integrated in a gate starting at the timestamp. Times are quantized by
+ *  the TDC and charge by the QDC.
+ *
+ *  After a hit the channel can not trigger until the end of the pulse and
+ *  of the integration gate plus a dead time. Each channel has a small number
+ *  of buffers where hits wait to be converted: if all buffers are busy the
+ *  hit is lost.
+ *
+ *  The input can be the waveform of a channel, processed as a stream, or
+ *  directly the hits of a @ref SiPMSensor. In the latter case the pulse is
+ *  evaluated analytically as a sum of exponentials so no waveform is ever
+ *  generated.
+ */
+
+#ifndef SIPM_SIPMASIC_H
+#define SIPM_SIPMASIC_H
+
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "SiPMAnalogSignal.h"
+#include "SiPMProperties.h"
+
+namespace sipm {
+class SiPMSensor;
+
+/** @struct SiPMAsicHit
+ * @brief Record produced by the ASIC for each hit
+ */
+struct SiPMAsicHit {
+  int64_t time;     ///< Timestamp in TDC bins
+  uint32_t tot;     ///< Time over the timing threshold in TDC bins
+  uint16_t charge;  ///< Integrated charge in QDC counts
+  uint16_t channel; ///< Channel of the hit
+};
+
+class SiPMAsic {
+public:
+  /// @brief Constructor of SiPMAsic
+  /** The shape of the pulse and the sampling of waveforms are taken from
+   * the @ref SiPMProperties of the sensors.
+   * @param nChannels Number of channels
+   * @param properties Properties of the sensors
+   */
+  SiPMAsic(const uint32_t, const SiPMProperties&);
+
+  /// @brief Sets timing and validation thresholds (in units of the signal)
+  void setThresholds(const double, const double);
+
+  /// @brief Sets width of a TDC bin in ns
+  void setTdc(const double x) { m_TdcBin = x; }
+
+  /// @brief Sets the charge integration
+  /** @param gate Length of the integration gate in ns
+   * @param lsb Charge corresponding to one QDC count (signal x ns)
+   * @param nBits Number of bits of the QDC (max 16)
+   */
+  void setQdc(const double, const double, const uint32_t = 10);
+
+  /// @brief Sets dead time in ns after the end of each hit
+  void setDeadTime(const double x) { m_DeadTime = x; }
+
+  /// @brief Sets number of buffers of each channel and conversion time in ns
+  void setBuffers(const uint32_t, const double);
+
+  /// @brief Processes hits of the last event of a sensor
+  /** The sensor must use analog readout. Only hits in the signal window are
+   * considered, as for the waveform.
+   * @param sensor Sensor that has run an event
+   * @param channel Channel of the sensor
+   * @param t0 Time of the start of the event in ns
+   */
+  void process(const SiPMSensor&, const uint32_t, const double);
+
+  /// @brief Processes next block of the waveform of a channel
+  /** Blocks of a channel are processed as a continuous stream: the first
+   * sample of a block follows the last sample of the previous one.
+   */
+  void process(const SiPMAnalogSignal&, const uint32_t);
+
+  /// @brief Returns records produced since last call to @ref takeHits
+  const std::vector<SiPMAsicHit>& hits() const { return m_Hits; }
+
+  /// @brief Returns records produced and removes them from the ASIC
+  std::vector<SiPMAsicHit> takeHits();
+
+  /// @brief Returns number of channels
+  uint32_t nChannels() const { return m_Channels.size(); }
+  /// @brief Returns number of records produced since last reset
+  constexpr uint64_t nRecords() const { return m_NRecords; }
+  /// @brief Returns number of pulses not validated since last reset
+  constexpr uint64_t nInvalid() const { return m_NInvalid; }
+  /// @brief Returns number of pulses lost in dead time since last reset
+  constexpr uint64_t nDead() const { return m_NDead; }
+  /// @brief Returns number of hits lost with all buffers busy since last reset
+  constexpr uint64_t nBusy() const { return m_NBusy; }
+
+  /// @brief Resets state of all channels, counters and records
+  void reset();
+
+  friend std::ostream& operator<<(std::ostream&, const SiPMAsic&);
+  std::string toString() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+  }
+
+private:
+  struct Channel {
+    // Discriminator
+    bool above = false;
+    bool lost = false;
+    // Hit being built
+    bool validated = false;
+    bool ended = false;
+    double start = 0;
+    double end = 0;
+    // Waveform input
+    float last = 0;
+    double time = 0;
+    double charge = 0;
+    bool integrating = false;
+    // Dead time and buffers
+    double deadUntil = -1e300;
+    std::vector<double> busyUntil;
+  };
+
+  // Pulse of one photoelectron as a sum of exponentials (see SiPMSensor::signalShape)
+  inline double shape(const double a, const double b, const double c, const double dt) const {
+    return a * std::exp(-dt * m_RateFast) + b * std::exp(-dt * m_RateSlow) - c * std::exp(-dt * m_RateRise);
+  }
+  inline double shapeSlope(const double a, const double b, const double c, const double dt) const {
+    return -a * m_RateFast * std::exp(-dt * m_RateFast) - b * m_RateSlow * std::exp(-dt * m_RateSlow) +
+           c * m_RateRise * std::exp(-dt * m_RateRise);
+  }
+  // Integral of the pulse from dt to dt + gate
+  double shapeIntegral(const double, const double, const double, const double, const double) const;
+  double peakTime(const double, const double, const double, const double) const;
+  double crossing(const double, const double, const double, double, double, const double) const;
+  void processInterval(Channel&, const uint32_t, const uint32_t, const double);
+
+  bool arm(Channel&, const double);
+  void finish(Channel&, const uint32_t);
+
+  double m_RateRise;
+  double m_RateFast;
+  double m_RateSlow;
+  double m_SlowFraction;
+  double m_Peak = 1;
+  double m_Gain;
+  double m_Sampling;
+  double m_SignalLength;
+
+  double m_TimingThreshold = 0.5;
+  double m_ValidationThreshold = 1.5;
+  double m_TdcBin = 0.03;
+  double m_Gate = 100;
+  double m_QdcLsb = 1;
+  uint32_t m_QdcMax = 1023;
+  double m_DeadTime = 0;
+  double m_ConversionTime = 0;
+  uint32_t m_NBuffers = 4;
+
+  // Scratch buffers with times and amplitudes of hits of the current event
+  std::vector<double> m_HitTimes;
+  std::vector<double> m_HitAmplitudes;
+  // Exponential terms of the current pulse (at the start of the interval)
+  double m_A = 0;
+  double m_B = 0;
+  double m_C = 0;
+
+  std::vector<Channel> m_Channels;
+  std::vector<SiPMAsicHit> m_Hits;
+  uint64_t m_NRecords = 0;
+  uint64_t m_NInvalid = 0;
+  uint64_t m_NDead = 0;
+  uint64_t m_NBusy = 0;
+};
+} // namespace sipm
+#endif /* SIPM_SIPMASIC_H */
@@ -0,0 +1,83 @@
+/** @class sipm::SiPMAutoTuner SimSiPM/SimSiPM/SiPMAutoTuner.h SiPMAutoTuner.h
+ *
+ *  @brief Chooses the fastest settings for the machine and the sensor.
+ *
+ *  The fastest algorithm to build the waveform depends on the CPU, on the
+ *  number of samples and on the number of hits of the events (see @ref
+ *  SiPMSensor::Synthesis). The best number of threads and of slices of a
+ *  batch depend on the machine as well. The tuner measures the candidates
+ *  with short benchmarks for a set of @ref SiPMProperties and stores the
+ *  decision in a cache file, keyed by CPU model and properties hash, so
+ *  that later runs on the same machine start with the best settings
+ *  without measuring again.
+ *
+ *  The cache is a text file with one line for each tuning:
+ *  `cpu-hash properties-hash photons threshold threads slices`.
+ */
+
+#ifndef SIPM_SIPMAUTOTUNER_H
+#define SIPM_SIPMAUTOTUNER_H
+
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace sipm {
+class SiPMBatchRunner;
+class SiPMProperties;
+class SiPMSensor;
+
+/** @struct SiPMTuning
+ * @brief Settings chosen by @ref SiPMAutoTuner
+ */
+struct SiPMTuning {
+  uint32_t synthesisThreshold = 0; ///< Hits above which the recursive synthesis is faster (UINT32_MAX if never)
+  uint32_t nThreads = 0;           ///< Threads of a batch runner
+  uint32_t slicesPerThread = 0;    ///< Slices of a batch for each thread
+  bool cached = false;             ///< True if the settings were read from the cache
+
+  friend std::ostream& operator<<(std::ostream&, const SiPMTuning&);
+  std::string toString() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+  }
+};
+
+class SiPMAutoTuner {
+public:
+  /// @brief Returns name of the cache file
+  /** Default is $SIPM_TUNING_FILE if set, otherwise .sipm-tuning in the
+   * home directory (or in the current directory if there is no home).
+   */
+  static std::string& cacheFile();
+  /// @brief Sets name of the cache file (empty to disable the cache)
+  static void setCacheFile(const std::string& x) { cacheFile() = x; }
+
+  /// @brief Returns model of the CPU (from /proc/cpuinfo where available)
+  static std::string cpuModel();
+
+  /// @brief Returns settings for a set of properties
+  /** Settings are read from the cache file. If this machine has never tuned
+   * the properties, the tuning is run and its result appended to the file.
+   * @param properties Properties of the sensor
+   * @param nPhotons Typical number of photons of an event
+   */
+  static SiPMTuning tuning(const SiPMProperties&, const uint32_t nPhotons = 100);
+
+  /// @brief Measures all candidates and returns the fastest settings (cache is not used)
+  static SiPMTuning tune(const SiPMProperties&, const uint32_t nPhotons = 100);
+
+  /// @brief Sets synthesis of a sensor to kAuto with the tuned threshold
+  static void apply(const SiPMTuning&, SiPMSensor&);
+  /// @brief Sets threads, slices and synthesis of the prototype sensor of a runner
+  static void apply(const SiPMTuning&, SiPMBatchRunner&);
+
+private:
+  static uint64_t machineHash();
+  static uint32_t tuneSynthesis(const SiPMProperties&);
+  static void tuneThreads(const SiPMProperties&, const uint32_t, SiPMTuning&);
+};
+} // namespace sipm
+#endif /* SIPM_SIPMAUTOTUNER_H */
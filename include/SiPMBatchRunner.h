@@ -0,0 +1,303 @@
+/** @class sipm::SiPMBatchRunner SimSiPM/SimSiPM/SiPMBatchRunner.h SiPMBatchRunner.h
+ *
+ *  @brief Runs batches of events on multiple threads.
+ *
+ *  This class simulates a batch of events on a @ref SiPMExecutor. Events are
+ *  split in contiguous slices and each task runs its own copy of a prototype
+ *  @ref SiPMSensor. Waveforms of all events are stored in a single contiguous
+ *  matrix (one row per event).
+ *
+ *  By default workers are placed on the machine topology: workers of the
+ *  internal pools are pinned to cpus spread over NUMA nodes and each task
+ *  copies the prototype sensor (signal shape, PDE spectrum and other read-only
+ *  tables) on its worker so that the copy is allocated on the worker's node.
+ *  Each task first-touches its slice of the output matrix, so pages of the
+ *  matrix are placed on the node that writes them. Placement can be disabled
+ *  with @ref setPlacement.
+ *
+ *  The latency of each event is recorded in a @ref SiPMLatency histogram.
+ *  Events slower than a threshold are captured with their input, random
+ *  state and properties hash (see @ref SiPMReplay) so that the tail of the
+ *  distribution can be profiled offline.
+ *
+ *  A memory budget can be set for the whole batch. Outputs that do not fit
+ *  in half of the budget are spilled to a file-backed mapping and the rest
+ *  is shared between the sensors of the tasks, which approximate events
+ *  that would exceed it with a uniform sample of their photoelectrons
+ *  instead of running out of memory.
+ */
+
+#ifndef SIPM_SIPMBATCHRUNNER_H
+#define SIPM_SIPMBATCHRUNNER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "SiPMChannelTable.h"
+#include "SiPMDebugInfo.h"
+#include "SiPMExecutor.h"
+#include "SiPMLatency.h"
+#include "SiPMMetrics.h"
+#include "SiPMOccupancy.h"
+#include "SiPMPhotonSource.h"
+#include "SiPMReplay.h"
+#include "SiPMSensor.h"
+#include "SiPMTypes.h"
+
+namespace sipm {
+class SiPMBatchRunner {
+public:
+  /// @brief SiPMBatchRunner constructor from a prototype sensor
+  /** Each task runs a copy of the sensor. With nThreads = 0 the default
+   * executor is used (@ref SiPMExecutor::defaultExecutor), otherwise the runner
+   * creates its own pool with nThreads workers.
+   * @param sensor Prototype sensor (properties, precision, delay distributions...)
+   * @param nThreads Number of worker threads (0 to use the default executor)
+   */
+  SiPMBatchRunner(const SiPMSensor&, const uint32_t nThreads = 0);
+
+  /// @brief SiPMBatchRunner constructor from a @ref SiPMProperties instance
+  SiPMBatchRunner(const SiPMProperties&, const uint32_t nThreads = 0);
+
+  /// @brief Enables or disables thread pinning and NUMA-aware allocation
+  /** Pinning applies only to pools created by the runner (nThreads > 0).
+   */
+  void setPlacement(const bool x) {
+    m_Placement = x;
+    m_OwnExecutor.reset();
+  }
+  /// @brief Returns true if thread pinning and NUMA-aware allocation are used
+  constexpr bool placement() const { return m_Placement; }
+
+  /// @brief Sets seed used to generate events
+  /** Each event uses its own seed derived from the seed and the event
+   * index, so results do not depend on the number of threads or on the
+   * placement. If no seed is set a random one is used for each batch.
+   */
+  void setSeed(const uint64_t x) {
+    m_Seed = x;
+    m_Seeded = true;
+  }
+
+  /// @brief Sets executor used to run events
+  /** Used to share a pool with the host application. Passing nullptr
+   * restores the default behaviour.
+   */
+  void setExecutor(std::shared_ptr<SiPMExecutor> x) { m_Executor = std::move(x); }
+  /// @brief Returns executor used to run events
+  std::shared_ptr<SiPMExecutor> executor();
+
+  /// @brief Sets per-channel parameters used to run events
+  /** Event i is simulated with the parameters of channel i % table.size(),
+   * so a batch of table.size() events is one readout of the whole array.
+   * Passing nullptr uses the prototype sensor for all events.
+   */
+  void setChannelTable(std::shared_ptr<const SiPMChannelTable> x) { m_Channels = std::move(x); }
+
+  /// @brief Enables accumulation of cell occupancy over all events
+  /** Each task fills its own @ref SiPMOccupancy, merged at the end of the
+   * task. The accumulator is not reset between batches (see @ref
+   * resetOccupancy).
+   */
+  void setOccupancy(const bool x) { m_FillOccupancy = x; }
+  /// @brief Returns occupancy accumulated over all events run so far
+  const SiPMOccupancy& occupancy() const { return m_Occupancy; }
+  /// @brief Sets all counters of the occupancy to zero
+  void resetOccupancy() { m_Occupancy.reset(); }
+
+  /// @brief Returns latency of all events run so far
+  /** Each event is timed from seeding to the copy of its waveform. The
+   * histogram is not reset between batches (see @ref resetLatency).
+   */
+  const SiPMLatency& latency() const { return m_Latency; }
+  /// @brief Removes all latencies recorded
+  void resetLatency() { m_Latency.reset(); }
+
+  /// @brief Sets latency in ns above which an event is captured for replay
+  /** Captured events of the last batch are available with @ref slowEvents
+   * and appended to the replay file, if set. A threshold of 0 disables the
+   * capture.
+   */
+  void setSlowEventThreshold(const uint64_t x) { m_SlowThreshold = x; }
+  /// @brief Returns latency threshold for the capture of slow events
+  constexpr uint64_t slowEventThreshold() const { return m_SlowThreshold; }
+  /// @brief Sets file where slow events are appended at the end of each batch
+  /** An empty name disables the file (events are only kept in memory). The
+   * file can be read back with @ref SiPMReplay::read.
+   */
+  void setReplayFile(const std::string& x) { m_ReplayFile = x; }
+  /// @brief Returns events captured in the last batch, sorted by index
+  const std::vector<SiPMSlowEvent>& slowEvents() const { return m_SlowEvents; }
+
+  /// @brief Sets registry where runtime metrics of the runner are updated
+  /** Counts events, photons, hits by type and waveforms written, the number
+   * of slices waiting for a worker and the time of each stage of the events
+   * (input, event, waveform). The registry can be shared with other
+   * components and exported while batches run. Passing nullptr disables
+   * metrics.
+   */
+  void setMetrics(std::shared_ptr<SiPMMetrics>);
+  /// @brief Returns registry of runtime metrics (nullptr if not set)
+  std::shared_ptr<SiPMMetrics> metrics() const { return m_Metrics; }
+
+  /// @brief Sets maximum number of bytes used by a batch (0 for no budget)
+  /** The budget covers the output (waveforms and MC-Truth) and the sensors
+   * of the running tasks. If the waveforms take more than half of the
+   * budget they are written to a file in @ref MappedMemory::directory
+   * instead of memory. What is left is split between the tasks, each
+   * sensor running with @ref SiPMSensor::setMemoryBudget. Events that do
+   * not fit are approximated with a sample of their photoelectrons (see
+   * @ref nDegradedEvents).
+   */
+  void setMemoryBudget(const size_t x) { m_MemoryBudget = x; }
+  /// @brief Returns memory budget in bytes (0 if not set)
+  constexpr size_t memoryBudget() const { return m_MemoryBudget; }
+  /// @brief Returns memory held by the output of the last batch in bytes
+  /** Waveforms spilled to disk are not counted.
+   */
+  size_t memoryUsage() const;
+  /// @brief Returns largest memory used by output and sensors since last reset
+  size_t peakMemoryUsage() const { return m_PeakMemory.load(std::memory_order_relaxed); }
+  /// @brief Sets peak memory to the memory currently held
+  void resetPeakMemoryUsage() { m_PeakMemory.store(memoryUsage(), std::memory_order_relaxed); }
+  /// @brief Returns true if waveforms of the last batch are stored in a file
+  constexpr bool spilled() const { return m_Spilled; }
+  /// @brief Returns number of events of the last batch approximated to fit the budget
+  uint32_t nDegradedEvents() const { return m_NDegraded.load(std::memory_order_relaxed); }
+
+  /// @brief Sets number of threads of the pool created by the runner (0 to use the default executor)
+  void setNThreads(const uint32_t x) {
+    m_NThreads = x;
+    m_OwnExecutor.reset();
+  }
+  /// @brief Returns number of worker threads
+  uint32_t nThreads() { return executor()->concurrency(); }
+  /// @brief Sets number of slices of a batch for each worker thread
+  /** More slices balance the load better between workers, fewer slices
+   * copy the prototype sensor fewer times. Default is 4.
+   */
+  void setSlicesPerThread(const uint32_t x) { m_SlicesPerThread = std::max<uint32_t>(x, 1); }
+  /// @brief Returns number of slices of a batch for each worker thread
+  constexpr uint32_t slicesPerThread() const { return m_SlicesPerThread; }
+  /// @brief Returns prototype sensor copied by each task
+  /** Changes (e.g. precision or synthesis) apply from the next batch.
+   */
+  SiPMSensor& sensor() { return m_Sensor; }
+
+  /// @brief Enables tuning of synthesis and threads before the first batch
+  /** Settings are taken from @ref SiPMAutoTuner for the properties of the
+   * prototype sensor, running the tuning (and caching its result) only if
+   * this machine has never tuned them. Tuning is done again if the
+   * properties change. An explicit executor is not replaced.
+   * @param x Enables or disables tuning
+   * @param nPhotons Typical number of photons of an event
+   */
+  void setAutoTune(const bool x, const uint32_t nPhotons = 100) {
+    m_AutoTune = x;
+    m_AutoTunePhotons = nPhotons;
+    m_TunedHash = 0;
+  }
+  /// @brief Returns true if settings are tuned before the first batch
+  constexpr bool autoTune() const { return m_AutoTune; }
+  /// @brief Returns topology used to place workers
+  const SiPMTopology& topology() const { return m_Topology; }
+
+  /// @brief Runs one event for each list of photon times
+  void run(const std::vector<std::vector<double>>&);
+
+  /// @brief Runs nEvents events with photons generated by a @ref SiPMPhotonSource
+  void run(const SiPMPhotonSource&, const uint32_t);
+
+  /// @brief Returns number of events in the last batch
+  constexpr uint32_t nEvents() const { return m_NEvents; }
+  /// @brief Returns number of samples of each waveform
+  constexpr uint32_t nSignalPoints() const { return m_NSignalPoints; }
+
+  /// @brief Returns pointer to the waveform of an event
+  const float* waveform(const uint32_t i) const { return m_Waveforms.get() + static_cast<size_t>(i) * m_NSignalPoints; }
+  /// @brief Returns waveform of an event as a @ref SiPMAnalogSignal
+  SiPMAnalogSignal signal(const uint32_t) const;
+  /// @brief Returns MC-Truth of an event
+  SiPMDebugInfo debug(const uint32_t) const;
+
+  friend std::ostream& operator<<(std::ostream&, const SiPMBatchRunner&);
+  std::string toString() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+  }
+
+private:
+  friend class SiPMAutoTuner;
+
+  // Waveform matrix is allocated without being touched (first-touch by workers)
+  struct WaveformDeleter {
+    size_t size;
+    MemoryPolicy policy;
+    void operator()(float* p) const { MappedMemory::deallocate(p, size, policy); }
+  };
+
+  // Ids of the metrics updated by the runner
+  struct MetricIds {
+    uint32_t events;
+    uint32_t photons;
+    uint32_t hits[5];
+    uint32_t waveforms;
+    uint32_t pendingSlices;
+    uint32_t memory;
+    uint32_t stages[3];
+  };
+
+  template <class F> void dispatch(const uint32_t, F&&);
+  void allocate(const uint32_t);
+  void applyAutoTune();
+  void updatePeakMemory(const size_t);
+
+  SiPMSensor m_Sensor;
+  SiPMTopology m_Topology;
+  uint32_t m_NThreads;
+  bool m_Placement = true;
+  std::shared_ptr<SiPMExecutor> m_Executor;
+  std::shared_ptr<SiPMExecutor> m_OwnExecutor;
+  std::shared_ptr<const SiPMChannelTable> m_Channels;
+  bool m_FillOccupancy = false;
+  SiPMOccupancy m_Occupancy;
+  SiPMLatency m_Latency;
+  uint64_t m_SlowThreshold = 0;
+  std::string m_ReplayFile;
+  std::vector<SiPMSlowEvent> m_SlowEvents;
+  std::shared_ptr<SiPMMetrics> m_Metrics;
+  MetricIds m_MetricIds;
+  // Results of tasks are merged under this lock
+  std::mutex m_MergeMutex;
+  uint64_t m_Seed = 0;
+  bool m_Seeded = false;
+  uint32_t m_SlicesPerThread = 4;
+  bool m_AutoTune = false;
+  uint32_t m_AutoTunePhotons = 100;
+  // Hash of the properties the settings were tuned for (0 if not tuned)
+  uint64_t m_TunedHash = 0;
+
+  size_t m_MemoryBudget = 0;
+  bool m_Spilled = false;
+  // Memory held by sensors of running tasks
+  std::atomic<size_t> m_SensorMemory{0};
+  std::atomic<size_t> m_PeakMemory{0};
+  std::atomic<uint32_t> m_NDegraded{0};
+
+  uint32_t m_NEvents = 0;
+  uint32_t m_NSignalPoints = 0;
+  std::unique_ptr<float[], WaveformDeleter> m_Waveforms{nullptr, WaveformDeleter{0, MemoryPolicy::kTransparentHugePages}};
+  // MC-Truth counters of each event (same order as SiPMDebugInfo)
+  static constexpr uint32_t nDebugFields = 6;
+  std::vector<uint32_t> m_Debug;
+};
+} // namespace sipm
+#endif /* SIPM_SIPMBATCHRUNNER_H */
@@ -0,0 +1,118 @@
+/** @class sipm::SiPMChannelTable SimSiPM/SimSiPM/SiPMChannelTable.h SiPMChannelTable.h
+ *
+ *  @brief Per-channel calibration parameters of a large array of SiPMs.
+ *
+ *  In arrays with many channels each SiPM has its own calibrated gain, dark
+ *  count rate, crosstalk, afterpulse and breakdown voltage. Instead of storing
+ *  one @ref SiPMProperties for each channel, parameters that change from
+ *  channel to channel are stored in a struct-of-arrays table and override a
+ *  base SiPMProperties (see SiPMSensor::setChannel). Reading the parameters
+ *  of a channel is a set of indexed loads.
+ *
+ *  Tables can be saved to a binary calibration file and loaded back by
+ *  mapping the file in memory, so that tables of millions of channels can be
+ *  opened without reading or copying them.
+ *
+ *  The breakdown voltage offset of a channel changes its overvoltage and so
+ *  its gain: @f[ G_{eff} = G \cdot \frac{V_{ov} - \Delta V_{bd}}{V_{ov}} @f]
+ *  where @f$ V_{ov} @f$ is the nominal overvoltage of the table.
+ */
+
+#ifndef SIPM_SIPMCHANNELTABLE_H
+#define SIPM_SIPMCHANNELTABLE_H
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "SiPMProperties.h"
+#include "SiPMTypes.h"
+
+namespace sipm {
+class SiPMChannelTable {
+public:
+  /** @enum Column
+   * @brief Parameters stored for each channel
+   */
+  enum Column : uint32_t {
+    kGain,            ///< Relative gain (as SiPMProperties::gain)
+    kDcr,             ///< Dark counts rate in Hz
+    kXt,              ///< Optical crosstalk probability
+    kAp,              ///< Afterpulse probability
+    kBreakdownOffset, ///< Offset of breakdown voltage from nominal in V
+    nColumns
+  };
+
+  SiPMChannelTable() = default;
+
+  /// @brief Constructs a table of nChannels with values taken from a @ref SiPMProperties
+  SiPMChannelTable(const uint32_t, const SiPMProperties&);
+
+  SiPMChannelTable(SiPMChannelTable&&) noexcept;
+  SiPMChannelTable& operator=(SiPMChannelTable&&) noexcept;
+  SiPMChannelTable(const SiPMChannelTable&) = delete;
+  SiPMChannelTable& operator=(const SiPMChannelTable&) = delete;
+  ~SiPMChannelTable();
+
+  /// @brief Opens a calibration file mapping it in memory
+  static SiPMChannelTable open(const std::string&);
+
+  /// @brief Writes the table to a calibration file
+  bool write(const std::string&) const;
+
+  /// @brief Returns number of channels in the table
+  constexpr uint32_t size() const { return m_Size; }
+  /// @brief Returns true if the table is a read-only mapping of a file
+  bool isMapped() const { return m_Map != nullptr; }
+
+  /// @brief Returns nominal overvoltage in V
+  constexpr double overvoltage() const { return m_Overvoltage; }
+  /// @brief Sets nominal overvoltage in V (used with breakdown offsets)
+  void setOvervoltage(const double x) { m_Overvoltage = x; }
+
+  /// @brief Returns a column of the table
+  const float* column(const Column c) const { return m_Columns[c]; }
+  /// @brief Returns a column of the table for writing (nullptr if mapped)
+  float* column(const Column c) { return isMapped() ? nullptr : const_cast<float*>(m_Columns[c]); }
+
+  float gain(const uint32_t ch) const { return m_Columns[kGain][ch]; }
+  float dcr(const uint32_t ch) const { return m_Columns[kDcr][ch]; }
+  float xt(const uint32_t ch) const { return m_Columns[kXt][ch]; }
+  float ap(const uint32_t ch) const { return m_Columns[kAp][ch]; }
+  float breakdownOffset(const uint32_t ch) const { return m_Columns[kBreakdownOffset][ch]; }
+
+  /// @brief Returns gain of a channel corrected for its breakdown offset
+  inline double effectiveGain(const uint32_t ch) const {
+    const double g = m_Columns[kGain][ch];
+    return (m_Overvoltage > 0) ? g * (1 - m_Columns[kBreakdownOffset][ch] / m_Overvoltage) : g;
+  }
+
+  /// @brief Sets all parameters of a channel
+  void set(const uint32_t, const double gain, const double dcr, const double xt, const double ap,
+           const double breakdownOffset = 0);
+
+  friend std::ostream& operator<<(std::ostream&, const SiPMChannelTable&);
+  std::string toString() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+  }
+
+private:
+  void reset();
+  void setColumns(const float*);
+  static size_t columnStride(const uint32_t);
+
+  uint32_t m_Size = 0;
+  double m_Overvoltage = 0;
+  const float* m_Columns[nColumns] = {nullptr};
+
+  // Storage of the table: owned or mapped from a file
+  SiPMVector<float> m_Data;
+  void* m_Map = nullptr;
+  size_t m_MapSize = 0;
+};
+} // namespace sipm
+#endif /* SIPM_SIPMCHANNELTABLE_H */
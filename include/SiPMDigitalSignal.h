@@ -0,0 +1,112 @@
+/** @class sipm::SiPMDigitalSignal SimSiPM/SimSiPM/SiPMDigitalSignal.h
+ * SiPMDigitalSignal.h
+ *
+ *  @brief Class containing the digital output of a SiPM event.
+ *
+ *  In digital SiPMs (and in photon-counting studies) each cell is read as a
+ *  binary switch: the output of an event is the list of fired cells with
+ *  their timestamps, not a waveform. This class stores timestamps and cell
+ *  indices of fired cells in increasing time order. Cells fired while still
+ *  dead from a previous discharge (see SiPMProperties::deadTime) are not
+ *  included.
+ *
+ *  Methods similar to the ones of @ref SiPMAnalogSignal are provided to
+ *  extract simple features: number of fired cells, time of first fired cell
+ *  and trigger/validation logic applied in a window or frame by frame.
+ */
+
+#ifndef SIPM_SIPMDIGITALSIGNAL_H
+#define SIPM_SIPMDIGITALSIGNAL_H
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "SiPMTypes.h"
+
+namespace sipm {
+/** @struct SiPMDigitalFrame
+ * @brief Digital output of a frame
+ *
+ * A frame is triggered when the number of fired cells reaches the trigger
+ * threshold. The trigger is validated if enough cells fire in the
+ * validation window starting at the trigger time and, if validated, cells
+ * fired in the integration window are counted.
+ */
+struct SiPMDigitalFrame {
+  uint32_t count = 0;      ///< Number of fired cells in the frame
+  double firstTime = -1;   ///< Time of first fired cell in ns (-1 if none)
+  double triggerTime = -1; ///< Time of trigger in ns (-1 if not triggered)
+  bool validated = false;  ///< True if the trigger has been validated
+  uint32_t integral = 0;   ///< Number of fired cells in the integration window (0 if not validated)
+};
+
+class SiPMDigitalSignal {
+public:
+  SiPMDigitalSignal() = default;
+
+  /// @brief Constructor of SiPMDigitalSignal
+  /** @param times Timestamps of fired cells in ns (increasing order)
+   * @param cells Indices of fired cells (as row << 16 | col)
+   * @param length Length of the event in ns
+   */
+  SiPMDigitalSignal(SiPMVector<float> times, SiPMVector<uint32_t> cells, const double length) noexcept
+    : m_Times(std::move(times)), m_Cells(std::move(cells)), m_Length(length) {}
+
+  /// @brief Returns number of fired cells
+  inline uint32_t size() const { return m_Times.size(); }
+  /// @brief Resets the class to its initial state
+  void clear() {
+    m_Times.clear();
+    m_Cells.clear();
+  }
+  /// @brief Returns length of the event in ns
+  constexpr double length() const { return m_Length; }
+
+  /// @brief Returns timestamp of the i-th fired cell in ns
+  inline float time(const uint32_t i) const { return m_Times[i]; }
+  /// @brief Returns row of the i-th fired cell
+  inline uint32_t row(const uint32_t i) const { return m_Cells[i] >> 16; }
+  /// @brief Returns column of the i-th fired cell
+  inline uint32_t col(const uint32_t i) const { return m_Cells[i] & 0xffff; }
+
+  /// @brief Returns timestamps of fired cells
+  template <typename T = SiPMVector<float>> T times() const;
+  /// @brief Returns indices of fired cells (as row << 16 | col)
+  const SiPMVector<uint32_t>& cells() const { return m_Cells; }
+
+  /// @brief Returns number of cells fired in a time window
+  uint32_t count(const double, const double) const;
+  /// @brief Returns time of first cell fired in a time window
+  double firstTime(const double, const double) const;
+  /// @brief Returns time at which a number of cells have fired in a time window
+  double triggerTime(const double, const double, const uint32_t) const;
+
+  /// @brief Applies trigger and validation logic to a time window
+  SiPMDigitalFrame frame(const double, const double, const uint32_t = 1, const double = 0, const uint32_t = 0,
+                         const double = 0) const;
+  /// @brief Splits the event in frames and applies trigger and validation logic to each one
+  std::vector<SiPMDigitalFrame> frames(const double, const uint32_t = 1, const double = 0, const uint32_t = 0,
+                                       const double = 0) const;
+
+  std::string toString() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+  }
+  friend std::ostream& operator<<(std::ostream&, const SiPMDigitalSignal&);
+
+private:
+  // Returns index of first cell fired at time >= t
+  uint32_t lowerBound(const double) const;
+
+  SiPMVector<float> m_Times;
+  SiPMVector<uint32_t> m_Cells;
+  double m_Length = 0;
+};
+} /* namespace sipm */
+#endif /* SIPM_SIPMDIGITALSIGNAL_H */
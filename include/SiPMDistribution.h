@@ -0,0 +1,103 @@
+/** @class sipm::SiPMDistribution SimSiPM/SimSiPM/SiPMDistribution.h SiPMDistribution.h
+ *
+ *  @brief Random sampler for arbitrary tabulated distributions.
+ *
+ *  This class is used to sample random values from a distribution given as a
+ *  table of values (measured spectra, histograms, time profiles...).
+ *  The distribution is built once and then sampled in O(1) using the alias
+ *  method of Walker (Vose implementation) to choose a bin and the analytical
+ *  inversion of the CDF inside the bin.
+ *
+ *  A tabulated PDF is considered piecewise linear between points while a
+ *  histogram is considered piecewise constant inside each bin.
+ */
+
+#ifndef SIPM_SIPMDISTRIBUTION_H
+#define SIPM_SIPMDISTRIBUTION_H
+
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "SiPMRandom.h"
+#include "SiPMTypes.h"
+
+namespace sipm {
+class SiPMDistribution {
+public:
+  SiPMDistribution() = default;
+
+  /// @brief Builds a distribution from a tabulated PDF
+  static SiPMDistribution fromPdf(const std::vector<double>&, const std::vector<double>&);
+
+  /// @brief Builds a distribution from a histogram
+  static SiPMDistribution fromHistogram(const std::vector<double>&, const std::vector<double>&);
+
+  /// @brief Returns number of bins in the distribution
+  inline uint32_t size() const { return m_Prob.size(); }
+  /// @brief Returns minimum value that can be sampled
+  double min() const { return m_X0.empty() ? 0 : m_X0.front(); }
+  /// @brief Returns maximum value that can be sampled
+  double max() const { return m_X0.empty() ? 0 : m_X0.back() + m_Dx.back(); }
+  /// @brief Returns mean value of the distribution
+  constexpr double mean() const { return m_Mean; }
+
+  /// @brief Samples a value from the distribution
+  inline double sample(SiPMRandom&) const noexcept;
+  /// @brief Samples n values from the distribution in a buffer
+  void sample(SiPMRandom&, double*, const uint32_t) const noexcept;
+  /// @brief Vector version of @ref sample
+  template <typename T = std::vector<double>> T sample(SiPMRandom&, const uint32_t) const;
+
+  /// @brief Returns a hash of the tabulated distribution
+  uint64_t hash() const;
+
+  friend std::ostream& operator<<(std::ostream&, const SiPMDistribution&);
+  std::string toString() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+  }
+
+private:
+  void build(const std::vector<double>&);
+  inline double invert(const uint32_t, const double) const noexcept;
+
+  // Alias table
+  SiPMVector<double> m_Prob;
+  SiPMVector<uint32_t> m_Alias;
+  // Bins description: start, width and density at both edges
+  SiPMVector<double> m_X0;
+  SiPMVector<double> m_Dx;
+  SiPMVector<double> m_Y0;
+  SiPMVector<double> m_Y1;
+  double m_Mean = 0;
+};
+
+/**
+ * Inverse of the CDF of a linear density inside a bin. The expression is
+ * written in a form that is numerically stable also for flat bins (y0 = y1)
+ * where it reduces to x0 + u * dx.
+ */
+inline double SiPMDistribution::invert(const uint32_t i, const double u) const noexcept {
+  const double y0 = m_Y0[i];
+  const double y1 = m_Y1[i];
+  const double d = y0 + std::sqrt(y0 * y0 + u * (y1 * y1 - y0 * y0));
+  // Avoid 0/0 for bins starting with null density
+  const double t = (d > 0) ? u * (y0 + y1) / d : 0;
+  return m_X0[i] + t * m_Dx[i];
+}
+
+inline double SiPMDistribution::sample(SiPMRandom& rng) const noexcept {
+  const double u = rng.Rand() * m_Prob.size();
+  uint32_t i = static_cast<uint32_t>(u);
+  if (u - i >= m_Prob[i]) {
+    i = m_Alias[i];
+  }
+  return invert(i, rng.Rand());
+}
+} // namespace sipm
+#endif /* SIPM_SIPMDISTRIBUTION_H */
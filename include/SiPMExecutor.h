@@ -0,0 +1,168 @@
+/** @class sipm::SiPMExecutor SimSiPM/SimSiPM/SiPMExecutor.h SiPMExecutor.h
+ *
+ *  @brief Interface used by all parallel features of SimSiPM.
+ *
+ *  Every parallel loop in SimSiPM (e.g. @ref SiPMBatchRunner) is executed by
+ *  a SiPMExecutor. By default an internal work-stealing pool is used
+ *  (@ref SiPMThreadPool). Applications that already have a thread pool can
+ *  wrap it in a @ref SiPMHostExecutor and install it with
+ *  @ref SiPMExecutor::setDefaultExecutor, so that a single scheduler controls
+ *  all the cores and SimSiPM does not spawn any thread.
+ */
+
+#ifndef SIPM_SIPMEXECUTOR_H
+#define SIPM_SIPMEXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sipm {
+/** @struct SiPMTopology
+ * @brief Description of cpus and NUMA nodes of the machine
+ *
+ * On Linux the topology is read from /sys/devices/system/node. On other
+ * systems, or if the information is not available, a single node with all
+ * the cpus is assumed.
+ */
+struct SiPMTopology {
+  /// @brief List of cpus in each node
+  std::vector<std::vector<uint32_t>> nodes;
+
+  /// @brief Detects topology of the current machine
+  static SiPMTopology detect();
+
+  /// @brief Returns number of NUMA nodes
+  uint32_t nNodes() const { return nodes.size(); }
+  /// @brief Returns total number of cpus
+  uint32_t nCpus() const;
+  /// @brief Returns cpu for the i-th worker spreading workers over nodes
+  uint32_t cpu(const uint32_t) const;
+
+  /// @brief Pins the calling thread to a cpu
+  static void pin(const uint32_t);
+
+  friend std::ostream& operator<<(std::ostream&, const SiPMTopology&);
+  std::string toString() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+  }
+};
+
+class SiPMExecutor {
+public:
+  virtual ~SiPMExecutor() = default;
+
+  /// @brief Returns number of tasks that can run concurrently
+  virtual uint32_t concurrency() const = 0;
+
+  /// @brief Runs f(i) for each i in [0, n) and waits for all tasks to finish
+  /** Tasks can run in any order and on any thread of the executor. If tasks
+   * throw, the first exception is rethrown in the caller after all tasks
+   * have finished.
+   */
+  virtual void parallelFor(const uint32_t, const std::function<void(uint32_t)>&) = 0;
+
+  /// @brief Returns the executor used when none is specified
+  /** If no executor has been set a @ref SiPMThreadPool with one worker for
+   * each cpu is created at first use. Its workers are not pinned: to pin them
+   * install a pool created with pin = true.
+   */
+  static std::shared_ptr<SiPMExecutor> defaultExecutor();
+
+  /// @brief Sets the executor used when none is specified
+  /** Passing nullptr restores the internal pool.
+   */
+  static void setDefaultExecutor(std::shared_ptr<SiPMExecutor>);
+
+private:
+  static std::mutex& defaultMutex();
+  static std::shared_ptr<SiPMExecutor>& defaultInstance();
+};
+
+/** @class sipm::SiPMThreadPool
+ * @brief Internal work-stealing thread pool
+ *
+ * Each worker owns a queue of tasks. Tasks of a parallel loop are spread over
+ * all queues; workers run tasks from the back of their own queue and, when it
+ * is empty, steal tasks from the front of the other queues. A parallel loop
+ * started from inside a task is run also by the calling worker, so nested
+ * loops do not deadlock.
+ */
+class SiPMThreadPool : public SiPMExecutor {
+public:
+  /// @brief Constructor of SiPMThreadPool
+  /// @param nThreads Number of worker threads (0 to use all cpus)
+  /// @param pin Pins each worker to a cpu spreading workers over NUMA nodes
+  SiPMThreadPool(const uint32_t nThreads = 0, const bool pin = false);
+  ~SiPMThreadPool();
+
+  SiPMThreadPool(const SiPMThreadPool&) = delete;
+  SiPMThreadPool& operator=(const SiPMThreadPool&) = delete;
+
+  uint32_t concurrency() const override { return m_Threads.size(); }
+  void parallelFor(const uint32_t, const std::function<void(uint32_t)>&) override;
+
+  /// @brief Returns true if workers are pinned to cpus
+  constexpr bool pinned() const { return m_Pinned; }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void workerLoop(const uint32_t);
+  bool runTask(const uint32_t);
+
+  std::vector<std::unique_ptr<Queue>> m_Queues;
+  std::vector<std::thread> m_Threads;
+  std::mutex m_Mutex;
+  std::condition_variable m_Cv;
+  uint32_t m_Pending = 0;
+  bool m_Stop = false;
+  bool m_Pinned;
+};
+
+/** @class sipm::SiPMHostExecutor
+ * @brief Adapter for a thread pool provided by the host application
+ *
+ * The host provides a function that submits a task to its own pool. Each
+ * iteration of a parallel loop is submitted as a task and the calling thread
+ * waits for all of them. The calling thread must not be the only free thread
+ * of the host pool.
+ * @code
+ * auto exec = std::make_shared<SiPMHostExecutor>(
+ *   [&pool](std::function<void()> task) { pool.enqueue(std::move(task)); }, pool.size());
+ * SiPMExecutor::setDefaultExecutor(exec);
+ * @endcode
+ */
+class SiPMHostExecutor : public SiPMExecutor {
+public:
+  using Submit = std::function<void(std::function<void()>)>;
+
+  /// @brief Constructor of SiPMHostExecutor
+  /// @param submit Function used to submit a task to the host pool
+  /// @param concurrency Number of threads of the host pool
+  SiPMHostExecutor(Submit submit, const uint32_t concurrency)
+    : m_Submit(std::move(submit)), m_Concurrency(concurrency > 0 ? concurrency : 1) {}
+
+  uint32_t concurrency() const override { return m_Concurrency; }
+  void parallelFor(const uint32_t, const std::function<void(uint32_t)>&) override;
+
+private:
+  Submit m_Submit;
+  uint32_t m_Concurrency;
+};
+} // namespace sipm
+#endif /* SIPM_SIPMEXECUTOR_H */
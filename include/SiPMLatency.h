@@ -0,0 +1,94 @@
+/** @class sipm::SiPMLatency SimSiPM/SimSiPM/SiPMLatency.h SiPMLatency.h
+ *
+ *  @brief Histogram of latencies with constant relative resolution.
+ *
+ *  Latencies in ns are counted in log-linear buckets: each power of two is
+ *  split in 32 buckets, so quantiles are within about 3% of the true value
+ *  for any latency from a few ns to hours. Buckets are a fixed array, so
+ *  recording a value does not allocate and takes constant time, as needed to
+ *  measure the latency of real-time loops without perturbing them.
+ */
+
+#ifndef SIPM_SIPMLATENCY_H
+#define SIPM_SIPMLATENCY_H
+
+#include <array>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+
+namespace sipm {
+class SiPMLatency {
+public:
+  /// @brief Number of buckets in each power of two
+  static constexpr uint32_t nSubBuckets = 32;
+  /// @brief Total number of buckets
+  static constexpr uint32_t nBuckets = 60 * nSubBuckets;
+
+  /// @brief Records a latency in ns
+  inline void record(const uint64_t ns) noexcept {
+    ++m_Counts[bucket(ns)];
+    ++m_Count;
+    m_Sum += ns;
+    m_Min = (ns < m_Min) ? ns : m_Min;
+    m_Max = (ns > m_Max) ? ns : m_Max;
+  }
+
+  /// @brief Adds counts of another histogram
+  void merge(const SiPMLatency&);
+
+  /// @brief Removes all recorded values
+  void reset();
+
+  /// @brief Returns number of recorded values
+  constexpr uint64_t count() const { return m_Count; }
+  /// @brief Returns minimum recorded latency in ns
+  constexpr uint64_t min() const { return m_Count ? m_Min : 0; }
+  /// @brief Returns maximum recorded latency in ns
+  constexpr uint64_t max() const { return m_Max; }
+  /// @brief Returns mean latency in ns
+  double mean() const { return m_Count ? static_cast<double>(m_Sum) / m_Count : 0; }
+
+  /// @brief Returns latency in ns below which a fraction q of the values lie
+  /** The upper edge of the bucket containing the quantile is returned, so
+   * quantiles are never underestimated.
+   */
+  uint64_t quantile(const double) const;
+
+  friend std::ostream& operator<<(std::ostream&, const SiPMLatency&);
+  std::string toString() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+  }
+
+private:
+  // Values below 2 * nSubBuckets have their own bucket, above each power of
+  // two is split in nSubBuckets
+  static constexpr uint32_t bucket(const uint64_t v) noexcept {
+    if (v < 2 * nSubBuckets) {
+      return v;
+    }
+    const uint32_t shift = 63 - __builtin_clzll(v) - 5;
+    return shift * nSubBuckets + static_cast<uint32_t>(v >> shift);
+  }
+  static constexpr uint64_t upperEdge(const uint32_t idx) noexcept {
+    if (idx < 2 * nSubBuckets) {
+      return idx;
+    }
+    const uint32_t shift = idx / nSubBuckets - 1;
+    const uint64_t sub = idx % nSubBuckets + nSubBuckets;
+    return ((sub + 1) << shift) - 1;
+  }
+
+  std::array<uint64_t, nBuckets> m_Counts = {};
+  uint64_t m_Count = 0;
+  uint64_t m_Sum = 0;
+  uint64_t m_Min = std::numeric_limits<uint64_t>::max();
+  uint64_t m_Max = 0;
+};
+} // namespace sipm
+#endif /* SIPM_SIPMLATENCY_H */
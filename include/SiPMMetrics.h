@@ -0,0 +1,228 @@
+/** @class sipm::SiPMMetrics SimSiPM/SimSiPM/SiPMMetrics.h SiPMMetrics.h
+ *
+ *  @brief Registry of runtime metrics (counters, gauges and histograms).
+ *
+ *  Metrics are registered by name and updated through the returned id.
+ *  Counters and histograms are updated without locks: each thread writes
+ *  its own shard of values and shards are summed only when the metrics are
+ *  read or exported. Gauges (e.g. queue depths) hold a single value shared
+ *  by all threads.
+ *
+ *  Names follow the Prometheus conventions and may include labels, e.g.
+ *  `sipm_hits_total{type="dcr"}`. The registry can be written in the
+ *  Prometheus text format or in JSON, on demand or periodically by a
+ *  background thread. Files are written to a temporary file and renamed,
+ *  so readers never see a partial file.
+ */
+
+#ifndef SIPM_SIPMMETRICS_H
+#define SIPM_SIPMMETRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sipm {
+class SiPMMetrics {
+public:
+  /** @enum Format
+   * @brief Format of exported metrics
+   */
+  enum class Format {
+    kPrometheus, ///< Prometheus text exposition format
+    kJson        ///< JSON object with one entry per metric
+  };
+
+  /// @brief Maximum number of metrics in a registry
+  static constexpr uint32_t maxMetrics = 512;
+  /// @brief Maximum number of values (one per counter, buckets + 1 per histogram)
+  static constexpr uint32_t maxSlots = 4096;
+  /// @brief Id returned when a metric can not be registered (updates are ignored)
+  static constexpr uint32_t invalidId = 0xffffffff;
+
+  SiPMMetrics();
+  ~SiPMMetrics();
+  SiPMMetrics(const SiPMMetrics&) = delete;
+  SiPMMetrics& operator=(const SiPMMetrics&) = delete;
+
+  /// @brief Registers a counter and returns its id
+  /** If a counter with the same name exists its id is returned. If the
+   * registry is full @ref invalidId is returned.
+   */
+  uint32_t counter(const std::string&, const std::string& help = "");
+  /// @brief Registers a gauge and returns its id
+  uint32_t gauge(const std::string&, const std::string& help = "");
+  /// @brief Registers a histogram and returns its id
+  /** @param name Name of the histogram
+   * @param bounds Upper bounds of the buckets in increasing order (an
+   * overflow bucket is added)
+   */
+  uint32_t histogram(const std::string&, const std::vector<double>&, const std::string& help = "");
+
+  /// @brief Returns n bounds starting from start, each factor times the previous one
+  static std::vector<double> exponentialBounds(const double, const double, const uint32_t);
+
+  /// @brief Adds n to a counter
+  inline void add(const uint32_t id, const uint64_t n = 1) {
+    if (!isValid(id)) {
+      return;
+    }
+    std::atomic<uint64_t>& v = shard().values[m_Metrics[id].slot];
+    // Only this thread writes its shard: no atomic read-modify-write needed
+    v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+  /// @brief Adds a value to a histogram
+  void observe(const uint32_t, const double);
+  /// @brief Sets value of a gauge
+  void set(const uint32_t id, const double x) {
+    if (!isValid(id)) {
+      return;
+    }
+    m_Gauges[m_Metrics[id].slot].store(toBits(x), std::memory_order_relaxed);
+  }
+  /// @brief Adds x (can be negative) to a gauge
+  void addGauge(const uint32_t, const double);
+
+  /// @brief Returns value of a counter summed over all threads
+  uint64_t value(const uint32_t) const;
+  /// @brief Returns value of a gauge
+  double gaugeValue(const uint32_t id) const {
+    if (!isValid(id)) {
+      return 0;
+    }
+    return fromBits(m_Gauges[m_Metrics[id].slot].load(std::memory_order_relaxed));
+  }
+  /// @brief Returns counts in each bucket of a histogram (last is overflow)
+  std::vector<uint64_t> bucketCounts(const uint32_t) const;
+  /// @brief Returns number of values added to a histogram
+  uint64_t count(const uint32_t) const;
+  /// @brief Returns sum of values added to a histogram
+  double sum(const uint32_t) const;
+  /// @brief Returns number of registered metrics
+  uint32_t nMetrics() const { return m_NMetrics.load(std::memory_order_acquire); }
+  /// @brief Returns id of a metric or -1 if it is not registered
+  int32_t find(const std::string&) const;
+
+  /// @brief Writes all metrics in the Prometheus text format
+  void writePrometheus(std::ostream&) const;
+  /// @brief Writes all metrics as a JSON object
+  void writeJson(std::ostream&) const;
+  /// @brief Writes all metrics to a file (through a temporary file)
+  bool write(const std::string&, const Format = Format::kPrometheus) const;
+
+  /// @brief Starts a thread writing metrics to a file periodically
+  /** @param fname Name of the file
+   * @param period Time between two writes in seconds
+   * @param format Format of the file
+   */
+  void startExport(const std::string&, const double, const Format = Format::kPrometheus);
+  /// @brief Stops the export thread (metrics are written a last time)
+  void stopExport();
+
+  /// @brief Adds time elapsed in seconds to a histogram when destroyed
+  class ScopedTimer {
+  public:
+    ScopedTimer(SiPMMetrics& metrics, const uint32_t id)
+      : m_Metrics(metrics), m_Id(id), m_Start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+      m_Metrics.observe(m_Id, std::chrono::duration<double>(std::chrono::steady_clock::now() - m_Start).count());
+    }
+
+  private:
+    SiPMMetrics& m_Metrics;
+    uint32_t m_Id;
+    std::chrono::steady_clock::time_point m_Start;
+  };
+
+  friend std::ostream& operator<<(std::ostream&, const SiPMMetrics&);
+  std::string toString() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+  }
+
+private:
+  enum class Type { kCounter, kGauge, kHistogram };
+  struct Metric {
+    std::string name;
+    std::string help;
+    Type type = Type::kGauge;
+    uint32_t slot = 0;
+    std::vector<double> bounds;
+  };
+  struct Shard {
+    std::atomic<uint64_t> values[maxSlots];
+    Shard() {
+      for (auto& v : values) {
+        v.store(0, std::memory_order_relaxed);
+      }
+    }
+  };
+
+  static uint64_t toBits(const double x) {
+    uint64_t b;
+    std::memcpy(&b, &x, sizeof(b));
+    return b;
+  }
+  static double fromBits(const uint64_t b) {
+    double x;
+    std::memcpy(&x, &b, sizeof(x));
+    return x;
+  }
+
+  // Registered metrics only (also rejects invalidId)
+  inline bool isValid(const uint32_t id) const { return id < m_NMetrics.load(std::memory_order_acquire); }
+
+  // Number of registries whose shard is cached by each thread
+  static constexpr uint32_t shardCacheSize = 4;
+  // Shard of the calling thread, created on first use. Each thread caches
+  // the shards of the last registries it used, keyed by registry id, so a
+  // thread alternating between a few registries does not take the lock
+  inline Shard& shard() {
+    thread_local struct {
+      uint64_t registry[shardCacheSize] = {};
+      Shard* shard[shardCacheSize] = {};
+      uint32_t next = 0;
+    } cache;
+    for (uint32_t i = 0; i < shardCacheSize; ++i) {
+      if (cache.registry[i] == m_Id) {
+        return *cache.shard[i];
+      }
+    }
+    const uint32_t i = cache.next;
+    cache.next = (i + 1) % shardCacheSize;
+    cache.shard[i] = &threadShard();
+    cache.registry[i] = m_Id;
+    return *cache.shard[i];
+  }
+  Shard& threadShard();
+  uint32_t registerMetric(const std::string&, const std::string&, const Type, const std::vector<double>&);
+  uint64_t sumSlot(const uint32_t) const;
+
+  const uint64_t m_Id;
+  std::unique_ptr<Metric[]> m_Metrics;
+  std::atomic<uint32_t> m_NMetrics{0};
+  uint32_t m_NSlots = 0;
+  uint32_t m_NGauges = 0;
+  std::unique_ptr<std::atomic<uint64_t>[]> m_Gauges;
+
+  mutable std::mutex m_Mutex;
+  std::map<std::thread::id, std::unique_ptr<Shard>> m_Shards;
+
+  std::thread m_Exporter;
+  std::mutex m_ExportMutex;
+  std::condition_variable m_ExportCv;
+  bool m_StopExport = false;
+};
+} // namespace sipm
+#endif /* SIPM_SIPMMETRICS_H */
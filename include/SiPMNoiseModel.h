@@ -0,0 +1,155 @@
+/** @class sipm::SiPMNoiseModel SimSiPM/SimSiPM/SiPMNoiseModel.h SiPMNoiseModel.h
+ *
+ *  @brief Correlated (coloured) electronic noise made by filtering white noise.
+ *
+ *  The model is a sum of independent components, each one a white gaussian
+ *  noise shaped by a cascade of first-order recursive filters:
+ *  - white noise;
+ *  - pink (1/f) noise between two frequencies, approximated by a cascade of
+ *    pole-zero sections with two poles per decade;
+ *  - band-limited noise of a CR-RC shaper (high-pass and low-pass corner).
+ *
+ *  Filters are discretized for a sampling time with @ref prepare and written
+ *  as a sum of first-order recursions (partial fractions), so a component
+ *  costs two multiply-adds per pole and per sample and the recursions of the
+ *  different poles are independent and vectorized. Each window starts from
+ *  the stationary state of the filters, so noise has the same variance in
+ *  all the samples and events are independent.
+ *
+ *  Frequencies are in Hz, sigmas in the units of the signal (1 is the
+ *  amplitude of one photoelectron) and power spectral densities are
+ *  one-sided, in units^2 / Hz.
+ */
+
+#ifndef SIPM_SIPMNOISEMODEL_H
+#define SIPM_SIPMNOISEMODEL_H
+
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "SiPMRandom.h"
+#include "SiPMTypes.h"
+
+namespace sipm {
+class SiPMNoiseModel {
+public:
+  /** @enum Type
+   * @brief Type of a component of the noise
+   */
+  enum class Type {
+    kWhite, ///< Flat spectrum
+    kPink,  ///< 1/f spectrum between fLow and fHigh
+    kBand   ///< CR-RC shaped spectrum with corners fLow and fHigh
+  };
+
+  /** @struct Component
+   * @brief Parameters of a component of the noise
+   */
+  struct Component {
+    Type type = Type::kWhite;
+    double sigma = 0; ///< Standard deviation
+    double fLow = 0;  ///< Low frequency in Hz
+    double fHigh = 0; ///< High frequency in Hz
+  };
+
+  /// @brief Maximum number of poles of a component
+  static constexpr uint32_t maxPoles = 16;
+
+  SiPMNoiseModel() = default;
+
+  /// @brief Adds white noise
+  void addWhite(const double);
+  /// @brief Adds 1/f noise between fLow and fHigh
+  /** @param sigma Standard deviation of the component
+   * @param fLow Frequency in Hz below which the spectrum is flat
+   * @param fHigh Frequency in Hz above which the spectrum is flat
+   */
+  void addPink(const double, const double, const double);
+  /// @brief Adds noise of a CR-RC shaper
+  /** Corners closer than 1% are moved apart to keep the poles distinct.
+   * @param sigma Standard deviation of the component
+   * @param fLow Corner in Hz of the CR (high-pass) filter
+   * @param fHigh Corner in Hz of the RC (low-pass) filter
+   */
+  void addBand(const double, const double, const double);
+
+  /// @brief Fits a model to a measured power spectral density
+  /** The PSD is fitted with a non-negative sum of white, pink and CR-RC
+   * components spread over the measured frequencies; the maxComponents
+   * components with the largest variance are kept. Relative residuals are
+   * minimized so all frequencies have the same weight. The model includes
+   * its own white component: the white noise of the sensor (@ref
+   * SiPMProperties::snr) should then be set negligible.
+   * @param freqs Frequencies in Hz
+   * @param psd One-sided PSD in units^2 / Hz at each frequency
+   * @param sampling Sampling time in ns
+   * @param maxComponents Maximum number of components of the model
+   */
+  static SiPMNoiseModel fromPsd(const std::vector<double>&, const std::vector<double>&, const double,
+                                const uint32_t maxComponents = 4);
+
+  /// @brief Computes the filters for a sampling time in ns
+  /** Frequencies above the Nyquist frequency (0.5 / sampling) are clamped to
+   * it, so a pink component entirely above it is white noise.
+   */
+  void prepare(const double);
+  /// @brief Returns sampling time in ns of the filters (0 if not prepared)
+  constexpr double sampling() const { return m_Sampling; }
+
+  /// @brief Returns true if the model has no components
+  bool empty() const { return m_Components.empty(); }
+  /// @brief Returns number of components
+  uint32_t nComponents() const { return m_Components.size(); }
+  /// @brief Returns components of the model
+  const std::vector<Component>& components() const { return m_Components; }
+  /// @brief Returns total number of poles (operations per sample are about twice as many)
+  uint32_t nPoles() const;
+  /// @brief Returns standard deviation of the noise
+  double sigma() const;
+  /// @brief Returns one-sided PSD in units^2 / Hz at a frequency in Hz
+  /** Evaluated from the discrete filters: the model must be prepared.
+   */
+  double psd(const double) const;
+
+  /// @brief Adds noise to n samples of a signal
+  /** @param signal Samples of the signal
+   * @param n Number of samples
+   * @param rng Random generator
+   * @param scratch Buffer for white noise (resized if smaller than n)
+   */
+  void addNoise(float*, const uint32_t, SiPMRandom&, SiPMVector<float>&) const;
+  /// @brief Returns n samples of noise
+  SiPMVector<float> generate(SiPMRandom&, const uint32_t) const;
+
+  friend std::ostream& operator<<(std::ostream&, const SiPMNoiseModel&);
+  std::string toString() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+  }
+
+private:
+  // Filter of a component as direct * x + sum of residue / (1 - pole z^-1), already scaled to sigma
+  struct Filter {
+    uint32_t nPoles = 0;
+    // Poles padded to a multiple of 4 with zeros (a zero residue adds nothing)
+    uint32_t nPadded = 0;
+    double direct = 0;
+    alignas(64) double poles[maxPoles] = {};
+    alignas(64) double residues[maxPoles] = {};
+    // Lower triangular factor of the stationary covariance of the states
+    double chol[maxPoles * maxPoles] = {};
+  };
+
+  static Filter makeFilter(const Component&, const double);
+  void filter(const Filter&, const float*, float*, const uint32_t, SiPMRandom&) const;
+
+  std::vector<Component> m_Components;
+  std::vector<Filter> m_Filters;
+  double m_Sampling = 0;
+};
+} // namespace sipm
+#endif /* SIPM_SIPMNOISEMODEL_H */
@@ -0,0 +1,92 @@
+/** @class sipm::SiPMOccupancy SimSiPM/SimSiPM/SiPMOccupancy.h SiPMOccupancy.h
+ *
+ *  @brief Number of times each cell has fired, summed over many events.
+ *
+ *  Holds one nSideCells x nSideCells grid of counters for each type of hit
+ *  (see @ref SiPMHit::HitType). Counters are updated looping directly on the
+ *  hits of a @ref SiPMSensor, so hits are never copied. Accumulators are not
+ *  thread safe: each thread fills its own accumulator and accumulators are
+ *  merged at the end (as done by @ref SiPMBatchRunner).
+ *
+ *  Counters of a hit type are stored row-major in a contiguous block, so the
+ *  whole accumulator can be seen as a nHitTypes x nSideCells x nSideCells
+ *  array.
+ */
+
+#ifndef SIPM_SIPMOCCUPANCY_H
+#define SIPM_SIPMOCCUPANCY_H
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "SiPMHit.h"
+#include "SiPMProperties.h"
+#include "SiPMTypes.h"
+
+namespace sipm {
+class SiPMSensor;
+
+class SiPMOccupancy {
+public:
+  /// @brief Number of hit types (grids) in the accumulator
+  static constexpr uint32_t nHitTypes = 6;
+
+  SiPMOccupancy() = default;
+
+  /// @brief Constructs an accumulator for a sensor with nSideCells x nSideCells cells
+  SiPMOccupancy(const uint32_t);
+
+  /// @brief Constructs an accumulator for a sensor described by a @ref SiPMProperties
+  SiPMOccupancy(const SiPMProperties& properties) : SiPMOccupancy(properties.nSideCells()) {}
+
+  /// @brief Adds hits of the last event of a sensor
+  void fill(const SiPMSensor&);
+
+  /// @brief Adds counters of another accumulator
+  /** Both accumulators must have the same number of cells.
+   */
+  void merge(const SiPMOccupancy&);
+
+  /// @brief Sets all counters to zero
+  void reset();
+
+  /// @brief Returns number of cells on each side
+  constexpr uint32_t nSideCells() const { return m_NSideCells; }
+  /// @brief Returns number of events added to the accumulator
+  constexpr uint64_t nEvents() const { return m_NEvents; }
+
+  /// @brief Returns number of times a cell has fired with hits of a given type
+  uint64_t count(const SiPMHit::HitType type, const uint32_t row, const uint32_t col) const {
+    return m_Counts[index(static_cast<uint32_t>(type), row, col)];
+  }
+  /// @brief Returns number of times a cell has fired with hits of any type
+  uint64_t count(const uint32_t, const uint32_t) const;
+
+  /// @brief Returns grid of counters of a hit type (row-major)
+  const uint64_t* grid(const SiPMHit::HitType type) const {
+    return m_Counts.data() + static_cast<size_t>(type) * m_NSideCells * m_NSideCells;
+  }
+  /// @brief Returns all counters (nHitTypes x nSideCells x nSideCells)
+  const uint64_t* data() const { return m_Counts.data(); }
+
+  friend std::ostream& operator<<(std::ostream&, const SiPMOccupancy&);
+  std::string toString() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+  }
+
+private:
+  inline size_t index(const uint32_t type, const uint32_t row, const uint32_t col) const {
+    return (static_cast<size_t>(type) * m_NSideCells + row) * m_NSideCells + col;
+  }
+
+  uint32_t m_NSideCells = 0;
+  uint64_t m_NEvents = 0;
+  SiPMVector<uint64_t> m_Counts;
+};
+} // namespace sipm
+#endif /* SIPM_SIPMOCCUPANCY_H */
@@ -0,0 +1,146 @@
+/** @class sipm::SiPMOutputWriter SimSiPM/SimSiPM/SiPMOutputWriter.h SiPMOutputWriter.h
+ *
+ *  @brief Writes waveforms to a file from a background thread.
+ *
+ *  Data is copied into one of a few large buffers and each full buffer is
+ *  written by a dedicated I/O thread, so the simulation fills the next
+ *  buffer while the previous one goes to disk. The caller waits only when
+ *  all buffers are waiting to be written (the disk is slower than the
+ *  simulation).
+ *
+ *  Buffers are aligned to pages and written at their offset with a single
+ *  `pwrite`. With direct I/O the file is opened with `O_DIRECT` (bypassing
+ *  the page cache) when the file system supports it; the last block is
+ *  padded and the file is truncated to its real size when closed.
+ *
+ *  Waveforms are written one after the other as raw float values in the
+ *  byte order of the machine, without header.
+ */
+
+#ifndef SIPM_SIPMOUTPUTWRITER_H
+#define SIPM_SIPMOUTPUTWRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sipm {
+class SiPMAnalogSignal;
+class SiPMBatchRunner;
+
+class SiPMOutputWriter {
+public:
+  /// @brief Size of blocks of direct I/O (buffers are a multiple of it)
+  static constexpr size_t blockSize = 4096;
+
+  /// @brief SiPMOutputWriter constructor
+  /** The file is created (or truncated) and the I/O thread started.
+   * Buffers use huge pages when possible, heap memory otherwise, and
+   * std::bad_alloc is thrown if they cannot be allocated at all.
+   * @param fname Name of the output file
+   * @param bufferSize Size of each buffer in bytes (rounded up to blockSize)
+   * @param nBuffers Number of buffers (2 for double buffering, at least 2)
+   * @param direct Opens the file with O_DIRECT if available
+   */
+  SiPMOutputWriter(const std::string&, const size_t bufferSize = 64 << 20, const uint32_t nBuffers = 2,
+                   const bool direct = false);
+  ~SiPMOutputWriter();
+  SiPMOutputWriter(const SiPMOutputWriter&) = delete;
+  SiPMOutputWriter& operator=(const SiPMOutputWriter&) = delete;
+
+  /// @brief Returns true if the file is open and no write has failed
+  bool good() const { return (m_Fd >= 0 || m_File) && !m_Error.load(std::memory_order_relaxed); }
+  /// @brief Returns true if the file is written with direct I/O
+  constexpr bool direct() const { return m_Direct; }
+  /// @brief Returns name of the output file
+  const std::string& fileName() const { return m_FileName; }
+
+  /// @brief Appends n bytes to the file
+  void write(const void*, const size_t);
+  /// @brief Appends the waveform of a signal
+  void write(const SiPMAnalogSignal&);
+  /// @brief Appends the waveforms of all events of the last batch of a runner
+  /** Waveforms are copied, so the runner can start the next batch while
+   * they are written.
+   */
+  void write(const SiPMBatchRunner&);
+
+  /// @brief Waits until all data given so far is in the file
+  /** With direct I/O the last partial block is kept in memory until more
+   * data completes it or the file is closed.
+   */
+  void flush();
+  /// @brief Writes remaining data, stops the I/O thread and closes the file
+  void close();
+
+  /// @brief Returns number of bytes given to the writer
+  constexpr uint64_t size() const { return m_Size; }
+  /// @brief Returns number of bytes written to the file so far
+  uint64_t bytesWritten() const { return m_BytesWritten.load(std::memory_order_relaxed); }
+  /// @brief Returns time spent by the I/O thread writing in seconds
+  double writeSeconds() const { return 1e-9 * m_WriteNs.load(std::memory_order_relaxed); }
+  /// @brief Returns bandwidth of the writes in bytes per second
+  double bandwidth() const {
+    const uint64_t ns = m_WriteNs.load(std::memory_order_relaxed);
+    return ns ? 1e9 * bytesWritten() / ns : 0;
+  }
+  /// @brief Returns time callers waited for a free buffer in seconds
+  double stallSeconds() const { return 1e-9 * m_StallNs; }
+
+  friend std::ostream& operator<<(std::ostream&, const SiPMOutputWriter&);
+  std::string toString() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+  }
+
+private:
+  struct Buffer {
+    char* data = nullptr;
+    size_t size = 0;     // Bytes to write
+    uint64_t offset = 0; // Offset in the file
+  };
+
+  void open(const bool);
+  void ioLoop();
+  bool writeBuffer(const Buffer&);
+  void submit(const size_t);
+  void nextBuffer();
+
+  std::string m_FileName;
+  // File descriptor used with pwrite, or stream of the portable fallback
+  int m_Fd = -1;
+  std::FILE* m_File = nullptr;
+  bool m_Direct = false;
+  size_t m_BufferSize;
+  std::vector<Buffer> m_Buffers;
+
+  // Buffer filled by the caller and bytes in it
+  uint32_t m_Current = 0;
+  size_t m_Fill = 0;
+  uint64_t m_Offset = 0; // Offset in the file of the current buffer
+  uint64_t m_Size = 0;
+  uint64_t m_StallNs = 0;
+
+  std::mutex m_Mutex;
+  std::condition_variable m_Cv;
+  std::deque<uint32_t> m_Pending;
+  std::deque<uint32_t> m_Free;
+  bool m_Busy = false;
+  bool m_Stop = false;
+  std::thread m_Thread;
+
+  std::atomic<bool> m_Error{false};
+  std::atomic<uint64_t> m_BytesWritten{0};
+  std::atomic<uint64_t> m_WriteNs{0};
+};
+} // namespace sipm
+#endif /* SIPM_SIPMOUTPUTWRITER_H */
@@ -0,0 +1,202 @@
+/** @class sipm::SiPMPhotonSource SimSiPM/SimSiPM/SiPMPhotonSource.h SiPMPhotonSource.h
+ *
+ *  @brief Base class for generators of photon arriving times.
+ *
+ *  A photon source describes the time profile of a light source and the
+ *  average number of photons it emits in one event. The number of photons is
+ *  sampled from a Poisson distribution and all the times are generated at once
+ *  in a vectorized batch and appended to a buffer (usually the input buffer of
+ *  a @ref SiPMSensor, see SiPMSensor::addPhotons).
+ *
+ *  Derived classes only need to implement @ref sampleTimes that fills a
+ *  contiguous range of times.
+ */
+
+#ifndef SIPM_SIPMPHOTONSOURCE_H
+#define SIPM_SIPMPHOTONSOURCE_H
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "SiPMRandom.h"
+#include "SiPMTypes.h"
+
+namespace sipm {
+class SiPMPhotonSource {
+public:
+  virtual ~SiPMPhotonSource() = default;
+
+  /// @brief Returns average number of photons emitted in one event
+  constexpr double mean() const { return m_Mean; }
+
+  /// @brief Sets average number of photons emitted in one event
+  void setMean(const double x) { m_Mean = x; }
+
+  /// @brief Generates a new set of photons appending them to a buffer
+  uint32_t generate(SiPMRandom&, std::vector<double>&) const;
+
+  /// @brief Generates a new set of photons
+  std::vector<double> generate(SiPMRandom&) const;
+
+  /// @brief Fills a range of photon times
+  /** Fills n times starting from out following the time profile of the source.
+   * The number of photons is chosen by @ref generate.
+   */
+  virtual void sampleTimes(SiPMRandom&, double*, const uint32_t) const = 0;
+
+  /// @brief Returns a short description of the source
+  virtual std::string toString() const = 0;
+
+protected:
+  SiPMPhotonSource(const double mean) : m_Mean(mean) {}
+
+private:
+  double m_Mean;
+};
+
+/** @class sipm::SiPMPulseSource
+ * @brief Light pulse with gaussian time profile
+ *
+ * Photons arrive at time t0 with a gaussian spread sigma. A sigma of 0
+ * describes a delta-like pulse where all photons arrive at the same time.
+ */
+class SiPMPulseSource : public SiPMPhotonSource {
+public:
+  /// @brief Constructor of SiPMPulseSource
+  /// @param mean Average number of photons in the pulse
+  /// @param t0 Arriving time of the pulse in ns
+  /// @param sigma Time spread of the pulse in ns (0 for a delta pulse)
+  SiPMPulseSource(const double mean, const double t0, const double sigma = 0)
+    : SiPMPhotonSource(mean), m_T0(t0), m_Sigma(sigma) {}
+
+  constexpr double t0() const { return m_T0; }
+  constexpr double sigma() const { return m_Sigma; }
+
+  void sampleTimes(SiPMRandom&, double*, const uint32_t) const override;
+  std::string toString() const override;
+
+private:
+  double m_T0;
+  double m_Sigma;
+};
+
+/** @class sipm::SiPMScintillatorSource
+ * @brief Scintillation light with rise and decay components
+ *
+ * Emission time follows a bi-exponential distribution:
+ * @f[ f(t) \propto \frac{e^{-t/\tau_d} - e^{-t/\tau_r}}{\tau_d - \tau_r} @f]
+ * that is the convolution of two exponentials, so each time is sampled as the
+ * sum of two exponential variables. An optional slow decay component and a
+ * gaussian transit-time spread (photodetector and light collection) can be added.
+ */
+class SiPMScintillatorSource : public SiPMPhotonSource {
+public:
+  /// @brief Constructor of SiPMScintillatorSource
+  /// @param mean Average number of photons
+  /// @param t0 Time of the interaction in ns
+  /// @param riseTime Rise time constant of the emission in ns
+  /// @param decayTime Decay time constant of the emission in ns
+  SiPMScintillatorSource(const double mean, const double t0, const double riseTime, const double decayTime)
+    : SiPMPhotonSource(mean), m_T0(t0), m_RiseTime(riseTime), m_DecayTime(decayTime) {}
+
+  constexpr double t0() const { return m_T0; }
+  constexpr double riseTime() const { return m_RiseTime; }
+  constexpr double decayTime() const { return m_DecayTime; }
+  constexpr double decayTimeSlow() const { return m_DecayTimeSlow; }
+  constexpr double slowFraction() const { return m_SlowFraction; }
+  constexpr double transitTimeSpread() const { return m_Tts; }
+
+  /// @brief Adds a slow decay component
+  /// @param tau Decay time constant of the slow component in ns
+  /// @param fraction Fraction of photons emitted with the slow component [0-1]
+  void setSlowComponent(const double tau, const double fraction) {
+    m_DecayTimeSlow = tau;
+    m_SlowFraction = fraction;
+  }
+
+  /// @brief Sets gaussian transit-time spread in ns
+  void setTransitTimeSpread(const double x) { m_Tts = x; }
+
+  void sampleTimes(SiPMRandom&, double*, const uint32_t) const override;
+  std::string toString() const override;
+
+private:
+  double m_T0;
+  double m_RiseTime;
+  double m_DecayTime;
+  double m_DecayTimeSlow = 0;
+  double m_SlowFraction = 0;
+  double m_Tts = 0;
+};
+
+/** @class sipm::SiPMBackgroundSource
+ * @brief Uniform background light with constant rate
+ *
+ * Photons are uniformly distributed in a time window. The average number of
+ * photons is given by the rate multiplied by the length of the window.
+ */
+class SiPMBackgroundSource : public SiPMPhotonSource {
+public:
+  /// @brief Constructor of SiPMBackgroundSource
+  /// @param rate Photon rate in Hz
+  /// @param start Start of the time window in ns
+  /// @param length Length of the time window in ns
+  SiPMBackgroundSource(const double rate, const double start, const double length)
+    : SiPMPhotonSource(rate * length * 1e-9), m_Rate(rate), m_Start(start), m_Length(length) {}
+
+  constexpr double rate() const { return m_Rate; }
+  constexpr double start() const { return m_Start; }
+  constexpr double length() const { return m_Length; }
+
+  void sampleTimes(SiPMRandom&, double*, const uint32_t) const override;
+  std::string toString() const override;
+
+private:
+  double m_Rate;
+  double m_Start;
+  double m_Length;
+};
+
+/** @class sipm::SiPMLaserSource
+ * @brief Train of laser pulses
+ *
+ * A burst of nPulses gaussian pulses separated by a fixed period. Each pulse
+ * has the same average number of photons. Photons are assigned uniformly to
+ * the pulses so the number of photons in each pulse is Poisson distributed.
+ */
+class SiPMLaserSource : public SiPMPhotonSource {
+public:
+  /// @brief Constructor of SiPMLaserSource
+  /// @param meanPerPulse Average number of photons in each pulse
+  /// @param t0 Time of the first pulse in ns
+  /// @param period Time between two consecutive pulses in ns
+  /// @param nPulses Number of pulses in the burst
+  /// @param sigma Time spread of each pulse in ns
+  SiPMLaserSource(const double meanPerPulse, const double t0, const double period, const uint32_t nPulses,
+                  const double sigma = 0)
+    : SiPMPhotonSource(meanPerPulse * nPulses), m_T0(t0), m_Period(period), m_NPulses(nPulses), m_Sigma(sigma) {}
+
+  constexpr double t0() const { return m_T0; }
+  constexpr double period() const { return m_Period; }
+  constexpr uint32_t nPulses() const { return m_NPulses; }
+  constexpr double sigma() const { return m_Sigma; }
+
+  void sampleTimes(SiPMRandom&, double*, const uint32_t) const override;
+  std::string toString() const override;
+
+private:
+  double m_T0;
+  double m_Period;
+  uint32_t m_NPulses;
+  double m_Sigma;
+};
+
+inline std::ostream& operator<<(std::ostream& out, const SiPMPhotonSource& obj) {
+  out << obj.toString();
+  return out;
+}
+} // namespace sipm
+#endif /* SIPM_SIPMPHOTONSOURCE_H */
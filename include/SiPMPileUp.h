@@ -0,0 +1,118 @@
+/** @class sipm::SiPMPileUp SimSiPM/SimSiPM/SiPMPileUp.h SiPMPileUp.h
+ *
+ *  @brief Overlay of photons from several bunch crossings.
+ *
+ *  At high luminosity each readout window contains photons coming from
+ *  several bunch crossings. This class builds the input of a sensor as the
+ *  overlay of photon sources: each source is registered with a time offset
+ *  and an average number of interactions per crossing. For each crossing the
+ *  number of interactions is Poisson distributed and each interaction
+ *  contributes a set of photons generated by the source.
+ *
+ *  Photon sets can be pre-generated in a pool (e.g. minimum-bias events) and
+ *  then reused: each interaction picks a random set from the pool instead of
+ *  generating a new one. Sets are stored sorted, so the overlay is a merge of
+ *  sorted runs and the result is given in increasing time order.
+ */
+
+#ifndef SIPM_SIPMPILEUP_H
+#define SIPM_SIPMPILEUP_H
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "SiPMPhotonSource.h"
+#include "SiPMRandom.h"
+#include "SiPMTypes.h"
+
+namespace sipm {
+class SiPMPileUp {
+public:
+  SiPMPileUp() = default;
+
+  /// @brief Sets bunch crossings contributing to the readout window
+  /** Crossings happen at times k * spacing for k in [first, last] relative to
+   * the triggered crossing (k = 0).
+   * @param spacing Time between two crossings in ns
+   * @param first Index of first crossing (e.g. -3 for 3 crossings before trigger)
+   * @param last Index of last crossing
+   */
+  void setCrossings(const double spacing, const int32_t first, const int32_t last);
+
+  /// @brief Registers a photon source
+  /** @param source Source of photons of one interaction
+   * @param offset Time offset of the source in ns (added to crossing time)
+   * @param multiplicity Average number of interactions per crossing
+   * @param inTimeOnly If true the source contributes only to the triggered crossing
+   * @return Index of the source
+   */
+  uint32_t addSource(std::shared_ptr<const SiPMPhotonSource>, const double offset, const double multiplicity,
+                     const bool inTimeOnly = false);
+
+  /// @brief Pre-generates a pool of photon sets for a source
+  /** Interactions of this source will reuse sets from the pool.
+   * Throws std::out_of_range if i is not the index of a source.
+   * @param i Index of the source (as returned by @ref addSource)
+   * @param rng Random number generator used to fill the pool
+   * @param size Number of photon sets in the pool
+   */
+  void fillPool(const uint32_t, SiPMRandom&, const uint32_t);
+
+  /// @brief Removes the pool of a source (sets will be generated each time)
+  /** Throws std::out_of_range if i is not the index of a source. */
+  void clearPool(const uint32_t);
+
+  /// @brief Returns number of registered sources
+  uint32_t nSources() const { return m_Sources.size(); }
+  /// @brief Returns number of photon sets in the pool of a source
+  /** Throws std::out_of_range if i is not the index of a source. */
+  uint32_t poolSize(const uint32_t i) const { return entry(i).poolStart.size(); }
+  /// @brief Returns number of interactions in the last generated overlay
+  uint32_t nInteractions() const { return m_NInteractions; }
+
+  /// @brief Generates an overlay appending photon times in increasing order
+  uint32_t generate(SiPMRandom&, std::vector<double>&);
+
+  /// @brief Generates an overlay
+  std::vector<double> generate(SiPMRandom&);
+
+  friend std::ostream& operator<<(std::ostream&, const SiPMPileUp&);
+  std::string toString() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+  }
+
+private:
+  struct Entry {
+    std::shared_ptr<const SiPMPhotonSource> source;
+    double offset;
+    double multiplicity;
+    bool inTimeOnly;
+    // Pool of sorted photon sets stored contiguously
+    SiPMVector<double> pool;
+    std::vector<uint32_t> poolStart;
+  };
+
+  // Source with index i, throws std::out_of_range if there is none
+  const Entry& entry(const uint32_t) const;
+  Entry& entry(const uint32_t i) { return const_cast<Entry&>(static_cast<const SiPMPileUp*>(this)->entry(i)); }
+  void mergeRuns(std::vector<double>&, const size_t);
+
+  std::vector<Entry> m_Sources;
+  double m_Spacing = 25;
+  int32_t m_FirstCrossing = 0;
+  int32_t m_LastCrossing = 0;
+
+  uint32_t m_NInteractions = 0;
+  // Boundaries of sorted runs and scratch buffer used by merge
+  std::vector<size_t> m_Runs;
+  std::vector<double> m_Scratch;
+  std::vector<double> m_Set;
+};
+} // namespace sipm
+#endif /* SIPM_SIPMPILEUP_H */
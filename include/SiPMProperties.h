@@ -89,6 +89,9 @@ public:
   /// @brief Returns recovery time of SiPM cells.
   constexpr double recoveryTime() const { return m_RecoveryTime; }
 
+  /// @brief Returns dead time of SiPM cells in digital readout.
+  constexpr double deadTime() const { return m_DeadTime; }
+
   /// @brief Returns DCR value.
   constexpr double dcr() const { return m_Dcr; }
 
@@ -116,6 +119,9 @@ public:
   /// @brief Returns value of cell-to-cell gain variation.
   constexpr double ccgv() const { return m_Ccgv; }
 
+  /// @brief Returns single photon time resolution (sigma) in ns.
+  constexpr double sptr() const { return m_Sptr; }
+
   /// @brief Returns relative gain.
   constexpr double gain() const { return m_Gain; }
 
@@ -203,6 +209,10 @@ public:
   /// @param x Recovery time constant of each SiPM cell in ns
   constexpr void setRecoveryTime(const double x) { m_RecoveryTime = x; }
 
+  /// @brief Set dead time of the SiPM cell in digital readout
+  /// @param x Time in ns after a discharge during which a cell can not fire again (0 for no dead time)
+  constexpr void setDeadTime(const double x) { m_DeadTime = x; }
+
   /// @brief Set SNR value in dB
   /// @param x Signal to noise ratio in dB
   constexpr void setSnr(const double x) {
@@ -226,6 +236,10 @@ public:
   /// @param x Value of ccgv as a fraction of signal
   constexpr void setCcgv(const double x) { m_Ccgv = x; }
 
+  /// @brief Set single photon time resolution
+  /// @param x Sigma of gaussian jitter added to the time of each photoelectron in ns (0 for no jitter)
+  constexpr void setSptr(const double x) { m_Sptr = x; }
+
   /// @brief Set value for PDE (and sets @ref PdeType::kSimplePde)
   /// @param x Flat value of PDE to be applied
   constexpr void setPde(const double x) {
@@ -294,6 +308,12 @@ public:
   /// @brief Set hit distriution type
   constexpr void setHitDistribution(const HitDistribution val) { m_HitDistribution = val; }
 
+  /// @brief Returns a hash of all the properties
+  /** Two instances with the same settings have the same hash. Used to check
+   * that an event is replayed with the settings it was generated with.
+   */
+  uint64_t hash() const;
+
   friend std::ostream& operator<<(std::ostream&, const SiPMProperties&);
   std::string toString() const {
     std::stringstream ss;
@@ -316,6 +336,7 @@ private:
   double m_FallTimeSlow = 100;
   double m_SlowComponentFraction;
   double m_RecoveryTime = 50;
+  double m_DeadTime = 0;
 
   double m_Dcr = 200e3;
   double m_Xt = 0.05;
@@ -326,6 +347,7 @@ private:
   double m_TauApSlowComponent = 80;
   double m_ApSlowFraction = 0.5;
   double m_Ccgv = 0.05;
+  double m_Sptr = 0;
   double m_SnrdB = 30;
   double m_Gain = 1.0;
   mutable double m_SnrLinear = 0;
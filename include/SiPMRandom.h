@@ -25,6 +25,14 @@
 // Musl implementation of lcg64
 static constexpr uint64_t lcg64(const uint64_t x) { return (x * 10419395304814325825ULL + 1) % -1ULL; }
 
+// Splitmix64 finalizer, maps close seeds to uncorrelated values
+static constexpr uint64_t splitmix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
 namespace sipm {
 namespace SiPMRng {
 /// @brief Implementation of xoshiro256+ 1.0 PRNG algorithm
@@ -87,6 +95,13 @@ public:
   /// @brief Return internal state of rng.
   const uint64_t* getState() const { return s; }
 
+  /// @brief Sets internal state of rng (4 values as returned by @ref getState)
+  void setState(const uint64_t* state) {
+    for (uint8_t i = 0; i < 4; ++i) {
+      s[i] = state[i];
+    }
+  }
+
 private:
   alignas(64) uint64_t s[4];
 };
@@ -111,6 +126,13 @@ public:
   double randGaussian(const double, const double) noexcept;
   /// @brief Gives random float with gaussian distribution
   float randGaussianF(const float, const float) noexcept;
+  /// @brief Gives random double with gaussian distribution using Box-Muller
+  /** Slower than @ref randGaussian on average but without rejection loops:
+   * each value costs exactly two uniform values, a log, a sqrt and a cos.
+   */
+  double randGaussianBoxMuller(const double, const double) noexcept;
+  /// @brief Fills a buffer with gaussian floats using Box-Muller
+  void randGaussianBoxMuller(const float, const float, float*, const uint32_t) noexcept;
   /// @brief Gives random double with exponential distribution
   double randExponential(const double) noexcept;
   /// @brief Gives random float with exponential distribution
@@ -0,0 +1,63 @@
+/** @class sipm::SiPMReplay SimSiPM/SimSiPM/SiPMReplay.h SiPMReplay.h
+ *
+ *  @brief Reads, writes and replays events captured for offline profiling.
+ *
+ *  Slow events of a batch (see @ref SiPMBatchRunner::setSlowEventThreshold)
+ *  are stored with everything needed to run them again: the photons given as
+ *  input, the state of the random generator at the start of the event, the
+ *  memory budget of the sensor and a hash of all its other settings (see
+ *  @ref SiPMSensor::hash). Replaying an event on a sensor with the same
+ *  settings gives exactly the same hits, so the event can be profiled in
+ *  isolation.
+ *
+ *  Events are appended to a binary file, one record after the other, in the
+ *  byte order of the machine.
+ */
+
+#ifndef SIPM_SIPMREPLAY_H
+#define SIPM_SIPMREPLAY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sipm {
+class SiPMSensor;
+
+/** @struct SiPMSlowEvent
+ * @brief Input and state of an event captured for replay
+ */
+struct SiPMSlowEvent {
+  uint32_t event = 0;                    ///< Index of the event in its batch
+  int32_t channel = -1;                  ///< Channel of the event (-1 if no channel table is used)
+  uint64_t latency = 0;                  ///< Time taken by the event in ns
+  uint64_t sensorHash = 0;               ///< Hash of the settings of the sensor (@ref SiPMSensor::hash)
+  uint64_t memoryBudget = 0;             ///< Memory budget of the sensor in bytes (0 if not set)
+  uint64_t rngState[4] = {0, 0, 0, 0};   ///< State of the random generator at the start of the event
+  std::vector<double> photonTimes;       ///< Times of the photons
+  std::vector<double> photonWavelengths; ///< Wavelengths of the photons (empty if not given)
+  std::vector<uint32_t> photonCells;     ///< Cells hit by the photons (empty if no position was given)
+};
+
+class SiPMReplay {
+public:
+  /// @brief Appends events to a replay file
+  /// @return False if the file could not be written
+  static bool write(const std::string&, const std::vector<SiPMSlowEvent>&);
+
+  /// @brief Reads all events of a replay file
+  static std::vector<SiPMSlowEvent> read(const std::string&);
+
+  /// @brief Runs an event again on a sensor
+  /** The sensor must have the settings the event was generated with:
+   * properties, delay distributions, noise model, readout, precision and
+   * real-time mode (for events with a channel, @ref SiPMSensor::setChannel
+   * must be called first). The memory budget of the event is set on the
+   * sensor. The state of the sensor is reset, then the event is run with the
+   * same photons and random state. The signal can be read as usual.
+   * @return False if the settings of the sensor do not match
+   */
+  static bool replay(SiPMSensor&, const SiPMSlowEvent&);
+};
+} // namespace sipm
+#endif /* SIPM_SIPMREPLAY_H */
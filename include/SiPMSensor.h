@@ -19,9 +19,17 @@
 #include <vector>
 
 #include "SiPMAnalogSignal.h"
+#include "SiPMChannelTable.h"
 #include "SiPMDebugInfo.h"
+#include "SiPMDigitalSignal.h"
+#include "SiPMDistribution.h"
 #include "SiPMHit.h"
+#include "SiPMLatency.h"
 #include "SiPMMath.h"
+#include "SiPMNoiseModel.h"
+#include "SiPMPhotonSource.h"
+#include "SiPMPileUp.h"
+#include "SiPMPrecision.h"
 #include "SiPMProperties.h"
 #include "SiPMRandom.h"
 #include "SiPMTypes.h"
@@ -29,6 +37,36 @@
 namespace sipm {
 class SiPMSensor {
 public:
+  /** @enum Precision
+   * @brief Floating point precision used internally for hits and signal.
+   * @sa SiPMPrecision.h
+   */
+  enum class Precision {
+    kDouble, ///< Double precision hits and accumulation (default)
+    kSingle  ///< Single precision hits and accumulation
+  };
+
+  /** @enum Readout
+   * @brief Output produced by the simulation.
+   */
+  enum class Readout {
+    kAnalog,  ///< Hit amplitudes are computed and the waveform can be built (default)
+    kDigital, ///< Only timestamps of fired cells are produced (see @ref SiPMDigitalSignal)
+    kTiming   ///< Hits are not sorted, only order statistics of their times are produced
+  };
+
+  /** @enum Synthesis
+   * @brief Algorithm used to build the waveform from the hits.
+   */
+  enum class Synthesis {
+    kDirect,    ///< Signal shape added at the time of each hit, O(hits x samples) (default)
+    kRecursive, ///< Exponentials of the signal shape as recursive filters of the hits, O(hits + samples)
+    kAuto       ///< Recursive if the event has at least @ref synthesisThreshold hits, direct otherwise
+  };
+
+  /// @brief Default number of hits above which kAuto uses the recursive synthesis
+  static constexpr uint32_t defaultSynthesisThreshold = 32;
+
   /// @brief SiPMSensor constructor from a @ref SiPMProperties instance
   /** Instantiates a SiPMSensor with parameter specified in the SiPMProperties.
    */
@@ -44,8 +82,68 @@ public:
   /// @brief Returns the @ref SiPMAnalogSignal stored in the SiPMSensor
   /** Used to get the generated signal from the sensor. This method should be
    * run after @ref runEvent otherwise it will return only electronic noise.
+   * The waveform is synthesized by the first call after @ref runEvent so
+   * jobs that only need hits or MC-Truth do not pay for it. Its noise is
+   * drawn from a generator seeded by @ref runEvent, so the following events
+   * are the same whether the waveform is requested or not.
+   */
+  SiPMAnalogSignal signal() const {
+    if (m_Readout != Readout::kAnalog) {
+      std::cerr << "Analog signal is only available in analog readout!" << std::endl;
+      return SiPMAnalogSignal();
+    }
+    buildSignal();
+    return m_Signal;
+  }
+
+  /// @brief Returns a reference to the @ref SiPMAnalogSignal stored in the SiPMSensor
+  /** Same as @ref signal without copying the waveform. The samples are
+   * overwritten by the next event: read (or copy) them before running it.
+   * The buffer is reused between events, but pointers to the samples are
+   * only guaranteed to be valid until the next event.
+   */
+  const SiPMAnalogSignal& signalView() const {
+    if (m_Readout != Readout::kAnalog) {
+      std::cerr << "Analog signal is only available in analog readout!" << std::endl;
+    } else {
+      buildSignal();
+    }
+    return m_Signal;
+  }
+
+  /// @brief Returns the @ref SiPMDigitalSignal of the last event
+  /** Timestamps of fired cells, excluding cells fired while dead (see
+   * SiPMProperties::deadTime). Available in analog and digital readout and
+   * built by the first call after @ref runEvent.
+   */
+  SiPMDigitalSignal digitalSignal() const {
+    if (m_Readout == Readout::kTiming) {
+      std::cerr << "Digital signal is not available in timing readout!" << std::endl;
+      return SiPMDigitalSignal();
+    }
+    buildDigitalSignal();
+    return m_DigitalSignal;
+  }
+
+  /// @brief Returns true if the waveform of the last event has been built
+  /** After @ref runEvent the waveform is built only when @ref signal is
+   * called for the first time.
+   */
+  constexpr bool isSignalBuilt() const { return !m_SignalPending; }
+
+  /// @brief Returns time of the k-th hit in the signal window
+  /** Time of the k-th (starting from 1) earliest hit in the signal window,
+   * noise hits included, or -1 if there are less than k hits. Computed by
+   * partial selection so hits do not need to be sorted (@ref
+   * Readout::kTiming).
+   */
+  double orderStatistic(const uint32_t) const;
+
+  /// @brief Returns times of the k earliest hits in the signal window
+  /** Times are in increasing order. Less than k values are returned if
+   * there are less than k hits.
    */
-  SiPMAnalogSignal signal() const { return m_Signal; }
+  std::vector<double> orderStatistics(const uint32_t) const;
 
   /// @brief Returns vector containing all SiPMHits
   /** This method allows to get all the hits generated in the simulation
@@ -86,6 +184,145 @@ public:
    */
   void setProperties(const SiPMProperties&);
 
+  /// @brief Sets parameters of a channel from a @ref SiPMChannelTable
+  /** Dark count rate, crosstalk and afterpulse probabilities of the channel
+   * are used instead of the ones of the properties, and the signal is
+   * scaled by the effective gain of the channel relative to
+   * SiPMProperties::gain. The properties are not modified: parameters are
+   * turned on/off as in the properties and @ref setProperties removes the
+   * channel, while @ref setProperty keeps it and updates its gain scale.
+   * Channels outside of the table are ignored. The signal shape is not
+   * recomputed so switching channel is only a few indexed loads.
+   */
+  void setChannel(const SiPMChannelTable&, const uint32_t);
+  /// @brief Returns channel set by @ref setChannel (-1 if none)
+  constexpr int64_t channel() const { return m_Channel; }
+
+  /// @brief Returns a hash of the settings used to generate events
+  /** Hash of the properties (@ref SiPMProperties::hash), of the channel
+   * set by @ref setChannel, of the delay distributions, of the noise model,
+   * of readout and precision and of the real-time and memory budget
+   * settings. Used to check that an event is replayed with the settings it
+   * was generated with.
+   */
+  uint64_t hash() const;
+
+  /// @brief Sets a custom distribution for the delay of afterpulses
+  /** Replaces the fast/slow exponential delays of afterpulses with values
+   * sampled from a tabulated distribution (e.g. a measured spectrum).
+   * Afterpulses with delay shorter than SiPMProperties::tauApFast are
+   * labelled as fast, others as slow. An empty distribution restores the
+   * default behaviour.
+   */
+  void setApDelayDistribution(const SiPMDistribution&);
+
+  /// @brief Sets a custom distribution for the delay of delayed optical crosstalk
+  /** Replaces the exponential delay of delayed crosstalk with values
+   * sampled from a tabulated distribution. An empty distribution restores
+   * the default behaviour.
+   */
+  void setDXtDelayDistribution(const SiPMDistribution&);
+
+  /// @brief Sets a model of correlated electronic noise
+  /** Noise of the model is added to the white noise given by
+   * SiPMProperties::snr. The model is prepared for the sampling time of the
+   * properties (again if it changes). An empty model removes it.
+   */
+  void setNoiseModel(const SiPMNoiseModel&);
+
+  /// @brief Returns the model of correlated electronic noise (empty if not set)
+  SiPMNoiseModel noiseModel() const { return m_NoiseModel ? *m_NoiseModel : SiPMNoiseModel(); }
+
+  /// @brief Sets the precision used internally for hits and signal accumulation
+  void setPrecision(const Precision val) { m_Precision = val; }
+
+  /// @brief Returns the precision used internally for hits and signal accumulation
+  constexpr Precision precision() const { return m_Precision; }
+
+  /// @brief Sets the readout mode
+  /** In digital readout the simulation stops after hits have been generated
+   * and sorted in time: cell amplitudes and the waveform are never computed.
+   * In timing readout hits are not even sorted: only @ref orderStatistic and
+   * @ref orderStatistics should be used.
+   */
+  void setReadout(const Readout val) { m_Readout = val; }
+
+  /// @brief Returns the readout mode
+  constexpr Readout readout() const { return m_Readout; }
+
+  /// @brief Sets the algorithm used to build the waveform
+  /** Both algorithms give the same waveform up to rounding. The direct one
+   * is faster for events with few hits, the recursive one for events with
+   * many hits: the best threshold for kAuto depends on the machine and on
+   * the number of samples (see @ref SiPMAutoTuner).
+   */
+  void setSynthesis(const Synthesis val) { m_Synthesis = val; }
+
+  /// @brief Returns the algorithm used to build the waveform
+  constexpr Synthesis synthesis() const { return m_Synthesis; }
+
+  /// @brief Sets number of hits above which kAuto uses the recursive synthesis
+  void setSynthesisThreshold(const uint32_t val) { m_SynthesisThreshold = val; }
+
+  /// @brief Returns number of hits above which kAuto uses the recursive synthesis
+  constexpr uint32_t synthesisThreshold() const { return m_SynthesisThreshold; }
+
+  /// @brief Sets real-time mode with a maximum number of hits per event
+  /** In real-time mode the time taken by each event is bounded:
+   * - buffers for hits and waveform are allocated once here;
+   * - hits are not generated once an event has maxHits hits;
+   * - cells, crosstalk neighbours and gaussian values are sampled without
+   *   rejection loops;
+   * - recovery of a cell only depends on its previous discharge, so
+   *   amplitudes are computed in linear time;
+   * - the waveform is built by @ref runEvent.
+   *
+   * The latency of each event is recorded in @ref latency. Events can not
+   * be resumed in real-time mode (see @ref runEvent).
+   * @param maxHits Maximum number of hits in an event (0 turns real-time mode off)
+   */
+  void setRealTime(const uint32_t);
+
+  /// @brief Returns maximum number of hits per event in real-time mode (0 if off)
+  constexpr uint32_t maxHits() const { return m_MaxHits; }
+
+  /// @brief Returns number of hits not generated in the last event because maxHits was reached
+  /** Photons not simulated once the event is full (maxHits) are counted as
+   * dropped hits even if they would not have been detected. With a memory
+   * budget the photoelectrons left out by sampling are counted.
+   */
+  constexpr uint32_t nDroppedHits() const { return m_nDropped; }
+
+  /// @brief Sets maximum number of bytes the sensor can hold (0 for no budget)
+  /** Before each event the number of hits that fit in the budget is
+   * computed from the memory used by the input, the waveform and the
+   * tables of the sensor. Events that would exceed it are approximated
+   * instead of growing without bound: photoelectrons are a uniform random
+   * sample of all the detected ones (see @ref nDroppedHits), so their time
+   * distribution is kept, and room is left for their correlated noise.
+   * The amplitude of the event is lower than the exact one.
+   */
+  void setMemoryBudget(const size_t);
+  /// @brief Returns memory budget in bytes (0 if not set)
+  constexpr size_t memoryBudget() const { return m_MemoryBudget; }
+  /// @brief Returns estimate of the heap memory held by the sensor in bytes
+  size_t memoryUsage() const;
+  /// @brief Returns largest memory held at the end of an event since last reset
+  constexpr size_t peakMemoryUsage() const { return m_PeakMemory; }
+  /// @brief Sets peak memory to the memory currently held
+  void resetPeakMemoryUsage() { m_PeakMemory = memoryUsage(); }
+  /// @brief Frees buffers of the last event (kept by default to be reused)
+  /** Used after an unusually large event to give memory back. The next
+   * event allocates its buffers again.
+   */
+  void releaseMemory();
+
+  /// @brief Returns latencies of events run in real-time mode
+  const SiPMLatency& latency() const { return m_Latency; }
+
+  /// @brief Removes latencies recorded so far
+  void resetLatency() { m_Latency.reset(); }
+
   /// @brief Adds a single photon to the list of photons to be simulated
   void addPhoton(const double);
 
@@ -98,7 +335,75 @@ public:
   /// @brief Adds multiple photons to the list of photons to be simulated at once
   void addPhotons(const std::vector<double>&, const std::vector<double>&);
 
+  /// @brief Sets n photons from a buffer of times
+  /** Same as the vector version, used by bindings to pass arrays without
+   * converting them to a vector first.
+   */
+  void addPhotons(const double*, const uint32_t);
+
+  /// @brief Sets n photons from buffers of times and wavelengths
+  void addPhotons(const double*, const double*, const uint32_t);
+
+  /// @brief Adds a single photon hitting the sensor in a given position
+  /** The photon fires the cell under its position instead of a cell sampled
+   * from SiPMProperties::hitDistribution. Photons outside the sensor are
+   * lost.
+   * @param time Time of the photon in ns
+   * @param x Position along columns in mm (origin in the center of the sensor)
+   * @param y Position along rows in mm (origin in the center of the sensor)
+   */
+  void addPhoton(const double, const double, const double);
+
+  /// @brief Adds a single photon with wavelength hitting the sensor in a given position
+  void addPhoton(const double, const double, const double, const double);
+
+  /// @brief Sets photons hitting the sensor in given positions (times, x, y)
+  /** Positions are converted to cells in a single batch. As for the other
+   * versions previous photons are replaced.
+   */
+  void addPhotons(const std::vector<double>&, const std::vector<double>&, const std::vector<double>&);
+
+  /// @brief Sets photons with wavelength hitting the sensor in given positions (times, wavelengths, x, y)
+  void addPhotons(const std::vector<double>&, const std::vector<double>&, const std::vector<double>&,
+                  const std::vector<double>&);
+
+  /// @brief Generates photons from a @ref SiPMPhotonSource and sets them as input
+  /** Photons are generated using the rng of the sensor directly in the input
+   * buffer. As for the vector version, previous photons are replaced.
+   */
+  void addPhotons(const SiPMPhotonSource&);
+
+  /// @brief Generates an overlay of photons from a @ref SiPMPileUp and sets them as input
+  /** Photons are generated using the rng of the sensor and are given in
+   * increasing time order. Previous photons are replaced.
+   */
+  void addPhotons(SiPMPileUp&);
+
+  /// @brief Appends multiple photons to the list of photons to be simulated
+  /** Unlike @ref addPhotons previous photons are kept. Used to add photons
+   * arriving in several batches to an event that has already been run.
+   * Photons are ignored if the previous ones have a wavelength or if the
+   * PDE depends on the wavelength.
+   */
+  void appendPhotons(const std::vector<double>&);
+
+  /// @brief Appends multiple photons with their wavelengths to the list of photons to be simulated
+  /** Photons are ignored if times and wavelengths have different sizes or if
+   * the previous photons have no wavelength.
+   */
+  void appendPhotons(const std::vector<double>&, const std::vector<double>&);
+
   /// @brief Runs a complete SiPM event
+  /** The event can be resumed: if photons are appended after a call to
+   * runEvent (using @ref addPhoton or @ref appendPhotons), the next call
+   * only generates hits and correlated noise of the new photons, updates
+   * amplitudes of the cells they fire and, if the waveform was already
+   * built, adds the new pulses to it instead of rebuilding it.
+   * Dark counts are generated only once per event. Resuming is not
+   * supported in real-time mode, that has a different recovery model: if
+   * the event was run or is resumed in real-time mode new photons are
+   * ignored.
+   */
   void runEvent();
 
   /// @brief Resets internal state of the SiPMSensor
@@ -114,21 +419,81 @@ public:
   }
 
 private:
+  friend class SiPMAsic;
+  friend class SiPMAutoTuner;
+  friend class SiPMBatchRunner;
+  friend class SiPMOccupancy;
+  friend class SiPMReplay;
+
+  // Parameters of the channel if one is set, else of the properties
+  inline double dcr() const { return (m_Channel >= 0) ? m_ChannelDcr : m_Properties.dcr(); }
+  inline double xt() const { return (m_Channel >= 0) ? m_ChannelXt : m_Properties.xt(); }
+  inline double ap() const { return (m_Channel >= 0) ? m_ChannelAp : m_Properties.ap(); }
   double evaluatePde(const double) const;
   inline bool isDetected(const double val) const noexcept { return m_rng.Rand() < val; }
   constexpr bool isInSensor(const int32_t, const int32_t) const noexcept;
   math::pair<uint32_t> hitCell() const;
+  void addPhotonCells(const double*, const double*, const uint32_t);
+  void padPhotonCells();
+  // Cell fired by the i-th photon (false if the photon is outside the sensor)
+  inline bool photonCell(const uint32_t i, math::pair<uint32_t>& position) const {
+    const uint32_t cell = (i < m_PhotonCells.size()) ? m_PhotonCells[i] : kRandomCell;
+    if (cell == kRandomCell) {
+      position = hitCell();
+      return true;
+    }
+    position = math::pair<uint32_t>(cell >> 16, cell & 0xffff);
+    return cell != kOutsideCell;
+  }
+  // Time of a photoelectron including single photon time jitter
+  inline double photoelectronTime(const uint32_t i) const {
+    const double sptr = m_Properties.sptr();
+    if (sptr <= 0) {
+      return m_PhotonTimes[i];
+    }
+    return m_PhotonTimes[i] + (m_MaxHits ? m_rng.randGaussianBoxMuller(0, sptr) : m_rng.randGaussian(0, sptr));
+  }
+  void addPhotoelectron(const double, const math::pair<uint32_t>&);
   SiPMVector<float> signalShape() const;
+  void updateShapePoles();
 
   void addDcrEvents();
-  void addPhotoelectrons();
-  void addCorrelatedNoise();
+  void addPhotoelectrons(const uint32_t = 0);
+  void addCorrelatedNoise(const uint32_t = 0);
 
   SiPMHit generateXtHit(const SiPMHit&) const;
   SiPMHit generateApHit(const SiPMHit&) const;
 
   void calculateSignalAmplitudes();
-  void generateSignal();
+  void generateSignal() const;
+  template <class P> void calculateSignalAmplitudes(SiPMHitBuffer<P>&);
+  template <class P> void generateSignal(const SiPMHitBuffer<P>&) const;
+  inline bool useRecursiveSynthesis(const uint32_t nHits) const {
+    return m_Synthesis == Synthesis::kRecursive || (m_Synthesis == Synthesis::kAuto && nHits >= m_SynthesisThreshold);
+  }
+  void updateSignalAmplitudes(const uint32_t);
+  template <class P> void updateSignalAmplitudes(SiPMHitBuffer<P>&, const uint32_t);
+  // Builds the waveform if runEvent has been called since last build
+  inline void buildSignal() const {
+    if (m_SignalPending) {
+      generateSignal();
+      m_SignalPending = false;
+    }
+  }
+  // Real-time mode
+  inline bool isFull() const { return m_Hits.size() >= m_HitLimit; }
+  void updateHitLimit();
+  void prepareRealTime();
+  template <class P> void calculateSignalAmplitudesRealTime(SiPMHitBuffer<P>&);
+  template <class P> void generateSignalRealTime(const SiPMHitBuffer<P>&);
+  void generateDigitalSignal() const;
+  void collectHitTimes() const;
+  inline void buildDigitalSignal() const {
+    if (m_DigitalPending) {
+      generateDigitalSignal();
+      m_DigitalPending = false;
+    }
+  }
 
   SiPMProperties m_Properties;
   mutable SiPMRandom m_rng;
@@ -140,18 +505,79 @@ private:
   uint32_t m_nDXt = 0;
   uint32_t m_nAp = 0;
 
+  // Number of photons already simulated in this event (for resumed events)
+  uint32_t m_nProcessedPhotons = 0;
+  bool m_EventRun = false;
+  // Event was run in real-time mode (it can not be resumed)
+  bool m_EventRealTime = false;
+
   std::vector<double> m_PhotonTimes;
   std::vector<double> m_PhotonWavelengths;
+  // Cells of photons given with a position (empty if no photon has a position)
+  static constexpr uint32_t kRandomCell = 0xffffffff;
+  static constexpr uint32_t kOutsideCell = 0xfffffffe;
+  std::vector<uint32_t> m_PhotonCells;
   std::vector<SiPMHit> m_Hits;
   std::vector<int32_t> m_HitsGraph;
 
+  // Optional delay samplers shared among copies of the sensor
+  std::shared_ptr<const SiPMDistribution> m_ApDelay;
+  std::shared_ptr<const SiPMDistribution> m_DXtDelay;
+  // Optional coloured noise, prepared for the current sampling
+  std::shared_ptr<const SiPMNoiseModel> m_NoiseModel;
+  mutable SiPMVector<float> m_NoiseScratch;
+
+  Precision m_Precision = Precision::kDouble;
+  // Internal hit buffers (only the one matching m_Precision is used)
+  SiPMHitBuffer<DoublePrecision> m_HitBufferDouble;
+  SiPMHitBuffer<SinglePrecision> m_HitBufferSingle;
+
   SiPMVector<float> m_SignalShape;
-  SiPMAnalogSignal m_Signal;
+  // Signal shape as sum of coefficient * decay^i (rise, fast and slow components)
+  double m_ShapeDecay[3] = {0, 0, 0};
+  double m_ShapeCoefficient[3] = {0, 0, 0};
+  Synthesis m_Synthesis = Synthesis::kDirect;
+  uint32_t m_SynthesisThreshold = defaultSynthesisThreshold;
+  // Channel parameters overriding the properties (if m_Channel is not -1)
+  int64_t m_Channel = -1;
+  double m_ChannelDcr = 0;
+  double m_ChannelXt = 0;
+  double m_ChannelAp = 0;
+  double m_ChannelGain = 0;
+  // Gain of current channel relative to the gain in the signal shape (updated when properties change)
+  double m_GainScale = 1;
+  // Waveform is built lazily by signal(), with noise from its own generator seeded by runEvent
+  mutable SiPMAnalogSignal m_Signal;
+  mutable SiPMRandom m_SignalRng;
+  mutable bool m_SignalPending = false;
+  Readout m_Readout = Readout::kAnalog;
+  mutable SiPMDigitalSignal m_DigitalSignal;
+  mutable bool m_DigitalPending = false;
+  // Scratch buffer of hit times used by order statistics
+  mutable std::vector<double> m_HitTimes;
+
+  // Real-time mode (off if m_MaxHits is 0)
+  uint32_t m_MaxHits = 0;
+  uint32_t m_nDropped = 0;
+  // Cells sampled from an alias table for non uniform hit distributions
+  SiPMDistribution m_CellSampler;
+  // Index of the last hit in each cell (-1 if none)
+  std::vector<int32_t> m_LastHit;
+  SiPMLatency m_Latency;
+
+  // Maximum hits of the event from maxHits and memory budget (no limit if neither is set)
+  uint32_t m_HitLimit = UINT32_MAX;
+  // Photoelectrons sampled when the budget limits the event: kept from m_FirstSampled, at most m_SampleLimit
+  uint32_t m_FirstSampled = 0;
+  uint32_t m_SampleLimit = UINT32_MAX;
+  uint32_t m_nCandidates = 0;
+  size_t m_MemoryBudget = 0;
+  size_t m_PeakMemory = 0;
 };
 
 constexpr bool SiPMSensor::isInSensor(const int32_t r, const int32_t c) const noexcept {
   const int32_t nSideCells = m_Properties.nSideCells();
-  return (r > 0) & (c > 0) & (r < nSideCells) & (c < nSideCells);
+  return (r >= 0) & (c >= 0) & (r < nSideCells) & (c < nSideCells);
 }
 } // namespace sipm
 #endif /* SIPM_SIPMSENSOR_H */
@@ -0,0 +1,168 @@
+/** @class sipm::SiPMTrigger SimSiPM/SimSiPM/SiPMTrigger.h SiPMTrigger.h
+ *
+ *  @brief Trigger stage for continuous streams of waveforms.
+ *
+ *  In continuous-mode studies the waveforms of a group of channels form a
+ *  stream (e.g. consecutive signals of each @ref SiPMSensor) that is
+ *  processed block by block. Each channel has a discriminator (leading edge
+ *  or constant fraction) and channels are combined with a majority
+ *  coincidence: a trigger is issued when at least a given number of channels
+ *  fire within the coincidence window. After a trigger no other trigger can
+ *  be issued for a dead time.
+ *
+ *  Only a short window around each trigger is kept: the last samples of each
+ *  channel are stored in a ring buffer so that the window can start before
+ *  the trigger (pre-trigger). Windows are emitted with their timestamp, so
+ *  memory and output size scale with the trigger rate and not with the
+ *  length of the stream.
+ */
+
+#ifndef SIPM_SIPMTRIGGER_H
+#define SIPM_SIPMTRIGGER_H
+
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "SiPMAnalogSignal.h"
+
+namespace sipm {
+/** @struct SiPMTriggerWindow
+ * @brief Samples of all channels around a trigger
+ */
+struct SiPMTriggerWindow {
+  double time;                    ///< Time of the trigger in ns from the start of the stream
+  int64_t firstSample;            ///< Index in the stream of the first sample of the window
+  uint32_t length;                ///< Number of samples of each channel
+  std::vector<uint32_t> channels; ///< Channels in coincidence
+  std::vector<float> samples;     ///< Samples of each channel (channel-major)
+
+  /// @brief Returns samples of a channel
+  const float* channel(const uint32_t c) const { return samples.data() + static_cast<size_t>(c) * length; }
+};
+
+class SiPMTrigger {
+public:
+  /** @enum Discriminator
+   * @brief Discriminator used on each channel
+   */
+  enum class Discriminator {
+    kLeadingEdge,     ///< Fires when the signal crosses the threshold
+    kConstantFraction ///< Fires at the zero crossing of the CFD signal once the threshold is crossed
+  };
+
+  /// @brief Constructor of SiPMTrigger
+  /** @param nChannels Number of channels in the stream
+   * @param sampling Sampling time of the waveforms in ns
+   */
+  SiPMTrigger(const uint32_t, const double);
+
+  /// @brief Sets leading edge discriminator
+  /// @param threshold Threshold in units of photoelectrons
+  void setLeadingEdge(const double);
+
+  /// @brief Sets constant fraction discriminator
+  /** @param threshold Arming threshold in units of photoelectrons
+   * @param fraction Fraction of the signal
+   * @param delay Delay of the CFD in ns
+   */
+  void setConstantFraction(const double, const double, const double);
+
+  /// @brief Sets majority coincidence
+  /** @param window Coincidence window in ns
+   * @param majority Minimum number of channels firing in the window
+   */
+  void setCoincidence(const double, const uint32_t);
+
+  /// @brief Sets dead time after a trigger in ns
+  void setDeadTime(const double x) { m_DeadTime = x; }
+
+  /// @brief Sets window stored for each trigger
+  /** @param preTrigger Length of the window before the trigger in ns
+   * @param postTrigger Length of the window after the trigger in ns
+   */
+  void setWindow(const double, const double);
+
+  /// @brief Processes next block of the stream
+  /** All channels must have the same number of samples.
+   */
+  void process(const std::vector<SiPMAnalogSignal>&);
+
+  /// @brief Processes next block of the stream (nSamples for each channel)
+  void process(const float* const*, const uint32_t);
+
+  /// @brief Emits windows not yet completed padding them with zeros
+  void flush();
+
+  /// @brief Returns windows emitted and removes them from the trigger
+  std::vector<SiPMTriggerWindow> takeWindows();
+
+  /// @brief Returns number of windows ready to be taken
+  uint32_t nWindows() const { return m_Windows.size(); }
+  /// @brief Returns number of triggers issued since last reset
+  constexpr uint64_t nTriggers() const { return m_NTriggers; }
+  /// @brief Returns number of samples of each channel processed since last reset
+  constexpr uint64_t nSamples() const { return m_NSamples; }
+  /// @brief Returns number of channels
+  uint32_t nChannels() const { return m_Channels.size(); }
+
+  /// @brief Resets the stream (ring buffers, discriminators and windows)
+  void reset();
+
+  friend std::ostream& operator<<(std::ostream&, const SiPMTrigger&);
+  std::string toString() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+  }
+
+private:
+  struct Channel {
+    std::vector<float> ring; // Last samples of the channel
+    float last = 0;          // Previous sample
+    float lastCfd = 0;       // Previous sample of CFD signal
+    bool armed = false;      // Signal above threshold (CFD)
+    double lastFire = 0;     // Time of last firing
+    bool hasFired = false;
+  };
+
+  struct Pending {
+    SiPMTriggerWindow window;
+    uint32_t filled;
+  };
+
+  void resize();
+  // Returns sample of a channel k samples before the current one (0 for current)
+  inline float past(const Channel& ch, const uint32_t k) const {
+    const uint64_t idx = m_NSamples - k;
+    return ch.ring[idx % m_RingSize];
+  }
+  bool discriminate(Channel&, const float, double&);
+  void trigger(const double);
+
+  double m_Sampling;
+  Discriminator m_Discriminator = Discriminator::kLeadingEdge;
+  double m_Threshold = 0.5;
+  double m_Fraction = 0.2;
+  uint32_t m_CfdDelay = 1;
+  double m_CoincidenceWindow = 0;
+  uint32_t m_Majority = 1;
+  double m_DeadTime = 0;
+  uint32_t m_PreSamples = 0;
+  uint32_t m_PostSamples = 1;
+  uint32_t m_RingSize = 1;
+
+  std::vector<Channel> m_Channels;
+  uint64_t m_NSamples = 0;
+  uint64_t m_NTriggers = 0;
+  double m_DeadUntil = 0;
+  bool m_Dead = false;
+  std::deque<Pending> m_Pending;
+  std::vector<SiPMTriggerWindow> m_Windows;
+};
+} // namespace sipm
+#endif /* SIPM_SIPMTRIGGER_H */
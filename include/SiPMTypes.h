@@ -3,13 +3,22 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <math.h>
 #include <memory>
 #include <mm_malloc.h>
+#include <string>
 #include <utility>
 #include <vector>
 
+#ifdef __unix__
+// For mmap, madvise and file-backed memory
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #ifdef __SSE__
 // For _mm_malloc and _mm_free
 #include <xmmintrin.h>
@@ -189,6 +198,208 @@ inline void aligned_free(void* ptr) {
   free(ptr);
 }
 
+/** @enum MemoryPolicy
+ * @brief Describes how memory of large buffers is obtained from the OS.
+ *
+ * Policies other than kAligned are meant for large buffers (e.g. batch of
+ * waveforms) since allocations are rounded to a multiple of the huge page
+ * size. On systems where a feature is not available the allocation falls
+ * back to the next policy: kHugePages -> kTransparentHugePages -> kAligned.
+ */
+enum class MemoryPolicy {
+  kAligned,              ///< Standard aligned allocation (same as AlignedAllocator)
+  kTransparentHugePages, ///< Aligned to huge page boundary and advised for transparent huge pages
+  kHugePages,            ///< Explicit 2 MB pages (MAP_HUGETLB) when available
+  kFileBacked            ///< Mapping of an unlinked file in @ref MappedMemory::directory for out-of-core runs
+};
+
+/** @brief Settings and helpers for memory obtained with a @ref MemoryPolicy */
+struct MappedMemory {
+  /// @brief Size of huge pages in bytes
+  static constexpr size_t hugePageSize = 2 * 1024 * 1024;
+
+  /// @brief Directory used to create files for kFileBacked buffers
+  static std::string& directory() {
+    static std::string dir = "/tmp";
+    return dir;
+  }
+
+  /// @brief Sets directory used to create files for kFileBacked buffers
+  static void setDirectory(const std::string& dir) { directory() = dir; }
+
+  static void* allocate(size_t size, MemoryPolicy policy);
+  static void deallocate(void* ptr, size_t size, MemoryPolicy policy);
+
+  static constexpr size_t roundUp(const size_t size) { return (size + hugePageSize - 1) / hugePageSize * hugePageSize; }
+};
+
+/**
+ * @class MappedAllocator
+ * @brief Allocator for large buffers with a selectable @ref MemoryPolicy
+ *
+ * Sibling of @ref AlignedAllocator where the memory policy is part of the
+ * type so that each kind of buffer can select its own policy.
+ *
+ * @tparam T type of objects to allocate.
+ * @tparam P memory policy.
+ */
+template <class T, MemoryPolicy P> class MappedAllocator {
+public:
+  using value_type = T;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+
+  static constexpr MemoryPolicy policy = P;
+
+  template <class U> struct rebind { using other = MappedAllocator<U, P>; };
+
+  MappedAllocator() noexcept {}
+  template <class U> MappedAllocator(const MappedAllocator<U, P>&) noexcept {}
+
+  pointer allocate(size_type n) {
+    pointer res = reinterpret_cast<pointer>(MappedMemory::allocate(sizeof(T) * n, P));
+    if (res == nullptr)
+      throw std::bad_alloc();
+    return res;
+  }
+  void deallocate(pointer p, size_type n) { MappedMemory::deallocate(p, sizeof(T) * n, P); }
+};
+
+template <class T1, MemoryPolicy P1, class T2, MemoryPolicy P2>
+constexpr bool operator==(const MappedAllocator<T1, P1>&, const MappedAllocator<T2, P2>&) noexcept {
+  return P1 == P2;
+}
+
+template <class T1, MemoryPolicy P1, class T2, MemoryPolicy P2>
+constexpr bool operator!=(const MappedAllocator<T1, P1>& lhs, const MappedAllocator<T2, P2>& rhs) noexcept {
+  return !(lhs == rhs);
+}
+
+/**
+ * Allocates size bytes following the given policy.
+ * @param size number of bytes to allocate
+ * @param policy memory policy to use
+ * @return pointer to allocated memory or nullptr
+ */
+inline void* MappedMemory::allocate(size_t size, MemoryPolicy policy) {
+  if (size == 0) {
+    size = 1;
+  }
+#ifdef __unix__
+  switch (policy) {
+    case (MemoryPolicy::kFileBacked): {
+      std::string path = directory() + "/sipm-XXXXXX";
+      const int fd = mkstemp(&path[0]);
+      if (fd < 0) {
+        return nullptr;
+      }
+      // File is removed from the directory and lives as long as the mapping
+      unlink(path.c_str());
+      void* res = nullptr;
+      if (ftruncate(fd, roundUp(size)) == 0) {
+        res = mmap(nullptr, roundUp(size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      }
+      close(fd);
+      return (res == MAP_FAILED) ? nullptr : res;
+    }
+    case (MemoryPolicy::kHugePages): {
+#ifdef MAP_HUGETLB
+      void* res = mmap(nullptr, roundUp(size), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (res != MAP_FAILED) {
+        return res;
+      }
+#endif
+      // No huge pages reserved: fall back to transparent huge pages
+      void* res2 = mmap(nullptr, roundUp(size) + hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                        -1, 0);
+      if (res2 == MAP_FAILED) {
+        return nullptr;
+      }
+      // Trim the mapping to a huge page boundary
+      char* base = reinterpret_cast<char*>(res2);
+      char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(base) + hugePageSize - 1) &
+                                              ~(uintptr_t)(hugePageSize - 1));
+      if (aligned != base) {
+        munmap(base, aligned - base);
+      }
+      munmap(aligned + roundUp(size), hugePageSize - (aligned - base));
+#ifdef MADV_HUGEPAGE
+      madvise(aligned, roundUp(size), MADV_HUGEPAGE);
+#endif
+      return aligned;
+    }
+    case (MemoryPolicy::kTransparentHugePages): {
+      void* res = aligned_malloc(roundUp(size), hugePageSize);
+#ifdef MADV_HUGEPAGE
+      if (res != nullptr) {
+        madvise(res, roundUp(size), MADV_HUGEPAGE);
+      }
+#endif
+      return res;
+    }
+    case (MemoryPolicy::kAligned):
+      break;
+  }
+#endif
+  return aligned_malloc(size, 64);
+}
+
+/**
+ * Releases memory obtained with @ref allocate using the same size and policy.
+ * @param ptr pointer returned by allocate
+ * @param size number of bytes passed to allocate
+ * @param policy memory policy passed to allocate
+ */
+inline void MappedMemory::deallocate(void* ptr, size_t size, MemoryPolicy policy) {
+  if (ptr == nullptr) {
+    return;
+  }
+  if (size == 0) {
+    size = 1;
+  }
+#ifdef __unix__
+  if ((policy == MemoryPolicy::kFileBacked) || (policy == MemoryPolicy::kHugePages)) {
+    munmap(ptr, roundUp(size));
+    return;
+  }
+#endif
+  aligned_free(ptr);
+}
+
+/// @brief std::vector using a @ref MappedAllocator with the given @ref MemoryPolicy
+template <typename T, MemoryPolicy P> using SiPMMappedVector = std::vector<T, MappedAllocator<T, P>>;
+
+// Policies of the buffers of the library, set at configuration time (see CMakeLists.txt)
+#ifndef SIPM_SIGNAL_MEMORY_POLICY
+#define SIPM_SIGNAL_MEMORY_POLICY kAligned
+#endif
+#ifndef SIPM_HIT_MEMORY_POLICY
+#define SIPM_HIT_MEMORY_POLICY kAligned
+#endif
+
+/** @brief @ref MemoryPolicy of each kind of buffer used by the library
+ *
+ * Buffers of a single event are small so kAligned is the default. Very long
+ * waveforms or events with millions of hits can use huge pages instead by
+ * configuring with e.g. -DSIPM_SIGNAL_MEMORY_POLICY=kTransparentHugePages.
+ * These buffers are allocated and copied for each event, so kHugePages and
+ * kFileBacked (a mmap or a file each time) are not allowed: they are left to
+ * the waveform matrix of @ref SiPMBatchRunner, allocated once per batch.
+ */
+struct BufferMemory {
+  /// @brief Policy of the waveform of @ref SiPMAnalogSignal
+  static constexpr MemoryPolicy signal = MemoryPolicy::SIPM_SIGNAL_MEMORY_POLICY;
+  /// @brief Policy of the internal hit buffers of the sensor
+  static constexpr MemoryPolicy hits = MemoryPolicy::SIPM_HIT_MEMORY_POLICY;
+
+  static_assert(signal == MemoryPolicy::kAligned || signal == MemoryPolicy::kTransparentHugePages,
+                "SIPM_SIGNAL_MEMORY_POLICY must be kAligned or kTransparentHugePages");
+  static_assert(hits == MemoryPolicy::kAligned || hits == MemoryPolicy::kTransparentHugePages,
+                "SIPM_HIT_MEMORY_POLICY must be kAligned or kTransparentHugePages");
+};
+
 /** SiPMVector is an high performance version of std::vector<T>.
  * SiPMVector uses an aligned allocator that allocates memory
  * to 64 bits boundaries. This allows more efficient cache usage since
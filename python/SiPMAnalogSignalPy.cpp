@@ -7,7 +7,8 @@ using namespace sipm;
 using vectorf = std::vector<float>;
 
 void SiPMAnalogSignalPy(py::module& m) {
-  py::class_<SiPMAnalogSignal> sipmanalogsignal(m, "SiPMAnalogSignal");
+  // Samples are exposed with the buffer protocol: numpy.asarray(signal) does not copy them
+  py::class_<SiPMAnalogSignal> sipmanalogsignal(m, "SiPMAnalogSignal", py::buffer_protocol());
 
   sipmanalogsignal.def("size", &SiPMAnalogSignal::size)
     .def("sampling", &SiPMAnalogSignal::sampling)
@@ -18,5 +19,9 @@ void SiPMAnalogSignalPy(py::module& m) {
     .def("toa", &SiPMAnalogSignal::toa)
     .def("top", &SiPMAnalogSignal::top)
     .def("__len__", &SiPMAnalogSignal::size)
+    .def_buffer([](const SiPMAnalogSignal& obj) -> py::buffer_info {
+      return py::buffer_info(const_cast<float*>(obj.data()), sizeof(float), py::format_descriptor<float>::format(), 1,
+                             {obj.size()}, {sizeof(float)}, true);
+    })
     .def("__repr__", &SiPMAnalogSignal::toString);
 }
@@ -0,0 +1,34 @@
+#include "SiPMAsic.h"
+#include "SiPMSensor.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+using namespace sipm;
+
+void SiPMAsicPy(py::module& m) {
+  py::class_<SiPMAsicHit>(m, "SiPMAsicHit")
+    .def_readonly("time", &SiPMAsicHit::time)
+    .def_readonly("tot", &SiPMAsicHit::tot)
+    .def_readonly("charge", &SiPMAsicHit::charge)
+    .def_readonly("channel", &SiPMAsicHit::channel);
+
+  py::class_<SiPMAsic> sipmasic(m, "SiPMAsic");
+  sipmasic.def(py::init<const uint32_t, const SiPMProperties&>())
+    .def("setThresholds", &SiPMAsic::setThresholds)
+    .def("setTdc", &SiPMAsic::setTdc)
+    .def("setQdc", &SiPMAsic::setQdc, py::arg("gate"), py::arg("lsb"), py::arg("nBits") = 10)
+    .def("setDeadTime", &SiPMAsic::setDeadTime)
+    .def("setBuffers", &SiPMAsic::setBuffers)
+    .def("process", py::overload_cast<const SiPMSensor&, const uint32_t, const double>(&SiPMAsic::process))
+    .def("process", py::overload_cast<const SiPMAnalogSignal&, const uint32_t>(&SiPMAsic::process))
+    .def("hits", &SiPMAsic::hits)
+    .def("takeHits", &SiPMAsic::takeHits)
+    .def("nChannels", &SiPMAsic::nChannels)
+    .def("nRecords", &SiPMAsic::nRecords)
+    .def("nInvalid", &SiPMAsic::nInvalid)
+    .def("nDead", &SiPMAsic::nDead)
+    .def("nBusy", &SiPMAsic::nBusy)
+    .def("reset", &SiPMAsic::reset)
+    .def("__repr__", &SiPMAsic::toString);
+}
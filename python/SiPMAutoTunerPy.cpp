@@ -0,0 +1,29 @@
+#include "SiPMAutoTuner.h"
+#include "SiPMBatchRunner.h"
+#include "SiPMProperties.h"
+#include "SiPMSensor.h"
+#include <pybind11/pybind11.h>
+
+namespace py = pybind11;
+using namespace sipm;
+
+void SiPMAutoTunerPy(py::module& m) {
+  py::class_<SiPMTuning> sipmtuning(m, "SiPMTuning");
+  sipmtuning.def(py::init<>())
+    .def_readwrite("synthesisThreshold", &SiPMTuning::synthesisThreshold)
+    .def_readwrite("nThreads", &SiPMTuning::nThreads)
+    .def_readwrite("slicesPerThread", &SiPMTuning::slicesPerThread)
+    .def_readonly("cached", &SiPMTuning::cached)
+    .def("__repr__", &SiPMTuning::toString);
+
+  py::class_<SiPMAutoTuner> sipmautotuner(m, "SiPMAutoTuner");
+  sipmautotuner.def_static("cacheFile", &SiPMAutoTuner::cacheFile)
+    .def_static("setCacheFile", &SiPMAutoTuner::setCacheFile)
+    .def_static("cpuModel", &SiPMAutoTuner::cpuModel)
+    .def_static("tuning", &SiPMAutoTuner::tuning, py::arg("properties"), py::arg("nPhotons") = 100,
+                py::call_guard<py::gil_scoped_release>())
+    .def_static("tune", &SiPMAutoTuner::tune, py::arg("properties"), py::arg("nPhotons") = 100,
+                py::call_guard<py::gil_scoped_release>())
+    .def_static("apply", static_cast<void (*)(const SiPMTuning&, SiPMSensor&)>(&SiPMAutoTuner::apply))
+    .def_static("apply", static_cast<void (*)(const SiPMTuning&, SiPMBatchRunner&)>(&SiPMAutoTuner::apply));
+}
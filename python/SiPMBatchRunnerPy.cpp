@@ -0,0 +1,56 @@
+#include "SiPMBatchRunner.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+using namespace sipm;
+using std::vector;
+
+void SiPMBatchRunnerPy(py::module& m) {
+  py::class_<SiPMBatchRunner> sipmbatchrunner(m, "SiPMBatchRunner");
+  sipmbatchrunner.def(py::init<const SiPMSensor&, const uint32_t>(), py::arg("sensor"), py::arg("nThreads") = 0)
+    .def(py::init<const SiPMProperties&, const uint32_t>(), py::arg("properties"), py::arg("nThreads") = 0)
+    .def("setPlacement", &SiPMBatchRunner::setPlacement)
+    .def("placement", &SiPMBatchRunner::placement)
+    .def("setSeed", &SiPMBatchRunner::setSeed)
+    .def("setExecutor", &SiPMBatchRunner::setExecutor)
+    .def("executor", &SiPMBatchRunner::executor)
+    // Holder of python objects is shared_ptr<SiPMChannelTable>, not shared_ptr<const SiPMChannelTable>
+    .def("setChannelTable",
+         [](SiPMBatchRunner& self, std::shared_ptr<SiPMChannelTable> x) { self.setChannelTable(std::move(x)); })
+    .def("setOccupancy", &SiPMBatchRunner::setOccupancy)
+    .def("occupancy", &SiPMBatchRunner::occupancy, py::return_value_policy::reference_internal)
+    .def("resetOccupancy", &SiPMBatchRunner::resetOccupancy)
+    .def("latency", &SiPMBatchRunner::latency, py::return_value_policy::reference_internal)
+    .def("resetLatency", &SiPMBatchRunner::resetLatency)
+    .def("setSlowEventThreshold", &SiPMBatchRunner::setSlowEventThreshold)
+    .def("slowEventThreshold", &SiPMBatchRunner::slowEventThreshold)
+    .def("setReplayFile", &SiPMBatchRunner::setReplayFile)
+    .def("slowEvents", &SiPMBatchRunner::slowEvents)
+    .def("setMetrics", &SiPMBatchRunner::setMetrics)
+    .def("metrics", &SiPMBatchRunner::metrics)
+    .def("setMemoryBudget", &SiPMBatchRunner::setMemoryBudget)
+    .def("memoryBudget", &SiPMBatchRunner::memoryBudget)
+    .def("memoryUsage", &SiPMBatchRunner::memoryUsage)
+    .def("peakMemoryUsage", &SiPMBatchRunner::peakMemoryUsage)
+    .def("resetPeakMemoryUsage", &SiPMBatchRunner::resetPeakMemoryUsage)
+    .def("spilled", &SiPMBatchRunner::spilled)
+    .def("nDegradedEvents", &SiPMBatchRunner::nDegradedEvents)
+    .def("setNThreads", &SiPMBatchRunner::setNThreads)
+    .def("nThreads", &SiPMBatchRunner::nThreads)
+    .def("setSlicesPerThread", &SiPMBatchRunner::setSlicesPerThread)
+    .def("slicesPerThread", &SiPMBatchRunner::slicesPerThread)
+    .def("sensor", &SiPMBatchRunner::sensor, py::return_value_policy::reference_internal)
+    .def("setAutoTune", &SiPMBatchRunner::setAutoTune, py::arg("x"), py::arg("nPhotons") = 100)
+    .def("autoTune", &SiPMBatchRunner::autoTune)
+    .def("topology", &SiPMBatchRunner::topology)
+    .def("run", static_cast<void (SiPMBatchRunner::*)(const vector<vector<double>>&)>(&SiPMBatchRunner::run),
+         py::call_guard<py::gil_scoped_release>())
+    .def("run", static_cast<void (SiPMBatchRunner::*)(const SiPMPhotonSource&, const uint32_t)>(&SiPMBatchRunner::run),
+         py::call_guard<py::gil_scoped_release>())
+    .def("nEvents", &SiPMBatchRunner::nEvents)
+    .def("nSignalPoints", &SiPMBatchRunner::nSignalPoints)
+    .def("signal", &SiPMBatchRunner::signal)
+    .def("debug", &SiPMBatchRunner::debug)
+    .def("__repr__", &SiPMBatchRunner::toString);
+}
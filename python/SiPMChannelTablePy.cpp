@@ -0,0 +1,28 @@
+#include "SiPMChannelTable.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+using namespace sipm;
+
+void SiPMChannelTablePy(py::module& m) {
+  py::class_<SiPMChannelTable, std::shared_ptr<SiPMChannelTable>> sipmchanneltable(m, "SiPMChannelTable");
+  sipmchanneltable.def(py::init<>())
+    .def(py::init<const uint32_t, const SiPMProperties&>())
+    .def_static("open", &SiPMChannelTable::open)
+    .def("write", &SiPMChannelTable::write)
+    .def("size", &SiPMChannelTable::size)
+    .def("isMapped", &SiPMChannelTable::isMapped)
+    .def("overvoltage", &SiPMChannelTable::overvoltage)
+    .def("setOvervoltage", &SiPMChannelTable::setOvervoltage)
+    .def("gain", &SiPMChannelTable::gain)
+    .def("dcr", &SiPMChannelTable::dcr)
+    .def("xt", &SiPMChannelTable::xt)
+    .def("ap", &SiPMChannelTable::ap)
+    .def("breakdownOffset", &SiPMChannelTable::breakdownOffset)
+    .def("effectiveGain", &SiPMChannelTable::effectiveGain)
+    .def("set", &SiPMChannelTable::set, py::arg("ch"), py::arg("gain"), py::arg("dcr"), py::arg("xt"), py::arg("ap"),
+         py::arg("breakdownOffset") = 0)
+    .def("__len__", &SiPMChannelTable::size)
+    .def("__repr__", &SiPMChannelTable::toString);
+}
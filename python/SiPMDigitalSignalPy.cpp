@@ -0,0 +1,33 @@
+#include "SiPMDigitalSignal.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+using namespace sipm;
+using vectorf = std::vector<float>;
+
+void SiPMDigitalSignalPy(py::module& m) {
+  py::class_<SiPMDigitalFrame> sipmdigitalframe(m, "SiPMDigitalFrame");
+  sipmdigitalframe.def_readonly("count", &SiPMDigitalFrame::count)
+    .def_readonly("firstTime", &SiPMDigitalFrame::firstTime)
+    .def_readonly("triggerTime", &SiPMDigitalFrame::triggerTime)
+    .def_readonly("validated", &SiPMDigitalFrame::validated)
+    .def_readonly("integral", &SiPMDigitalFrame::integral);
+
+  py::class_<SiPMDigitalSignal> sipmdigitalsignal(m, "SiPMDigitalSignal");
+  sipmdigitalsignal.def("size", &SiPMDigitalSignal::size)
+    .def("length", &SiPMDigitalSignal::length)
+    .def("time", &SiPMDigitalSignal::time)
+    .def("row", &SiPMDigitalSignal::row)
+    .def("col", &SiPMDigitalSignal::col)
+    .def("times", &SiPMDigitalSignal::times<vectorf>)
+    .def("count", &SiPMDigitalSignal::count)
+    .def("firstTime", &SiPMDigitalSignal::firstTime)
+    .def("triggerTime", &SiPMDigitalSignal::triggerTime)
+    .def("frame", &SiPMDigitalSignal::frame, py::arg("start"), py::arg("gate"), py::arg("triggerThreshold") = 1,
+         py::arg("validationWindow") = 0, py::arg("validationThreshold") = 0, py::arg("integrationWindow") = 0)
+    .def("frames", &SiPMDigitalSignal::frames, py::arg("frameLength"), py::arg("triggerThreshold") = 1,
+         py::arg("validationWindow") = 0, py::arg("validationThreshold") = 0, py::arg("integrationWindow") = 0)
+    .def("__len__", &SiPMDigitalSignal::size)
+    .def("__repr__", &SiPMDigitalSignal::toString);
+}
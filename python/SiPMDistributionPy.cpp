@@ -0,0 +1,23 @@
+#include "SiPMDistribution.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+using namespace sipm;
+using std::vector;
+
+void SiPMDistributionPy(py::module& m) {
+  py::class_<SiPMDistribution> sipmdistribution(m, "SiPMDistribution");
+  sipmdistribution.def(py::init<>())
+    .def_static("fromPdf", &SiPMDistribution::fromPdf)
+    .def_static("fromHistogram", &SiPMDistribution::fromHistogram)
+    .def("size", &SiPMDistribution::size)
+    .def("min", &SiPMDistribution::min)
+    .def("max", &SiPMDistribution::max)
+    .def("mean", &SiPMDistribution::mean)
+    .def("sample", static_cast<double (SiPMDistribution::*)(SiPMRandom&) const noexcept>(&SiPMDistribution::sample))
+    .def("sample", static_cast<vector<double> (SiPMDistribution::*)(SiPMRandom&, const uint32_t) const>(
+                     &SiPMDistribution::sample))
+    .def("__len__", &SiPMDistribution::size)
+    .def("__repr__", &SiPMDistribution::toString);
+}
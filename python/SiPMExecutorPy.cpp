@@ -0,0 +1,25 @@
+#include "SiPMExecutor.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+using namespace sipm;
+
+void SiPMExecutorPy(py::module& m) {
+  py::class_<SiPMTopology> sipmtopology(m, "SiPMTopology");
+  sipmtopology.def_static("detect", &SiPMTopology::detect)
+    .def_readonly("nodes", &SiPMTopology::nodes)
+    .def("nNodes", &SiPMTopology::nNodes)
+    .def("nCpus", &SiPMTopology::nCpus)
+    .def("__repr__", &SiPMTopology::toString);
+
+  // Host executors wrap C++ pools and are not exposed
+  py::class_<SiPMExecutor, std::shared_ptr<SiPMExecutor>> sipmexecutor(m, "SiPMExecutor");
+  sipmexecutor.def("concurrency", &SiPMExecutor::concurrency)
+    .def_static("defaultExecutor", &SiPMExecutor::defaultExecutor)
+    .def_static("setDefaultExecutor", &SiPMExecutor::setDefaultExecutor);
+
+  py::class_<SiPMThreadPool, SiPMExecutor, std::shared_ptr<SiPMThreadPool>> sipmthreadpool(m, "SiPMThreadPool");
+  sipmthreadpool.def(py::init<const uint32_t, const bool>(), py::arg("nThreads") = 0, py::arg("pin") = false)
+    .def("pinned", &SiPMThreadPool::pinned);
+}
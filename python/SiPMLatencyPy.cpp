@@ -0,0 +1,19 @@
+#include "SiPMLatency.h"
+#include <pybind11/pybind11.h>
+
+namespace py = pybind11;
+using namespace sipm;
+
+void SiPMLatencyPy(py::module& m) {
+  py::class_<SiPMLatency> sipmlatency(m, "SiPMLatency");
+  sipmlatency.def(py::init<>())
+    .def("record", &SiPMLatency::record)
+    .def("merge", &SiPMLatency::merge)
+    .def("reset", &SiPMLatency::reset)
+    .def("count", &SiPMLatency::count)
+    .def("min", &SiPMLatency::min)
+    .def("max", &SiPMLatency::max)
+    .def("mean", &SiPMLatency::mean)
+    .def("quantile", &SiPMLatency::quantile)
+    .def("__repr__", &SiPMLatency::toString);
+}
@@ -0,0 +1,39 @@
+#include "SiPMMetrics.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+using namespace sipm;
+
+void SiPMMetricsPy(py::module& m) {
+  py::class_<SiPMMetrics, std::shared_ptr<SiPMMetrics>> sipmmetrics(m, "SiPMMetrics");
+  // Registered before the methods that use it as default argument
+  py::enum_<SiPMMetrics::Format>(sipmmetrics, "Format")
+    .value("kPrometheus", SiPMMetrics::Format::kPrometheus)
+    .value("kJson", SiPMMetrics::Format::kJson);
+
+  sipmmetrics.def(py::init<>())
+    .def("counter", &SiPMMetrics::counter, py::arg("name"), py::arg("help") = "")
+    .def("gauge", &SiPMMetrics::gauge, py::arg("name"), py::arg("help") = "")
+    .def("histogram", &SiPMMetrics::histogram, py::arg("name"), py::arg("bounds"), py::arg("help") = "")
+    .def_static("exponentialBounds", &SiPMMetrics::exponentialBounds)
+    .def("add", &SiPMMetrics::add, py::arg("id"), py::arg("n") = 1)
+    .def("observe", &SiPMMetrics::observe)
+    .def("set", &SiPMMetrics::set)
+    .def("addGauge", &SiPMMetrics::addGauge)
+    .def("value", &SiPMMetrics::value)
+    .def("gaugeValue", &SiPMMetrics::gaugeValue)
+    .def("bucketCounts", &SiPMMetrics::bucketCounts)
+    .def("count", &SiPMMetrics::count)
+    .def("sum", &SiPMMetrics::sum)
+    .def("nMetrics", &SiPMMetrics::nMetrics)
+    .def("find", &SiPMMetrics::find)
+    .def("write", &SiPMMetrics::write, py::arg("fname"), py::arg("format") = SiPMMetrics::Format::kPrometheus)
+    .def("startExport", &SiPMMetrics::startExport, py::arg("fname"), py::arg("period"),
+         py::arg("format") = SiPMMetrics::Format::kPrometheus)
+    .def("stopExport", &SiPMMetrics::stopExport, py::call_guard<py::gil_scoped_release>())
+    .def("__repr__", &SiPMMetrics::toString);
+
+  sipmmetrics.attr("invalidId") = SiPMMetrics::invalidId;
+
+}
@@ -0,0 +1,43 @@
+#include "SiPMNoiseModel.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+using namespace sipm;
+using std::vector;
+
+void SiPMNoiseModelPy(py::module& m) {
+  py::class_<SiPMNoiseModel> sipmnoisemodel(m, "SiPMNoiseModel");
+  py::enum_<SiPMNoiseModel::Type>(sipmnoisemodel, "Type")
+    .value("White", SiPMNoiseModel::Type::kWhite)
+    .value("Pink", SiPMNoiseModel::Type::kPink)
+    .value("Band", SiPMNoiseModel::Type::kBand);
+
+  py::class_<SiPMNoiseModel::Component>(sipmnoisemodel, "Component")
+    .def_readonly("type", &SiPMNoiseModel::Component::type)
+    .def_readonly("sigma", &SiPMNoiseModel::Component::sigma)
+    .def_readonly("fLow", &SiPMNoiseModel::Component::fLow)
+    .def_readonly("fHigh", &SiPMNoiseModel::Component::fHigh);
+
+  sipmnoisemodel.def(py::init<>())
+    .def("addWhite", &SiPMNoiseModel::addWhite, py::arg("sigma"))
+    .def("addPink", &SiPMNoiseModel::addPink, py::arg("sigma"), py::arg("fLow"), py::arg("fHigh"))
+    .def("addBand", &SiPMNoiseModel::addBand, py::arg("sigma"), py::arg("fLow"), py::arg("fHigh"))
+    .def_static("fromPsd", &SiPMNoiseModel::fromPsd, py::arg("freqs"), py::arg("psd"), py::arg("sampling"),
+                py::arg("maxComponents") = 4)
+    .def("prepare", &SiPMNoiseModel::prepare)
+    .def("sampling", &SiPMNoiseModel::sampling)
+    .def("empty", &SiPMNoiseModel::empty)
+    .def("nComponents", &SiPMNoiseModel::nComponents)
+    .def("components", &SiPMNoiseModel::components)
+    .def("nPoles", &SiPMNoiseModel::nPoles)
+    .def("sigma", &SiPMNoiseModel::sigma)
+    .def("psd", &SiPMNoiseModel::psd)
+    .def("generate",
+         [](const SiPMNoiseModel& self, SiPMRandom& rng, const uint32_t n) {
+           const SiPMVector<float> out = self.generate(rng, n);
+           return vector<float>(out.begin(), out.end());
+         })
+    .def("__len__", &SiPMNoiseModel::nComponents)
+    .def("__repr__", &SiPMNoiseModel::toString);
+}
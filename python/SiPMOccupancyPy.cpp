@@ -0,0 +1,30 @@
+#include "SiPMOccupancy.h"
+#include "SiPMSensor.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+using namespace sipm;
+
+void SiPMOccupancyPy(py::module& m) {
+  // Counters are exposed with the buffer protocol: numpy.asarray(occupancy)
+  // gives a (nHitTypes, nSideCells, nSideCells) array without copying
+  py::class_<SiPMOccupancy> sipmoccupancy(m, "SiPMOccupancy", py::buffer_protocol());
+  sipmoccupancy.def(py::init<const uint32_t>())
+    .def(py::init<const SiPMProperties&>())
+    .def("fill", &SiPMOccupancy::fill)
+    .def("merge", &SiPMOccupancy::merge)
+    .def("reset", &SiPMOccupancy::reset)
+    .def("nSideCells", &SiPMOccupancy::nSideCells)
+    .def("nEvents", &SiPMOccupancy::nEvents)
+    .def("count", py::overload_cast<const SiPMHit::HitType, const uint32_t, const uint32_t>(&SiPMOccupancy::count,
+                                                                                              py::const_))
+    .def("count", py::overload_cast<const uint32_t, const uint32_t>(&SiPMOccupancy::count, py::const_))
+    .def_buffer([](const SiPMOccupancy& obj) -> py::buffer_info {
+      const size_t n = obj.nSideCells();
+      return py::buffer_info(const_cast<uint64_t*>(obj.data()), sizeof(uint64_t),
+                             py::format_descriptor<uint64_t>::format(), 3, {size_t(SiPMOccupancy::nHitTypes), n, n},
+                             {sizeof(uint64_t) * n * n, sizeof(uint64_t) * n, sizeof(uint64_t)}, true);
+    })
+    .def("__repr__", &SiPMOccupancy::toString);
+}
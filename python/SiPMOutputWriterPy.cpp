@@ -0,0 +1,38 @@
+#include "SiPMAnalogSignal.h"
+#include "SiPMBatchRunner.h"
+#include "SiPMOutputWriter.h"
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+namespace py = pybind11;
+using namespace sipm;
+
+void SiPMOutputWriterPy(py::module& m) {
+  py::class_<SiPMOutputWriter> sipmoutputwriter(m, "SiPMOutputWriter");
+  sipmoutputwriter
+    .def(py::init<const std::string&, const size_t, const uint32_t, const bool>(), py::arg("fname"),
+         py::arg("bufferSize") = 64 << 20, py::arg("nBuffers") = 2, py::arg("direct") = false)
+    .def("good", &SiPMOutputWriter::good)
+    .def("direct", &SiPMOutputWriter::direct)
+    .def("fileName", &SiPMOutputWriter::fileName)
+    // Waits for a free buffer only if the disk is slower than the simulation
+    .def("write", static_cast<void (SiPMOutputWriter::*)(const SiPMBatchRunner&)>(&SiPMOutputWriter::write),
+         py::call_guard<py::gil_scoped_release>())
+    .def("write", static_cast<void (SiPMOutputWriter::*)(const SiPMAnalogSignal&)>(&SiPMOutputWriter::write),
+         py::call_guard<py::gil_scoped_release>())
+    .def("write",
+         [](SiPMOutputWriter& self, const py::array_t<float, py::array::c_style | py::array::forcecast>& x) {
+           self.write(x.data(), x.nbytes());
+         })
+    .def("flush", &SiPMOutputWriter::flush, py::call_guard<py::gil_scoped_release>())
+    .def("close", &SiPMOutputWriter::close, py::call_guard<py::gil_scoped_release>())
+    .def("size", &SiPMOutputWriter::size)
+    .def("bytesWritten", &SiPMOutputWriter::bytesWritten)
+    .def("writeSeconds", &SiPMOutputWriter::writeSeconds)
+    .def("bandwidth", &SiPMOutputWriter::bandwidth)
+    .def("stallSeconds", &SiPMOutputWriter::stallSeconds)
+    .def("__enter__", [](SiPMOutputWriter& self) -> SiPMOutputWriter& { return self; },
+         py::return_value_policy::reference)
+    .def("__exit__", [](SiPMOutputWriter& self, py::args) { self.close(); })
+    .def("__repr__", &SiPMOutputWriter::toString);
+}
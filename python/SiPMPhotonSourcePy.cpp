@@ -0,0 +1,45 @@
+#include "SiPMPhotonSource.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+using namespace sipm;
+
+void SiPMPhotonSourcePy(py::module& m) {
+  py::class_<SiPMPhotonSource, std::shared_ptr<SiPMPhotonSource>> sipmphotonsource(m, "SiPMPhotonSource");
+  sipmphotonsource.def("mean", &SiPMPhotonSource::mean)
+    .def("setMean", &SiPMPhotonSource::setMean)
+    .def("generate", py::overload_cast<SiPMRandom&>(&SiPMPhotonSource::generate, py::const_))
+    .def("__repr__", &SiPMPhotonSource::toString);
+
+  py::class_<SiPMPulseSource, SiPMPhotonSource, std::shared_ptr<SiPMPulseSource>>(m, "SiPMPulseSource")
+    .def(py::init<const double, const double, const double>(), py::arg("mean"), py::arg("t0"), py::arg("sigma") = 0)
+    .def("t0", &SiPMPulseSource::t0)
+    .def("sigma", &SiPMPulseSource::sigma);
+
+  py::class_<SiPMScintillatorSource, SiPMPhotonSource, std::shared_ptr<SiPMScintillatorSource>>(m, "SiPMScintillatorSource")
+    .def(py::init<const double, const double, const double, const double>(), py::arg("mean"), py::arg("t0"),
+         py::arg("riseTime"), py::arg("decayTime"))
+    .def("t0", &SiPMScintillatorSource::t0)
+    .def("riseTime", &SiPMScintillatorSource::riseTime)
+    .def("decayTime", &SiPMScintillatorSource::decayTime)
+    .def("decayTimeSlow", &SiPMScintillatorSource::decayTimeSlow)
+    .def("slowFraction", &SiPMScintillatorSource::slowFraction)
+    .def("transitTimeSpread", &SiPMScintillatorSource::transitTimeSpread)
+    .def("setSlowComponent", &SiPMScintillatorSource::setSlowComponent)
+    .def("setTransitTimeSpread", &SiPMScintillatorSource::setTransitTimeSpread);
+
+  py::class_<SiPMBackgroundSource, SiPMPhotonSource, std::shared_ptr<SiPMBackgroundSource>>(m, "SiPMBackgroundSource")
+    .def(py::init<const double, const double, const double>(), py::arg("rate"), py::arg("start"), py::arg("length"))
+    .def("rate", &SiPMBackgroundSource::rate)
+    .def("start", &SiPMBackgroundSource::start)
+    .def("length", &SiPMBackgroundSource::length);
+
+  py::class_<SiPMLaserSource, SiPMPhotonSource, std::shared_ptr<SiPMLaserSource>>(m, "SiPMLaserSource")
+    .def(py::init<const double, const double, const double, const uint32_t, const double>(), py::arg("meanPerPulse"),
+         py::arg("t0"), py::arg("period"), py::arg("nPulses"), py::arg("sigma") = 0)
+    .def("t0", &SiPMLaserSource::t0)
+    .def("period", &SiPMLaserSource::period)
+    .def("nPulses", &SiPMLaserSource::nPulses)
+    .def("sigma", &SiPMLaserSource::sigma);
+}
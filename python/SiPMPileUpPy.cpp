@@ -0,0 +1,26 @@
+#include "SiPMPileUp.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+using namespace sipm;
+using std::vector;
+
+void SiPMPileUpPy(py::module& m) {
+  py::class_<SiPMPileUp> sipmpileup(m, "SiPMPileUp");
+  sipmpileup.def(py::init<>())
+    .def("setCrossings", &SiPMPileUp::setCrossings, py::arg("spacing"), py::arg("first"), py::arg("last"))
+    // Holder of python objects is shared_ptr<SiPMPhotonSource>, not shared_ptr<const SiPMPhotonSource>
+    .def(
+      "addSource",
+      [](SiPMPileUp& self, std::shared_ptr<SiPMPhotonSource> source, const double offset, const double multiplicity,
+         const bool inTimeOnly) { return self.addSource(std::move(source), offset, multiplicity, inTimeOnly); },
+      py::arg("source"), py::arg("offset"), py::arg("multiplicity"), py::arg("inTimeOnly") = false)
+    .def("fillPool", &SiPMPileUp::fillPool)
+    .def("clearPool", &SiPMPileUp::clearPool)
+    .def("nSources", &SiPMPileUp::nSources)
+    .def("poolSize", &SiPMPileUp::poolSize)
+    .def("nInteractions", &SiPMPileUp::nInteractions)
+    .def("generate", static_cast<vector<double> (SiPMPileUp::*)(SiPMRandom&)>(&SiPMPileUp::generate))
+    .def("__repr__", &SiPMPileUp::toString);
+}
@@ -24,6 +24,7 @@ void SiPMPropertiesPy(py::module& m) {
     .def("fallingTimeSlow", &SiPMProperties::fallingTimeSlow)
     .def("slowComponentFraction", &SiPMProperties::slowComponentFraction)
     .def("recoveryTime", &SiPMProperties::recoveryTime)
+    .def("deadTime", &SiPMProperties::deadTime)
     .def("dcr", &SiPMProperties::dcr)
     .def("xt", &SiPMProperties::xt)
     .def("dxt", &SiPMProperties::dxt)
@@ -33,6 +34,7 @@ void SiPMPropertiesPy(py::module& m) {
     .def("tauApSlow", &SiPMProperties::tauApSlow)
     .def("apSlowFraction", &SiPMProperties::apSlowFraction)
     .def("ccgv", &SiPMProperties::ccgv)
+    .def("sptr", &SiPMProperties::sptr)
     .def("snrdB", &SiPMProperties::snrdB)
     .def("snrLinear", &SiPMProperties::snrLinear)
     .def("pde", &SiPMProperties::pde)
@@ -53,11 +55,13 @@ void SiPMPropertiesPy(py::module& m) {
     .def("setFallTimeSlow", &SiPMProperties::setFallTimeSlow)
     .def("setSlowComponentFraction", &SiPMProperties::setSlowComponentFraction)
     .def("setRecoveryTime", &SiPMProperties::setRecoveryTime)
+    .def("setDeadTime", &SiPMProperties::setDeadTime)
     .def("setSnr", &SiPMProperties::setSnr)
     .def("setTauApFastComponent", &SiPMProperties::setTauApFastComponent)
     .def("setTauApSlowComponent", &SiPMProperties::setTauApSlowComponent)
     .def("setTauApSlowFraction", &SiPMProperties::setTauApSlowFraction)
     .def("setCcgv", &SiPMProperties::setCcgv)
+    .def("setSptr", &SiPMProperties::setSptr)
     .def("setPde", &SiPMProperties::setPde)
     .def("setDcr", &SiPMProperties::setDcr)
     .def("setXt", &SiPMProperties::setXt)
@@ -78,6 +82,7 @@ void SiPMPropertiesPy(py::module& m) {
     .def("setPdeSpectrum",
          py::overload_cast<const vector<double>&, const vector<double>&>(&SiPMProperties::setPdeSpectrum))
     .def("setHitDistribution", &SiPMProperties::setHitDistribution)
+    .def("hash", &SiPMProperties::hash)
     .def("__repr__", &SiPMProperties::toString);
 
   py::enum_<SiPMProperties::PdeType>(sipmproperties, "PdeType")
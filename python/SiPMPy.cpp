@@ -7,18 +7,50 @@ namespace py = pybind11;
 
 void SiPMPropertiesPy(py::module&);
 void SiPMAnalogSignalPy(py::module&);
+void SiPMDigitalSignalPy(py::module&);
 void SiPMDebugInfoPy(py::module&);
 void SiPMHitPy(py::module&);
 void SiPMSensorPy(py::module&);
 void SiPMRandomPy(py::module&);
+void SiPMPhotonSourcePy(py::module&);
+void SiPMPileUpPy(py::module&);
+void SiPMDistributionPy(py::module&);
+void SiPMNoiseModelPy(py::module&);
+void SiPMExecutorPy(py::module&);
+void SiPMChannelTablePy(py::module&);
+void SiPMBatchRunnerPy(py::module&);
+void SiPMOccupancyPy(py::module&);
+void SiPMTriggerPy(py::module&);
+void SiPMAsicPy(py::module&);
+void SiPMLatencyPy(py::module&);
+void SiPMReplayPy(py::module&);
+void SiPMMetricsPy(py::module&);
+void SiPMOutputWriterPy(py::module&);
+void SiPMAutoTunerPy(py::module&);
 
 PYBIND11_MODULE(SiPM, m) {
   m.doc() = "Module for SiPM simulation";
   m.attr("__version__") = SIPM_VERSION;
   SiPMPropertiesPy(m);
   SiPMAnalogSignalPy(m);
+  SiPMDigitalSignalPy(m);
   SiPMDebugInfoPy(m);
   SiPMHitPy(m);
+  SiPMLatencyPy(m);
   SiPMSensorPy(m);
   SiPMRandomPy(m);
+  SiPMPhotonSourcePy(m);
+  SiPMPileUpPy(m);
+  SiPMDistributionPy(m);
+  SiPMNoiseModelPy(m);
+  SiPMExecutorPy(m);
+  SiPMChannelTablePy(m);
+  SiPMOccupancyPy(m);
+  SiPMReplayPy(m);
+  SiPMMetricsPy(m);
+  SiPMBatchRunnerPy(m);
+  SiPMOutputWriterPy(m);
+  SiPMAutoTunerPy(m);
+  SiPMTriggerPy(m);
+  SiPMAsicPy(m);
 }
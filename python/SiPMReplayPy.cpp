@@ -0,0 +1,34 @@
+#include "SiPMReplay.h"
+#include "SiPMSensor.h"
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <vector>
+
+namespace py = pybind11;
+using namespace sipm;
+
+void SiPMReplayPy(py::module& m) {
+  py::class_<SiPMSlowEvent> sipmslowevent(m, "SiPMSlowEvent");
+  sipmslowevent.def(py::init<>())
+    .def_readwrite("event", &SiPMSlowEvent::event)
+    .def_readwrite("channel", &SiPMSlowEvent::channel)
+    .def_readwrite("latency", &SiPMSlowEvent::latency)
+    .def_readwrite("sensorHash", &SiPMSlowEvent::sensorHash)
+    .def_readwrite("memoryBudget", &SiPMSlowEvent::memoryBudget)
+    .def_property(
+      "rngState", [](const SiPMSlowEvent& ev) { return std::vector<uint64_t>(ev.rngState, ev.rngState + 4); },
+      [](SiPMSlowEvent& ev, const std::vector<uint64_t>& x) {
+        for (size_t i = 0; i < 4 && i < x.size(); ++i) {
+          ev.rngState[i] = x[i];
+        }
+      })
+    .def_readwrite("photonTimes", &SiPMSlowEvent::photonTimes)
+    .def_readwrite("photonWavelengths", &SiPMSlowEvent::photonWavelengths)
+    .def_readwrite("photonCells", &SiPMSlowEvent::photonCells);
+
+  py::class_<SiPMReplay> sipmreplay(m, "SiPMReplay");
+  sipmreplay.def_static("write", &SiPMReplay::write)
+    .def_static("read", &SiPMReplay::read)
+    .def_static("replay", &SiPMReplay::replay);
+}
@@ -1,10 +1,27 @@
 #include "SiPMSensor.h"
 #include <pybind11/iostream.h>
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <vector>
+
 namespace py = pybind11;
 using namespace sipm;
+using arrayd = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+namespace {
+// Features of the signal returned by runAndExtract
+constexpr size_t nFeatures = 5;
+void extract(const SiPMAnalogSignal& signal, const double start, const double gate, const double threshold,
+             double* out) {
+  out[0] = signal.integral(start, gate, threshold);
+  out[1] = signal.peak(start, gate, threshold);
+  out[2] = signal.toa(start, gate, threshold);
+  out[3] = signal.tot(start, gate, threshold);
+  out[4] = signal.top(start, gate, threshold);
+}
+} // namespace
 
 void SiPMSensorPy(py::module& m) {
   py::class_<SiPMSensor, std::shared_ptr<SiPMSensor>> sipmsensor(m, "SiPMSensor");
@@ -15,16 +32,137 @@ void SiPMSensorPy(py::module& m) {
     .def("hits", &SiPMSensor::hits)
     .def("hitsGraph", &SiPMSensor::hitsGraph)
     .def("signal", &SiPMSensor::signal)
+    // Waveform of the sensor as a read-only numpy array without copy. The array keeps the
+    // sensor alive but it is valid only until the next event, which overwrites the samples
+    .def("signalView",
+         [](py::object self) {
+           const SiPMAnalogSignal& signal = self.cast<const SiPMSensor&>().signalView();
+           py::array_t<float> view({signal.size()}, {sizeof(float)}, signal.data(), self);
+           view.attr("setflags")(py::arg("write") = false);
+           return view;
+         })
+    // Waveform of the sensor copied once in a numpy array that owns its samples
+    .def("signalCopy",
+         [](const SiPMSensor& self) {
+           const SiPMAnalogSignal& signal = self.signalView();
+           return py::array_t<float>(signal.size(), signal.data());
+         })
+    .def("digitalSignal", &SiPMSensor::digitalSignal)
+    .def("orderStatistic", &SiPMSensor::orderStatistic)
+    .def("orderStatistics", &SiPMSensor::orderStatistics)
     .def("rng", static_cast<const SiPMRandom (SiPMSensor::*)() const>(&SiPMSensor::rng))
     .def("debug", &SiPMSensor::debug)
     .def("setProperty", &SiPMSensor::setProperty)
     .def("setProperties", &SiPMSensor::setProperties)
+    .def("setPrecision", &SiPMSensor::setPrecision)
+    .def("precision", &SiPMSensor::precision)
+    .def("setReadout", &SiPMSensor::setReadout)
+    .def("readout", &SiPMSensor::readout)
+    .def("setSynthesis", &SiPMSensor::setSynthesis)
+    .def("synthesis", &SiPMSensor::synthesis)
+    .def("setSynthesisThreshold", &SiPMSensor::setSynthesisThreshold)
+    .def("synthesisThreshold", &SiPMSensor::synthesisThreshold)
+    .def("setRealTime", &SiPMSensor::setRealTime)
+    .def("maxHits", &SiPMSensor::maxHits)
+    .def("nDroppedHits", &SiPMSensor::nDroppedHits)
+    .def("setMemoryBudget", &SiPMSensor::setMemoryBudget)
+    .def("memoryBudget", &SiPMSensor::memoryBudget)
+    .def("memoryUsage", &SiPMSensor::memoryUsage)
+    .def("peakMemoryUsage", &SiPMSensor::peakMemoryUsage)
+    .def("resetPeakMemoryUsage", &SiPMSensor::resetPeakMemoryUsage)
+    .def("releaseMemory", &SiPMSensor::releaseMemory)
+    .def("latency", &SiPMSensor::latency)
+    .def("resetLatency", &SiPMSensor::resetLatency)
+    .def("setApDelayDistribution", &SiPMSensor::setApDelayDistribution)
+    .def("setDXtDelayDistribution", &SiPMSensor::setDXtDelayDistribution)
+    .def("setNoiseModel", &SiPMSensor::setNoiseModel)
+    .def("noiseModel", &SiPMSensor::noiseModel)
+    .def("setChannel", &SiPMSensor::setChannel)
+    .def("channel", &SiPMSensor::channel)
+    .def("hash", &SiPMSensor::hash)
+    .def("isSignalBuilt", &SiPMSensor::isSignalBuilt)
     .def("addPhoton", py::overload_cast<const double>(&SiPMSensor::addPhoton))
     .def("addPhoton", py::overload_cast<const double, const double>(&SiPMSensor::addPhoton))
+    // Numpy arrays are read in place (overloads tried before the list versions)
+    .def("addPhotons", [](SiPMSensor& sensor, const arrayd& t) { sensor.addPhotons(t.data(), t.size()); })
+    .def("addPhotons",
+         [](SiPMSensor& sensor, const arrayd& t, const arrayd& w) {
+           if (t.size() != w.size()) {
+             std::cerr << "Photon times and wavelengths must have the same size!" << std::endl;
+             return;
+           }
+           sensor.addPhotons(t.data(), w.data(), t.size());
+         })
     .def("addPhotons", py::overload_cast<const std::vector<double>&>(&SiPMSensor::addPhotons))
     .def("addPhotons",
          py::overload_cast<const std::vector<double>&, const std::vector<double>&>(&SiPMSensor::addPhotons))
+    .def("addPhoton", py::overload_cast<const double, const double, const double>(&SiPMSensor::addPhoton))
+    .def("addPhoton",
+         py::overload_cast<const double, const double, const double, const double>(&SiPMSensor::addPhoton))
+    .def("addPhotons", py::overload_cast<const std::vector<double>&, const std::vector<double>&,
+                                         const std::vector<double>&>(&SiPMSensor::addPhotons))
+    .def("addPhotons", py::overload_cast<const std::vector<double>&, const std::vector<double>&,
+                                         const std::vector<double>&, const std::vector<double>&>(&SiPMSensor::addPhotons))
+    .def("addPhotons", py::overload_cast<const SiPMPhotonSource&>(&SiPMSensor::addPhotons))
+    .def("addPhotons", py::overload_cast<SiPMPileUp&>(&SiPMSensor::addPhotons))
+    .def("appendPhotons", py::overload_cast<const std::vector<double>&>(&SiPMSensor::appendPhotons))
+    .def("appendPhotons",
+         py::overload_cast<const std::vector<double>&, const std::vector<double>&>(&SiPMSensor::appendPhotons))
     .def("runEvent", &SiPMSensor::runEvent)
+    // Reset, input, event and features (integral, peak, toa, tot, top) in a single call
+    .def(
+      "runAndExtract",
+      [](SiPMSensor& sensor, const arrayd& t, const double start, const double gate, const double threshold) {
+        double features[nFeatures];
+        const double* times = t.data();
+        const uint32_t n = t.size();
+        {
+          py::gil_scoped_release release;
+          sensor.resetState();
+          sensor.addPhotons(times, n);
+          sensor.runEvent();
+          extract(sensor.signalView(), start, gate, threshold, features);
+        }
+        return py::make_tuple(features[0], features[1], features[2], features[3], features[4]);
+      },
+      py::arg("times"), py::arg("intStart"), py::arg("intGate"), py::arg("threshold"))
+    // Same for a list of events, returns a (nEvents, 5) array
+    .def(
+      "runAndExtract",
+      [](SiPMSensor& sensor, const std::vector<arrayd>& events, const double start, const double gate,
+         const double threshold) {
+        py::array_t<double> out({events.size(), nFeatures});
+        double* features = out.mutable_data();
+        std::vector<const double*> times(events.size());
+        std::vector<uint32_t> sizes(events.size());
+        for (size_t i = 0; i < events.size(); ++i) {
+          times[i] = events[i].data();
+          sizes[i] = events[i].size();
+        }
+        py::gil_scoped_release release;
+        for (size_t i = 0; i < events.size(); ++i) {
+          sensor.resetState();
+          sensor.addPhotons(times[i], sizes[i]);
+          sensor.runEvent();
+          extract(sensor.signalView(), start, gate, threshold, features + i * nFeatures);
+        }
+        return out;
+      },
+      py::arg("events"), py::arg("intStart"), py::arg("intGate"), py::arg("threshold"))
     .def("resetState", &SiPMSensor::resetState)
     .def("__repr__", &SiPMSensor::toString);
+
+  py::enum_<SiPMSensor::Precision>(sipmsensor, "Precision")
+    .value("kDouble", SiPMSensor::Precision::kDouble)
+    .value("kSingle", SiPMSensor::Precision::kSingle);
+
+  py::enum_<SiPMSensor::Readout>(sipmsensor, "Readout")
+    .value("kAnalog", SiPMSensor::Readout::kAnalog)
+    .value("kDigital", SiPMSensor::Readout::kDigital)
+    .value("kTiming", SiPMSensor::Readout::kTiming);
+
+  py::enum_<SiPMSensor::Synthesis>(sipmsensor, "Synthesis")
+    .value("kDirect", SiPMSensor::Synthesis::kDirect)
+    .value("kRecursive", SiPMSensor::Synthesis::kRecursive)
+    .value("kAuto", SiPMSensor::Synthesis::kAuto);
 }
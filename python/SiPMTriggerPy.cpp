@@ -0,0 +1,40 @@
+#include "SiPMTrigger.h"
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+using namespace sipm;
+
+void SiPMTriggerPy(py::module& m) {
+  py::class_<SiPMTriggerWindow>(m, "SiPMTriggerWindow")
+    .def_readonly("time", &SiPMTriggerWindow::time)
+    .def_readonly("firstSample", &SiPMTriggerWindow::firstSample)
+    .def_readonly("length", &SiPMTriggerWindow::length)
+    .def_readonly("channels", &SiPMTriggerWindow::channels)
+    .def("samples", [](const SiPMTriggerWindow& w) {
+      const size_t nChannels = w.length ? w.samples.size() / w.length : 0;
+      return py::array_t<float>({nChannels, size_t(w.length)}, w.samples.data());
+    });
+
+  py::class_<SiPMTrigger> sipmtrigger(m, "SiPMTrigger");
+  sipmtrigger.def(py::init<const uint32_t, const double>())
+    .def("setLeadingEdge", &SiPMTrigger::setLeadingEdge)
+    .def("setConstantFraction", &SiPMTrigger::setConstantFraction)
+    .def("setCoincidence", &SiPMTrigger::setCoincidence)
+    .def("setDeadTime", &SiPMTrigger::setDeadTime)
+    .def("setWindow", &SiPMTrigger::setWindow)
+    .def("process", py::overload_cast<const std::vector<SiPMAnalogSignal>&>(&SiPMTrigger::process))
+    .def("flush", &SiPMTrigger::flush)
+    .def("takeWindows", &SiPMTrigger::takeWindows)
+    .def("nWindows", &SiPMTrigger::nWindows)
+    .def("nTriggers", &SiPMTrigger::nTriggers)
+    .def("nSamples", &SiPMTrigger::nSamples)
+    .def("nChannels", &SiPMTrigger::nChannels)
+    .def("reset", &SiPMTrigger::reset)
+    .def("__repr__", &SiPMTrigger::toString);
+
+  py::enum_<SiPMTrigger::Discriminator>(sipmtrigger, "Discriminator")
+    .value("LeadingEdge", SiPMTrigger::Discriminator::kLeadingEdge)
+    .value("ConstantFraction", SiPMTrigger::Discriminator::kConstantFraction);
+}
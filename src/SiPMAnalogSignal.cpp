@@ -6,7 +6,9 @@
 
 namespace sipm {
 
-template <> auto SiPMAnalogSignal::waveform<SiPMVector<float>>() const -> SiPMVector<float> { return m_Waveform; }
+template <> auto SiPMAnalogSignal::waveform<SiPMVector<float>>() const -> SiPMVector<float> {
+  return SiPMVector<float>(m_Waveform.cbegin(), m_Waveform.cend());
+}
 
 template <> auto SiPMAnalogSignal::waveform<std::vector<float>>() const -> std::vector<float> {
   return std::vector<float>(m_Waveform.cbegin(), m_Waveform.cend());
@@ -0,0 +1,360 @@
+#include "SiPMAsic.h"
+#include "SiPMHit.h"
+#include "SiPMSensor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace sipm {
+SiPMAsic::SiPMAsic(const uint32_t nChannels, const SiPMProperties& properties)
+  : m_RateRise(1 / properties.risingTime()), m_RateFast(1 / properties.fallingTimeFast()),
+    m_RateSlow(1 / properties.fallingTimeSlow()),
+    m_SlowFraction(properties.hasSlowComponent() ? properties.slowComponentFraction() : 0), m_Gain(properties.gain()),
+    m_Sampling(properties.sampling()), m_SignalLength(properties.signalLength()), m_Channels(nChannels) {
+  // Normalize pulse to unit height as done for the waveform
+  const double a = 1 - m_SlowFraction;
+  const double b = m_SlowFraction;
+  m_Peak = shape(a, b, 1, peakTime(a, b, 1, 10 * properties.fallingTimeFast()));
+  setBuffers(m_NBuffers, m_ConversionTime);
+}
+
+void SiPMAsic::setThresholds(const double timing, const double validation) {
+  if (validation < timing) {
+    std::cerr << "Validation threshold must not be lower than timing threshold!" << std::endl;
+    return;
+  }
+  m_TimingThreshold = timing;
+  m_ValidationThreshold = validation;
+}
+
+void SiPMAsic::setQdc(const double gate, const double lsb, const uint32_t nBits) {
+  if (nBits == 0 || nBits > 16) {
+    std::cerr << "Number of bits of QDC must be between 1 and 16!" << std::endl;
+    return;
+  }
+  m_Gate = gate;
+  m_QdcLsb = lsb;
+  m_QdcMax = (1u << nBits) - 1;
+}
+
+void SiPMAsic::setBuffers(const uint32_t nBuffers, const double conversionTime) {
+  if (nBuffers == 0) {
+    std::cerr << "Number of buffers must be at least 1!" << std::endl;
+    return;
+  }
+  m_NBuffers = nBuffers;
+  m_ConversionTime = conversionTime;
+  for (Channel& ch : m_Channels) {
+    ch.busyUntil.assign(m_NBuffers, -std::numeric_limits<double>::infinity());
+  }
+}
+
+void SiPMAsic::reset() {
+  for (Channel& ch : m_Channels) {
+    ch = Channel();
+  }
+  setBuffers(m_NBuffers, m_ConversionTime);
+  m_Hits.clear();
+  m_NRecords = 0;
+  m_NInvalid = 0;
+  m_NDead = 0;
+  m_NBusy = 0;
+}
+
+std::vector<SiPMAsicHit> SiPMAsic::takeHits() {
+  std::vector<SiPMAsicHit> out;
+  out.swap(m_Hits);
+  return out;
+}
+
+// Primitive of each exponential evaluated between dt and dt + gate
+double SiPMAsic::shapeIntegral(const double a, const double b, const double c, const double dt,
+                               const double gate) const {
+  auto term = [&](const double k, const double rate) {
+    return k / rate * (std::exp(-dt * rate) - std::exp(-(dt + gate) * rate));
+  };
+  return term(a, m_RateFast) + term(b, m_RateSlow) - term(c, m_RateRise);
+}
+
+/**
+ * The rising term decays faster than the others, so the slope of the pulse
+ * changes sign at most once and the pulse has a single maximum.
+ * @return Time of the maximum of the pulse in [0, dtMax]
+ */
+double SiPMAsic::peakTime(const double a, const double b, const double c, const double dtMax) const {
+  if (shapeSlope(a, b, c, 0) <= 0) {
+    return 0;
+  }
+  if (shapeSlope(a, b, c, dtMax) >= 0) {
+    return dtMax;
+  }
+  double lo = 0;
+  double hi = dtMax;
+  for (uint32_t i = 0; i < 64 && hi - lo > 1e-6; ++i) {
+    const double mid = 0.5 * (lo + hi);
+    if (shapeSlope(a, b, c, mid) > 0) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return 0.5 * (lo + hi);
+}
+
+/**
+ * Pulse must be monotonic in [lo, hi] and cross the threshold in it.
+ * @return Time at which the pulse crosses the threshold
+ */
+double SiPMAsic::crossing(const double a, const double b, const double c, double lo, double hi,
+                          const double threshold) const {
+  const bool rising = shape(a, b, c, lo) < shape(a, b, c, hi);
+  for (uint32_t i = 0; i < 64 && hi - lo > 1e-6; ++i) {
+    const double mid = 0.5 * (lo + hi);
+    if ((shape(a, b, c, mid) > threshold) == rising) {
+      hi = mid;
+    } else {
+      lo = mid;
+    }
+  }
+  return 0.5 * (lo + hi);
+}
+
+/**
+ * A pulse arriving while the channel is dead only moves the discriminator,
+ * the hit being built is not modified.
+ * @param ch Channel
+ * @param time Time of the crossing of the timing threshold
+ * @return False if the pulse is lost because the channel is dead
+ */
+bool SiPMAsic::arm(Channel& ch, const double time) {
+  ch.above = true;
+  ch.lost = time < ch.deadUntil || ch.integrating;
+  if (ch.lost) {
+    ++m_NDead;
+    return false;
+  }
+  ch.validated = false;
+  ch.ended = false;
+  ch.start = time;
+  ch.charge = 0;
+  return true;
+}
+
+// Called once the pulse is below threshold and the charge is integrated
+void SiPMAsic::finish(Channel& ch, const uint32_t channel) {
+  if (!ch.validated) {
+    ++m_NInvalid;
+    return;
+  }
+  const double end = std::max(ch.end, ch.start + m_Gate);
+  ch.deadUntil = end + m_DeadTime;
+
+  // Hit is lost if all buffers are still converting previous hits
+  auto buffer = std::min_element(ch.busyUntil.begin(), ch.busyUntil.end());
+  if (*buffer > ch.start) {
+    ++m_NBusy;
+    return;
+  }
+  *buffer = end + m_ConversionTime;
+
+  const int64_t start = std::floor(ch.start / m_TdcBin);
+  const int64_t stop = std::floor(ch.end / m_TdcBin);
+  const double counts = std::floor(ch.charge / m_QdcLsb);
+  SiPMAsicHit hit;
+  hit.time = start;
+  hit.tot = std::clamp<int64_t>(stop - start, 0, std::numeric_limits<uint32_t>::max());
+  hit.charge = std::clamp<double>(counts, 0, m_QdcMax);
+  hit.channel = channel;
+  m_Hits.push_back(hit);
+  ++m_NRecords;
+}
+
+/**
+ * Runs the discriminator between hit k and the following one. The pulse is
+ * the sum of three exponentials (m_A, m_B, m_C at the time of hit k) and has
+ * a single maximum, so crossings are found by bisection only when the value
+ * at the end of the interval or the maximum require it.
+ * @param ch Channel
+ * @param channel Index of the channel
+ * @param k Index of the hit at the start of the interval
+ * @param t0 Time of the start of the event in ns
+ */
+void SiPMAsic::processInterval(Channel& ch, const uint32_t channel, const uint32_t k, const double t0) {
+  const uint32_t nHits = m_HitTimes.size();
+  const double t = m_HitTimes[k];
+  // After the last hit the pulse is followed until the end of the window
+  const bool last = k + 1 == nHits;
+  const double len = last ? m_SignalLength - t : m_HitTimes[k + 1] - t;
+  const double a = m_A;
+  const double b = m_B;
+  const double c = m_C;
+  const double end = shape(a, b, c, len);
+  double peak = -1;
+
+  if (!ch.above) {
+    // Pulse is bounded by a + b: most intervals end here
+    if (a + b <= m_TimingThreshold) {
+      return;
+    }
+    double hi = len;
+    if (end <= m_TimingThreshold) {
+      peak = peakTime(a, b, c, len);
+      if (shape(a, b, c, peak) <= m_TimingThreshold) {
+        return;
+      }
+      hi = peak;
+    }
+    const double dt = crossing(a, b, c, 0, hi, m_TimingThreshold);
+    if (arm(ch, t0 + t + dt)) {
+      // Charge of hits up to k and of following hits in the gate
+      double charge = shapeIntegral(a, b, c, dt, m_Gate);
+      const double gateEnd = t + dt + m_Gate;
+      for (uint32_t j = k + 1; j < nHits && m_HitTimes[j] < gateEnd; ++j) {
+        const double amplitude = m_HitAmplitudes[j];
+        charge += shapeIntegral(amplitude * (1 - m_SlowFraction), amplitude * m_SlowFraction, amplitude, 0,
+                                gateEnd - m_HitTimes[j]);
+      }
+      ch.charge = charge;
+    }
+  }
+
+  if (!ch.lost && !ch.validated && a + b > m_ValidationThreshold) {
+    if (end >= m_ValidationThreshold) {
+      ch.validated = true;
+    } else {
+      if (peak < 0) {
+        peak = peakTime(a, b, c, len);
+      }
+      ch.validated = shape(a, b, c, peak) >= m_ValidationThreshold;
+    }
+  }
+
+  if (end < m_TimingThreshold) {
+    if (peak < 0) {
+      peak = peakTime(a, b, c, len);
+    }
+    ch.above = false;
+    if (!ch.lost) {
+      ch.end = t0 + t + crossing(a, b, c, peak, len, m_TimingThreshold);
+      finish(ch, channel);
+    }
+  } else if (last && ch.above) {
+    // Pulse is truncated at the end of the window as the waveform
+    ch.above = false;
+    if (!ch.lost) {
+      ch.end = t0 + m_SignalLength;
+      finish(ch, channel);
+    }
+  }
+}
+
+void SiPMAsic::process(const SiPMSensor& sensor, const uint32_t channel, const double t0) {
+  if (channel >= m_Channels.size()) {
+    std::cerr << "Channel " << channel << " is out of range!" << std::endl;
+    return;
+  }
+  if (sensor.readout() != SiPMSensor::Readout::kAnalog) {
+    std::cerr << "Hits must have amplitudes: use analog readout!" << std::endl;
+    return;
+  }
+  // Hits in the signal window (already sorted by time) in units of the signal
+  const double scale = m_Gain * sensor.m_GainScale / m_Peak;
+  m_HitTimes.clear();
+  m_HitAmplitudes.clear();
+  for (const SiPMHit& hit : sensor.m_Hits) {
+    if (hit.time() >= 0 && hit.time() < m_SignalLength) {
+      m_HitTimes.push_back(hit.time());
+      m_HitAmplitudes.push_back(hit.amplitude() * scale);
+    }
+  }
+
+  Channel& ch = m_Channels[channel];
+  m_A = 0;
+  m_B = 0;
+  m_C = 0;
+  const uint32_t nHits = m_HitTimes.size();
+  for (uint32_t k = 0; k < nHits; ++k) {
+    if (k > 0) {
+      const double dt = m_HitTimes[k] - m_HitTimes[k - 1];
+      m_A *= std::exp(-dt * m_RateFast);
+      m_B *= std::exp(-dt * m_RateSlow);
+      m_C *= std::exp(-dt * m_RateRise);
+    }
+    const double amplitude = m_HitAmplitudes[k];
+    m_A += amplitude * (1 - m_SlowFraction);
+    m_B += amplitude * m_SlowFraction;
+    m_C += amplitude;
+    processInterval(ch, channel, k, t0);
+  }
+}
+
+void SiPMAsic::process(const SiPMAnalogSignal& signal, const uint32_t channel) {
+  if (channel >= m_Channels.size()) {
+    std::cerr << "Channel " << channel << " is out of range!" << std::endl;
+    return;
+  }
+  Channel& ch = m_Channels[channel];
+  const uint32_t nSamples = signal.size();
+  const double sampling = signal.sampling();
+  const float* data = signal.data();
+  for (uint32_t s = 0; s < nSamples; ++s) {
+    const double time = ch.time + s * sampling;
+    const float x = data[s];
+    if (!ch.above && ch.last <= m_TimingThreshold && x > m_TimingThreshold) {
+      const double frac = (m_TimingThreshold - ch.last) / (x - ch.last);
+      if (arm(ch, time - (1 - frac) * sampling)) {
+        ch.integrating = true;
+      }
+    }
+    if (ch.integrating) {
+      if (time < ch.start + m_Gate) {
+        ch.charge += x * sampling;
+      } else {
+        ch.integrating = false;
+        if (ch.ended) {
+          finish(ch, channel);
+        }
+      }
+    }
+    if (ch.above) {
+      if (!ch.lost) {
+        ch.validated |= x >= m_ValidationThreshold;
+      }
+      if (x <= m_TimingThreshold) {
+        ch.above = false;
+        if (!ch.lost) {
+          const double frac = (ch.last - m_TimingThreshold) / (ch.last - x);
+          ch.end = time - (1 - frac) * sampling;
+          ch.ended = true;
+          // Pulses not validated do not wait for the end of the gate
+          if (!ch.validated) {
+            ch.integrating = false;
+          }
+          if (!ch.integrating) {
+            finish(ch, channel);
+          }
+        }
+      }
+    }
+    ch.last = x;
+  }
+  ch.time += nSamples * sampling;
+}
+
+std::ostream& operator<<(std::ostream& out, const SiPMAsic& obj) {
+  out << std::setprecision(2) << std::fixed;
+  out << "===> SiPM Asic <===\n";
+  out << "Address: " << std::addressof(obj) << "\n";
+  out << "Number of channels: " << obj.m_Channels.size() << "\n";
+  out << "Thresholds: " << obj.m_TimingThreshold << " timing, " << obj.m_ValidationThreshold << " validation\n";
+  out << "TDC bin: " << obj.m_TdcBin * 1000 << " ps\n";
+  out << "QDC: " << obj.m_Gate << " ns gate, " << obj.m_QdcMax + 1 << " counts\n";
+  out << "Dead time: " << obj.m_DeadTime << " ns\n";
+  out << "Buffers: " << obj.m_NBuffers << " with " << obj.m_ConversionTime << " ns conversion\n";
+  out << "Records: " << obj.m_NRecords << "\n";
+  out << "Lost (invalid / dead / busy): " << obj.m_NInvalid << " / " << obj.m_NDead << " / " << obj.m_NBusy << "\n";
+  return out;
+}
+} // namespace sipm
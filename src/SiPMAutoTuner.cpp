@@ -0,0 +1,249 @@
+#include "SiPMAutoTuner.h"
+#include "SiPMBatchRunner.h"
+#include "SiPMPhotonSource.h"
+#include "SiPMProperties.h"
+#include "SiPMSensor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace sipm {
+namespace {
+// Changes when the candidates or the way they are measured change
+constexpr uint32_t kTuningVersion = 1;
+
+uint64_t fnv1a(const std::string& s, uint64_t h = 0xcbf29ce484222325) {
+  for (const unsigned char c : s) {
+    h = (h ^ c) * 0x100000001b3;
+  }
+  return h;
+}
+
+// Shortest time in seconds of f over a few trials, each long enough to be measured
+template <class F> double measure(F&& f) {
+  using clock = std::chrono::steady_clock;
+  uint32_t reps = 1;
+  double best = std::numeric_limits<double>::max();
+  for (uint32_t trial = 0; trial < 3;) {
+    const auto start = clock::now();
+    for (uint32_t i = 0; i < reps; ++i) {
+      f();
+    }
+    const double t = std::chrono::duration<double>(clock::now() - start).count();
+    if (t < 1e-3 && reps < (1u << 20)) {
+      reps *= 2;
+      continue;
+    }
+    best = std::min(best, t / reps);
+    ++trial;
+  }
+  return best;
+}
+} // namespace
+
+std::string& SiPMAutoTuner::cacheFile() {
+  static std::string fname = [] {
+    if (const char* env = std::getenv("SIPM_TUNING_FILE")) {
+      return std::string(env);
+    }
+    const char* home = std::getenv("HOME");
+    return home ? std::string(home) + "/.sipm-tuning" : std::string(".sipm-tuning");
+  }();
+  return fname;
+}
+
+std::string SiPMAutoTuner::cpuModel() {
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line)) {
+    // x86 and most ARM kernels
+    if (line.rfind("model name", 0) == 0 || line.rfind("Processor", 0) == 0 || line.rfind("cpu model", 0) == 0) {
+      const size_t pos = line.find(':');
+      if (pos != std::string::npos && pos + 2 <= line.size()) {
+        return line.substr(pos + 2);
+      }
+    }
+  }
+  return "unknown";
+}
+
+uint64_t SiPMAutoTuner::machineHash() {
+  return fnv1a(cpuModel() + "/" + std::to_string(std::thread::hardware_concurrency()) + "/" +
+               std::to_string(kTuningVersion));
+}
+
+/**
+ * @param properties Properties of the sensor
+ * @param nPhotons Typical number of photons of an event
+ */
+SiPMTuning SiPMAutoTuner::tuning(const SiPMProperties& properties, const uint32_t nPhotons) {
+  const std::string& fname = cacheFile();
+  const uint64_t machine = machineHash();
+  const uint64_t hash = properties.hash();
+  if (!fname.empty()) {
+    std::ifstream file(fname);
+    std::string line;
+    SiPMTuning out;
+    // Last matching line wins
+    while (std::getline(file, line)) {
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      std::istringstream ss(line);
+      uint64_t m, h;
+      uint32_t n;
+      SiPMTuning t;
+      if (ss >> std::hex >> m >> h >> std::dec >> n >> t.synthesisThreshold >> t.nThreads >> t.slicesPerThread) {
+        if (m == machine && h == hash && n == nPhotons) {
+          out = t;
+          out.cached = true;
+        }
+      }
+    }
+    if (out.cached) {
+      return out;
+    }
+  }
+
+  const SiPMTuning out = tune(properties, nPhotons);
+  if (!fname.empty()) {
+    std::ofstream file(fname, std::ios::app);
+    if (!file.is_open()) {
+      std::cerr << "Could not write tuning to " << fname << "!" << std::endl;
+      return out;
+    }
+    file << "# " << cpuModel() << "\n";
+    file << std::hex << machine << " " << hash << std::dec << " " << nPhotons << " " << out.synthesisThreshold << " "
+         << out.nThreads << " " << out.slicesPerThread << "\n";
+  }
+  return out;
+}
+
+/**
+ * Times both syntheses on events with an increasing number of hits. The
+ * threshold is the smallest number of hits from which the recursive
+ * synthesis is always faster.
+ */
+uint32_t SiPMAutoTuner::tuneSynthesis(const SiPMProperties& properties) {
+  // Only the cost of the waveform is measured: no noise hits, every photon is a hit
+  SiPMProperties p(properties);
+  p.setDcrOff();
+  p.setXtOff();
+  p.setApOff();
+  p.setPdeType(SiPMProperties::PdeType::kNoPde);
+  SiPMSensor sensor(p);
+  sensor.rng().rng().seed(1234567890ULL);
+
+  uint32_t threshold = std::numeric_limits<uint32_t>::max();
+  for (uint32_t n = 1; n <= 4096; n *= 2) {
+    std::vector<double> photons(n);
+    for (double& t : photons) {
+      t = sensor.rng().Rand() * p.signalLength();
+    }
+    sensor.resetState();
+    sensor.addPhotons(photons);
+    sensor.runEvent();
+    const uint32_t nHits = sensor.m_HitBufferDouble.size();
+
+    sensor.setSynthesis(SiPMSensor::Synthesis::kDirect);
+    const double direct = measure([&sensor] { sensor.generateSignal(); });
+    sensor.setSynthesis(SiPMSensor::Synthesis::kRecursive);
+    const double recursive = measure([&sensor] { sensor.generateSignal(); });
+    if (recursive < direct) {
+      threshold = std::min(threshold, nHits);
+    } else {
+      threshold = std::numeric_limits<uint32_t>::max();
+    }
+  }
+  return threshold;
+}
+
+/**
+ * Runs the same batch with 1, 2, 4... threads up to the number of cpus,
+ * then with different slices per thread for the fastest number of threads.
+ */
+void SiPMAutoTuner::tuneThreads(const SiPMProperties& properties, const uint32_t nPhotons, SiPMTuning& tuning) {
+  const uint32_t nCpus = std::max(std::thread::hardware_concurrency(), 1u);
+  const uint32_t nEvents = std::max(256u, 32 * nCpus);
+  const SiPMPulseSource source(nPhotons, properties.signalLength() / 5);
+
+  auto throughput = [&](const uint32_t nThreads, const uint32_t slices) {
+    SiPMBatchRunner runner(properties, nThreads);
+    apply(tuning, runner.sensor());
+    runner.setSlicesPerThread(slices);
+    runner.setSeed(1234567890ULL);
+    // Warm-up starts the pool and touches the output
+    runner.run(source, nEvents);
+    const auto start = std::chrono::steady_clock::now();
+    runner.run(source, nEvents);
+    return nEvents / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+
+  std::vector<uint32_t> candidates;
+  for (uint32_t n = 1; n < nCpus; n *= 2) {
+    candidates.push_back(n);
+  }
+  candidates.push_back(nCpus);
+  double best = 0;
+  for (const uint32_t n : candidates) {
+    const double x = throughput(n, 4);
+    if (x > best) {
+      best = x;
+      tuning.nThreads = n;
+      tuning.slicesPerThread = 4;
+    }
+  }
+  for (const uint32_t slices : {1u, 16u}) {
+    const double x = throughput(tuning.nThreads, slices);
+    if (x > best) {
+      best = x;
+      tuning.slicesPerThread = slices;
+    }
+  }
+}
+
+/**
+ * @param properties Properties of the sensor
+ * @param nPhotons Typical number of photons of an event
+ */
+SiPMTuning SiPMAutoTuner::tune(const SiPMProperties& properties, const uint32_t nPhotons) {
+  SiPMTuning out;
+  out.synthesisThreshold = tuneSynthesis(properties);
+  tuneThreads(properties, nPhotons, out);
+  return out;
+}
+
+void SiPMAutoTuner::apply(const SiPMTuning& tuning, SiPMSensor& sensor) {
+  sensor.setSynthesis(SiPMSensor::Synthesis::kAuto);
+  sensor.setSynthesisThreshold(tuning.synthesisThreshold);
+}
+
+void SiPMAutoTuner::apply(const SiPMTuning& tuning, SiPMBatchRunner& runner) {
+  apply(tuning, runner.sensor());
+  // Threads of a pool given by the user are not changed
+  if (!runner.m_Executor) {
+    runner.setNThreads(tuning.nThreads);
+  }
+  runner.setSlicesPerThread(tuning.slicesPerThread);
+}
+
+std::ostream& operator<<(std::ostream& out, const SiPMTuning& obj) {
+  out << "===> SiPM Tuning <===\n";
+  out << "Address: " << std::addressof(obj) << "\n";
+  out << "Recursive synthesis from: ";
+  if (obj.synthesisThreshold == std::numeric_limits<uint32_t>::max()) {
+    out << "never\n";
+  } else {
+    out << obj.synthesisThreshold << " hits\n";
+  }
+  out << "Threads: " << obj.nThreads << " - slices per thread: " << obj.slicesPerThread << "\n";
+  out << "Source: " << (obj.cached ? "cache" : "measured") << "\n";
+  return out;
+}
+} // namespace sipm
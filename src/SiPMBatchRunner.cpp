@@ -0,0 +1,308 @@
+#include "SiPMBatchRunner.h"
+#include "SiPMAnalogSignal.h"
+#include "SiPMAutoTuner.h"
+#include "SiPMSensor.h"
+#include "SiPMTypes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <random>
+
+namespace sipm {
+SiPMBatchRunner::SiPMBatchRunner(const SiPMSensor& sensor, const uint32_t nThreads)
+  : m_Sensor(sensor), m_Topology(SiPMTopology::detect()), m_NThreads(nThreads),
+    m_Occupancy(sensor.properties()) {}
+
+SiPMBatchRunner::SiPMBatchRunner(const SiPMProperties& properties, const uint32_t nThreads)
+  : SiPMBatchRunner(SiPMSensor(properties), nThreads) {}
+
+void SiPMBatchRunner::setMetrics(std::shared_ptr<SiPMMetrics> x) {
+  m_Metrics = std::move(x);
+  if (!m_Metrics) {
+    return;
+  }
+  SiPMMetrics& m = *m_Metrics;
+  m_MetricIds.events = m.counter("sipm_events_total", "Events simulated");
+  m_MetricIds.photons = m.counter("sipm_photons_total", "Photons given as input");
+  // Photoelectrons of the sensor include dark counts and crosstalk: each type is counted once
+  static const char* hitTypes[5] = {"photoelectron", "dcr", "xt", "dxt", "ap"};
+  for (uint32_t i = 0; i < 5; ++i) {
+    m_MetricIds.hits[i] = m.counter(std::string("sipm_hits_total{type=\"") + hitTypes[i] + "\"}", "Hits by type");
+  }
+  m_MetricIds.waveforms = m.counter("sipm_waveforms_written_total", "Waveforms written to the output matrix");
+  m_MetricIds.pendingSlices = m.gauge("sipm_batch_pending_slices", "Slices of the batch waiting for a worker");
+  m_MetricIds.memory = m.gauge("sipm_batch_memory_bytes", "Memory held by the output and the sensors of the batch");
+  // From 1 us to about 4 s
+  const std::vector<double> bounds = SiPMMetrics::exponentialBounds(1e-6, 2, 23);
+  static const char* stages[3] = {"input", "event", "waveform"};
+  for (uint32_t i = 0; i < 3; ++i) {
+    m_MetricIds.stages[i] = m.histogram(std::string("sipm_stage_seconds{stage=\"") + stages[i] + "\"}", bounds,
+                                        "Time of each stage of an event");
+  }
+}
+
+std::shared_ptr<SiPMExecutor> SiPMBatchRunner::executor() {
+  if (m_Executor) {
+    return m_Executor;
+  }
+  if (m_NThreads == 0) {
+    return SiPMExecutor::defaultExecutor();
+  }
+  if (!m_OwnExecutor) {
+    m_OwnExecutor = std::make_shared<SiPMThreadPool>(m_NThreads, m_Placement);
+  }
+  return m_OwnExecutor;
+}
+
+void SiPMBatchRunner::allocate(const uint32_t nEvents) {
+  m_NEvents = nEvents;
+  m_NSignalPoints = m_Sensor.properties().nSignalPoints();
+  const size_t size = static_cast<size_t>(nEvents) * m_NSignalPoints * sizeof(float);
+  const size_t debugSize = static_cast<size_t>(nEvents) * nDebugFields * sizeof(uint32_t);
+  // Waveforms that do not fit in half of the budget go to disk
+  m_Spilled = m_MemoryBudget > 0 && size + debugSize > m_MemoryBudget / 2;
+  const MemoryPolicy policy = m_Spilled ? MemoryPolicy::kFileBacked : MemoryPolicy::kTransparentHugePages;
+  // Previous batch is released first, with its own size and policy
+  m_Waveforms.reset();
+  m_Waveforms.get_deleter() = WaveformDeleter{size, policy};
+  // Memory is not touched here: pages are placed by the first thread writing them
+  m_Waveforms.reset(reinterpret_cast<float*>(MappedMemory::allocate(size, policy)));
+  if (!m_Waveforms) {
+    std::cerr << "Could not allocate memory for " << nEvents << " waveforms";
+    std::cerr << (m_Spilled ? " in " + MappedMemory::directory() : "") << "\n";
+    m_NEvents = 0;
+  }
+  m_Debug.assign(static_cast<size_t>(m_NEvents) * nDebugFields, 0);
+  m_Debug.shrink_to_fit();
+}
+
+size_t SiPMBatchRunner::memoryUsage() const {
+  const size_t waveforms = m_Spilled ? 0 : static_cast<size_t>(m_NEvents) * m_NSignalPoints * sizeof(float);
+  return waveforms + m_Debug.capacity() * sizeof(uint32_t) + m_SensorMemory.load(std::memory_order_relaxed);
+}
+
+void SiPMBatchRunner::updatePeakMemory(const size_t x) {
+  size_t peak = m_PeakMemory.load(std::memory_order_relaxed);
+  while (x > peak && !m_PeakMemory.compare_exchange_weak(peak, x, std::memory_order_relaxed)) {
+  }
+}
+
+void SiPMBatchRunner::applyAutoTune() {
+  const uint64_t hash = m_Sensor.properties().hash();
+  if (hash == m_TunedHash) {
+    return;
+  }
+  const SiPMTuning tuning = SiPMAutoTuner::tuning(m_Sensor.properties(), m_AutoTunePhotons);
+  SiPMAutoTuner::apply(tuning, *this);
+  m_TunedHash = hash;
+}
+
+/**
+ * Splits events in contiguous slices run as tasks of the executor. There are
+ * few slices per thread so that idle workers can steal work. Each task
+ * touches its slice of the output, copies the prototype sensor and then runs
+ * its events. The input of each event is set by the functor.
+ * @param nEvents Number of events to run
+ * @param setInput Functor called as setInput(sensor, event) before each event
+ */
+template <class F> void SiPMBatchRunner::dispatch(const uint32_t nEvents, F&& setInput) {
+  if (m_AutoTune) {
+    applyAutoTune();
+  }
+  allocate(nEvents);
+  m_SlowEvents.clear();
+  m_NDegraded.store(0, std::memory_order_relaxed);
+  if (m_NEvents == 0) {
+    return;
+  }
+  const std::shared_ptr<SiPMExecutor> exec = executor();
+  // Output held in memory is fixed during the batch, sensors share the rest of the budget
+  const size_t outputMemory = memoryUsage();
+  updatePeakMemory(outputMemory);
+  size_t sensorBudget = 0;
+  if (m_MemoryBudget > 0) {
+    if (m_MemoryBudget <= outputMemory) {
+      std::cerr << "Memory budget of " << m_MemoryBudget << " bytes is used by the output: events have no hits!\n";
+    }
+    // A budget of 1 byte still limits the sensor (0 would remove the limit)
+    sensorBudget = std::max<size_t>((m_MemoryBudget - std::min(m_MemoryBudget, outputMemory)) / exec->concurrency(), 1);
+  }
+  const SiPMChannelTable* channels = (m_Channels && m_Channels->size() > 0) ? m_Channels.get() : nullptr;
+  const uint32_t nSignalPoints = m_NSignalPoints;
+  const uint32_t nSlices = std::min(m_SlicesPerThread * exec->concurrency(), m_NEvents);
+  // Each event has its own seed so that results do not depend on scheduling. The seed of the batch is
+  // mixed before adding the event index, so that batches with close seeds do not share events
+  const uint64_t seed = splitmix64(
+    m_Seeded ? m_Seed : (static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}());
+
+  SiPMMetrics* metrics = m_Metrics.get();
+  const MetricIds& ids = m_MetricIds;
+
+  if (!m_Placement) {
+    std::fill_n(m_Waveforms.get(), static_cast<size_t>(m_NEvents) * nSignalPoints, 0.f);
+  }
+  if (metrics) {
+    metrics->addGauge(ids.pendingSlices, nSlices);
+  }
+
+  exec->parallelFor(nSlices, [&](const uint32_t w) {
+    if (metrics) {
+      metrics->addGauge(ids.pendingSlices, -1);
+    }
+    const uint32_t first = static_cast<uint64_t>(m_NEvents) * w / nSlices;
+    const uint32_t last = static_cast<uint64_t>(m_NEvents) * (w + 1) / nSlices;
+    float* out = m_Waveforms.get() + static_cast<size_t>(first) * nSignalPoints;
+    if (m_Placement) {
+      // First-touch of the output slice of this task
+      std::fill_n(out, static_cast<size_t>(last - first) * nSignalPoints, 0.f);
+    }
+    // Local copy of the sensor and of its read-only tables
+    SiPMSensor sensor(m_Sensor);
+    sensor.setMemoryBudget(sensorBudget);
+    size_t sensorMemory = 0;
+    SiPMOccupancy occupancy(m_FillOccupancy ? sensor.properties().nSideCells() : 0);
+    SiPMLatency latency;
+    std::vector<SiPMSlowEvent> slowEvents;
+    uint64_t rngState[4];
+
+    for (uint32_t i = first; i < last; ++i, out += nSignalPoints) {
+      const auto start = std::chrono::steady_clock::now();
+      sensor.rng().rng().seed(splitmix64(seed + i));
+      sensor.resetState();
+      if (channels) {
+        sensor.setChannel(*channels, i % channels->size());
+      }
+      setInput(sensor, i);
+      // Input may use the generator, so the state is saved just before the event
+      std::copy_n(sensor.rng().rng().getState(), 4, rngState);
+      const auto inputEnd = std::chrono::steady_clock::now();
+      sensor.runEvent();
+      if (m_FillOccupancy) {
+        occupancy.fill(sensor);
+      }
+      const auto eventEnd = std::chrono::steady_clock::now();
+
+      sensor.buildSignal();
+      const SiPMAnalogSignal& signal = sensor.m_Signal;
+      const uint32_t n = std::min(signal.size(), nSignalPoints);
+      for (uint32_t j = 0; j < n; ++j) {
+        out[j] = signal[j];
+      }
+
+      const SiPMDebugInfo debug = sensor.debug();
+      if (sensorBudget > 0 && sensor.nDroppedHits() > 0) {
+        m_NDegraded.fetch_add(1, std::memory_order_relaxed);
+      }
+      // Difference can be negative: unsigned arithmetic wraps around consistently
+      const size_t memory = sensor.memoryUsage();
+      const size_t total = outputMemory + m_SensorMemory.fetch_add(memory - sensorMemory) + memory - sensorMemory;
+      sensorMemory = memory;
+      updatePeakMemory(total);
+      uint32_t* d = m_Debug.data() + static_cast<size_t>(i) * nDebugFields;
+      d[0] = debug.nPhotons;
+      d[1] = debug.nPhotoelectrons;
+      d[2] = debug.nDcr;
+      d[3] = debug.nXt;
+      d[4] = debug.nDXt;
+      d[5] = debug.nAp;
+
+      const auto end = std::chrono::steady_clock::now();
+      const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+      latency.record(ns);
+      if (metrics) {
+        metrics->add(ids.events);
+        metrics->add(ids.photons, debug.nPhotons);
+        metrics->add(ids.hits[0], debug.nPhotoelectrons - debug.nDcr - debug.nXt);
+        metrics->add(ids.hits[1], debug.nDcr);
+        metrics->add(ids.hits[2], debug.nXt - debug.nDXt);
+        metrics->add(ids.hits[3], debug.nDXt);
+        metrics->add(ids.hits[4], debug.nAp);
+        metrics->add(ids.waveforms);
+        metrics->set(ids.memory, total);
+        metrics->observe(ids.stages[0], std::chrono::duration<double>(inputEnd - start).count());
+        metrics->observe(ids.stages[1], std::chrono::duration<double>(eventEnd - inputEnd).count());
+        metrics->observe(ids.stages[2], std::chrono::duration<double>(end - eventEnd).count());
+      }
+      if (m_SlowThreshold > 0 && ns > m_SlowThreshold) {
+        SiPMSlowEvent ev;
+        ev.event = i;
+        ev.channel = channels ? static_cast<int32_t>(i % channels->size()) : -1;
+        ev.latency = ns;
+        ev.sensorHash = sensor.hash();
+        ev.memoryBudget = sensor.memoryBudget();
+        std::copy_n(rngState, 4, ev.rngState);
+        ev.photonTimes = sensor.m_PhotonTimes;
+        ev.photonWavelengths = sensor.m_PhotonWavelengths;
+        ev.photonCells = sensor.m_PhotonCells;
+        slowEvents.push_back(std::move(ev));
+      }
+    }
+    m_SensorMemory.fetch_sub(sensorMemory);
+    std::lock_guard<std::mutex> lock(m_MergeMutex);
+    if (m_FillOccupancy) {
+      m_Occupancy.merge(occupancy);
+    }
+    m_Latency.merge(latency);
+    m_SlowEvents.insert(m_SlowEvents.end(), std::make_move_iterator(slowEvents.begin()),
+                        std::make_move_iterator(slowEvents.end()));
+  });
+
+  std::sort(m_SlowEvents.begin(), m_SlowEvents.end(),
+            [](const SiPMSlowEvent& a, const SiPMSlowEvent& b) { return a.event < b.event; });
+  if (!m_ReplayFile.empty() && !m_SlowEvents.empty()) {
+    SiPMReplay::write(m_ReplayFile, m_SlowEvents);
+  }
+}
+
+/**
+ * @param photons Vector containing the photon times of each event
+ */
+void SiPMBatchRunner::run(const std::vector<std::vector<double>>& photons) {
+  dispatch(photons.size(), [&photons](SiPMSensor& sensor, const uint32_t i) { sensor.addPhotons(photons[i]); });
+}
+
+/**
+ * @param source Source used to generate photons of each event
+ * @param nEvents Number of events to run
+ */
+void SiPMBatchRunner::run(const SiPMPhotonSource& source, const uint32_t nEvents) {
+  dispatch(nEvents, [&source](SiPMSensor& sensor, const uint32_t) { sensor.addPhotons(source); });
+}
+
+SiPMAnalogSignal SiPMBatchRunner::signal(const uint32_t i) const {
+  const float* wav = waveform(i);
+  return SiPMAnalogSignal(SiPMVector<float>(wav, wav + m_NSignalPoints), m_Sensor.properties().sampling());
+}
+
+SiPMDebugInfo SiPMBatchRunner::debug(const uint32_t i) const {
+  const uint32_t* d = m_Debug.data() + static_cast<size_t>(i) * nDebugFields;
+  return SiPMDebugInfo(d[0], d[1], d[2], d[3], d[4], d[5]);
+}
+
+std::ostream& operator<<(std::ostream& out, const SiPMBatchRunner& obj) {
+  out << "===> SiPM Batch Runner <===\n";
+  out << "Address: " << std::addressof(obj) << "\n";
+  out << "Executor: " << (obj.m_Executor ? "user" : (obj.m_NThreads > 0 ? "own pool" : "default")) << "\n";
+  if (obj.m_NThreads > 0) {
+    out << "Number of threads: " << obj.m_NThreads << "\n";
+  }
+  out << "Placement: " << (obj.m_Placement ? "pinned, first-touch" : "disabled") << "\n";
+  out << "Slices per thread: " << obj.m_SlicesPerThread << (obj.m_AutoTune ? " (auto-tuned)" : "") << "\n";
+  out << "Number of events: " << obj.m_NEvents << "\n";
+  out << "Number of signal points: " << obj.m_NSignalPoints << "\n";
+  if (obj.m_SlowThreshold > 0) {
+    out << "Slow events: " << obj.m_SlowEvents.size() << " above " << obj.m_SlowThreshold << " ns";
+    out << (obj.m_ReplayFile.empty() ? "" : " written to " + obj.m_ReplayFile) << "\n";
+  }
+  if (obj.m_MemoryBudget > 0) {
+    out << "Memory budget: " << obj.m_MemoryBudget << " bytes";
+    out << (obj.m_Spilled ? " (waveforms spilled to disk)" : "") << "\n";
+    out << "Peak memory: " << obj.peakMemoryUsage() << " bytes\n";
+    out << "Degraded events: " << obj.nDegradedEvents() << "\n";
+  }
+  out << obj.m_Topology;
+  return out;
+}
+} // namespace sipm
@@ -0,0 +1,189 @@
+#include "SiPMChannelTable.h"
+#include "SiPMProperties.h"
+#include "SiPMTypes.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+namespace sipm {
+namespace {
+// Header of calibration files (64 bytes), followed by one block per column
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t nChannels;
+  uint32_t nColumns;
+  uint32_t reserved;
+  double overvoltage;
+  char padding[32];
+};
+static_assert(sizeof(FileHeader) == 64, "Header of channel table must be 64 bytes");
+
+constexpr char fileMagic[8] = {'S', 'I', 'P', 'M', 'C', 'H', 'T', 'B'};
+constexpr uint32_t fileVersion = 1;
+} // namespace
+
+/// Each column is padded to a multiple of 64 bytes so that all columns are aligned
+size_t SiPMChannelTable::columnStride(const uint32_t n) { return (static_cast<size_t>(n) * sizeof(float) + 63) / 64 * 16; }
+
+SiPMChannelTable::SiPMChannelTable(const uint32_t n, const SiPMProperties& base) : m_Size(n) {
+  const size_t stride = columnStride(n);
+  m_Data.resize(stride * nColumns);
+  setColumns(m_Data.data());
+  for (uint32_t i = 0; i < n; ++i) {
+    set(i, base.gain(), base.dcr(), base.xt(), base.ap(), 0);
+  }
+}
+
+SiPMChannelTable::SiPMChannelTable(SiPMChannelTable&& rhs) noexcept { *this = std::move(rhs); }
+
+SiPMChannelTable& SiPMChannelTable::operator=(SiPMChannelTable&& rhs) noexcept {
+  if (this != &rhs) {
+    reset();
+    m_Size = rhs.m_Size;
+    m_Overvoltage = rhs.m_Overvoltage;
+    // Moving a vector keeps its buffer so column pointers stay valid
+    m_Data = std::move(rhs.m_Data);
+    m_Map = rhs.m_Map;
+    m_MapSize = rhs.m_MapSize;
+    std::copy(rhs.m_Columns, rhs.m_Columns + nColumns, m_Columns);
+    rhs.m_Map = nullptr;
+    rhs.m_MapSize = 0;
+    rhs.m_Size = 0;
+    std::fill(rhs.m_Columns, rhs.m_Columns + nColumns, nullptr);
+  }
+  return *this;
+}
+
+SiPMChannelTable::~SiPMChannelTable() { reset(); }
+
+void SiPMChannelTable::reset() {
+#ifdef __unix__
+  if (m_Map) {
+    munmap(m_Map, m_MapSize);
+  }
+#endif
+  m_Map = nullptr;
+  m_MapSize = 0;
+  m_Data.clear();
+  m_Size = 0;
+  std::fill(m_Columns, m_Columns + nColumns, nullptr);
+}
+
+void SiPMChannelTable::setColumns(const float* data) {
+  const size_t stride = columnStride(m_Size);
+  for (uint32_t c = 0; c < nColumns; ++c) {
+    m_Columns[c] = data + c * stride;
+  }
+}
+
+/**
+ * @param ch Index of the channel
+ * @param gain Relative gain
+ * @param dcr Dark counts rate in Hz
+ * @param xt Optical crosstalk probability
+ * @param ap Afterpulse probability
+ * @param breakdownOffset Offset of breakdown voltage in V
+ */
+void SiPMChannelTable::set(const uint32_t ch, const double gain, const double dcr, const double xt, const double ap,
+                           const double breakdownOffset) {
+  if (isMapped()) {
+    std::cerr << "SiPMChannelTable mapped from a file is read-only!" << std::endl;
+    return;
+  }
+  column(kGain)[ch] = gain;
+  column(kDcr)[ch] = dcr;
+  column(kXt)[ch] = xt;
+  column(kAp)[ch] = ap;
+  column(kBreakdownOffset)[ch] = breakdownOffset;
+}
+
+/**
+ * The file is mapped read-only and pages are loaded by the OS only when they
+ * are accessed. On systems without mmap the file is read in memory.
+ * @param fname Path of the calibration file
+ * @return Table of channels (empty if the file can not be read)
+ */
+SiPMChannelTable SiPMChannelTable::open(const std::string& fname) {
+  SiPMChannelTable table;
+  std::ifstream file(fname, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Could not open " << fname << " for reading!" << std::endl;
+    return table;
+  }
+  FileHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
+  if (!file || std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0 || header.version != fileVersion ||
+      header.nColumns != nColumns) {
+    std::cerr << fname << " is not a valid channel table!" << std::endl;
+    return table;
+  }
+  const size_t dataSize = columnStride(header.nChannels) * nColumns * sizeof(float);
+  file.seekg(0, std::ios::end);
+  if (static_cast<size_t>(file.tellg()) < sizeof(FileHeader) + dataSize) {
+    std::cerr << fname << " is truncated!" << std::endl;
+    return table;
+  }
+  table.m_Size = header.nChannels;
+  table.m_Overvoltage = header.overvoltage;
+
+#ifdef __unix__
+  const int fd = ::open(fname.c_str(), O_RDONLY);
+  void* map = (fd >= 0) ? mmap(nullptr, sizeof(FileHeader) + dataSize, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  if (fd >= 0) {
+    close(fd);
+  }
+  if (map != MAP_FAILED) {
+    table.m_Map = map;
+    table.m_MapSize = sizeof(FileHeader) + dataSize;
+    table.setColumns(reinterpret_cast<const float*>(reinterpret_cast<const char*>(map) + sizeof(FileHeader)));
+    return table;
+  }
+#endif
+  table.m_Data.resize(dataSize / sizeof(float));
+  file.seekg(sizeof(FileHeader));
+  file.read(reinterpret_cast<char*>(table.m_Data.data()), dataSize);
+  table.setColumns(table.m_Data.data());
+  return table;
+}
+
+/**
+ * @param fname Path of the calibration file
+ * @return true if the file has been written
+ */
+bool SiPMChannelTable::write(const std::string& fname) const {
+  std::ofstream file(fname, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    std::cerr << "Could not open " << fname << " for writing!" << std::endl;
+    return false;
+  }
+  FileHeader header;
+  std::memset(&header, 0, sizeof(FileHeader));
+  std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+  header.version = fileVersion;
+  header.nChannels = m_Size;
+  header.nColumns = nColumns;
+  header.overvoltage = m_Overvoltage;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+  const size_t stride = columnStride(m_Size);
+  for (uint32_t c = 0; c < nColumns; ++c) {
+    file.write(reinterpret_cast<const char*>(m_Columns[c]), stride * sizeof(float));
+  }
+  return static_cast<bool>(file);
+}
+
+std::ostream& operator<<(std::ostream& out, const SiPMChannelTable& obj) {
+  out << std::setprecision(2) << std::fixed;
+  out << "===> SiPM Channel Table <===\n";
+  out << "Address: " << std::addressof(obj) << "\n";
+  out << "Number of channels: " << obj.m_Size << "\n";
+  out << "Storage: " << (obj.isMapped() ? "mapped file" : "memory") << "\n";
+  if (obj.m_Overvoltage > 0) {
+    out << "Nominal overvoltage: " << obj.m_Overvoltage << " V\n";
+  }
+  return out;
+}
+} // namespace sipm
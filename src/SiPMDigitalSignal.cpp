@@ -0,0 +1,127 @@
+#include "SiPMDigitalSignal.h"
+#include "SiPMTypes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace sipm {
+
+template <> auto SiPMDigitalSignal::times<SiPMVector<float>>() const -> SiPMVector<float> { return m_Times; }
+
+template <> auto SiPMDigitalSignal::times<std::vector<float>>() const -> std::vector<float> {
+  return std::vector<float>(m_Times.cbegin(), m_Times.cend());
+}
+
+uint32_t SiPMDigitalSignal::lowerBound(const double t) const {
+  return std::lower_bound(m_Times.cbegin(), m_Times.cend(), t) - m_Times.cbegin();
+}
+
+/**
+ * @param start Start of the window in ns
+ * @param gate Length of the window in ns
+ * @return Number of cells fired in [start, start + gate)
+ */
+uint32_t SiPMDigitalSignal::count(const double start, const double gate) const {
+  return lowerBound(start + gate) - lowerBound(start);
+}
+
+/**
+ * @param start Start of the window in ns
+ * @param gate Length of the window in ns
+ * @return Time of first fired cell in ns or -1 if no cell fired in the window
+ */
+double SiPMDigitalSignal::firstTime(const double start, const double gate) const {
+  const uint32_t first = lowerBound(start);
+  if (first == m_Times.size() || m_Times[first] >= start + gate) {
+    return -1;
+  }
+  return m_Times[first];
+}
+
+/**
+ * @param start Start of the window in ns
+ * @param gate Length of the window in ns
+ * @param threshold Number of fired cells needed to trigger
+ * @return Time of the threshold-th fired cell in ns or -1 if not reached
+ */
+double SiPMDigitalSignal::triggerTime(const double start, const double gate, const uint32_t threshold) const {
+  const uint32_t idx = lowerBound(start) + std::max(threshold, 1u) - 1;
+  if (idx >= m_Times.size() || m_Times[idx] >= start + gate) {
+    return -1;
+  }
+  return m_Times[idx];
+}
+
+/**
+ * Validation and integration windows start at the trigger time and are
+ * limited to the end of the window.
+ * @param start Start of the window in ns
+ * @param gate Length of the window in ns
+ * @param triggerThreshold Number of fired cells needed to trigger
+ * @param validationWindow Length of validation window in ns
+ * @param validationThreshold Number of fired cells in validation window needed to validate (0 to always validate)
+ * @param integrationWindow Length of integration window in ns (0 to integrate up to the end of the window)
+ */
+SiPMDigitalFrame SiPMDigitalSignal::frame(const double start, const double gate, const uint32_t triggerThreshold,
+                                          const double validationWindow, const uint32_t validationThreshold,
+                                          const double integrationWindow) const {
+  SiPMDigitalFrame out;
+  const double end = start + gate;
+  const uint32_t first = lowerBound(start);
+  const uint32_t last = lowerBound(end);
+  out.count = last - first;
+  if (out.count == 0) {
+    return out;
+  }
+  out.firstTime = m_Times[first];
+
+  const uint32_t trigger = first + std::max(triggerThreshold, 1u) - 1;
+  if (trigger >= last) {
+    return out;
+  }
+  out.triggerTime = m_Times[trigger];
+
+  const double validationEnd = std::min(out.triggerTime + validationWindow, end);
+  out.validated = (lowerBound(validationEnd) - trigger) >= validationThreshold;
+  if (out.validated) {
+    const double integrationEnd = (integrationWindow > 0) ? std::min(out.triggerTime + integrationWindow, end) : end;
+    out.integral = lowerBound(integrationEnd) - trigger;
+  }
+  return out;
+}
+
+/**
+ * @param frameLength Length of each frame in ns
+ * @param triggerThreshold Number of fired cells needed to trigger
+ * @param validationWindow Length of validation window in ns
+ * @param validationThreshold Number of fired cells in validation window needed to validate
+ * @param integrationWindow Length of integration window in ns
+ * @return Output of each frame in the event
+ */
+std::vector<SiPMDigitalFrame> SiPMDigitalSignal::frames(const double frameLength, const uint32_t triggerThreshold,
+                                                        const double validationWindow,
+                                                        const uint32_t validationThreshold,
+                                                        const double integrationWindow) const {
+  if (frameLength <= 0) {
+    std::cerr << "Frame length must be positive!" << std::endl;
+    return {};
+  }
+  const uint32_t nFrames = std::ceil(m_Length / frameLength);
+  std::vector<SiPMDigitalFrame> out(nFrames);
+  for (uint32_t i = 0; i < nFrames; ++i) {
+    out[i] = frame(i * frameLength, frameLength, triggerThreshold, validationWindow, validationThreshold,
+                   integrationWindow);
+  }
+  return out;
+}
+
+std::ostream& operator<<(std::ostream& out, const SiPMDigitalSignal& obj) {
+  out << std::setprecision(2) << std::fixed;
+  out << "===> SiPM Digital Signal <===\n";
+  out << "Address: " << std::addressof(obj) << "\n";
+  out << "Signal length is: " << obj.m_Length << " ns\n";
+  out << "Number of fired cells: " << obj.m_Times.size();
+  return out;
+}
+} // namespace sipm
@@ -0,0 +1,234 @@
+#include "SiPMDistribution.h"
+#include "SiPMRandom.h"
+#include "SiPMTypes.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+
+namespace sipm {
+/**
+ * The PDF is linearly interpolated between the tabulated points. Values
+ * do not need to be normalized but must not be negative and x values must be
+ * strictly increasing. Throws std::invalid_argument if sizes differ, if
+ * there are less than 2 points, if x is not strictly increasing, if the PDF
+ * is negative or if it is null everywhere.
+ * @param x Points where the PDF is evaluated
+ * @param pdf Value of the PDF in each point
+ */
+SiPMDistribution SiPMDistribution::fromPdf(const std::vector<double>& x, const std::vector<double>& pdf) {
+  SiPMDistribution retval;
+  if (x.size() != pdf.size()) {
+    std::cerr << "SiPMDistribution needs the same number of points and PDF values!" << std::endl;
+    throw std::invalid_argument("SiPMDistribution needs the same number of points and PDF values");
+  }
+  const uint32_t n = x.size();
+  if (n < 2) {
+    std::cerr << "SiPMDistribution needs at least 2 points!" << std::endl;
+    throw std::invalid_argument("SiPMDistribution needs at least 2 points");
+  }
+  if (std::any_of(pdf.begin(), pdf.end(), [](const double y) { return !(y >= 0); })) {
+    std::cerr << "SiPMDistribution needs a non-negative PDF!" << std::endl;
+    throw std::invalid_argument("SiPMDistribution needs a non-negative PDF");
+  }
+  std::vector<double> weights(n - 1);
+  retval.m_X0.resize(n - 1);
+  retval.m_Dx.resize(n - 1);
+  retval.m_Y0.resize(n - 1);
+  retval.m_Y1.resize(n - 1);
+  for (uint32_t i = 0; i < n - 1; ++i) {
+    if (!(x[i + 1] > x[i])) {
+      std::cerr << "SiPMDistribution needs strictly increasing points!" << std::endl;
+      throw std::invalid_argument("SiPMDistribution needs strictly increasing points");
+    }
+    const double y0 = pdf[i];
+    const double y1 = pdf[i + 1];
+    retval.m_X0[i] = x[i];
+    retval.m_Dx[i] = x[i + 1] - x[i];
+    retval.m_Y0[i] = y0;
+    retval.m_Y1[i] = y1;
+    weights[i] = 0.5 * (y0 + y1) * retval.m_Dx[i];
+  }
+  retval.build(weights);
+  return retval;
+}
+
+/**
+ * Values are uniformly distributed inside each bin. Throws
+ * std::invalid_argument if the number of edges is not the number of bins
+ * plus one, if edges are not strictly increasing, if a bin is negative or
+ * if all bins are empty.
+ * @param edges Edges of the bins (one more than the number of bins)
+ * @param counts Content of each bin
+ */
+SiPMDistribution SiPMDistribution::fromHistogram(const std::vector<double>& edges, const std::vector<double>& counts) {
+  SiPMDistribution retval;
+  const uint32_t n = counts.size();
+  if (n == 0) {
+    std::cerr << "SiPMDistribution needs at least 1 bin!" << std::endl;
+    throw std::invalid_argument("SiPMDistribution needs at least 1 bin");
+  }
+  if (edges.size() != counts.size() + 1) {
+    std::cerr << "SiPMDistribution needs one edge more than the number of bins!" << std::endl;
+    throw std::invalid_argument("SiPMDistribution needs one edge more than the number of bins");
+  }
+  std::vector<double> weights(n);
+  retval.m_X0.resize(n);
+  retval.m_Dx.resize(n);
+  retval.m_Y0.assign(n, 1);
+  retval.m_Y1.assign(n, 1);
+  for (uint32_t i = 0; i < n; ++i) {
+    if (!(edges[i + 1] > edges[i])) {
+      std::cerr << "SiPMDistribution needs strictly increasing edges!" << std::endl;
+      throw std::invalid_argument("SiPMDistribution needs strictly increasing edges");
+    }
+    retval.m_X0[i] = edges[i];
+    retval.m_Dx[i] = edges[i + 1] - edges[i];
+    weights[i] = counts[i];
+  }
+  retval.build(weights);
+  return retval;
+}
+
+/**
+ * Builds the alias table using Vose algorithm. Each bin is split in two
+ * parts: the bin itself with probability m_Prob and its alias.
+ * @param weights Probability of each bin (not normalized)
+ */
+void SiPMDistribution::build(const std::vector<double>& weights) {
+  const uint32_t n = weights.size();
+  if (std::any_of(weights.begin(), weights.end(), [](const double w) { return !(w >= 0); })) {
+    std::cerr << "SiPMDistribution needs non-negative weights!" << std::endl;
+    throw std::invalid_argument("SiPMDistribution needs non-negative weights");
+  }
+  const double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+  // Probabilities are normalized to the total
+  if (!(total > 0) || !std::isfinite(total)) {
+    std::cerr << "SiPMDistribution needs at least one positive finite weight!" << std::endl;
+    throw std::invalid_argument("SiPMDistribution needs at least one positive finite weight");
+  }
+  m_Prob.resize(n);
+  m_Alias.resize(n);
+
+  std::vector<double> scaled(n);
+  std::vector<uint32_t> small;
+  std::vector<uint32_t> large;
+  small.reserve(n);
+  large.reserve(n);
+
+  m_Mean = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    scaled[i] = weights[i] * n / total;
+    if (scaled[i] < 1) {
+      small.push_back(i);
+    } else {
+      large.push_back(i);
+    }
+    // Mean value of a linear density in the bin
+    const double y0 = m_Y0[i];
+    const double y1 = m_Y1[i];
+    const double c = (y0 + y1 > 0) ? (y0 + 2 * y1) / (3 * (y0 + y1)) : 0.5;
+    m_Mean += weights[i] / total * (m_X0[i] + c * m_Dx[i]);
+  }
+
+  while (!small.empty() && !large.empty()) {
+    const uint32_t s = small.back();
+    const uint32_t l = large.back();
+    small.pop_back();
+    large.pop_back();
+    m_Prob[s] = scaled[s];
+    m_Alias[s] = l;
+    scaled[l] = (scaled[l] + scaled[s]) - 1;
+    if (scaled[l] < 1) {
+      small.push_back(l);
+    } else {
+      large.push_back(l);
+    }
+  }
+  // Remaining bins have probability 1 (up to rounding errors)
+  for (const uint32_t i : large) {
+    m_Prob[i] = 1;
+    m_Alias[i] = i;
+  }
+  for (const uint32_t i : small) {
+    m_Prob[i] = 1;
+    m_Alias[i] = i;
+  }
+}
+
+/**
+ * Batch version of sampling. Random numbers are generated in advance and
+ * the selection of the bin is branch-free so that loops can be vectorized
+ * using gather instructions.
+ * @param rng Random number generator to use
+ * @param out Buffer where to store sampled values
+ * @param n Number of values to sample
+ */
+void SiPMDistribution::sample(SiPMRandom& rng, double* out, const uint32_t n) const noexcept {
+  if (n == 0 || m_Prob.empty()) {
+    return;
+  }
+  const uint32_t nBins = m_Prob.size();
+  const SiPMVector<double> u = rng.Rand<SiPMVector<double>>(n);
+  const SiPMVector<double> v = rng.Rand<SiPMVector<double>>(n);
+  SiPMVector<uint32_t> idx(n);
+
+  for (uint32_t i = 0; i < n; ++i) {
+    const double x = u[i] * nBins;
+    const uint32_t j = static_cast<uint32_t>(x);
+    idx[i] = (x - j < m_Prob[j]) ? j : m_Alias[j];
+  }
+  for (uint32_t i = 0; i < n; ++i) {
+    out[i] = invert(idx[i], v[i]);
+  }
+}
+
+/**
+ * @param rng Random number generator to use
+ * @param n Number of values to sample
+ */
+template <>
+auto SiPMDistribution::sample<SiPMVector<double>>(SiPMRandom& rng, const uint32_t n) const -> SiPMVector<double> {
+  SiPMVector<double> out(n);
+  sample(rng, out.data(), n);
+  return out;
+}
+
+/**
+ * @param rng Random number generator to use
+ * @param n Number of values to sample
+ */
+template <>
+auto SiPMDistribution::sample<std::vector<double>>(SiPMRandom& rng, const uint32_t n) const -> std::vector<double> {
+  std::vector<double> out(n);
+  sample(rng, out.data(), n);
+  return out;
+}
+
+// FNV-1a over the bins (the alias table is derived from them)
+uint64_t SiPMDistribution::hash() const {
+  uint64_t h = 0xcbf29ce484222325;
+  auto add = [&h](const SiPMVector<double>& v) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(v.data());
+    for (size_t i = 0; i < v.size() * sizeof(double); ++i) {
+      h = (h ^ p[i]) * 0x100000001b3;
+    }
+  };
+  add(m_X0);
+  add(m_Dx);
+  add(m_Y0);
+  add(m_Y1);
+  return h;
+}
+
+std::ostream& operator<<(std::ostream& out, const SiPMDistribution& obj) {
+  out << std::setprecision(2) << std::fixed;
+  out << "===> SiPM Distribution <===\n";
+  out << "Address: " << std::addressof(obj) << "\n";
+  out << "Number of bins: " << obj.size() << "\n";
+  out << "Range: " << obj.min() << " - " << obj.max() << "\n";
+  out << "Mean value: " << obj.mean() << "\n";
+  return out;
+}
+} // namespace sipm
@@ -0,0 +1,338 @@
+#include "SiPMExecutor.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace sipm {
+namespace {
+// Parses a list of cpus in the kernel format (e.g. "0-3,8,10-11")
+std::vector<uint32_t> parseCpuList(const std::string& list) {
+  std::vector<uint32_t> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty() || range == "\n") {
+      continue;
+    }
+    const size_t dash = range.find('-');
+    const uint32_t first = std::stoul(range.substr(0, dash));
+    const uint32_t last = (dash == std::string::npos) ? first : std::stoul(range.substr(dash + 1));
+    for (uint32_t i = first; i <= last; ++i) {
+      cpus.push_back(i);
+    }
+  }
+  return cpus;
+}
+
+// Formats a list of cpus as ranges
+std::string formatCpuList(const std::vector<uint32_t>& cpus) {
+  std::stringstream ss;
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    size_t j = i;
+    while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+      ++j;
+    }
+    ss << ((i > 0) ? "," : "") << cpus[i];
+    if (j > i) {
+      ss << "-" << cpus[j];
+    }
+    i = j;
+  }
+  return ss.str();
+}
+} // namespace
+
+SiPMTopology SiPMTopology::detect() {
+  SiPMTopology topology;
+#ifdef __linux__
+  // Only cpus available to this process (e.g. restricted by taskset or cgroups)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  const bool hasAffinity = sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == 0;
+
+  std::vector<uint32_t> nodeIds;
+  if (DIR* dir = opendir("/sys/devices/system/node")) {
+    while (const dirent* entry = readdir(dir)) {
+      const std::string name = entry->d_name;
+      if (name.size() > 4 && name.compare(0, 4, "node") == 0 && std::isdigit(name[4])) {
+        nodeIds.push_back(std::stoul(name.substr(4)));
+      }
+    }
+    closedir(dir);
+  }
+  std::sort(nodeIds.begin(), nodeIds.end());
+
+  for (const uint32_t id : nodeIds) {
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+    std::string list;
+    std::getline(file, list);
+    std::vector<uint32_t> cpus;
+    for (const uint32_t cpu : parseCpuList(list)) {
+      if (!hasAffinity || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) {
+        cpus.push_back(cpu);
+      }
+    }
+    // Memory-only nodes have no cpus
+    if (!cpus.empty()) {
+      topology.nodes.push_back(cpus);
+    }
+  }
+#endif
+  if (topology.nodes.empty()) {
+    const uint32_t nCpus = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<uint32_t> cpus(nCpus);
+    for (uint32_t i = 0; i < nCpus; ++i) {
+      cpus[i] = i;
+    }
+    topology.nodes.push_back(cpus);
+  }
+  return topology;
+}
+
+uint32_t SiPMTopology::nCpus() const {
+  uint32_t n = 0;
+  for (const auto& node : nodes) {
+    n += node.size();
+  }
+  return n;
+}
+
+/**
+ * Workers are distributed round-robin over the nodes so that all memory
+ * controllers are used also when running less threads than cpus. If there are
+ * more workers than cpus, cpus are reused.
+ * @param i Index of the worker
+ */
+uint32_t SiPMTopology::cpu(const uint32_t i) const {
+  const std::vector<uint32_t>& node = nodes[i % nodes.size()];
+  return node[(i / nodes.size()) % node.size()];
+}
+
+void SiPMTopology::pin(const uint32_t cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) != 0) {
+    std::cerr << "Could not pin thread to cpu " << cpu << "\n";
+  }
+#endif
+}
+
+std::mutex& SiPMExecutor::defaultMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::shared_ptr<SiPMExecutor>& SiPMExecutor::defaultInstance() {
+  static std::shared_ptr<SiPMExecutor> instance;
+  return instance;
+}
+
+std::shared_ptr<SiPMExecutor> SiPMExecutor::defaultExecutor() {
+  std::lock_guard<std::mutex> lock(defaultMutex());
+  std::shared_ptr<SiPMExecutor>& instance = defaultInstance();
+  if (!instance) {
+    // Threads are not pinned: a library should not change affinity of the process
+    instance = std::make_shared<SiPMThreadPool>(0, false);
+  }
+  return instance;
+}
+
+void SiPMExecutor::setDefaultExecutor(std::shared_ptr<SiPMExecutor> executor) {
+  std::lock_guard<std::mutex> lock(defaultMutex());
+  defaultInstance() = std::move(executor);
+}
+
+namespace {
+// Pool and queue index of the current thread if it is a worker
+thread_local const SiPMThreadPool* tlPool = nullptr;
+thread_local uint32_t tlIndex = 0;
+
+// Counts finished tasks of a parallel loop and keeps the first exception thrown by a task
+struct Latch {
+  explicit Latch(const uint32_t n) : remaining(n) {}
+  // Runs a task: the latch is counted down also if the task throws
+  void run(const std::function<void(uint32_t)>& f, const uint32_t i) {
+    try {
+      f(i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+    countDown();
+  }
+  void countDown() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--remaining == 0) {
+      cv.notify_all();
+    }
+  }
+  bool done() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return remaining == 0;
+  }
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return remaining == 0; });
+  }
+  // Rethrows in the caller the exception of a task, once all tasks have finished
+  void rethrow() {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  std::mutex mutex;
+  std::condition_variable cv;
+  uint32_t remaining;
+  std::exception_ptr error;
+};
+} // namespace
+
+SiPMThreadPool::SiPMThreadPool(const uint32_t nThreads, const bool pin) : m_Pinned(pin) {
+  const SiPMTopology topology = SiPMTopology::detect();
+  const uint32_t n = (nThreads > 0) ? nThreads : topology.nCpus();
+  for (uint32_t i = 0; i < n; ++i) {
+    m_Queues.emplace_back(new Queue);
+  }
+  for (uint32_t i = 0; i < n; ++i) {
+    const uint32_t cpu = topology.cpu(i);
+    m_Threads.emplace_back([this, i, cpu] {
+      if (m_Pinned) {
+        SiPMTopology::pin(cpu);
+      }
+      workerLoop(i);
+    });
+  }
+}
+
+SiPMThreadPool::~SiPMThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stop = true;
+  }
+  m_Cv.notify_all();
+  for (auto& t : m_Threads) {
+    t.join();
+  }
+}
+
+/**
+ * Runs one task: first from the back of the own queue, then stealing from
+ * the front of the other queues.
+ * @param self Index of the queue of the calling thread
+ * @return false if all queues are empty
+ */
+bool SiPMThreadPool::runTask(const uint32_t self) {
+  const uint32_t nQueues = m_Queues.size();
+  for (uint32_t k = 0; k < nQueues; ++k) {
+    Queue& queue = *m_Queues[(self + k) % nQueues];
+    std::function<void()> task;
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.tasks.empty()) {
+        continue;
+      }
+      if (k == 0) {
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+      } else {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      --m_Pending;
+    }
+    task();
+    return true;
+  }
+  return false;
+}
+
+void SiPMThreadPool::workerLoop(const uint32_t self) {
+  tlPool = this;
+  tlIndex = self;
+  while (true) {
+    if (runTask(self)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Cv.wait(lock, [this] { return m_Stop || m_Pending > 0; });
+    if (m_Stop && m_Pending == 0) {
+      return;
+    }
+  }
+}
+
+/**
+ * Tasks are spread round-robin over the queues of the workers. If called
+ * from a worker of this pool, the calling worker runs tasks while waiting.
+ * @param n Number of iterations
+ * @param f Function called for each iteration
+ */
+void SiPMThreadPool::parallelFor(const uint32_t n, const std::function<void(uint32_t)>& f) {
+  if (n == 0) {
+    return;
+  }
+  Latch latch(n);
+  // Counted before queueing: a worker can run (and uncount) a task as soon as it is queued
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Pending += n;
+  }
+  const uint32_t nQueues = m_Queues.size();
+  for (uint32_t i = 0; i < n; ++i) {
+    Queue& queue = *m_Queues[i % nQueues];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.emplace_back([&f, &latch, i] { latch.run(f, i); });
+  }
+  m_Cv.notify_all();
+
+  if (tlPool == this) {
+    while (!latch.done()) {
+      if (!runTask(tlIndex)) {
+        std::this_thread::yield();
+      }
+    }
+  } else {
+    latch.wait();
+  }
+  latch.rethrow();
+}
+
+void SiPMHostExecutor::parallelFor(const uint32_t n, const std::function<void(uint32_t)>& f) {
+  if (n == 0) {
+    return;
+  }
+  Latch latch(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    m_Submit([&f, &latch, i] { latch.run(f, i); });
+  }
+  latch.wait();
+  latch.rethrow();
+}
+
+std::ostream& operator<<(std::ostream& out, const SiPMTopology& obj) {
+  out << "===> SiPM Topology <===\n";
+  out << "Number of NUMA nodes: " << obj.nNodes() << "\n";
+  out << "Number of cpus: " << obj.nCpus() << "\n";
+  for (uint32_t i = 0; i < obj.nNodes(); ++i) {
+    out << "Node " << i << " cpus: " << formatCpuList(obj.nodes[i]) << "\n";
+  }
+  return out;
+}
+
+} // namespace sipm
@@ -0,0 +1,51 @@
+#include "SiPMLatency.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace sipm {
+void SiPMLatency::merge(const SiPMLatency& rhs) {
+  for (uint32_t i = 0; i < nBuckets; ++i) {
+    m_Counts[i] += rhs.m_Counts[i];
+  }
+  m_Count += rhs.m_Count;
+  m_Sum += rhs.m_Sum;
+  m_Min = std::min(m_Min, rhs.m_Min);
+  m_Max = std::max(m_Max, rhs.m_Max);
+}
+
+void SiPMLatency::reset() { *this = SiPMLatency(); }
+
+/**
+ * @param q Fraction of values in [0,1] (e.g. 0.99 for the 99th percentile)
+ * @return Latency in ns (0 if no value has been recorded)
+ */
+uint64_t SiPMLatency::quantile(const double q) const {
+  if (m_Count == 0) {
+    return 0;
+  }
+  // Rank of the value (1 for the smallest)
+  const uint64_t rank = std::max<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * m_Count), 1);
+  uint64_t cumulative = 0;
+  for (uint32_t i = 0; i < nBuckets; ++i) {
+    cumulative += m_Counts[i];
+    if (cumulative >= rank) {
+      return std::clamp(upperEdge(i), min(), m_Max);
+    }
+  }
+  return m_Max;
+}
+
+std::ostream& operator<<(std::ostream& out, const SiPMLatency& obj) {
+  out << std::setprecision(2) << std::fixed;
+  out << "===> SiPM Latency <===\n";
+  out << "Address: " << std::addressof(obj) << "\n";
+  out << "Number of values: " << obj.m_Count << "\n";
+  out << "Mean: " << obj.mean() * 1e-3 << " us\n";
+  out << "p50 / p99 / p999: " << obj.quantile(0.5) * 1e-3 << " / " << obj.quantile(0.99) * 1e-3 << " / "
+      << obj.quantile(0.999) * 1e-3 << " us\n";
+  out << "Max: " << obj.m_Max * 1e-3 << " us\n";
+  return out;
+}
+} // namespace sipm
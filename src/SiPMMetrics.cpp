@@ -0,0 +1,337 @@
+#include "SiPMMetrics.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+namespace sipm {
+namespace {
+// Unique id of each registry, so that thread-local caches are never reused
+// by a registry allocated at the same address
+std::atomic<uint64_t> nextRegistryId{1};
+
+// Name without labels (family of the metric)
+std::string baseName(const std::string& name) { return name.substr(0, name.find('{')); }
+
+// Labels without braces (empty if there are none)
+std::string labels(const std::string& name) {
+  const size_t pos = name.find('{');
+  return (pos == std::string::npos) ? "" : name.substr(pos + 1, name.size() - pos - 2);
+}
+
+std::string jsonEscape(const std::string& s) {
+  std::string out;
+  for (const char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+    }
+    out += c;
+  }
+  return out;
+}
+
+void writeDouble(std::ostream& out, const double x) {
+  if (x == std::numeric_limits<double>::infinity()) {
+    out << "+Inf";
+  } else {
+    out << x;
+  }
+}
+} // namespace
+
+SiPMMetrics::SiPMMetrics()
+  : m_Id(nextRegistryId++), m_Metrics(new Metric[maxMetrics]), m_Gauges(new std::atomic<uint64_t>[maxMetrics]) {
+  for (uint32_t i = 0; i < maxMetrics; ++i) {
+    m_Gauges[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+SiPMMetrics::~SiPMMetrics() { stopExport(); }
+
+uint32_t SiPMMetrics::registerMetric(const std::string& name, const std::string& help, const Type type,
+                                     const std::vector<double>& bounds) {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  const uint32_t n = m_NMetrics.load(std::memory_order_relaxed);
+  for (uint32_t i = 0; i < n; ++i) {
+    if (m_Metrics[i].name == name) {
+      if (m_Metrics[i].type != type) {
+        std::cerr << "Metric " << name << " is already registered with a different type!" << std::endl;
+      }
+      return i;
+    }
+  }
+  // Histograms have one slot for each bucket and one for the sum, gauges are not sharded
+  const uint32_t nSlots = (type == Type::kHistogram) ? bounds.size() + 2 : (type == Type::kCounter);
+  if (n == maxMetrics || m_NSlots + nSlots > maxSlots) {
+    std::cerr << "Too many metrics, " << name << " is not registered!" << std::endl;
+    // Updates of an invalid id are ignored so callers do not need to check
+    return invalidId;
+  }
+  Metric& m = m_Metrics[n];
+  m.name = name;
+  m.help = help;
+  m.type = type;
+  m.bounds = bounds;
+  m.slot = (type == Type::kGauge) ? m_NGauges++ : m_NSlots;
+  m_NSlots += nSlots;
+  // Metric is visible to readers only once complete
+  m_NMetrics.store(n + 1, std::memory_order_release);
+  return n;
+}
+
+uint32_t SiPMMetrics::counter(const std::string& name, const std::string& help) {
+  return registerMetric(name, help, Type::kCounter, {});
+}
+
+uint32_t SiPMMetrics::gauge(const std::string& name, const std::string& help) {
+  return registerMetric(name, help, Type::kGauge, {});
+}
+
+uint32_t SiPMMetrics::histogram(const std::string& name, const std::vector<double>& bounds, const std::string& help) {
+  if (!std::is_sorted(bounds.begin(), bounds.end())) {
+    std::cerr << "Bounds of histogram " << name << " must be in increasing order!" << std::endl;
+    std::vector<double> sorted(bounds);
+    std::sort(sorted.begin(), sorted.end());
+    return registerMetric(name, help, Type::kHistogram, sorted);
+  }
+  return registerMetric(name, help, Type::kHistogram, bounds);
+}
+
+/**
+ * @param start Upper bound of the first bucket
+ * @param factor Ratio between consecutive bounds
+ * @param n Number of bounds
+ */
+std::vector<double> SiPMMetrics::exponentialBounds(const double start, const double factor, const uint32_t n) {
+  std::vector<double> out(n);
+  double x = start;
+  for (uint32_t i = 0; i < n; ++i, x *= factor) {
+    out[i] = x;
+  }
+  return out;
+}
+
+SiPMMetrics::Shard& SiPMMetrics::threadShard() {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  std::unique_ptr<Shard>& s = m_Shards[std::this_thread::get_id()];
+  if (!s) {
+    s.reset(new Shard);
+  }
+  return *s;
+}
+
+void SiPMMetrics::observe(const uint32_t id, const double x) {
+  if (!isValid(id)) {
+    return;
+  }
+  const Metric& m = m_Metrics[id];
+  const uint32_t bucket = std::lower_bound(m.bounds.begin(), m.bounds.end(), x) - m.bounds.begin();
+  std::atomic<uint64_t>* v = shard().values + m.slot;
+  v[bucket].store(v[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic<uint64_t>& sum = v[m.bounds.size() + 1];
+  sum.store(toBits(fromBits(sum.load(std::memory_order_relaxed)) + x), std::memory_order_relaxed);
+}
+
+void SiPMMetrics::addGauge(const uint32_t id, const double x) {
+  if (!isValid(id)) {
+    return;
+  }
+  std::atomic<uint64_t>& v = m_Gauges[m_Metrics[id].slot];
+  uint64_t old = v.load(std::memory_order_relaxed);
+  while (!v.compare_exchange_weak(old, toBits(fromBits(old) + x), std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t SiPMMetrics::sumSlot(const uint32_t slot) const {
+  uint64_t sum = 0;
+  for (const auto& s : m_Shards) {
+    sum += s.second->values[slot].load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+uint64_t SiPMMetrics::value(const uint32_t id) const {
+  if (!isValid(id)) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return sumSlot(m_Metrics[id].slot);
+}
+
+std::vector<uint64_t> SiPMMetrics::bucketCounts(const uint32_t id) const {
+  if (!isValid(id)) {
+    return {};
+  }
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  const Metric& m = m_Metrics[id];
+  std::vector<uint64_t> out(m.bounds.size() + 1);
+  for (uint32_t i = 0; i < out.size(); ++i) {
+    out[i] = sumSlot(m.slot + i);
+  }
+  return out;
+}
+
+uint64_t SiPMMetrics::count(const uint32_t id) const {
+  const std::vector<uint64_t> counts = bucketCounts(id);
+  uint64_t n = 0;
+  for (const uint64_t c : counts) {
+    n += c;
+  }
+  return n;
+}
+
+double SiPMMetrics::sum(const uint32_t id) const {
+  if (!isValid(id)) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  const Metric& m = m_Metrics[id];
+  double sum = 0;
+  for (const auto& s : m_Shards) {
+    sum += fromBits(s.second->values[m.slot + m.bounds.size() + 1].load(std::memory_order_relaxed));
+  }
+  return sum;
+}
+
+int32_t SiPMMetrics::find(const std::string& name) const {
+  const uint32_t n = nMetrics();
+  for (uint32_t i = 0; i < n; ++i) {
+    if (m_Metrics[i].name == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void SiPMMetrics::writePrometheus(std::ostream& out) const {
+  const uint32_t n = nMetrics();
+  std::string family;
+  out << std::setprecision(std::numeric_limits<double>::max_digits10);
+  for (uint32_t i = 0; i < n; ++i) {
+    const Metric& m = m_Metrics[i];
+    // Metrics with the same name and different labels share HELP and TYPE
+    if (baseName(m.name) != family) {
+      family = baseName(m.name);
+      if (!m.help.empty()) {
+        out << "# HELP " << family << " " << m.help << "\n";
+      }
+      out << "# TYPE " << family << " "
+          << (m.type == Type::kCounter ? "counter" : (m.type == Type::kGauge ? "gauge" : "histogram")) << "\n";
+    }
+    if (m.type == Type::kCounter) {
+      out << m.name << " " << value(i) << "\n";
+    } else if (m.type == Type::kGauge) {
+      out << m.name << " " << gaugeValue(i) << "\n";
+    } else {
+      const std::string lbl = labels(m.name);
+      const std::string sep = lbl.empty() ? "" : ",";
+      const std::vector<uint64_t> counts = bucketCounts(i);
+      uint64_t cumulative = 0;
+      for (uint32_t b = 0; b < counts.size(); ++b) {
+        cumulative += counts[b];
+        out << family << "_bucket{" << lbl << sep << "le=\"";
+        writeDouble(out, b < m.bounds.size() ? m.bounds[b] : std::numeric_limits<double>::infinity());
+        out << "\"} " << cumulative << "\n";
+      }
+      const std::string suffix = lbl.empty() ? "" : "{" + lbl + "}";
+      out << family << "_sum" << suffix << " " << sum(i) << "\n";
+      out << family << "_count" << suffix << " " << cumulative << "\n";
+    }
+  }
+}
+
+void SiPMMetrics::writeJson(std::ostream& out) const {
+  const uint32_t n = nMetrics();
+  out << std::setprecision(std::numeric_limits<double>::max_digits10);
+  out << "{";
+  for (uint32_t i = 0; i < n; ++i) {
+    const Metric& m = m_Metrics[i];
+    out << (i ? ",\n " : "\n ") << "\"" << jsonEscape(m.name) << "\": ";
+    if (m.type == Type::kCounter) {
+      out << value(i);
+    } else if (m.type == Type::kGauge) {
+      out << gaugeValue(i);
+    } else {
+      const std::vector<uint64_t> counts = bucketCounts(i);
+      uint64_t total = 0;
+      out << "{\"bounds\": [";
+      for (uint32_t b = 0; b < m.bounds.size(); ++b) {
+        out << (b ? ", " : "") << m.bounds[b];
+      }
+      out << "], \"counts\": [";
+      for (uint32_t b = 0; b < counts.size(); ++b) {
+        out << (b ? ", " : "") << counts[b];
+        total += counts[b];
+      }
+      out << "], \"count\": " << total << ", \"sum\": " << sum(i) << "}";
+    }
+  }
+  out << "\n}\n";
+}
+
+/**
+ * @param fname Name of the file
+ * @param format Format of the file
+ */
+bool SiPMMetrics::write(const std::string& fname, const Format format) const {
+  const std::string tmp = fname + ".tmp";
+  {
+    std::ofstream file(tmp);
+    if (!file.is_open()) {
+      std::cerr << "Could not open " << tmp << " for writing!" << std::endl;
+      return false;
+    }
+    if (format == Format::kJson) {
+      writeJson(file);
+    } else {
+      writePrometheus(file);
+    }
+    if (!file) {
+      return false;
+    }
+  }
+  return std::rename(tmp.c_str(), fname.c_str()) == 0;
+}
+
+void SiPMMetrics::startExport(const std::string& fname, const double period, const Format format) {
+  stopExport();
+  m_StopExport = false;
+  const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(std::max(period, 1e-3)));
+  m_Exporter = std::thread([this, fname, interval, format] {
+    std::unique_lock<std::mutex> lock(m_ExportMutex);
+    while (!m_ExportCv.wait_for(lock, interval, [this] { return m_StopExport; })) {
+      write(fname, format);
+    }
+    write(fname, format);
+  });
+}
+
+void SiPMMetrics::stopExport() {
+  if (!m_Exporter.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_ExportMutex);
+    m_StopExport = true;
+  }
+  m_ExportCv.notify_all();
+  m_Exporter.join();
+}
+
+std::ostream& operator<<(std::ostream& out, const SiPMMetrics& obj) {
+  out << "===> SiPM Metrics <===\n";
+  out << "Address: " << std::addressof(obj) << "\n";
+  out << "Number of metrics: " << obj.nMetrics() << "\n";
+  {
+    std::lock_guard<std::mutex> lock(obj.m_Mutex);
+    out << "Number of thread shards: " << obj.m_Shards.size() << "\n";
+  }
+  out << "Export: " << (obj.m_Exporter.joinable() ? "running" : "stopped") << "\n";
+  obj.writePrometheus(out);
+  return out;
+}
+} // namespace sipm
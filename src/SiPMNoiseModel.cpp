@@ -0,0 +1,434 @@
+#include "SiPMNoiseModel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <numeric>
+
+namespace sipm {
+namespace {
+bool validComponent(const double sigma, const double fLow, const double fHigh) {
+  return sigma >= 0 && fLow > 0 && fHigh >= fLow && std::isfinite(fHigh);
+}
+} // namespace
+
+void SiPMNoiseModel::addWhite(const double sigma) {
+  if (sigma < 0) {
+    std::cerr << "Invalid white noise component!" << std::endl;
+    return;
+  }
+  m_Components.push_back({Type::kWhite, sigma, 0, 0});
+  if (m_Sampling > 0) {
+    m_Filters.push_back(makeFilter(m_Components.back(), m_Sampling));
+  }
+}
+
+void SiPMNoiseModel::addPink(const double sigma, const double fLow, const double fHigh) {
+  if (!validComponent(sigma, fLow, fHigh) || fHigh == fLow) {
+    std::cerr << "Invalid pink noise component!" << std::endl;
+    return;
+  }
+  m_Components.push_back({Type::kPink, sigma, fLow, fHigh});
+  if (m_Sampling > 0) {
+    m_Filters.push_back(makeFilter(m_Components.back(), m_Sampling));
+  }
+}
+
+void SiPMNoiseModel::addBand(const double sigma, const double fLow, const double fHigh) {
+  if (!validComponent(sigma, fLow, fHigh)) {
+    std::cerr << "Invalid band noise component!" << std::endl;
+    return;
+  }
+  m_Components.push_back({Type::kBand, sigma, fLow, std::max(fHigh, 1.01 * fLow)});
+  if (m_Sampling > 0) {
+    m_Filters.push_back(makeFilter(m_Components.back(), m_Sampling));
+  }
+}
+
+/**
+ * Each section (1 - q z^-1) / (1 - p z^-1) comes from the matched z-transform
+ * of an analog pole (and zero) at frequency f: p = exp(-2 pi f dt). The
+ * cascade is expanded in partial fractions so that each pole is an
+ * independent first-order recursion.
+ *
+ * Corners are clamped to the Nyquist frequency since the spectrum above it is
+ * not sampled. A pink component entirely above it is flat and becomes white
+ * noise, as does any component whose poles are too close to be separated.
+ */
+SiPMNoiseModel::Filter SiPMNoiseModel::makeFilter(const Component& c, const double sampling) {
+  const double dt = sampling * 1e-9;
+  const double nyquist = 0.5 / dt;
+  const double fLow = std::min(c.fLow, nyquist);
+  const double fHigh = std::min(c.fHigh, nyquist);
+  auto pole = [dt](const double f) { return std::exp(-2 * M_PI * f * dt); };
+
+  std::vector<double> p, q;
+  switch (c.type) {
+    case Type::kWhite:
+      break;
+    case Type::kPink: {
+      if (fLow >= fHigh) {
+        break;
+      }
+      // Two poles per decade: poles and zeros alternate with constant spacing
+      const double decades = std::log10(fHigh / fLow);
+      const uint32_t n = std::min<uint32_t>(std::max<uint32_t>(std::ceil(2 * decades), 1), maxPoles);
+      const double ratio = std::pow(fHigh / fLow, 1.0 / n);
+      for (uint32_t i = 0; i < n; ++i) {
+        const double f = fLow * std::pow(ratio, i);
+        p.push_back(pole(f));
+        q.push_back(pole(f * std::sqrt(ratio)));
+      }
+      break;
+    }
+    case Type::kBand:
+      // CR: zero in DC, RC: no zero
+      p.push_back(pole(fLow));
+      q.push_back(1);
+      p.push_back(std::min(pole(fHigh), 0.99 * p[0]));
+      q.push_back(0);
+      break;
+  }
+
+  // Partial fractions need distinct poles
+  bool degenerate = false;
+  for (uint32_t k = 0; k < p.size(); ++k) {
+    for (uint32_t i = 0; i < k; ++i) {
+      degenerate |= std::abs(p[i] - p[k]) <= 1e-9 * std::max(p[i], p[k]);
+    }
+  }
+  if (degenerate) {
+    std::cerr << "Noise component with degenerate poles, replaced by white noise!" << std::endl;
+    p.clear();
+    q.clear();
+  }
+
+  Filter out;
+  const uint32_t n = p.size();
+  out.nPoles = n;
+  out.nPadded = (n + 3) / 4 * 4;
+  double direct = 1;
+  for (uint32_t i = 0; i < n; ++i) {
+    direct *= q[i] / p[i];
+  }
+  out.direct = direct;
+  for (uint32_t k = 0; k < n; ++k) {
+    double r = 1;
+    for (uint32_t i = 0; i < n; ++i) {
+      r *= 1 - q[i] / p[k];
+      if (i != k) {
+        r /= 1 - p[i] / p[k];
+      }
+    }
+    out.poles[k] = p[k];
+    out.residues[k] = r;
+  }
+
+  // Stationary variance for unit white noise: states have covariance 1 / (1 - pi pj)
+  auto cov = [&out](const uint32_t i, const uint32_t j) { return 1 / (1 - out.poles[i] * out.poles[j]); };
+  double variance = out.direct * out.direct;
+  for (uint32_t i = 0; i < n; ++i) {
+    variance += 2 * out.direct * out.residues[i];
+    for (uint32_t j = 0; j < n; ++j) {
+      variance += out.residues[i] * out.residues[j] * cov(i, j);
+    }
+  }
+  const double scale = variance > 0 ? c.sigma / std::sqrt(variance) : 0;
+  out.direct *= scale;
+  for (uint32_t i = 0; i < n; ++i) {
+    out.residues[i] *= scale;
+  }
+
+  // Cholesky factor of the covariance, columns of (numerically) dependent states are dropped
+  for (uint32_t j = 0; j < n; ++j) {
+    double d = cov(j, j);
+    for (uint32_t k = 0; k < j; ++k) {
+      d -= out.chol[j * maxPoles + k] * out.chol[j * maxPoles + k];
+    }
+    if (d <= 1e-12 * cov(j, j)) {
+      continue;
+    }
+    const double ljj = std::sqrt(d);
+    out.chol[j * maxPoles + j] = ljj;
+    for (uint32_t i = j + 1; i < n; ++i) {
+      double x = cov(i, j);
+      for (uint32_t k = 0; k < j; ++k) {
+        x -= out.chol[i * maxPoles + k] * out.chol[j * maxPoles + k];
+      }
+      out.chol[i * maxPoles + j] = x / ljj;
+    }
+  }
+  return out;
+}
+
+/**
+ * @param sampling Sampling time in ns
+ */
+void SiPMNoiseModel::prepare(const double sampling) {
+  if (sampling <= 0) {
+    std::cerr << "Invalid sampling time for noise model!" << std::endl;
+    return;
+  }
+  m_Sampling = sampling;
+  m_Filters.clear();
+  for (const Component& c : m_Components) {
+    m_Filters.push_back(makeFilter(c, sampling));
+  }
+}
+
+uint32_t SiPMNoiseModel::nPoles() const {
+  uint32_t n = 0;
+  for (const Filter& f : m_Filters) {
+    n += f.nPoles;
+  }
+  return n;
+}
+
+double SiPMNoiseModel::sigma() const {
+  double variance = 0;
+  for (const Component& c : m_Components) {
+    variance += c.sigma * c.sigma;
+  }
+  return std::sqrt(variance);
+}
+
+/**
+ * @param f Frequency in Hz
+ */
+double SiPMNoiseModel::psd(const double f) const {
+  if (m_Filters.size() != m_Components.size()) {
+    std::cerr << "Noise model must be prepared with a sampling time!" << std::endl;
+    return 0;
+  }
+  const double dt = m_Sampling * 1e-9;
+  const std::complex<double> w = std::polar(1.0, -2 * M_PI * f * dt);
+  double out = 0;
+  for (const Filter& filter : m_Filters) {
+    std::complex<double> h = filter.direct;
+    for (uint32_t k = 0; k < filter.nPoles; ++k) {
+      h += filter.residues[k] / (1.0 - filter.poles[k] * w);
+    }
+    // White noise of unit variance has a one-sided PSD of 2 dt
+    out += 2 * dt * std::norm(h);
+  }
+  return out;
+}
+
+namespace {
+// Filter loop with a number of poles known at compile time, so that states stay in registers
+template <uint32_t N>
+void filterLoop(double* s, const double* __restrict poles, const double* __restrict residues, const double direct,
+                const float* __restrict white, float* __restrict out, const uint32_t n) {
+  double state[N], p[N], r[N];
+  for (uint32_t k = 0; k < N; ++k) {
+    state[k] = s[k];
+    p[k] = poles[k];
+    r[k] = residues[k];
+  }
+  // Poles are independent: the inner loop should be vectorized by compiler
+  for (uint32_t i = 0; i < n; ++i) {
+    const double x = white[i];
+    double y = direct * x;
+    for (uint32_t k = 0; k < N; ++k) {
+      state[k] = p[k] * state[k] + x;
+      y += r[k] * state[k];
+    }
+    out[i] += y;
+  }
+}
+} // namespace
+
+// Adds the output of a filter driven by white noise to out
+void SiPMNoiseModel::filter(const Filter& f, const float* white, float* out, const uint32_t n,
+                            SiPMRandom& rng) const {
+  alignas(64) double s[maxPoles] = {};
+  if (f.nPoles > 0) {
+    // State drawn from the stationary distribution
+    float g[maxPoles];
+    rng.randGaussianBoxMuller(0, 1, g, f.nPoles);
+    for (uint32_t i = 0; i < f.nPoles; ++i) {
+      for (uint32_t j = 0; j <= i; ++j) {
+        s[i] += f.chol[i * maxPoles + j] * g[j];
+      }
+    }
+  }
+
+  static_assert(maxPoles == 16, "Filter loops are instantiated for up to 16 poles");
+  switch (f.nPadded) {
+    case 0:
+      for (uint32_t i = 0; i < n; ++i) {
+        out[i] += f.direct * white[i];
+      }
+      break;
+    case 4:
+      filterLoop<4>(s, f.poles, f.residues, f.direct, white, out, n);
+      break;
+    case 8:
+      filterLoop<8>(s, f.poles, f.residues, f.direct, white, out, n);
+      break;
+    case 12:
+      filterLoop<12>(s, f.poles, f.residues, f.direct, white, out, n);
+      break;
+    default:
+      filterLoop<16>(s, f.poles, f.residues, f.direct, white, out, n);
+      break;
+  }
+}
+
+/**
+ * @param signal Samples of the signal
+ * @param n Number of samples
+ * @param rng Random generator
+ * @param scratch Buffer for white noise
+ */
+void SiPMNoiseModel::addNoise(float* signal, const uint32_t n, SiPMRandom& rng, SiPMVector<float>& scratch) const {
+  if (m_Filters.size() != m_Components.size()) {
+    std::cerr << "Noise model must be prepared with a sampling time!" << std::endl;
+    return;
+  }
+  if (scratch.size() < n) {
+    scratch.resize(n);
+  }
+  for (const Filter& f : m_Filters) {
+    rng.randGaussianBoxMuller(0, 1, scratch.data(), n);
+    filter(f, scratch.data(), signal, n, rng);
+  }
+}
+
+SiPMVector<float> SiPMNoiseModel::generate(SiPMRandom& rng, const uint32_t n) const {
+  SiPMVector<float> out(n, 0);
+  SiPMVector<float> scratch;
+  addNoise(out.data(), n, rng, scratch);
+  return out;
+}
+
+/**
+ * Candidates are white noise, pink noise over the measured range and CR-RC
+ * bands three per decade. Their variances are the non-negative least
+ * squares solution (coordinate descent on the normal equations).
+ */
+SiPMNoiseModel SiPMNoiseModel::fromPsd(const std::vector<double>& freqs, const std::vector<double>& psd,
+                                       const double sampling, const uint32_t maxComponents) {
+  if (freqs.size() != psd.size() || freqs.size() < 2 || sampling <= 0) {
+    std::cerr << "Invalid power spectral density!" << std::endl;
+    return SiPMNoiseModel();
+  }
+  const double nyquist = 0.5e9 / sampling;
+  std::vector<double> f, s;
+  for (uint32_t i = 0; i < freqs.size(); ++i) {
+    if (freqs[i] > 0 && freqs[i] <= nyquist && psd[i] > 0) {
+      f.push_back(freqs[i]);
+      s.push_back(psd[i]);
+    }
+  }
+  if (f.size() < 2) {
+    std::cerr << "Power spectral density needs at least two positive values below Nyquist frequency!" << std::endl;
+    return SiPMNoiseModel();
+  }
+  const double fMin = *std::min_element(f.begin(), f.end());
+  const double fMax = *std::max_element(f.begin(), f.end());
+
+  std::vector<Component> candidates;
+  candidates.push_back({Type::kWhite, 1, 0, 0});
+  if (fMax > fMin) {
+    candidates.push_back({Type::kPink, 1, fMin, fMax});
+  }
+  const double step = std::pow(10, 1.0 / 3);
+  for (double fc = fMin; fc <= fMax * step; fc *= step) {
+    candidates.push_back({Type::kBand, 1, fc / 2, 2 * fc});
+  }
+
+  // Relative PSD of each candidate with unit variance
+  const uint32_t nc = candidates.size();
+  const uint32_t nf = f.size();
+  std::vector<std::vector<double>> a(nc, std::vector<double>(nf));
+  for (uint32_t c = 0; c < nc; ++c) {
+    SiPMNoiseModel unit;
+    unit.m_Components.push_back(candidates[c]);
+    unit.prepare(sampling);
+    for (uint32_t i = 0; i < nf; ++i) {
+      a[c][i] = unit.psd(f[i]) / s[i];
+    }
+  }
+
+  // Minimizes |sum v_c a_c - 1|^2 with v >= 0 using only candidates in active
+  auto solve = [&](const std::vector<uint32_t>& active) {
+    const uint32_t n = active.size();
+    std::vector<double> gram(n * n), rhs(n), v(n, 0);
+    for (uint32_t i = 0; i < n; ++i) {
+      const std::vector<double>& ai = a[active[i]];
+      rhs[i] = std::accumulate(ai.begin(), ai.end(), 0.0);
+      for (uint32_t j = 0; j < n; ++j) {
+        gram[i * n + j] = std::inner_product(ai.begin(), ai.end(), a[active[j]].begin(), 0.0);
+      }
+    }
+    for (uint32_t sweep = 0; sweep < 10000; ++sweep) {
+      double change = 0;
+      for (uint32_t i = 0; i < n; ++i) {
+        double grad = -rhs[i];
+        for (uint32_t j = 0; j < n; ++j) {
+          grad += gram[i * n + j] * v[j];
+        }
+        const double x = std::max(0.0, v[i] - grad / gram[i * n + i]);
+        change = std::max(change, std::abs(x - v[i]) * std::sqrt(gram[i * n + i]));
+        v[i] = x;
+      }
+      if (change < 1e-9) {
+        break;
+      }
+    }
+    return v;
+  };
+
+  std::vector<uint32_t> active(nc);
+  std::iota(active.begin(), active.end(), 0);
+  std::vector<double> v = solve(active);
+  // Keeps the components with the largest variance and fits again
+  std::vector<uint32_t> order(nc);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&v](const uint32_t i, const uint32_t j) { return v[i] > v[j]; });
+  active.clear();
+  for (uint32_t i = 0; i < nc && active.size() < std::max(maxComponents, 1u); ++i) {
+    if (v[order[i]] > 0) {
+      active.push_back(order[i]);
+    }
+  }
+  v = solve(active);
+
+  const double total = std::accumulate(v.begin(), v.end(), 0.0);
+  SiPMNoiseModel out;
+  for (uint32_t i = 0; i < active.size(); ++i) {
+    if (v[i] > 1e-6 * total) {
+      Component c = candidates[active[i]];
+      c.sigma = std::sqrt(v[i]);
+      out.m_Components.push_back(c);
+    }
+  }
+  out.prepare(sampling);
+  return out;
+}
+
+std::ostream& operator<<(std::ostream& out, const SiPMNoiseModel& obj) {
+  out << "===> SiPM Noise Model <===\n";
+  out << "Address: " << std::addressof(obj) << "\n";
+  out << "Sigma: " << obj.sigma() << "\n";
+  if (obj.m_Sampling > 0) {
+    out << "Sampling: " << obj.m_Sampling << " ns - poles: " << obj.nPoles() << "\n";
+  }
+  for (const SiPMNoiseModel::Component& c : obj.m_Components) {
+    switch (c.type) {
+      case SiPMNoiseModel::Type::kWhite:
+        out << "White: sigma " << c.sigma << "\n";
+        break;
+      case SiPMNoiseModel::Type::kPink:
+        out << "Pink: sigma " << c.sigma << " from " << c.fLow << " Hz to " << c.fHigh << " Hz\n";
+        break;
+      case SiPMNoiseModel::Type::kBand:
+        out << "Band: sigma " << c.sigma << " from " << c.fLow << " Hz to " << c.fHigh << " Hz\n";
+        break;
+    }
+  }
+  return out;
+}
+} // namespace sipm
@@ -0,0 +1,71 @@
+#include "SiPMOccupancy.h"
+#include "SiPMHit.h"
+#include "SiPMSensor.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace sipm {
+SiPMOccupancy::SiPMOccupancy(const uint32_t nSideCells)
+  : m_NSideCells(nSideCells), m_Counts(static_cast<size_t>(nHitTypes) * nSideCells * nSideCells, 0) {}
+
+/**
+ * @param sensor Sensor that has run an event
+ */
+void SiPMOccupancy::fill(const SiPMSensor& sensor) {
+  if (sensor.properties().nSideCells() != m_NSideCells) {
+    std::cerr << "Number of cells of sensor and occupancy do not match!" << std::endl;
+    return;
+  }
+  const uint32_t n = m_NSideCells;
+  uint64_t* counts = m_Counts.data();
+  for (const SiPMHit& hit : sensor.m_Hits) {
+    const uint32_t row = hit.row();
+    const uint32_t col = hit.col();
+    if (row < n && col < n) {
+      ++counts[index(static_cast<uint32_t>(hit.hitType()), row, col)];
+    }
+  }
+  ++m_NEvents;
+}
+
+void SiPMOccupancy::merge(const SiPMOccupancy& rhs) {
+  if (rhs.m_NSideCells != m_NSideCells) {
+    std::cerr << "Can not merge occupancies with different number of cells!" << std::endl;
+    return;
+  }
+  const size_t size = m_Counts.size();
+  uint64_t* __restrict counts = m_Counts.data();
+  const uint64_t* __restrict other = rhs.m_Counts.data();
+  for (size_t i = 0; i < size; ++i) {
+    counts[i] += other[i];
+  }
+  m_NEvents += rhs.m_NEvents;
+}
+
+void SiPMOccupancy::reset() {
+  std::fill(m_Counts.begin(), m_Counts.end(), 0);
+  m_NEvents = 0;
+}
+
+uint64_t SiPMOccupancy::count(const uint32_t row, const uint32_t col) const {
+  uint64_t sum = 0;
+  for (uint32_t t = 0; t < nHitTypes; ++t) {
+    sum += m_Counts[index(t, row, col)];
+  }
+  return sum;
+}
+
+std::ostream& operator<<(std::ostream& out, const SiPMOccupancy& obj) {
+  uint64_t total = 0;
+  for (const uint64_t c : obj.m_Counts) {
+    total += c;
+  }
+  out << "===> SiPM Occupancy <===\n";
+  out << "Address: " << std::addressof(obj) << "\n";
+  out << "Number of cells: " << obj.m_NSideCells << " x " << obj.m_NSideCells << "\n";
+  out << "Number of events: " << obj.m_NEvents << "\n";
+  out << "Number of hits: " << total << "\n";
+  return out;
+}
+} // namespace sipm
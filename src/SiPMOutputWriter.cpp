@@ -0,0 +1,247 @@
+#include "SiPMOutputWriter.h"
+#include "SiPMAnalogSignal.h"
+#include "SiPMBatchRunner.h"
+#include "SiPMTypes.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace sipm {
+/**
+ * @param fname Name of the output file
+ * @param bufferSize Size of each buffer in bytes
+ * @param nBuffers Number of buffers
+ * @param direct Opens the file with O_DIRECT if available
+ */
+SiPMOutputWriter::SiPMOutputWriter(const std::string& fname, const size_t bufferSize, const uint32_t nBuffers,
+                                   const bool direct)
+  : m_FileName(fname), m_BufferSize((std::max<size_t>(bufferSize, 1) + blockSize - 1) / blockSize * blockSize) {
+  open(direct);
+  if (!good()) {
+    std::cerr << "Could not open " << fname << " for writing!" << std::endl;
+    return;
+  }
+  // Buffers are aligned to huge pages, which also satisfies direct I/O
+  m_Buffers.resize(std::max<uint32_t>(nBuffers, 2));
+  for (uint32_t i = 0; i < m_Buffers.size(); ++i) {
+    void* data = MappedMemory::allocate(m_BufferSize, MemoryPolicy::kTransparentHugePages);
+    // Heap buffers aligned to blocks are released in the same way
+    if (data == nullptr) {
+      data = aligned_malloc(m_BufferSize, blockSize);
+    }
+    if (data == nullptr) {
+      std::cerr << "Could not allocate buffers for " << fname << "!" << std::endl;
+      close();
+      throw std::bad_alloc();
+    }
+    m_Buffers[i].data = reinterpret_cast<char*>(data);
+    if (i > 0) {
+      m_Free.push_back(i);
+    }
+  }
+  m_Thread = std::thread(&SiPMOutputWriter::ioLoop, this);
+}
+
+SiPMOutputWriter::~SiPMOutputWriter() { close(); }
+
+void SiPMOutputWriter::open(const bool direct) {
+#ifdef __unix__
+  const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+  if (direct) {
+    m_Fd = ::open(m_FileName.c_str(), flags | O_DIRECT, 0644);
+    // Some file systems (e.g. tmpfs) do not support direct I/O
+    m_Direct = (m_Fd >= 0);
+  }
+#endif
+  if (m_Fd < 0) {
+    m_Fd = ::open(m_FileName.c_str(), flags, 0644);
+  }
+#else
+  // Portable fallback: buffers are written in order with fwrite
+  m_File = std::fopen(m_FileName.c_str(), "wb");
+#endif
+}
+
+bool SiPMOutputWriter::writeBuffer(const Buffer& buffer) {
+#ifdef __unix__
+  size_t done = 0;
+  while (done < buffer.size) {
+    const ssize_t n = pwrite(m_Fd, buffer.data + done, buffer.size - done, buffer.offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    done += n;
+  }
+  return true;
+#else
+  return std::fwrite(buffer.data, 1, buffer.size, m_File) == buffer.size;
+#endif
+}
+
+void SiPMOutputWriter::ioLoop() {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  while (true) {
+    m_Cv.wait(lock, [this] { return m_Stop || !m_Pending.empty(); });
+    if (m_Pending.empty()) {
+      break;
+    }
+    const uint32_t idx = m_Pending.front();
+    m_Pending.pop_front();
+    m_Busy = true;
+    lock.unlock();
+
+    // After an error buffers are still released so that callers never block
+    const Buffer& buffer = m_Buffers[idx];
+    if (!m_Error.load(std::memory_order_relaxed)) {
+      const auto start = std::chrono::steady_clock::now();
+      if (writeBuffer(buffer)) {
+        m_BytesWritten.fetch_add(buffer.size, std::memory_order_relaxed);
+      } else {
+        std::cerr << "Could not write " << m_FileName << ": " << std::strerror(errno) << std::endl;
+        m_Error.store(true, std::memory_order_relaxed);
+      }
+      const auto stop = std::chrono::steady_clock::now();
+      m_WriteNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count(),
+                          std::memory_order_relaxed);
+    }
+
+    lock.lock();
+    m_Busy = false;
+    m_Free.push_back(idx);
+    m_Cv.notify_all();
+  }
+}
+
+// Queues n bytes of the current buffer for writing
+void SiPMOutputWriter::submit(const size_t n) {
+  Buffer& buffer = m_Buffers[m_Current];
+  buffer.size = n;
+  buffer.offset = m_Offset;
+  m_Offset += n;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Pending.push_back(m_Current);
+  }
+  m_Cv.notify_all();
+}
+
+// Waits for a free buffer and makes it the current one
+void SiPMOutputWriter::nextBuffer() {
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  if (m_Free.empty()) {
+    const auto start = std::chrono::steady_clock::now();
+    m_Cv.wait(lock, [this] { return !m_Free.empty(); });
+    m_StallNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+  m_Current = m_Free.front();
+  m_Free.pop_front();
+  m_Fill = 0;
+}
+
+/**
+ * @param data Pointer to the data
+ * @param n Number of bytes
+ */
+void SiPMOutputWriter::write(const void* data, size_t n) {
+  if (m_Buffers.empty() || !m_Thread.joinable()) {
+    return;
+  }
+  const char* src = reinterpret_cast<const char*>(data);
+  m_Size += n;
+  while (n > 0) {
+    const size_t chunk = std::min(n, m_BufferSize - m_Fill);
+    std::memcpy(m_Buffers[m_Current].data + m_Fill, src, chunk);
+    m_Fill += chunk;
+    src += chunk;
+    n -= chunk;
+    if (m_Fill == m_BufferSize) {
+      submit(m_BufferSize);
+      nextBuffer();
+    }
+  }
+}
+
+void SiPMOutputWriter::write(const SiPMAnalogSignal& signal) { write(signal.data(), signal.size() * sizeof(float)); }
+
+void SiPMOutputWriter::write(const SiPMBatchRunner& runner) {
+  if (runner.nEvents() > 0) {
+    write(runner.waveform(0), static_cast<size_t>(runner.nEvents()) * runner.nSignalPoints() * sizeof(float));
+  }
+}
+
+void SiPMOutputWriter::flush() {
+  if (m_Buffers.empty() || !m_Thread.joinable()) {
+    return;
+  }
+  // Direct I/O writes whole blocks: the last partial block moves to the next buffer
+  const size_t n = m_Direct ? m_Fill / blockSize * blockSize : m_Fill;
+  if (n > 0) {
+    const char* tail = m_Buffers[m_Current].data + n;
+    const size_t nTail = m_Fill - n;
+    submit(n);
+    nextBuffer();
+    std::memcpy(m_Buffers[m_Current].data, tail, nTail);
+    m_Fill = nTail;
+  }
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  m_Cv.wait(lock, [this] { return m_Pending.empty() && !m_Busy; });
+}
+
+void SiPMOutputWriter::close() {
+  if (m_Thread.joinable()) {
+    // Last block of direct I/O is padded with zeros, the file is truncated below
+    const size_t n = m_Direct ? (m_Fill + blockSize - 1) / blockSize * blockSize : m_Fill;
+    if (n > 0) {
+      std::memset(m_Buffers[m_Current].data + m_Fill, 0, n - m_Fill);
+      submit(n);
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_Stop = true;
+    }
+    m_Cv.notify_all();
+    m_Thread.join();
+  }
+#ifdef __unix__
+  if (m_Fd >= 0) {
+    if (m_Direct && ftruncate(m_Fd, m_Size) != 0) {
+      m_Error.store(true, std::memory_order_relaxed);
+    }
+    ::close(m_Fd);
+    m_Fd = -1;
+  }
+#endif
+  if (m_File) {
+    std::fclose(m_File);
+    m_File = nullptr;
+  }
+  for (Buffer& buffer : m_Buffers) {
+    MappedMemory::deallocate(buffer.data, m_BufferSize, MemoryPolicy::kTransparentHugePages);
+  }
+  m_Buffers.clear();
+}
+
+std::ostream& operator<<(std::ostream& out, const SiPMOutputWriter& obj) {
+  out << "===> SiPM Output Writer <===\n";
+  out << "Address: " << std::addressof(obj) << "\n";
+  out << "File: " << obj.m_FileName << (obj.m_Direct ? " (direct I/O)" : "") << "\n";
+  out << "Buffers: " << obj.m_Buffers.size() << " x " << obj.m_BufferSize << " bytes\n";
+  out << "Bytes written: " << obj.bytesWritten() << " of " << obj.m_Size << "\n";
+  out << "Bandwidth: " << obj.bandwidth() * 1e-6 << " MB/s\n";
+  out << "Write time: " << obj.writeSeconds() << " s - stall time: " << obj.stallSeconds() << " s\n";
+  out << "Status: " << (obj.good() ? "good" : "error") << "\n";
+  return out;
+}
+} // namespace sipm
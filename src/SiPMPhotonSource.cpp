@@ -0,0 +1,146 @@
+#include "SiPMPhotonSource.h"
+#include "SiPMRandom.h"
+#include "SiPMTypes.h"
+
+#include <cstdint>
+
+namespace sipm {
+namespace {
+// Adds a gaussian smearing to n values in place
+void smear(SiPMRandom& rng, double* out, const uint32_t n, const double sigma) {
+  if (sigma <= 0 || n == 0) {
+    return;
+  }
+  const SiPMVector<double> buffer = rng.randGaussian<SiPMVector<double>>(0, sigma, n);
+  for (uint32_t i = 0; i < n; ++i) {
+    out[i] += buffer[i];
+  }
+}
+} // namespace
+
+/**
+ * The number of photons is sampled from a Poisson distribution with average
+ * @ref mean and their times are appended at the end of the buffer.
+ * @param rng Random number generator to use
+ * @param out Buffer where photon times are appended
+ * @return Number of photons generated
+ */
+uint32_t SiPMPhotonSource::generate(SiPMRandom& rng, std::vector<double>& out) const {
+  const uint32_t n = rng.randPoisson(m_Mean);
+  if (n == 0) {
+    return 0;
+  }
+  const size_t offset = out.size();
+  out.resize(offset + n);
+  sampleTimes(rng, out.data() + offset, n);
+  return n;
+}
+
+/**
+ * @param rng Random number generator to use
+ * @return Vector containing photon times
+ */
+std::vector<double> SiPMPhotonSource::generate(SiPMRandom& rng) const {
+  std::vector<double> out;
+  generate(rng, out);
+  return out;
+}
+
+void SiPMPulseSource::sampleTimes(SiPMRandom& rng, double* out, const uint32_t n) const {
+  for (uint32_t i = 0; i < n; ++i) {
+    out[i] = m_T0;
+  }
+  smear(rng, out, n, m_Sigma);
+}
+
+void SiPMScintillatorSource::sampleTimes(SiPMRandom& rng, double* out, const uint32_t n) const {
+  if (n == 0) {
+    return;
+  }
+  // Decay component (fast or slow)
+  const SiPMVector<double> u = rng.Rand<SiPMVector<double>>(n);
+  const SiPMVector<double> decay = rng.randExponential<SiPMVector<double>>(1, n);
+  for (uint32_t i = 0; i < n; ++i) {
+    const double tau = (u[i] < m_SlowFraction) ? m_DecayTimeSlow : m_DecayTime;
+    out[i] = m_T0 + decay[i] * tau;
+  }
+  // Rise component: bi-exponential is the convolution of two exponentials
+  if (m_RiseTime > 0) {
+    const SiPMVector<double> rise = rng.randExponential<SiPMVector<double>>(m_RiseTime, n);
+    for (uint32_t i = 0; i < n; ++i) {
+      out[i] += rise[i];
+    }
+  }
+  smear(rng, out, n, m_Tts);
+}
+
+void SiPMBackgroundSource::sampleTimes(SiPMRandom& rng, double* out, const uint32_t n) const {
+  if (n == 0) {
+    return;
+  }
+  const SiPMVector<double> u = rng.Rand<SiPMVector<double>>(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    out[i] = m_Start + u[i] * m_Length;
+  }
+}
+
+void SiPMLaserSource::sampleTimes(SiPMRandom& rng, double* out, const uint32_t n) const {
+  if (n == 0) {
+    return;
+  }
+  const SiPMVector<double> u = rng.Rand<SiPMVector<double>>(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    const uint32_t pulse = static_cast<uint32_t>(u[i] * m_NPulses);
+    out[i] = m_T0 + pulse * m_Period;
+  }
+  smear(rng, out, n, m_Sigma);
+}
+
+std::string SiPMPulseSource::toString() const {
+  std::stringstream ss;
+  ss << std::setprecision(2) << std::fixed;
+  ss << "===> SiPM Pulse Source <===\n";
+  ss << "Average number of photons: " << mean() << "\n";
+  ss << "Pulse time: " << m_T0 << " ns\n";
+  ss << "Pulse time spread: " << m_Sigma << " ns\n";
+  return ss.str();
+}
+
+std::string SiPMScintillatorSource::toString() const {
+  std::stringstream ss;
+  ss << std::setprecision(2) << std::fixed;
+  ss << "===> SiPM Scintillator Source <===\n";
+  ss << "Average number of photons: " << mean() << "\n";
+  ss << "Interaction time: " << m_T0 << " ns\n";
+  ss << "Rise time: " << m_RiseTime << " ns\n";
+  ss << "Decay time: " << m_DecayTime << " ns\n";
+  if (m_SlowFraction > 0) {
+    ss << "Decay time (slow): " << m_DecayTimeSlow << " ns\n";
+    ss << "Slow component fraction: " << m_SlowFraction * 100 << " %\n";
+  }
+  ss << "Transit time spread: " << m_Tts << " ns\n";
+  return ss.str();
+}
+
+std::string SiPMBackgroundSource::toString() const {
+  std::stringstream ss;
+  ss << std::setprecision(2) << std::fixed;
+  ss << "===> SiPM Background Source <===\n";
+  ss << "Photon rate: " << m_Rate / 1e6 << " MHz\n";
+  ss << "Time window: " << m_Start << " - " << m_Start + m_Length << " ns\n";
+  ss << "Average number of photons: " << mean() << "\n";
+  return ss.str();
+}
+
+std::string SiPMLaserSource::toString() const {
+  std::stringstream ss;
+  ss << std::setprecision(2) << std::fixed;
+  ss << "===> SiPM Laser Source <===\n";
+  ss << "Average number of photons per pulse: " << mean() / m_NPulses << "\n";
+  ss << "First pulse time: " << m_T0 << " ns\n";
+  ss << "Pulse period: " << m_Period << " ns\n";
+  ss << "Number of pulses: " << m_NPulses << "\n";
+  ss << "Pulse time spread: " << m_Sigma << " ns\n";
+  return ss.str();
+}
+} // namespace sipm
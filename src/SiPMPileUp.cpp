@@ -0,0 +1,165 @@
+#include "SiPMPileUp.h"
+#include "SiPMPhotonSource.h"
+#include "SiPMRandom.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace sipm {
+void SiPMPileUp::setCrossings(const double spacing, const int32_t first, const int32_t last) {
+  if (last < first) {
+    std::cerr << "Last crossing must not be before first crossing!" << std::endl;
+    return;
+  }
+  m_Spacing = spacing;
+  m_FirstCrossing = first;
+  m_LastCrossing = last;
+}
+
+uint32_t SiPMPileUp::addSource(std::shared_ptr<const SiPMPhotonSource> source, const double offset,
+                               const double multiplicity, const bool inTimeOnly) {
+  Entry entry;
+  entry.source = std::move(source);
+  entry.offset = offset;
+  entry.multiplicity = multiplicity;
+  entry.inTimeOnly = inTimeOnly;
+  m_Sources.push_back(std::move(entry));
+  return m_Sources.size() - 1;
+}
+
+auto SiPMPileUp::entry(const uint32_t i) const -> const Entry& {
+  if (i >= m_Sources.size()) {
+    std::cerr << "SiPMPileUp has no source with index " << i << "!" << std::endl;
+    throw std::out_of_range("SiPMPileUp has no source with index " + std::to_string(i));
+  }
+  return m_Sources[i];
+}
+
+void SiPMPileUp::fillPool(const uint32_t i, SiPMRandom& rng, const uint32_t size) {
+  Entry& source = entry(i);
+  source.pool.clear();
+  source.poolStart.resize(size);
+  for (uint32_t j = 0; j < size; ++j) {
+    source.poolStart[j] = source.pool.size();
+    m_Set.clear();
+    source.source->generate(rng, m_Set);
+    std::sort(m_Set.begin(), m_Set.end());
+    source.pool.insert(source.pool.end(), m_Set.begin(), m_Set.end());
+  }
+}
+
+void SiPMPileUp::clearPool(const uint32_t i) {
+  Entry& source = entry(i);
+  source.pool.clear();
+  source.poolStart.clear();
+}
+
+/**
+ * Each interaction appends a sorted run of photon times shifted by the time
+ * of its crossing and by the offset of its source. Runs are then merged.
+ * @param rng Random number generator to use
+ * @param out Buffer where photon times are appended
+ * @return Number of photons generated
+ */
+uint32_t SiPMPileUp::generate(SiPMRandom& rng, std::vector<double>& out) {
+  const size_t offset = out.size();
+  m_Runs.clear();
+  m_Runs.push_back(offset);
+  m_NInteractions = 0;
+
+  for (const Entry& entry : m_Sources) {
+    const int32_t first = entry.inTimeOnly ? 0 : m_FirstCrossing;
+    const int32_t last = entry.inTimeOnly ? 0 : m_LastCrossing;
+    const uint32_t nPool = entry.poolStart.size();
+    for (int32_t k = first; k <= last; ++k) {
+      const uint32_t n = rng.randPoisson(entry.multiplicity);
+      const double t0 = k * m_Spacing + entry.offset;
+      for (uint32_t j = 0; j < n; ++j) {
+        ++m_NInteractions;
+        const double* set;
+        size_t size;
+        if (nPool > 0) {
+          const uint32_t idx = rng.randInteger(nPool);
+          const size_t end = (idx + 1 < nPool) ? entry.poolStart[idx + 1] : entry.pool.size();
+          set = entry.pool.data() + entry.poolStart[idx];
+          size = end - entry.poolStart[idx];
+        } else {
+          m_Set.clear();
+          entry.source->generate(rng, m_Set);
+          std::sort(m_Set.begin(), m_Set.end());
+          set = m_Set.data();
+          size = m_Set.size();
+        }
+        if (size == 0) {
+          continue;
+        }
+        const size_t start = out.size();
+        out.resize(start + size);
+        for (size_t l = 0; l < size; ++l) {
+          out[start + l] = set[l] + t0;
+        }
+        m_Runs.push_back(out.size());
+      }
+    }
+  }
+  mergeRuns(out, offset);
+  return out.size() - offset;
+}
+
+std::vector<double> SiPMPileUp::generate(SiPMRandom& rng) {
+  std::vector<double> out;
+  generate(rng, out);
+  return out;
+}
+
+/**
+ * Bottom-up merge of sorted runs: each pass merges pairs of adjacent runs
+ * so the cost is O(n log(k)) for k runs.
+ * @param out Buffer containing the runs
+ * @param offset Start of first run in the buffer
+ */
+void SiPMPileUp::mergeRuns(std::vector<double>& out, const size_t offset) {
+  if (m_Runs.size() < 3) {
+    return;
+  }
+  m_Scratch.resize(out.size());
+  double* src = out.data();
+  double* dst = m_Scratch.data();
+  std::vector<size_t> merged;
+  while (m_Runs.size() > 2) {
+    const size_t nRuns = m_Runs.size() - 1;
+    merged.clear();
+    merged.push_back(m_Runs[0]);
+    for (size_t i = 0; i < nRuns; i += 2) {
+      if (i + 1 < nRuns) {
+        std::merge(src + m_Runs[i], src + m_Runs[i + 1], src + m_Runs[i + 1], src + m_Runs[i + 2], dst + m_Runs[i]);
+        merged.push_back(m_Runs[i + 2]);
+      } else {
+        std::copy(src + m_Runs[i], src + m_Runs[i + 1], dst + m_Runs[i]);
+        merged.push_back(m_Runs[i + 1]);
+      }
+    }
+    std::swap(src, dst);
+    m_Runs.swap(merged);
+  }
+  if (src != out.data()) {
+    std::copy(src + offset, src + out.size(), out.data() + offset);
+  }
+}
+
+std::ostream& operator<<(std::ostream& out, const SiPMPileUp& obj) {
+  out << std::setprecision(2) << std::fixed;
+  out << "===> SiPM Pile-Up <===\n";
+  out << "Address: " << std::addressof(obj) << "\n";
+  out << "Crossings: " << obj.m_FirstCrossing << " to " << obj.m_LastCrossing << "\n";
+  out << "Crossing spacing: " << obj.m_Spacing << " ns\n";
+  for (uint32_t i = 0; i < obj.m_Sources.size(); ++i) {
+    const SiPMPileUp::Entry& entry = obj.m_Sources[i];
+    out << "Source " << i << ": offset " << entry.offset << " ns, " << entry.multiplicity << " interactions/crossing";
+    out << (entry.inTimeOnly ? ", in-time only" : "") << ", pool size " << entry.poolStart.size() << "\n";
+  }
+  return out;
+}
+} // namespace sipm
@@ -29,12 +29,16 @@ void SiPMProperties::setProperty(const std::string& prop, const double val) {
     setSlowComponentFraction(val);
   } else if (aProp == "recoverytime") {
     setRecoveryTime(val);
+  } else if (aProp == "deadtime") {
+    setDeadTime(val);
   } else if (aProp == "tauapfast") {
     setTauApFastComponent(val);
   } else if (aProp == "tauapslow") {
     setTauApSlowComponent(val);
   } else if (aProp == "ccgv") {
     setCcgv(val);
+  } else if (aProp == "sptr") {
+    setSptr(val);
   } else if (aProp == "snr") {
     setSnr(val);
   } else if (aProp == "pde") {
@@ -132,6 +136,54 @@ SiPMProperties SiPMProperties::readSettings(const std::string& fname) {
   return retval;
 }
 
+// FNV-1a over the bytes of each setting (cached values are not included)
+uint64_t SiPMProperties::hash() const {
+  uint64_t h = 0xcbf29ce484222325;
+  auto add = [&h](const auto x) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(&x);
+    for (size_t i = 0; i < sizeof(x); ++i) {
+      h = (h ^ p[i]) * 0x100000001b3;
+    }
+  };
+  add(m_Size);
+  add(m_Pitch);
+  add(static_cast<int32_t>(m_HitDistribution));
+  add(m_Sampling);
+  add(m_SignalLength);
+  add(m_RiseTime);
+  add(m_FallTimeFast);
+  add(m_HasSlowComponent);
+  if (m_HasSlowComponent) {
+    add(m_FallTimeSlow);
+    add(m_SlowComponentFraction);
+  }
+  add(m_RecoveryTime);
+  add(m_DeadTime);
+  add(m_HasDcr);
+  add(m_Dcr);
+  add(m_HasXt);
+  add(m_Xt);
+  add(m_HasDXt);
+  add(m_DXt);
+  add(m_DXtTau);
+  add(m_HasAp);
+  add(m_Ap);
+  add(m_TauApFastComponent);
+  add(m_TauApSlowComponent);
+  add(m_ApSlowFraction);
+  add(m_Ccgv);
+  add(m_Sptr);
+  add(m_SnrdB);
+  add(m_Gain);
+  add(static_cast<int32_t>(m_HasPde));
+  add(m_Pde);
+  for (const auto& it : m_PdeSpectrum) {
+    add(it.first);
+    add(it.second);
+  }
+  return h;
+}
+
 std::ostream& operator<<(std::ostream& out, const SiPMProperties& obj) {
   out << std::setprecision(2) << std::fixed;
   out << "===> SiPM Properties <===" << '\n';
@@ -152,6 +204,9 @@ std::ostream& operator<<(std::ostream& out, const SiPMProperties& obj) {
       break;
   }
   out << "Cell recovery time: " << obj.m_RecoveryTime << " ns\n";
+  if (obj.m_DeadTime > 0) {
+    out << "Cell dead time (digital readout): " << obj.m_DeadTime << " ns\n";
+  }
   if (obj.m_HasDcr) {
     out << "Dark count rate: " << obj.m_Dcr / 1e3 << " kHz\n";
   } else {
@@ -175,6 +230,9 @@ std::ostream& operator<<(std::ostream& out, const SiPMProperties& obj) {
     out << "Afterpulse is OFF\n";
   }
   out << "Cell-to-cell gain variation: " << obj.m_Ccgv * 100 << " %\n";
+  if (obj.m_Sptr > 0) {
+    out << "Single photon time resolution: " << obj.m_Sptr << " ns\n";
+  }
   out << "SNR: " << obj.m_SnrdB << " dB\n";
   if (obj.m_HasPde == SiPMProperties::PdeType::kSimplePde) {
     out << "Photon detection efficiency: " << obj.m_Pde * 100 << " %\n";
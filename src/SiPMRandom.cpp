@@ -70,12 +70,44 @@ void Xorshift256plus::jump() {
 // SCALAR //
 
 /**
+ * For small values of mu the multiplication method is used. For larger
+ * values its cost grows linearly with mu so the transformed rejection
+ * method (PTRS) is used instead.
+ *
+ * REFERENCE:  - W. Hoermann (1993):
+ *              The transformed rejection method for generating Poisson
+ *              random variables, Insurance: Mathematics and Economics 12, 39-45.
+ *
  * @param mu Mean value of the poisson distribution
  */
 uint32_t SiPMRandom::randPoisson(const double mu) noexcept {
   if (mu == 0) {
     return 0;
   }
+  if (mu >= 10) {
+    const double slam = sqrt(mu);
+    const double loglam = log(mu);
+    const double b = 0.931 + 2.53 * slam;
+    const double a = -0.059 + 0.02483 * b;
+    const double invalpha = 1.1239 + 1.1328 / (b - 3.4);
+    const double vr = 0.9277 - 3.6224 / (b - 2);
+
+    while (true) {
+      const double u = Rand() - 0.5;
+      const double v = Rand();
+      const double us = 0.5 - fabs(u);
+      const double k = floor((2 * a / us + b) * u + mu + 0.43);
+      if ((us >= 0.07) && (v <= vr)) {
+        return static_cast<uint32_t>(k);
+      }
+      if ((k < 0) || ((us < 0.013) && (v > us))) {
+        continue;
+      }
+      if (log(v) + log(invalpha) - log(a / (us * us) + b) <= -mu + k * loglam - lgamma(k + 1)) {
+        return static_cast<uint32_t>(k);
+      }
+    }
+  }
   const double q = exp(-mu);
   double p = 1.0;
   uint32_t out = 0;
@@ -290,6 +322,36 @@ float SiPMRandom::randGaussianF(const float mu, const float sigma) noexcept {
   } while (false);
 }
 
+/**
+ * @param mu Mean value of the gaussian distribution
+ * @param sigma Standard deviation of the gaussian distribution
+ * @return double value from gaussian distribution
+ */
+double SiPMRandom::randGaussianBoxMuller(const double mu, const double sigma) noexcept {
+  // 1 - Rand() is in (0,1] so log is finite
+  const double r = std::sqrt(-2 * std::log(1 - Rand()));
+  return mu + sigma * r * std::cos(2 * M_PI * Rand());
+}
+
+/**
+ * Both values of each Box-Muller pair are used.
+ * @param mu Mean value of the gaussian distribution
+ * @param sigma Standard deviation of the gaussian distribution
+ * @param out Buffer of at least n values
+ * @param n Number of values to generate
+ */
+void SiPMRandom::randGaussianBoxMuller(const float mu, const float sigma, float* out, const uint32_t n) noexcept {
+  for (uint32_t i = 0; i + 1 < n; i += 2) {
+    const float r = sigma * std::sqrt(-2 * std::log(1 - RandF()));
+    const float phi = 2 * static_cast<float>(M_PI) * RandF();
+    out[i] = mu + r * std::cos(phi);
+    out[i + 1] = mu + r * std::sin(phi);
+  }
+  if (n % 2) {
+    out[n - 1] = randGaussianBoxMuller(mu, sigma);
+  }
+}
+
 /**
  * @param max Maximum value of integer to generate
  * @return uint32_t value from random integer distribution
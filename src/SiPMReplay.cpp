@@ -0,0 +1,117 @@
+#include "SiPMReplay.h"
+#include "SiPMSensor.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace sipm {
+namespace {
+constexpr char kMagic[8] = {'S', 'i', 'P', 'M', 'S', 'l', 'o', 'w'};
+
+template <class T> void put(std::ofstream& file, const T& x) { file.write(reinterpret_cast<const char*>(&x), sizeof(T)); }
+
+template <class T> void putVector(std::ofstream& file, const std::vector<T>& v) {
+  put(file, static_cast<uint32_t>(v.size()));
+  file.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+template <class T> bool get(std::ifstream& file, T& x) {
+  return static_cast<bool>(file.read(reinterpret_cast<char*>(&x), sizeof(T)));
+}
+
+// Size of the file is used to reject corrupted sizes before allocating
+template <class T> bool getVector(std::ifstream& file, std::vector<T>& v, const std::streamoff size) {
+  uint32_t n;
+  if (!get(file, n)) {
+    return false;
+  }
+  if (static_cast<std::streamoff>(n) * static_cast<std::streamoff>(sizeof(T)) > size - file.tellg()) {
+    return false;
+  }
+  v.resize(n);
+  return static_cast<bool>(file.read(reinterpret_cast<char*>(v.data()), n * sizeof(T)));
+}
+} // namespace
+
+/**
+ * @param fname Name of the replay file (created if it does not exist)
+ * @param events Events to append
+ */
+bool SiPMReplay::write(const std::string& fname, const std::vector<SiPMSlowEvent>& events) {
+  std::ofstream file(fname, std::ios::binary | std::ios::app);
+  if (!file.is_open()) {
+    std::cerr << "Could not open " << fname << " for writing!" << std::endl;
+    return false;
+  }
+  for (const SiPMSlowEvent& ev : events) {
+    file.write(kMagic, sizeof(kMagic));
+    put(file, ev.event);
+    put(file, ev.channel);
+    put(file, ev.latency);
+    put(file, ev.sensorHash);
+    put(file, ev.memoryBudget);
+    for (uint8_t i = 0; i < 4; ++i) {
+      put(file, ev.rngState[i]);
+    }
+    putVector(file, ev.photonTimes);
+    putVector(file, ev.photonWavelengths);
+    putVector(file, ev.photonCells);
+  }
+  return static_cast<bool>(file);
+}
+
+/**
+ * @param fname Name of the replay file
+ * @return Events in the order they were written
+ */
+std::vector<SiPMSlowEvent> SiPMReplay::read(const std::string& fname) {
+  std::vector<SiPMSlowEvent> events;
+  std::ifstream file(fname, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Could not open " << fname << " for reading!" << std::endl;
+    return events;
+  }
+  file.seekg(0, std::ios::end);
+  const std::streamoff size = file.tellg();
+  file.seekg(0, std::ios::beg);
+  char magic[sizeof(kMagic)];
+  while (file.read(magic, sizeof(magic))) {
+    SiPMSlowEvent ev;
+    bool ok = std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+    ok = ok && get(file, ev.event) && get(file, ev.channel) && get(file, ev.latency) && get(file, ev.sensorHash) &&
+         get(file, ev.memoryBudget);
+    for (uint8_t i = 0; i < 4 && ok; ++i) {
+      ok = get(file, ev.rngState[i]);
+    }
+    ok = ok && getVector(file, ev.photonTimes, size) && getVector(file, ev.photonWavelengths, size) &&
+         getVector(file, ev.photonCells, size);
+    if (!ok) {
+      std::cerr << "Corrupted record in " << fname << " after " << events.size() << " events!" << std::endl;
+      break;
+    }
+    events.push_back(std::move(ev));
+  }
+  return events;
+}
+
+/**
+ * @param sensor Sensor used to run the event
+ * @param ev Event to replay
+ */
+bool SiPMReplay::replay(SiPMSensor& sensor, const SiPMSlowEvent& ev) {
+  sensor.setMemoryBudget(ev.memoryBudget);
+  if (sensor.hash() != ev.sensorHash) {
+    std::cerr << "Settings of the sensor do not match the ones of event " << ev.event << "!" << std::endl;
+    return false;
+  }
+  sensor.resetState();
+  sensor.m_PhotonTimes = ev.photonTimes;
+  sensor.m_PhotonWavelengths = ev.photonWavelengths;
+  sensor.m_PhotonCells = ev.photonCells;
+  sensor.rng().rng().setState(ev.rngState);
+  sensor.runEvent();
+  return true;
+}
+} // namespace sipm
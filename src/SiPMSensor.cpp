@@ -4,28 +4,129 @@
 #include <SiPMHit.h>
 #include <SiPMMath.h>
 #include <SiPMTypes.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <numeric>
+#include <type_traits>
 
 namespace sipm {
   // All constructors MUST call signalShape
-SiPMSensor::SiPMSensor() { m_SignalShape = signalShape(); }
+SiPMSensor::SiPMSensor() {
+  m_SignalShape = signalShape();
+  updateShapePoles();
+}
 
 SiPMSensor::SiPMSensor(const SiPMProperties& aProperty) {
   m_Properties = aProperty;
   m_SignalShape = signalShape();
+  updateShapePoles();
 }
 
 // Each time a property is changed signalShape MUST be called
 void SiPMSensor::setProperty(const std::string& prop, const double val) {
   m_Properties.setProperty(prop, val);
   // After setting property update sipm members
+  if (m_Channel >= 0) {
+    m_GainScale = m_ChannelGain / m_Properties.gain();
+  }
   m_SignalShape = signalShape();
+  updateShapePoles();
+  if (m_NoiseModel && m_NoiseModel->sampling() != m_Properties.sampling()) {
+    setNoiseModel(*m_NoiseModel);
+  }
+  if (m_MaxHits) {
+    prepareRealTime();
+  }
 }
 
 void SiPMSensor::setProperties(const SiPMProperties& val) {
   m_Properties = val;
+  m_GainScale = 1;
+  m_Channel = -1;
   // After setting property update sipm members
   m_SignalShape = signalShape();
+  updateShapePoles();
+  if (m_NoiseModel && m_NoiseModel->sampling() != m_Properties.sampling()) {
+    setNoiseModel(*m_NoiseModel);
+  }
+  if (m_MaxHits) {
+    prepareRealTime();
+  }
+}
+
+/**
+ * @param table Table of channel parameters
+ * @param ch Index of the channel in the table
+ */
+void SiPMSensor::setChannel(const SiPMChannelTable& table, const uint32_t ch) {
+  if (ch >= table.size()) {
+    std::cerr << "Channel " << ch << " is out of range (table has " << table.size() << " channels)!" << std::endl;
+    return;
+  }
+  m_Channel = ch;
+  m_ChannelDcr = table.dcr(ch);
+  m_ChannelXt = table.xt(ch);
+  m_ChannelAp = table.ap(ch);
+  m_ChannelGain = table.effectiveGain(ch);
+  m_GainScale = m_ChannelGain / m_Properties.gain();
+}
+
+// FNV-1a of the hash of the properties and of all the other settings that change the hits
+uint64_t SiPMSensor::hash() const {
+  uint64_t h = m_Properties.hash();
+  auto add = [&h](const auto x) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(&x);
+    for (size_t i = 0; i < sizeof(x); ++i) {
+      h = (h ^ p[i]) * 0x100000001b3;
+    }
+  };
+  add(m_Channel);
+  if (m_Channel >= 0) {
+    add(m_ChannelDcr);
+    add(m_ChannelXt);
+    add(m_ChannelAp);
+    add(m_GainScale);
+  }
+  add(m_ApDelay ? m_ApDelay->hash() : 0);
+  add(m_DXtDelay ? m_DXtDelay->hash() : 0);
+  add(static_cast<uint32_t>(m_NoiseModel ? m_NoiseModel->nComponents() : 0));
+  if (m_NoiseModel) {
+    for (const SiPMNoiseModel::Component& c : m_NoiseModel->components()) {
+      add(static_cast<int32_t>(c.type));
+      add(c.sigma);
+      add(c.fLow);
+      add(c.fHigh);
+    }
+  }
+  add(static_cast<int32_t>(m_Readout));
+  add(static_cast<int32_t>(m_Precision));
+  add(m_MaxHits);
+  add(m_MemoryBudget);
+  return h;
+}
+
+void SiPMSensor::setApDelayDistribution(const SiPMDistribution& val) {
+  m_ApDelay = (val.size() > 0) ? std::make_shared<const SiPMDistribution>(val) : nullptr;
+}
+
+void SiPMSensor::setDXtDelayDistribution(const SiPMDistribution& val) {
+  m_DXtDelay = (val.size() > 0) ? std::make_shared<const SiPMDistribution>(val) : nullptr;
+}
+
+void SiPMSensor::setNoiseModel(const SiPMNoiseModel& val) {
+  if (val.empty()) {
+    m_NoiseModel = nullptr;
+    return;
+  }
+  auto model = std::make_shared<SiPMNoiseModel>(val);
+  model->prepare(m_Properties.sampling());
+  m_NoiseModel = std::move(model);
+  // Real-time events do not allocate
+  if (m_MaxHits) {
+    m_NoiseScratch.resize(m_Properties.nSignalPoints());
+  }
 }
 
 void SiPMSensor::addPhoton(const double val) { m_PhotonTimes.emplace_back(val); }
@@ -38,19 +139,246 @@ void SiPMSensor::addPhoton(const double val1, const double val2) {
 void SiPMSensor::addPhotons(const std::vector<double>& val) {
   m_PhotonTimes = val;
   m_PhotonWavelengths.clear();
+  m_PhotonCells.clear();
 }
 
 void SiPMSensor::addPhotons(const std::vector<double>& val1, const std::vector<double>& val2) {
   m_PhotonTimes = val1;
   m_PhotonWavelengths = val2;
+  m_PhotonCells.clear();
+}
+
+void SiPMSensor::addPhotons(const double* times, const uint32_t n) {
+  m_PhotonTimes.assign(times, times + n);
+  m_PhotonWavelengths.clear();
+  m_PhotonCells.clear();
+}
+
+void SiPMSensor::addPhotons(const double* times, const double* wlens, const uint32_t n) {
+  m_PhotonTimes.assign(times, times + n);
+  m_PhotonWavelengths.assign(wlens, wlens + n);
+  m_PhotonCells.clear();
+}
+
+void SiPMSensor::addPhoton(const double time, const double x, const double y) {
+  padPhotonCells();
+  m_PhotonTimes.emplace_back(time);
+  addPhotonCells(&x, &y, 1);
+}
+
+void SiPMSensor::addPhoton(const double time, const double wlen, const double x, const double y) {
+  padPhotonCells();
+  m_PhotonTimes.emplace_back(time);
+  m_PhotonWavelengths.emplace_back(wlen);
+  addPhotonCells(&x, &y, 1);
+}
+
+void SiPMSensor::addPhotons(const std::vector<double>& times, const std::vector<double>& x,
+                            const std::vector<double>& y) {
+  if (x.size() != times.size() || y.size() != times.size()) {
+    std::cerr << "Photon times and positions must have the same size!" << std::endl;
+    return;
+  }
+  m_PhotonTimes = times;
+  m_PhotonWavelengths.clear();
+  m_PhotonCells.clear();
+  addPhotonCells(x.data(), y.data(), times.size());
+}
+
+void SiPMSensor::addPhotons(const std::vector<double>& times, const std::vector<double>& wlens,
+                            const std::vector<double>& x, const std::vector<double>& y) {
+  if (x.size() != times.size() || y.size() != times.size()) {
+    std::cerr << "Photon times and positions must have the same size!" << std::endl;
+    return;
+  }
+  m_PhotonTimes = times;
+  m_PhotonWavelengths = wlens;
+  m_PhotonCells.clear();
+  addPhotonCells(x.data(), y.data(), times.size());
+}
+
+/**
+ * Positions are converted to cells on the pitch grid with the origin in the
+ * center of the sensor. The loop has no branches so it can be vectorized.
+ * @param x Positions along columns in mm
+ * @param y Positions along rows in mm
+ * @param n Number of photons
+ */
+void SiPMSensor::addPhotonCells(const double* x, const double* y, const uint32_t n) {
+  const uint32_t nSideCells = m_Properties.nSideCells();
+  const double recPitch = 1000. / m_Properties.pitch();
+  const double half = 0.5 * nSideCells;
+  const size_t offset = m_PhotonCells.size();
+  m_PhotonCells.resize(offset + n);
+  uint32_t* __restrict cells = m_PhotonCells.data() + offset;
+  for (uint32_t i = 0; i < n; ++i) {
+    const double col = x[i] * recPitch + half;
+    const double row = y[i] * recPitch + half;
+    const bool inside = (col >= 0) & (col < nSideCells) & (row >= 0) & (row < nSideCells);
+    const uint32_t cell = SiPMHitBuffer<DoublePrecision>::cellIndex(static_cast<uint32_t>(inside ? row : 0),
+                                                                    static_cast<uint32_t>(inside ? col : 0));
+    cells[i] = inside ? cell : kOutsideCell;
+  }
+}
+
+// Photons without position added before the first one with position fire random cells
+void SiPMSensor::padPhotonCells() {
+  if (m_PhotonCells.size() < m_PhotonTimes.size()) {
+    m_PhotonCells.resize(m_PhotonTimes.size(), kRandomCell);
+  }
+}
+
+void SiPMSensor::addPhotons(const SiPMPhotonSource& source) {
+  m_PhotonTimes.clear();
+  m_PhotonWavelengths.clear();
+  m_PhotonCells.clear();
+  source.generate(m_rng, m_PhotonTimes);
+}
+
+void SiPMSensor::addPhotons(SiPMPileUp& pileUp) {
+  m_PhotonTimes.clear();
+  m_PhotonWavelengths.clear();
+  m_PhotonCells.clear();
+  pileUp.generate(m_rng, m_PhotonTimes);
+}
+
+// Each photon must keep its wavelength: photons without it can not be mixed with the others
+void SiPMSensor::appendPhotons(const std::vector<double>& val) {
+  if (m_Properties.pdeType() == SiPMProperties::PdeType::kSpectrumPde || !m_PhotonWavelengths.empty()) {
+    std::cerr << "Photons without wavelength can not be appended to photons with wavelength!" << std::endl;
+    return;
+  }
+  m_PhotonTimes.insert(m_PhotonTimes.end(), val.begin(), val.end());
+}
+
+void SiPMSensor::appendPhotons(const std::vector<double>& val1, const std::vector<double>& val2) {
+  if (val1.size() != val2.size()) {
+    std::cerr << "Photon times and wavelengths must have the same size!" << std::endl;
+    return;
+  }
+  if (m_PhotonWavelengths.size() != m_PhotonTimes.size()) {
+    std::cerr << "Photons with wavelength can not be appended to photons without wavelength!" << std::endl;
+    return;
+  }
+  m_PhotonTimes.insert(m_PhotonTimes.end(), val1.begin(), val1.end());
+  m_PhotonWavelengths.insert(m_PhotonWavelengths.end(), val2.begin(), val2.end());
 }
 
 void SiPMSensor::runEvent() {
+  // Resume an event already run: only new photons are simulated
+  if (m_EventRun) {
+    if (m_PhotonTimes.size() <= m_nProcessedPhotons) {
+      return;
+    }
+    // Amplitudes of resumed events use the recovery of all previous discharges, not the real-time one
+    if (m_EventRealTime || m_MaxHits) {
+      std::cerr << "Events can not be resumed in real-time mode: new photons are ignored!" << std::endl;
+      m_nProcessedPhotons = m_PhotonTimes.size();
+      return;
+    }
+    const uint32_t nOldHits = m_Hits.size();
+    if (m_MemoryBudget) {
+      updateHitLimit();
+    }
+    addPhotoelectrons(m_nProcessedPhotons);
+    addCorrelatedNoise(nOldHits);
+    m_nProcessedPhotons = m_PhotonTimes.size();
+    if (m_Readout == Readout::kDigital) {
+      std::sort(m_Hits.begin() + nOldHits, m_Hits.end());
+      std::inplace_merge(m_Hits.begin(), m_Hits.begin() + nOldHits, m_Hits.end());
+    } else if (m_Readout == Readout::kAnalog) {
+      updateSignalAmplitudes(nOldHits);
+    }
+    m_DigitalPending = true;
+    m_PeakMemory = std::max(m_PeakMemory, memoryUsage());
+    return;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  m_nDropped = 0;
+  if (m_MemoryBudget) {
+    updateHitLimit();
+  }
   addDcrEvents();
   addPhotoelectrons();
   addCorrelatedNoise();
-  calculateSignalAmplitudes();
-  generateSignal();
+  switch (m_Readout) {
+    case (Readout::kAnalog):
+      calculateSignalAmplitudes();
+      break;
+    // Amplitudes are not needed: hits are only sorted in time
+    case (Readout::kDigital):
+      std::sort(m_Hits.begin(), m_Hits.end());
+      break;
+    // Hits are not sorted, order statistics use partial selection
+    case (Readout::kTiming):
+      break;
+  }
+  m_nProcessedPhotons = m_PhotonTimes.size();
+  m_EventRun = true;
+  m_EventRealTime = (m_MaxHits > 0);
+  m_DigitalPending = (m_Readout != Readout::kTiming);
+  m_PeakMemory = std::max(m_PeakMemory, memoryUsage());
+  if (m_MaxHits) {
+    // Waveform is built now so that the whole event is timed
+    if (m_Readout == Readout::kAnalog) {
+      if (m_Precision == Precision::kDouble) {
+        generateSignalRealTime(m_HitBufferDouble);
+      } else {
+        generateSignalRealTime(m_HitBufferSingle);
+      }
+    }
+    m_SignalPending = false;
+    const auto stop = std::chrono::steady_clock::now();
+    m_Latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+    return;
+  }
+  // Waveform is synthesized only when requested. The seed of its noise is drawn now so that the main
+  // generator does not depend on whether the waveform is built
+  m_Signal.clear();
+  m_SignalPending = (m_Readout == Readout::kAnalog);
+  if (m_SignalPending) {
+    m_SignalRng.rng().seed(m_rng.rng()());
+  }
+}
+
+// Copies times of hits in the signal window in the scratch buffer
+void SiPMSensor::collectHitTimes() const {
+  const double length = m_Properties.signalLength();
+  m_HitTimes.clear();
+  m_HitTimes.reserve(m_Hits.size());
+  for (const SiPMHit& hit : m_Hits) {
+    if (hit.time() >= 0 && hit.time() < length) {
+      m_HitTimes.push_back(hit.time());
+    }
+  }
+}
+
+/**
+ * @param k Rank of the hit (1 for the earliest)
+ * @return Time of the k-th hit in ns or -1 if there are less than k hits
+ */
+double SiPMSensor::orderStatistic(const uint32_t k) const {
+  if (k == 0) {
+    std::cerr << "Rank of order statistic starts from 1!" << std::endl;
+    return -1;
+  }
+  collectHitTimes();
+  if (m_HitTimes.size() < k) {
+    return -1;
+  }
+  std::nth_element(m_HitTimes.begin(), m_HitTimes.begin() + k - 1, m_HitTimes.end());
+  return m_HitTimes[k - 1];
+}
+
+/**
+ * @param k Number of hits
+ * @return Times of the k earliest hits in ns
+ */
+std::vector<double> SiPMSensor::orderStatistics(const uint32_t k) const {
+  collectHitTimes();
+  const uint32_t n = std::min<size_t>(k, m_HitTimes.size());
+  std::partial_sort(m_HitTimes.begin(), m_HitTimes.begin() + n, m_HitTimes.end());
+  return std::vector<double>(m_HitTimes.begin(), m_HitTimes.begin() + n);
 }
 
 void SiPMSensor::resetState() {
@@ -65,7 +393,13 @@ void SiPMSensor::resetState() {
   m_HitsGraph.clear();
   m_PhotonTimes.clear();
   m_PhotonWavelengths.clear();
+  m_PhotonCells.clear();
   m_Signal.clear();
+  m_SignalPending = false;
+  m_DigitalSignal.clear();
+  m_DigitalPending = false;
+  m_nProcessedPhotons = 0;
+  m_EventRun = false;
 }
 
 SiPMVector<float> SiPMSensor::signalShape() const {
@@ -104,6 +438,37 @@ SiPMVector<float> SiPMSensor::signalShape() const {
   return lSignalShape;
 }
 
+/**
+ * Each component of the signal shape is an exponential decay and can be
+ * generated by a first order recursive filter. Normalization of the shape is
+ * taken from the tabulated shape at its peak, so both syntheses match.
+ */
+void SiPMSensor::updateShapePoles() {
+  const double sampling = m_Properties.sampling();
+  const double slf = m_Properties.hasSlowComponent() ? m_Properties.slowComponentFraction() : 0;
+  m_ShapeDecay[0] = std::exp(-sampling / m_Properties.risingTime());
+  m_ShapeDecay[1] = std::exp(-sampling / m_Properties.fallingTimeFast());
+  m_ShapeDecay[2] = m_Properties.hasSlowComponent() ? std::exp(-sampling / m_Properties.fallingTimeSlow()) : 0;
+  m_ShapeCoefficient[0] = -1;
+  m_ShapeCoefficient[1] = 1 - slf;
+  m_ShapeCoefficient[2] = slf;
+
+  uint32_t peak = 0;
+  for (uint32_t i = 1; i < m_SignalShape.size(); ++i) {
+    if (std::abs(m_SignalShape[i]) > std::abs(m_SignalShape[peak])) {
+      peak = i;
+    }
+  }
+  double raw = 0;
+  for (uint32_t k = 0; k < 3; ++k) {
+    raw += m_ShapeCoefficient[k] * std::pow(m_ShapeDecay[k], peak);
+  }
+  const double scale = (raw != 0) ? m_SignalShape[peak] / raw : 0;
+  for (uint32_t k = 0; k < 3; ++k) {
+    m_ShapeCoefficient[k] *= scale;
+  }
+}
+
 double SiPMSensor::evaluatePde(const double x) const {
   // Linear interpolation of x (wlen) to obtain a new value
   // for y (pde) using a LUT stored in m_Properties
@@ -128,6 +493,14 @@ math::pair<uint32_t> SiPMSensor::hitCell() const {
   math::pair<uint32_t> hit;
   // index start from 0. nSidecels = 9 gives 10 cells
   const int32_t nSideCells = m_Properties.nSideCells();
+  // Real-time mode: one sample from the alias table
+  if (m_CellSampler.size() > 0) {
+    const uint32_t nCells = nSideCells * nSideCells;
+    const uint32_t cell = std::min<uint32_t>(m_CellSampler.sample(m_rng), nCells - 1);
+    hit.first = cell / nSideCells;
+    hit.second = cell % nSideCells;
+    return hit;
+  }
   switch (m_Properties.hitDistribution()) {
     // Uniform on the sensor
     case (SiPMProperties::HitDistribution::kUniform):
@@ -175,14 +548,16 @@ math::pair<uint32_t> SiPMSensor::hitCell() const {
 void SiPMSensor::addDcrEvents() {
   if (m_Properties.hasDcr() == false){ return; }
   const double signalLength = m_Properties.signalLength();
-  const double meanDcr = 1e9 / m_Properties.dcr();
+  const double meanDcr = 1e9 / dcr();
   const int32_t nSideCells = m_Properties.nSideCells();
 
   // Starting generation "before" the signal window gives better results
   double last = -meanDcr;
 
   while (last < signalLength) {
-    if (last > 0) {
+    if (last > 0 && isFull()) {
+      ++m_nDropped;
+    } else if (last > 0) {
       // DCR are uniform on sipm surface
       const uint32_t row = m_rng.randInteger(nSideCells);
       const uint32_t col = m_rng.randInteger(nSideCells);
@@ -198,50 +573,98 @@ void SiPMSensor::addDcrEvents() {
   }
 }
 
-void SiPMSensor::addPhotoelectrons() {
+/**
+ * @param first Index of first photon to simulate
+ */
+void SiPMSensor::addPhotoelectrons(const uint32_t first) {
   const uint32_t nPhotons = m_PhotonTimes.size();
-  m_Hits.reserve(nPhotons);
+  // In real-time mode capacity is already reserved
+  if (m_MaxHits == 0) {
+    m_Hits.reserve(std::min<size_t>(m_Hits.size() + nPhotons - first, m_HitLimit));
+  }
+  m_FirstSampled = m_Hits.size();
+  m_nCandidates = 0;
+  m_SampleLimit = UINT32_MAX;
+  // If the memory budget limits the event, photoelectrons are sampled uniformly (instead of keeping the
+  // first ones given) and room is left for their correlated noise. The loops below are then never full
+  const uint32_t noLimit = m_MaxHits ? m_MaxHits : UINT32_MAX;
+  if (m_MemoryBudget && m_HitLimit < noLimit && m_HitLimit > m_Hits.size()) {
+    const double xtMu = m_Properties.hasXt() ? xt() / (1 + xt()) : 0;
+    const double apMu = m_Properties.hasAp() ? ap() / (1 + ap()) : 0;
+    // Mean number of hits generated by a photoelectron, itself included, is 1 / (1 - mu)
+    const double mu = std::min(xtMu + apMu, 0.9);
+    m_SampleLimit = std::max<uint32_t>((m_HitLimit - m_Hits.size()) * (1 - mu), 1);
+  }
 
   switch (m_Properties.pdeType()) {
     // Add all photons
     case (SiPMProperties::PdeType::kNoPde):
-      for (uint32_t i = 0; i < nPhotons; ++i) {
-        const math::pair<uint32_t> position = hitCell();
-        m_Hits.emplace_back(m_PhotonTimes[i], 1, position.first, position.second, SiPMHit::HitType::kPhotoelectron);
-        m_HitsGraph.emplace_back(-1);
-        ++m_nTotalHits;
-        ++m_nPe;
+      for (uint32_t i = first; i < nPhotons; ++i) {
+        if (isFull()) {
+          m_nDropped += nPhotons - i;
+          break;
+        }
+        math::pair<uint32_t> position;
+        if (!photonCell(i, position)) {
+          continue;
+        }
+        addPhotoelectron(photoelectronTime(i), position);
       }
       break;
 
     // Simple pde
     case (SiPMProperties::PdeType::kSimplePde):
-      for (uint32_t i = 0; i < nPhotons; ++i) {
-        if (isDetected(m_Properties.pde())) {
-          const math::pair<uint32_t> position = hitCell();
-          m_Hits.emplace_back(m_PhotonTimes[i], 1, position.first, position.second, SiPMHit::HitType::kPhotoelectron);
-          m_HitsGraph.emplace_back(-1);
-          ++m_nTotalHits;
-          ++m_nPe;
+      for (uint32_t i = first; i < nPhotons; ++i) {
+        if (isFull()) {
+          m_nDropped += nPhotons - i;
+          break;
+        }
+        math::pair<uint32_t> position;
+        if (isDetected(m_Properties.pde()) && photonCell(i, position)) {
+          addPhotoelectron(photoelectronTime(i), position);
         }
       }
       break;
 
     // Evaluate pde based on wavelength
     case (SiPMProperties::PdeType::kSpectrumPde):
-      for (uint32_t i = 0; i < nPhotons; ++i) {
-        if (isDetected(evaluatePde(m_PhotonWavelengths[i]))) {
-          const math::pair<uint32_t> position = hitCell();
-          m_Hits.emplace_back(m_PhotonTimes[i], 1, position.first, position.second, SiPMHit::HitType::kPhotoelectron);
-          m_HitsGraph.emplace_back(-1);
-          ++m_nTotalHits;
-          ++m_nPe;
+      for (uint32_t i = first; i < nPhotons; ++i) {
+        if (isFull()) {
+          m_nDropped += nPhotons - i;
+          break;
+        }
+        math::pair<uint32_t> position;
+        if (isDetected(evaluatePde(m_PhotonWavelengths[i])) && photonCell(i, position)) {
+          addPhotoelectron(photoelectronTime(i), position);
         }
       }
       break;
   } /* SWITCH */
 }
 
+/**
+ * Photoelectrons beyond the sampling limit are kept by reservoir sampling:
+ * the k-th one replaces a random kept photoelectron with probability
+ * limit / k, so kept photoelectrons are a uniform sample of all of them.
+ * @param time Time of the photoelectron
+ * @param position Cell of the photoelectron
+ */
+void SiPMSensor::addPhotoelectron(const double time, const math::pair<uint32_t>& position) {
+  const uint32_t k = m_nCandidates++;
+  if (k < m_SampleLimit) {
+    m_Hits.emplace_back(time, 1, position.first, position.second, SiPMHit::HitType::kPhotoelectron);
+    m_HitsGraph.emplace_back(-1);
+    ++m_nTotalHits;
+    ++m_nPe;
+    return;
+  }
+  ++m_nDropped;
+  const uint32_t j = m_rng.randInteger(k + 1);
+  if (j < m_SampleLimit) {
+    m_Hits[m_FirstSampled + j] = SiPMHit(time, 1, position.first, position.second, SiPMHit::HitType::kPhotoelectron);
+  }
+}
+
 SiPMHit SiPMSensor::generateXtHit(const SiPMHit& xtGen) const {
   int32_t xtRow, xtCol;
   const int32_t row = xtGen.row();
@@ -253,18 +676,48 @@ SiPMHit SiPMSensor::generateXtHit(const SiPMHit& xtGen) const {
     hitType = SiPMHit::HitType::kDelayedOpticalCrosstalk;
   }
 
-  do {
-    xtRow = row + m_rng.randInteger(3) - 1;
-    xtCol = col + m_rng.randInteger(3) - 1;
-  } while ((xtRow == row) && (xtCol == col) && !isInSensor(xtRow, xtCol)); // Pick a different cell
+  if (m_Properties.nSideCells() < 2) {
+    // No neighbour cells
+    xtRow = row;
+    xtCol = col;
+  } else if (m_MaxHits) {
+    // Pick one of the neighbours in the sensor without rejection
+    int32_t neighbours[8];
+    uint32_t nNeighbours = 0;
+    for (int32_t dr = -1; dr <= 1; ++dr) {
+      for (int32_t dc = -1; dc <= 1; ++dc) {
+        const bool valid = (dr || dc) && isInSensor(row + dr, col + dc);
+        neighbours[nNeighbours] = (dr + 1) * 3 + (dc + 1);
+        nNeighbours += valid;
+      }
+    }
+    const int32_t k = neighbours[m_rng.randInteger(nNeighbours)];
+    xtRow = row + k / 3 - 1;
+    xtCol = col + k % 3 - 1;
+  } else {
+    do {
+      xtRow = row + m_rng.randInteger(3) - 1;
+      xtCol = col + m_rng.randInteger(3) - 1;
+    } while (((xtRow == row) && (xtCol == col)) || !isInSensor(xtRow, xtCol)); // Pick a different cell
+  }
 
-  // Time is equal to xtGenerator if isDelayed == false, else add random exponential delay
-  const double xtTime = xtGen.time() + m_rng.randExponential(m_Properties.dxtTau()) * (int)isDelayed;
+  // Time is equal to xtGenerator if isDelayed == false, else add random delay
+  double xtTime = xtGen.time();
+  if (isDelayed) {
+    xtTime += m_DXtDelay ? m_DXtDelay->sample(m_rng) : m_rng.randExponential(m_Properties.dxtTau());
+  }
 
   return SiPMHit{xtTime, 1, static_cast<uint32_t>(xtRow), static_cast<uint32_t>(xtCol), hitType};
 }
 
 SiPMHit SiPMSensor::generateApHit(const SiPMHit& apGen) const {
+  if (m_ApDelay) {
+    const double delay = m_ApDelay->sample(m_rng);
+    const SiPMHit::HitType hitType =
+      (delay < m_Properties.tauApFast()) ? SiPMHit::HitType::kFastAfterPulse : SiPMHit::HitType::kSlowAfterPulse;
+    return SiPMHit{apGen.time() + delay, 1, apGen.row(), apGen.col(), hitType};
+  }
+
   const bool isSlow = m_rng.Rand() < m_Properties.apSlowFraction();
   SiPMHit::HitType hitType = SiPMHit::HitType::kFastAfterPulse;
 
@@ -278,14 +731,17 @@ SiPMHit SiPMSensor::generateApHit(const SiPMHit& apGen) const {
   return SiPMHit{apGen.time() + delay, 1, apGen.row(), apGen.col(), hitType};
 }
 
-void SiPMSensor::addCorrelatedNoise() {
+/**
+ * @param first Index of first hit that can generate correlated noise
+ */
+void SiPMSensor::addCorrelatedNoise(const uint32_t first) {
   // Correct xt considering multiple xt chains (geometric series)
   const bool hasXt = m_Properties.hasXt();
   const bool hasAp = m_Properties.hasAp();
-  const double xtExpMu = exp(-m_Properties.xt() / (1 + m_Properties.xt()));
-  const double apExpMu = exp(-m_Properties.ap() / (1 + m_Properties.ap()));
+  const double xtExpMu = exp(-xt() / (1 + xt()));
+  const double apExpMu = exp(-ap() / (1 + ap()));
 
-  uint32_t currentHitIdx = 0;
+  uint32_t currentHitIdx = first;
   while (currentHitIdx < m_nTotalHits) {
     // Variables used for poisson process
     double xtPoiss = m_rng.Rand() * (int)(hasXt);
@@ -293,6 +749,10 @@ void SiPMSensor::addCorrelatedNoise() {
 
     // XT
     while (xtPoiss > xtExpMu) {
+      if (isFull()) {
+        ++m_nDropped;
+        break;
+      }
       // Generate generic xt hit
       const SiPMHit xtHit = generateXtHit(m_Hits[currentHitIdx]);
       // Add hit and increase counters
@@ -308,6 +768,10 @@ void SiPMSensor::addCorrelatedNoise() {
 
     // AP
     while (apPoiss > apExpMu) {
+      if (isFull()) {
+        ++m_nDropped;
+        break;
+      }
       // Generate generic ap hit
       const SiPMHit apHit = generateApHit(m_Hits[currentHitIdx]);
 
@@ -325,56 +789,517 @@ void SiPMSensor::addCorrelatedNoise() {
 }
 
 void SiPMSensor::calculateSignalAmplitudes() {
+  switch (m_Precision) {
+    case (Precision::kDouble):
+      if (m_MaxHits) {
+        calculateSignalAmplitudesRealTime(m_HitBufferDouble);
+      } else {
+        calculateSignalAmplitudes(m_HitBufferDouble);
+      }
+      break;
+    case (Precision::kSingle):
+      if (m_MaxHits) {
+        calculateSignalAmplitudesRealTime(m_HitBufferSingle);
+      } else {
+        calculateSignalAmplitudes(m_HitBufferSingle);
+      }
+      break;
+  }
+}
+
+void SiPMSensor::generateSignal() const {
+  switch (m_Precision) {
+    case (Precision::kDouble):
+      generateSignal(m_HitBufferDouble);
+      break;
+    case (Precision::kSingle):
+      generateSignal(m_HitBufferSingle);
+      break;
+  }
+}
+
+template <class P> void SiPMSensor::calculateSignalAmplitudes(SiPMHitBuffer<P>& buffer) {
+  using T = typename P::value_type;
   // Hits are sorted inplace such that thay have increasing times
   std::sort(m_Hits.begin(), m_Hits.end());
-  const double recoveryRate = 1 / m_Properties.recoveryTime();
+  const uint32_t nHits = m_Hits.size();
+  const T recoveryRate = 1 / m_Properties.recoveryTime();
+
+  // Move hits in the struct-of-arrays buffer and add ccgv
+  buffer.resize(nHits);
+  for (uint32_t i = 0; i < nHits; ++i) {
+    buffer.times[i] = m_Hits[i].time();
+    buffer.amplitudes[i] = m_Hits[i].amplitude() * m_rng.randGaussian(1, m_Properties.ccgv());
+    buffer.gains[i] = buffer.amplitudes[i];
+    buffer.cells[i] = SiPMHitBuffer<P>::cellIndex(m_Hits[i].row(), m_Hits[i].col());
+  }
 
-  for (uint32_t i = 0; i < m_nTotalHits; ++i) {
-    // Add ccgv
-    m_Hits[i].amplitude() *= m_rng.randGaussian(1, m_Properties.ccgv());
+  const T* times = buffer.times.data();
+  const uint32_t* cells = buffer.cells.data();
+  T* amplitudes = buffer.amplitudes.data();
+  for (uint32_t i = 0; i < nHits; ++i) {
     // Calculate amplitude of cells fired multiple times
     // Just check cells at previous index wrt i. Cells are sorted by time
     // so just chek at "previous times".
+    const uint32_t cell = cells[i];
     for (uint32_t j = 0; j < i; ++j) {
-      if (m_Hits[i] == m_Hits[j]) {
-        const double delay = m_Hits[i].time() - m_Hits[j].time();
-        m_Hits[i].amplitude() *= m_Hits[j].amplitude() * (1 - exp(-delay * recoveryRate));
+      if (cell == cells[j]) {
+        const T delay = times[i] - times[j];
+        amplitudes[i] *= amplitudes[j] * (1 - std::exp(-delay * recoveryRate));
       }
     }
   }
+
+  for (uint32_t i = 0; i < nHits; ++i) {
+    m_Hits[i].amplitude() = amplitudes[i];
+  }
 }
 
-void SiPMSensor::generateSignal() {
+void SiPMSensor::updateSignalAmplitudes(const uint32_t nOld) {
+  switch (m_Precision) {
+    case (Precision::kDouble):
+      updateSignalAmplitudes(m_HitBufferDouble, nOld);
+      break;
+    case (Precision::kSingle):
+      updateSignalAmplitudes(m_HitBufferSingle, nOld);
+      break;
+  }
+}
+
+/**
+ * Merges hits added by a resumed event (from nOld to the end of m_Hits) with
+ * hits of previous runs, that are already sorted and stored in the buffer.
+ * Only amplitudes of hits in cells fired by new hits are recomputed. If the
+ * waveform has already been built, the change of amplitude of each of these
+ * hits is added to it.
+ * @param buffer Buffer containing hits of previous runs
+ * @param nOld Number of hits of previous runs
+ */
+template <class P> void SiPMSensor::updateSignalAmplitudes(SiPMHitBuffer<P>& buffer, const uint32_t nOld) {
+  using T = typename P::value_type;
   const uint32_t nHits = m_Hits.size();
+  const T recoveryRate = 1 / m_Properties.recoveryTime();
+  std::sort(m_Hits.begin() + nOld, m_Hits.end());
+
+  // Cells fired by new hits
+  std::vector<uint32_t> touched(nHits - nOld);
+  for (uint32_t i = nOld; i < nHits; ++i) {
+    touched[i - nOld] = SiPMHitBuffer<P>::cellIndex(m_Hits[i].row(), m_Hits[i].col());
+  }
+  std::sort(touched.begin(), touched.end());
+  touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+
+  // Merge old (in buffer) and new hits keeping time order
+  SiPMHitBuffer<P> merged;
+  merged.resize(nHits);
+  SiPMVector<T> oldAmplitudes(nHits, 0);
+  std::vector<SiPMHit> hits;
+  hits.reserve(nHits);
+  uint32_t i = 0;
+  uint32_t j = nOld;
+  for (uint32_t k = 0; k < nHits; ++k) {
+    if (j == nHits || (i < nOld && m_Hits[i].time() <= m_Hits[j].time())) {
+      merged.times[k] = buffer.times[i];
+      merged.gains[k] = buffer.gains[i];
+      merged.amplitudes[k] = buffer.amplitudes[i];
+      merged.cells[k] = buffer.cells[i];
+      oldAmplitudes[k] = buffer.amplitudes[i];
+      hits.push_back(m_Hits[i++]);
+    } else {
+      merged.times[k] = m_Hits[j].time();
+      merged.gains[k] = m_Hits[j].amplitude() * m_rng.randGaussian(1, m_Properties.ccgv());
+      merged.amplitudes[k] = merged.gains[k];
+      merged.cells[k] = SiPMHitBuffer<P>::cellIndex(m_Hits[j].row(), m_Hits[j].col());
+      hits.push_back(m_Hits[j++]);
+    }
+  }
+
+  // Recompute amplitudes in cells fired by new hits
+  const T* times = merged.times.data();
+  const uint32_t* cells = merged.cells.data();
+  T* amplitudes = merged.amplitudes.data();
+  for (uint32_t k = 0; k < nHits; ++k) {
+    const uint32_t cell = cells[k];
+    if (!std::binary_search(touched.begin(), touched.end(), cell)) {
+      continue;
+    }
+    amplitudes[k] = merged.gains[k];
+    for (uint32_t l = 0; l < k; ++l) {
+      if (cell == cells[l]) {
+        const T delay = times[k] - times[l];
+        amplitudes[k] *= amplitudes[l] * (1 - std::exp(-delay * recoveryRate));
+      }
+    }
+    hits[k].amplitude() = amplitudes[k];
+  }
+
+  // Add change of each pulse to an existing waveform
+  if (!m_SignalPending && m_Signal.size() > 0) {
+    const uint32_t nSignalPoints = m_Signal.size();
+    const T recSampling = 1 / m_Properties.sampling();
+    const float* __restrict shape = m_SignalShape.data();
+    float* __restrict signal = &m_Signal[0];
+    for (uint32_t k = 0; k < nHits; ++k) {
+      const float delta = (amplitudes[k] - oldAmplitudes[k]) * m_GainScale;
+      const uint32_t start = std::round(times[k] * recSampling);
+      if (delta == 0 || start >= nSignalPoints) {
+        continue;
+      }
+      const uint32_t n = nSignalPoints - start;
+      for (uint32_t l = 0; l < n; ++l) {
+        signal[start + l] += shape[l] * delta;
+      }
+    }
+  }
+
+  buffer = std::move(merged);
+  m_Hits = std::move(hits);
+}
+
+template <class P> void SiPMSensor::generateSignal(const SiPMHitBuffer<P>& buffer) const {
+  using T = typename P::value_type;
+  using A = typename P::accumulator_type;
+  const uint32_t nHits = buffer.size();
   const uint32_t nSignalPoints = m_Properties.nSignalPoints();
   // Reciprocal of sampling (avoid division later)
-  const float recSampling = 1 / m_Properties.sampling();
+  const T recSampling = 1 / m_Properties.sampling();
+  const A gainScale = m_GainScale;
 
   // Start with gaussian noise
-  m_Signal = SiPMAnalogSignal(m_rng.randGaussianF<SiPMVector<float>>(0, m_Properties.snrLinear(), nSignalPoints),
-                              m_Properties.sampling());
+  SiPMVector<float> noise = m_SignalRng.randGaussianF<SiPMVector<float>>(0, m_Properties.snrLinear(), nSignalPoints);
+  if (m_NoiseModel) {
+    m_NoiseModel->addNoise(noise.data(), nSignalPoints, m_SignalRng, m_NoiseScratch);
+  }
   if (nHits == 0) {
+    m_Signal.assign(noise, m_Properties.sampling());
     return;
   }
 
-  // Temp storage in vectors
-  SiPMVector<uint32_t> times(nHits);
-  SiPMVector<float> amplitudes(nHits);
+  // Accumulate directly in the waveform if it has the same type
+  SiPMVector<A> accumulator;
+  A* signal;
+  if constexpr (std::is_same<A, float>::value) {
+    signal = noise.data();
+  } else {
+    accumulator.assign(noise.begin(), noise.end());
+    signal = accumulator.data();
+  }
 
-  // Convert ns in units of samples and round to nearest
+  // Hits are read from the buffer: times in ns are rounded to the nearest sample
+  if (useRecursiveSynthesis(nHits)) {
+    // Hits are an impulse train filtered by the three exponentials of the shape
+    SiPMVector<A> impulses(nSignalPoints, 0);
+    for (uint32_t i = 0; i < nHits; ++i) {
+      const int64_t start = std::round(buffer.times[i] * recSampling);
+      if (start >= 0 && start < nSignalPoints) {
+        impulses[start] += buffer.amplitudes[i] * gainScale;
+      }
+    }
+    const double d0 = m_ShapeDecay[0], d1 = m_ShapeDecay[1], d2 = m_ShapeDecay[2];
+    const double c0 = m_ShapeCoefficient[0], c1 = m_ShapeCoefficient[1], c2 = m_ShapeCoefficient[2];
+    double y0 = 0, y1 = 0, y2 = 0;
+    for (uint32_t j = 0; j < nSignalPoints; ++j) {
+      y0 = y0 * d0 + impulses[j];
+      y1 = y1 * d1 + impulses[j];
+      y2 = y2 * d2 + impulses[j];
+      signal[j] += c0 * y0 + c1 * y1 + c2 * y2;
+    }
+  } else {
+    // This loop should be vectorized and unrolled by compiler
+    const float* __restrict shape = m_SignalShape.data();
+    for (uint32_t i = 0; i < nHits; ++i) {
+      const int64_t start = std::round(buffer.times[i] * recSampling);
+      if (start < 0 || start >= nSignalPoints) {
+        continue;
+      }
+      const A amplitude = buffer.amplitudes[i] * gainScale;
+      const uint32_t n = nSignalPoints - start;
+      A* __restrict out = signal + start;
+      for (uint32_t j = 0; j < n; ++j) {
+        out[j] += shape[j] * amplitude;
+      }
+    }
+  }
+
+  if constexpr (!std::is_same<A, float>::value) {
+    for (uint32_t i = 0; i < nSignalPoints; ++i) {
+      noise[i] = accumulator[i];
+    }
+  }
+  m_Signal.assign(noise, m_Properties.sampling());
+}
+
+/**
+ * Hits are already sorted in time. If cells have a dead time, hits are
+ * grouped by cell (keeping time order) and a hit is dropped if its cell
+ * fired less than a dead time before. Hits outside the signal window can
+ * still make a cell dead but are not included in the output.
+ */
+void SiPMSensor::generateDigitalSignal() const {
+  const uint32_t nHits = m_Hits.size();
+  const double deadTime = m_Properties.deadTime();
+  const double length = m_Properties.signalLength();
+
+  std::vector<uint8_t> alive(nHits, 1);
+  if (deadTime > 0) {
+    // Keys (cell, index) sorted so hits of each cell are adjacent and in time order
+    std::vector<uint64_t> keys(nHits);
+    for (uint32_t i = 0; i < nHits; ++i) {
+      const uint64_t cell = SiPMHitBuffer<DoublePrecision>::cellIndex(m_Hits[i].row(), m_Hits[i].col());
+      keys[i] = (cell << 32) | i;
+    }
+    std::sort(keys.begin(), keys.end());
+    uint64_t lastCell = ~0ULL;
+    double lastTime = 0;
+    for (uint32_t i = 0; i < nHits; ++i) {
+      const uint64_t cell = keys[i] >> 32;
+      const uint32_t idx = keys[i] & 0xffffffff;
+      const double t = m_Hits[idx].time();
+      if (cell == lastCell && t - lastTime < deadTime) {
+        alive[idx] = 0;
+        continue;
+      }
+      lastCell = cell;
+      lastTime = t;
+    }
+  }
+
+  SiPMVector<float> times;
+  SiPMVector<uint32_t> cells;
+  times.reserve(nHits);
+  cells.reserve(nHits);
   for (uint32_t i = 0; i < nHits; ++i) {
-    times[i] = std::round(m_Hits[i].time() * recSampling);
-    amplitudes[i] = m_Hits[i].amplitude();
+    const SiPMHit& hit = m_Hits[i];
+    if (alive[i] && hit.time() >= 0 && hit.time() < length) {
+      times.push_back(hit.time());
+      cells.push_back(SiPMHitBuffer<DoublePrecision>::cellIndex(hit.row(), hit.col()));
+    }
+  }
+  m_DigitalSignal = SiPMDigitalSignal(std::move(times), std::move(cells), length);
+}
+
+/**
+ * @param maxHits Maximum number of hits in an event (0 turns real-time mode off)
+ */
+void SiPMSensor::setRealTime(const uint32_t maxHits) {
+  m_MaxHits = maxHits;
+  m_HitLimit = maxHits ? maxHits : UINT32_MAX;
+  if (maxHits == 0) {
+    m_CellSampler = SiPMDistribution();
+    m_LastHit.clear();
+    return;
+  }
+  prepareRealTime();
+}
+
+// Allocates all buffers used by an event and tabulates the hit distribution
+void SiPMSensor::prepareRealTime() {
+  const uint32_t nSideCells = m_Properties.nSideCells();
+  const uint32_t nCells = nSideCells * nSideCells;
+  m_Hits.reserve(m_MaxHits);
+  m_HitsGraph.reserve(m_MaxHits);
+  m_HitBufferDouble.resize(m_MaxHits);
+  m_HitBufferDouble.clear();
+  m_HitBufferSingle.resize(m_MaxHits);
+  m_HitBufferSingle.clear();
+  m_LastHit.assign(nCells, -1);
+  m_Signal.assign(SiPMVector<float>(m_Properties.nSignalPoints(), 0), m_Properties.sampling());
+  if (m_NoiseModel) {
+    m_NoiseScratch.resize(m_Properties.nSignalPoints());
   }
 
-  // This loop should be vectorized and unrolled by compiler
+  // Probability of each cell (row-major) for the distributions of hitCell
+  std::vector<double> weights(nCells, 1);
+  switch (m_Properties.hitDistribution()) {
+    case (SiPMProperties::HitDistribution::kUniform):
+      m_CellSampler = SiPMDistribution();
+      return;
+    case (SiPMProperties::HitDistribution::kCircle): {
+      // Area of each cell inside the unit circle estimated on a grid of points
+      static constexpr uint32_t kGrid = 8;
+      const double side = 2.0 / nSideCells;
+      for (uint32_t r = 0; r < nSideCells; ++r) {
+        for (uint32_t c = 0; c < nSideCells; ++c) {
+          uint32_t nInside = 0;
+          for (uint32_t i = 0; i < kGrid; ++i) {
+            for (uint32_t j = 0; j < kGrid; ++j) {
+              const double x = -1 + (r + (i + 0.5) / kGrid) * side;
+              const double y = -1 + (c + (j + 0.5) / kGrid) * side;
+              nInside += (x * x + y * y) <= 1;
+            }
+          }
+          const double inside = static_cast<double>(nInside) / (kGrid * kGrid);
+          weights[r * nSideCells + c] = 0.9 * inside / M_PI + 0.1 * (1 - inside) / (4 - M_PI);
+        }
+      }
+      break;
+    }
+    case (SiPMProperties::HitDistribution::kGaussian): {
+      // Gaussian inside 1.64 sigmas on each axis, uniform otherwise
+      auto cdf = [](const double x) { return 0.5 * std::erfc(-x / M_SQRT2); };
+      const double pIn = std::pow(cdf(1.64) - cdf(-1.64), 2);
+      std::vector<double> axis(nSideCells);
+      for (uint32_t i = 0; i < nSideCells; ++i) {
+        const double width = 3.28 / nSideCells;
+        axis[i] = cdf(-1.64 + (i + 1) * width) - cdf(-1.64 + i * width);
+      }
+      for (uint32_t r = 0; r < nSideCells; ++r) {
+        for (uint32_t c = 0; c < nSideCells; ++c) {
+          weights[r * nSideCells + c] = axis[r] * axis[c] + (1 - pIn) / nCells;
+        }
+      }
+      break;
+    }
+  }
+  std::vector<double> edges(nCells + 1);
+  for (uint32_t i = 0; i <= nCells; ++i) {
+    edges[i] = i;
+  }
+  m_CellSampler = SiPMDistribution::fromHistogram(edges, weights);
+}
+
+/**
+ * Same as @ref calculateSignalAmplitudes but the amplitude of a hit only
+ * depends on the previous hit in the same cell, found in a table indexed by
+ * cell. Gain variations are sampled with Box-Muller.
+ */
+template <class P> void SiPMSensor::calculateSignalAmplitudesRealTime(SiPMHitBuffer<P>& buffer) {
+  using T = typename P::value_type;
+  std::sort(m_Hits.begin(), m_Hits.end());
+  const uint32_t nHits = m_Hits.size();
+  const uint32_t nSideCells = m_Properties.nSideCells();
+  const T recoveryRate = 1 / m_Properties.recoveryTime();
+  const double ccgv = m_Properties.ccgv();
+
+  buffer.resize(nHits);
+  for (uint32_t i = 0; i < nHits; ++i) {
+    buffer.times[i] = m_Hits[i].time();
+    buffer.amplitudes[i] = m_Hits[i].amplitude() * m_rng.randGaussianBoxMuller(1, ccgv);
+    buffer.gains[i] = buffer.amplitudes[i];
+    buffer.cells[i] = SiPMHitBuffer<P>::cellIndex(m_Hits[i].row(), m_Hits[i].col());
+  }
+
+  T* amplitudes = buffer.amplitudes.data();
+  for (uint32_t i = 0; i < nHits; ++i) {
+    int32_t& last = m_LastHit[m_Hits[i].row() * nSideCells + m_Hits[i].col()];
+    if (last >= 0) {
+      const T delay = buffer.times[i] - buffer.times[last];
+      amplitudes[i] *= amplitudes[last] * (1 - std::exp(-delay * recoveryRate));
+    }
+    last = i;
+  }
+  // Clear only cells that have been fired
+  for (uint32_t i = 0; i < nHits; ++i) {
+    m_LastHit[m_Hits[i].row() * nSideCells + m_Hits[i].col()] = -1;
+    m_Hits[i].amplitude() = amplitudes[i];
+  }
+}
+
+/**
+ * Same as @ref generateSignal but noise is sampled with Box-Muller and
+ * pulses are accumulated directly in the preallocated waveform.
+ */
+template <class P> void SiPMSensor::generateSignalRealTime(const SiPMHitBuffer<P>& buffer) {
+  using T = typename P::value_type;
+  const uint32_t nHits = buffer.size();
+  const uint32_t nSignalPoints = m_Properties.nSignalPoints();
+  const T recSampling = 1 / m_Properties.sampling();
+
+  m_Signal.resize(nSignalPoints);
+  float* signal = &m_Signal[0];
+  m_rng.randGaussianBoxMuller(0, m_Properties.snrLinear(), signal, nSignalPoints);
+  if (m_NoiseModel) {
+    m_NoiseModel->addNoise(signal, nSignalPoints, m_rng, m_NoiseScratch);
+  }
+  const float* __restrict shape = m_SignalShape.data();
   for (uint32_t i = 0; i < nHits; ++i) {
-    for (uint32_t j = times[i]; j < nSignalPoints; ++j) {
-      m_Signal[j] += m_SignalShape[j - times[i]] * amplitudes[i];
+    const int64_t start = std::round(buffer.times[i] * recSampling);
+    if (start < 0 || start >= nSignalPoints) {
+      continue;
+    }
+    const float amplitude = buffer.amplitudes[i] * m_GainScale;
+    const uint32_t n = nSignalPoints - start;
+    float* __restrict out = signal + start;
+    for (uint32_t j = 0; j < n; ++j) {
+      out[j] += shape[j] * amplitude;
     }
   }
 }
 
+namespace {
+template <class V> size_t bytes(const V& v) { return v.capacity() * sizeof(typename V::value_type); }
+} // namespace
+
+// Waveform and digital signal are counted with the size they have once built
+size_t SiPMSensor::memoryUsage() const {
+  size_t n = sizeof(SiPMSensor);
+  n += bytes(m_PhotonTimes) + bytes(m_PhotonWavelengths) + bytes(m_PhotonCells);
+  n += bytes(m_Hits) + bytes(m_HitsGraph) + bytes(m_HitTimes) + bytes(m_LastHit);
+  n += bytes(m_HitBufferDouble.times) + bytes(m_HitBufferDouble.amplitudes) + bytes(m_HitBufferDouble.gains) +
+       bytes(m_HitBufferDouble.cells);
+  n += bytes(m_HitBufferSingle.times) + bytes(m_HitBufferSingle.amplitudes) + bytes(m_HitBufferSingle.gains) +
+       bytes(m_HitBufferSingle.cells);
+  n += bytes(m_SignalShape) + bytes(m_NoiseScratch);
+  const size_t nSignalPoints = (m_Readout == Readout::kAnalog) ? m_Properties.nSignalPoints() : 0;
+  n += std::max<size_t>(m_Signal.size(), nSignalPoints) * sizeof(float);
+  n += m_DigitalSignal.size() * (sizeof(float) + sizeof(uint32_t));
+  // Alias table: probability, alias and linear interpolation
+  n += m_CellSampler.size() * (5 * sizeof(double) + sizeof(uint32_t));
+  return n;
+}
+
+/**
+ * Hits use the SiPMHit, the parent index and the struct-of-arrays buffer of
+ * the precision used, plus the scratch buffers of the readout. Vectors can
+ * double their capacity when they grow, so only half of the budget left by
+ * the other buffers is given to hits. The other buffers are counted by
+ * their size, not by their capacity, so that the limit of an event does not
+ * depend on the events run before it and the event can be replayed.
+ */
+void SiPMSensor::updateHitLimit() {
+  const size_t valueSize = (m_Precision == Precision::kDouble) ? sizeof(double) : sizeof(float);
+  size_t perHit = sizeof(SiPMHit) + sizeof(int32_t) + 3 * valueSize + sizeof(uint32_t);
+  perHit += (m_Readout == Readout::kTiming) ? sizeof(double) : sizeof(float) + sizeof(uint32_t);
+
+  const size_t nSignalPoints = (m_Readout == Readout::kAnalog) ? m_Properties.nSignalPoints() : 0;
+  size_t fixed = sizeof(SiPMSensor);
+  fixed += (m_PhotonTimes.size() + m_PhotonWavelengths.size()) * sizeof(double) +
+           m_PhotonCells.size() * sizeof(uint32_t);
+  fixed += bytes(m_SignalShape) + bytes(m_LastHit);
+  fixed += (m_NoiseModel ? 2 : 1) * nSignalPoints * sizeof(float);
+  fixed += m_CellSampler.size() * (5 * sizeof(double) + sizeof(uint32_t));
+  const size_t limit = (m_MemoryBudget > fixed) ? (m_MemoryBudget - fixed) / (2 * perHit) : 0;
+  m_HitLimit = std::min<size_t>(m_MaxHits ? m_MaxHits : UINT32_MAX, limit);
+}
+
+/**
+ * @param budget Maximum number of bytes (0 to remove the budget)
+ */
+void SiPMSensor::setMemoryBudget(const size_t budget) {
+  m_MemoryBudget = budget;
+  if (budget == 0) {
+    m_HitLimit = m_MaxHits ? m_MaxHits : UINT32_MAX;
+  }
+}
+
+void SiPMSensor::releaseMemory() {
+  // Buffers of real-time mode are allocated once and kept
+  if (m_MaxHits) {
+    return;
+  }
+  std::vector<double>().swap(m_PhotonTimes);
+  std::vector<double>().swap(m_PhotonWavelengths);
+  std::vector<uint32_t>().swap(m_PhotonCells);
+  std::vector<SiPMHit>().swap(m_Hits);
+  std::vector<int32_t>().swap(m_HitsGraph);
+  std::vector<double>().swap(m_HitTimes);
+  SiPMVector<float>().swap(m_NoiseScratch);
+  m_HitBufferDouble = SiPMHitBuffer<DoublePrecision>();
+  m_HitBufferSingle = SiPMHitBuffer<SinglePrecision>();
+  m_DigitalSignal = SiPMDigitalSignal();
+  resetState();
+}
+
 std::ostream& operator<<(std::ostream& out, const SiPMSensor& obj) {
   out << std::setprecision(2) << std::fixed;
   out << "===> SiPM Sensor <===\n";
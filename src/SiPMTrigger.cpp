@@ -0,0 +1,234 @@
+#include "SiPMTrigger.h"
+#include "SiPMAnalogSignal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+namespace sipm {
+SiPMTrigger::SiPMTrigger(const uint32_t nChannels, const double sampling)
+  : m_Sampling(sampling), m_Channels(nChannels) {
+  resize();
+}
+
+void SiPMTrigger::setLeadingEdge(const double threshold) {
+  m_Discriminator = Discriminator::kLeadingEdge;
+  m_Threshold = threshold;
+}
+
+void SiPMTrigger::setConstantFraction(const double threshold, const double fraction, const double delay) {
+  m_Discriminator = Discriminator::kConstantFraction;
+  m_Threshold = threshold;
+  m_Fraction = fraction;
+  m_CfdDelay = std::max<uint32_t>(std::lround(delay / m_Sampling), 1);
+  resize();
+}
+
+void SiPMTrigger::setCoincidence(const double window, const uint32_t majority) {
+  if (majority == 0 || majority > m_Channels.size()) {
+    std::cerr << "Majority must be between 1 and the number of channels!" << std::endl;
+    return;
+  }
+  m_CoincidenceWindow = window;
+  m_Majority = majority;
+}
+
+void SiPMTrigger::setWindow(const double preTrigger, const double postTrigger) {
+  m_PreSamples = std::lround(preTrigger / m_Sampling);
+  m_PostSamples = std::max<uint32_t>(std::lround(postTrigger / m_Sampling), 1);
+  resize();
+}
+
+// Ring buffers hold the pre-trigger window and the delayed samples of the CFD
+void SiPMTrigger::resize() {
+  m_RingSize = std::max(m_PreSamples, m_CfdDelay) + 1;
+  for (Channel& ch : m_Channels) {
+    std::vector<float> ring(m_RingSize, 0);
+    // Keep samples already in the stream
+    for (uint32_t k = 0; k < std::min<size_t>(m_RingSize, ch.ring.size()) && k < m_NSamples; ++k) {
+      const uint64_t idx = m_NSamples - 1 - k;
+      ring[idx % m_RingSize] = ch.ring[idx % ch.ring.size()];
+    }
+    ch.ring = std::move(ring);
+  }
+}
+
+void SiPMTrigger::reset() {
+  for (Channel& ch : m_Channels) {
+    ch = Channel();
+  }
+  m_NSamples = 0;
+  m_NTriggers = 0;
+  m_Dead = false;
+  m_Pending.clear();
+  m_Windows.clear();
+  resize();
+}
+
+/**
+ * @param ch Channel
+ * @param x Current sample of the channel
+ * @param time Interpolated time of firing in ns (if fired)
+ * @return True if the channel fires at the current sample
+ */
+bool SiPMTrigger::discriminate(Channel& ch, const float x, double& time) {
+  const double thr = m_Threshold;
+  if (m_Discriminator == Discriminator::kLeadingEdge) {
+    if (ch.last <= thr && x > thr) {
+      const double frac = (thr - ch.last) / (x - ch.last);
+      time = (static_cast<double>(m_NSamples) - 1 + frac) * m_Sampling;
+      return true;
+    }
+    return false;
+  }
+
+  // Constant fraction: delayed signal minus attenuated signal
+  const float delayed = (m_NSamples >= m_CfdDelay) ? past(ch, m_CfdDelay) : 0;
+  const float cfd = delayed - m_Fraction * x;
+  const float lastCfd = ch.lastCfd;
+  ch.lastCfd = cfd;
+  if (x > thr && ch.last <= thr) {
+    ch.armed = true;
+  } else if (x <= thr) {
+    ch.armed = false;
+  }
+  if (ch.armed && lastCfd < 0 && cfd >= 0) {
+    ch.armed = false;
+    const double frac = -lastCfd / (cfd - lastCfd);
+    time = (static_cast<double>(m_NSamples) - 1 + frac) * m_Sampling;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Copies the pre-trigger samples of all channels from the ring buffers. The
+ * rest of the window is filled while the stream is processed.
+ * @param time Time of the trigger in ns
+ */
+void SiPMTrigger::trigger(const double time) {
+  ++m_NTriggers;
+  Pending pending;
+  SiPMTriggerWindow& window = pending.window;
+  const uint32_t nChannels = m_Channels.size();
+  window.time = time;
+  window.firstSample = static_cast<int64_t>(m_NSamples) - m_PreSamples;
+  window.length = m_PreSamples + m_PostSamples;
+  window.samples.assign(static_cast<size_t>(nChannels) * window.length, 0);
+  for (uint32_t c = 0; c < nChannels; ++c) {
+    const Channel& ch = m_Channels[c];
+    if (ch.hasFired && std::abs(ch.lastFire - time) <= m_CoincidenceWindow) {
+      window.channels.push_back(c);
+    }
+    float* out = window.samples.data() + static_cast<size_t>(c) * window.length;
+    for (uint32_t k = 0; k < m_PreSamples; ++k) {
+      // Samples before the start of the stream are zero
+      const uint32_t back = m_PreSamples - k;
+      out[k] = (m_NSamples >= back) ? past(ch, back) : 0;
+    }
+  }
+  pending.filled = m_PreSamples;
+  m_Pending.push_back(std::move(pending));
+}
+
+/**
+ * @param data Pointer to the samples of each channel
+ * @param nSamples Number of samples of each channel
+ */
+void SiPMTrigger::process(const float* const* data, const uint32_t nSamples) {
+  const uint32_t nChannels = m_Channels.size();
+  for (uint32_t s = 0; s < nSamples; ++s) {
+    const uint64_t idx = m_NSamples % m_RingSize;
+    for (uint32_t c = 0; c < nChannels; ++c) {
+      Channel& ch = m_Channels[c];
+      const float x = data[c][s];
+      double time;
+      if (discriminate(ch, x, time)) {
+        ch.lastFire = time;
+        ch.hasFired = true;
+        if (!m_Dead || time >= m_DeadUntil) {
+          uint32_t nCoincident = 0;
+          for (const Channel& other : m_Channels) {
+            nCoincident += other.hasFired && std::abs(other.lastFire - time) <= m_CoincidenceWindow;
+          }
+          if (nCoincident >= m_Majority) {
+            trigger(time);
+            m_Dead = true;
+            m_DeadUntil = time + m_DeadTime;
+          }
+        }
+      }
+      ch.ring[idx] = x;
+      ch.last = x;
+    }
+
+    // Fill windows waiting for post-trigger samples
+    for (Pending& pending : m_Pending) {
+      SiPMTriggerWindow& window = pending.window;
+      for (uint32_t c = 0; c < nChannels; ++c) {
+        window.samples[static_cast<size_t>(c) * window.length + pending.filled] = data[c][s];
+      }
+      ++pending.filled;
+    }
+    while (!m_Pending.empty() && m_Pending.front().filled == m_Pending.front().window.length) {
+      m_Windows.push_back(std::move(m_Pending.front().window));
+      m_Pending.pop_front();
+    }
+    ++m_NSamples;
+  }
+}
+
+/**
+ * @param signals Next signal of each channel
+ */
+void SiPMTrigger::process(const std::vector<SiPMAnalogSignal>& signals) {
+  if (signals.size() != m_Channels.size()) {
+    std::cerr << "Number of signals does not match number of channels!" << std::endl;
+    return;
+  }
+  std::vector<const float*> data(signals.size());
+  uint32_t nSamples = signals.empty() ? 0 : signals[0].size();
+  for (uint32_t c = 0; c < signals.size(); ++c) {
+    if (signals[c].size() != nSamples) {
+      std::cerr << "All signals must have the same number of samples!" << std::endl;
+      return;
+    }
+    data[c] = signals[c].data();
+  }
+  process(data.data(), nSamples);
+}
+
+void SiPMTrigger::flush() {
+  for (Pending& pending : m_Pending) {
+    m_Windows.push_back(std::move(pending.window));
+  }
+  m_Pending.clear();
+}
+
+std::vector<SiPMTriggerWindow> SiPMTrigger::takeWindows() {
+  std::vector<SiPMTriggerWindow> out;
+  out.swap(m_Windows);
+  return out;
+}
+
+std::ostream& operator<<(std::ostream& out, const SiPMTrigger& obj) {
+  out << std::setprecision(2) << std::fixed;
+  out << "===> SiPM Trigger <===\n";
+  out << "Address: " << std::addressof(obj) << "\n";
+  out << "Number of channels: " << obj.m_Channels.size() << "\n";
+  if (obj.m_Discriminator == SiPMTrigger::Discriminator::kLeadingEdge) {
+    out << "Discriminator: leading edge at " << obj.m_Threshold << " pe\n";
+  } else {
+    out << "Discriminator: constant fraction " << obj.m_Fraction * 100 << " %, delay " << obj.m_CfdDelay * obj.m_Sampling
+        << " ns, arming threshold " << obj.m_Threshold << " pe\n";
+  }
+  out << "Coincidence: " << obj.m_Majority << " channels in " << obj.m_CoincidenceWindow << " ns\n";
+  out << "Dead time: " << obj.m_DeadTime << " ns\n";
+  out << "Window: " << obj.m_PreSamples * obj.m_Sampling << " ns pre-trigger, " << obj.m_PostSamples * obj.m_Sampling
+      << " ns post-trigger\n";
+  out << "Samples processed: " << obj.m_NSamples << "\n";
+  out << "Triggers: " << obj.m_NTriggers << "\n";
+  return out;
+}
+} // namespace sipm
@@ -0,0 +1,135 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <vector>
+
+using namespace sipm;
+
+struct TestSiPMAsic : public ::testing::Test {
+  static constexpr int N = 100;
+  SiPMRandom rng;
+
+  // Sensor without noise so that waveform and hits give the same pulse
+  static SiPMProperties noiseless() {
+    SiPMProperties properties;
+    properties.setDcrOff();
+    properties.setXtOff();
+    properties.setApOff();
+    properties.setSnr(200);
+    properties.setCcgv(0);
+    return properties;
+  }
+
+  // Rectangular pulse from sample t0 to t1 (excluded)
+  static SiPMAnalogSignal pulse(const uint32_t t0, const uint32_t t1, const float amplitude, const uint32_t n = 500) {
+    SiPMVector<float> wav(n, 0);
+    for (uint32_t i = t0; i < t1; ++i) {
+      wav[i] = amplitude;
+    }
+    return SiPMAnalogSignal(wav, 1);
+  }
+};
+
+TEST_F(TestSiPMAsic, Waveform) {
+  SiPMAsic asic(1, SiPMProperties());
+  asic.setThresholds(0.5, 1.5);
+  asic.setTdc(0.5);
+  asic.setQdc(20, 1);
+  asic.process(pulse(100, 150, 2), 0);
+  ASSERT_EQ(asic.hits().size(), 1);
+  const SiPMAsicHit hit = asic.hits()[0];
+  // Crossings interpolated between samples
+  EXPECT_EQ(hit.time, std::floor((99 + 0.25) / 0.5));
+  EXPECT_EQ(hit.tot, std::floor((149 + 0.75) / 0.5) - hit.time);
+  // Gate from crossing covers 20 samples
+  EXPECT_EQ(hit.charge, 40);
+  EXPECT_EQ(hit.channel, 0);
+}
+
+TEST_F(TestSiPMAsic, Stream) {
+  // A pulse across two blocks is seen only once
+  SiPMAsic asic(2, SiPMProperties());
+  asic.setThresholds(0.5, 1.5);
+  asic.setTdc(1);
+  asic.process(pulse(480, 500, 2), 1);
+  asic.process(pulse(0, 30, 2), 1);
+  ASSERT_EQ(asic.nRecords(), 1);
+  EXPECT_EQ(asic.hits()[0].channel, 1);
+  EXPECT_EQ(asic.hits()[0].time, 479);
+  EXPECT_EQ(asic.hits()[0].tot, 50);
+  EXPECT_EQ(asic.takeHits().size(), 1);
+  EXPECT_EQ(asic.hits().size(), 0);
+}
+
+TEST_F(TestSiPMAsic, Validation) {
+  SiPMAsic asic(1, SiPMProperties());
+  asic.setThresholds(0.5, 1.5);
+  asic.process(pulse(100, 150, 1), 0);
+  EXPECT_EQ(asic.nRecords(), 0);
+  EXPECT_EQ(asic.nInvalid(), 1);
+}
+
+TEST_F(TestSiPMAsic, DeadTimeAndBusy) {
+  SiPMVector<float> wav(1000, 0);
+  for (uint32_t p = 0; p < 5; ++p) {
+    for (uint32_t i = 0; i < 10; ++i) {
+      wav[100 + 150 * p + i] = 2;
+    }
+  }
+  SiPMAnalogSignal signal(wav, 1);
+
+  SiPMAsic dead(1, SiPMProperties());
+  dead.setQdc(20, 1);
+  dead.setDeadTime(200);
+  dead.process(signal, 0);
+  EXPECT_EQ(dead.nRecords(), 3);
+  EXPECT_EQ(dead.nDead(), 2);
+
+  SiPMAsic busy(1, SiPMProperties());
+  busy.setQdc(20, 1);
+  busy.setBuffers(2, 400);
+  busy.process(signal, 0);
+  // Third pulse finds both buffers busy
+  EXPECT_EQ(busy.nRecords(), 4);
+  EXPECT_EQ(busy.nBusy(), 1);
+}
+
+TEST_F(TestSiPMAsic, Saturation) {
+  SiPMAsic asic(1, SiPMProperties());
+  asic.setQdc(100, 1, 4);
+  asic.process(pulse(100, 150, 100), 0);
+  ASSERT_EQ(asic.nRecords(), 1);
+  EXPECT_EQ(asic.hits()[0].charge, 15);
+}
+
+TEST_F(TestSiPMAsic, HitsAndWaveform) {
+  // Analytic pulse from hits agrees with the waveform
+  SiPMProperties properties = noiseless();
+  properties.setSampling(0.1);
+  SiPMSensor sensor(properties);
+  SiPMAsic fromHits(1, properties);
+  SiPMAsic fromWaveform(1, properties);
+  for (SiPMAsic* asic : {&fromHits, &fromWaveform}) {
+    asic->setThresholds(0.5, 5);
+    asic->setTdc(0.05);
+    asic->setQdc(100, 1, 16);
+  }
+  for (int i = 0; i < N; ++i) {
+    sensor.resetState();
+    const std::vector<double> times = rng.randGaussian(100, 2, rng.randInteger(40) + 10);
+    sensor.addPhotons(times);
+    sensor.runEvent();
+    fromHits.process(sensor, 0, i * properties.signalLength());
+    fromWaveform.process(sensor.signal(), 0);
+  }
+  ASSERT_EQ(fromHits.nRecords(), fromWaveform.nRecords());
+  const std::vector<SiPMAsicHit> a = fromHits.takeHits();
+  const std::vector<SiPMAsicHit> b = fromWaveform.takeHits();
+  for (uint32_t i = 0; i < a.size(); ++i) {
+    EXPECT_NEAR(a[i].time, b[i].time, 4);
+    EXPECT_NEAR(a[i].tot, b[i].tot, 0.02 * a[i].tot + 4);
+    EXPECT_NEAR(a[i].charge, b[i].charge, 0.02 * a[i].charge + 2);
+  }
+}
@@ -0,0 +1,87 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+using namespace sipm;
+
+struct TestSiPMAutoTuner : public ::testing::Test {
+  SiPMProperties properties;
+  // ctest runs each test in its own process in the same directory: one file per test
+  const std::string fname =
+    std::string("TestSiPMAutoTuner.") + ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".txt";
+
+  void SetUp() override {
+    std::remove(fname.c_str());
+    SiPMAutoTuner::setCacheFile(fname);
+    properties.setSignalLength(200);
+  }
+  void TearDown() override { std::remove(fname.c_str()); }
+};
+
+TEST_F(TestSiPMAutoTuner, Cache) {
+  const SiPMTuning first = SiPMAutoTuner::tuning(properties, 10);
+  EXPECT_FALSE(first.cached);
+  EXPECT_GT(first.nThreads, 0);
+  EXPECT_GT(first.slicesPerThread, 0);
+
+  // Second call reads the file
+  const SiPMTuning second = SiPMAutoTuner::tuning(properties, 10);
+  EXPECT_TRUE(second.cached);
+  EXPECT_EQ(second.synthesisThreshold, first.synthesisThreshold);
+  EXPECT_EQ(second.nThreads, first.nThreads);
+  EXPECT_EQ(second.slicesPerThread, first.slicesPerThread);
+
+  // Different properties are tuned again
+  properties.setSignalLength(300);
+  EXPECT_FALSE(SiPMAutoTuner::tuning(properties, 10).cached);
+  std::ifstream file(fname);
+  uint32_t nLines = 0;
+  for (std::string line; std::getline(file, line);) {
+    nLines += (!line.empty() && line[0] != '#');
+  }
+  EXPECT_EQ(nLines, 2);
+}
+
+TEST_F(TestSiPMAutoTuner, Apply) {
+  SiPMTuning tuning;
+  tuning.synthesisThreshold = 50;
+  tuning.nThreads = 2;
+  tuning.slicesPerThread = 8;
+  SiPMSensor sensor(properties);
+  SiPMAutoTuner::apply(tuning, sensor);
+  EXPECT_EQ(sensor.synthesis(), SiPMSensor::Synthesis::kAuto);
+  EXPECT_EQ(sensor.synthesisThreshold(), 50);
+
+  SiPMBatchRunner runner(properties);
+  SiPMAutoTuner::apply(tuning, runner);
+  EXPECT_EQ(runner.nThreads(), 2);
+  EXPECT_EQ(runner.slicesPerThread(), 8);
+  EXPECT_EQ(runner.sensor().synthesisThreshold(), 50);
+}
+
+TEST_F(TestSiPMAutoTuner, BatchRunner) {
+  // Results do not depend on the tuned settings
+  SiPMBatchRunner reference(properties, 1);
+  reference.setSeed(42);
+  reference.run(SiPMPulseSource(20, 20), 50);
+
+  SiPMBatchRunner runner(properties);
+  runner.setAutoTune(true, 20);
+  runner.setSeed(42);
+  runner.run(SiPMPulseSource(20, 20), 50);
+  const SiPMTuning tuning = SiPMAutoTuner::tuning(properties, 20);
+  EXPECT_TRUE(tuning.cached);
+  EXPECT_EQ(runner.nThreads(), tuning.nThreads);
+  EXPECT_EQ(runner.slicesPerThread(), tuning.slicesPerThread);
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(runner.debug(i).nPhotoelectrons, reference.debug(i).nPhotoelectrons);
+    for (uint32_t j = 0; j < runner.nSignalPoints(); ++j) {
+      ASSERT_NEAR(runner.waveform(i)[j], reference.waveform(i)[j], 1e-3);
+    }
+  }
+}
@@ -0,0 +1,167 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+using namespace sipm;
+
+struct TestSiPMBatchRunner : public ::testing::Test {
+  static constexpr int N = 200;
+  SiPMProperties properties;
+};
+
+TEST_F(TestSiPMBatchRunner, Executor) {
+  auto pool = std::make_shared<SiPMThreadPool>(3);
+  SiPMBatchRunner runner(properties);
+  runner.setExecutor(pool);
+  EXPECT_EQ(runner.executor(), pool);
+  EXPECT_EQ(runner.nThreads(), 3);
+  runner.run(SiPMPulseSource(10, 20), N);
+  EXPECT_EQ(runner.nEvents(), N);
+}
+
+TEST_F(TestSiPMBatchRunner, RunSource) {
+  SiPMBatchRunner runner(properties, 4);
+  runner.run(SiPMPulseSource(50, 20), N);
+  EXPECT_EQ(runner.nEvents(), N);
+  EXPECT_EQ(runner.nSignalPoints(), properties.nSignalPoints());
+  double nPhotons = 0;
+  for (int i = 0; i < N; ++i) {
+    nPhotons += runner.debug(i).nPhotons;
+    EXPECT_EQ(runner.signal(i).size(), properties.nSignalPoints());
+  }
+  EXPECT_NEAR(nPhotons / N, 50, 2);
+}
+
+TEST_F(TestSiPMBatchRunner, RunPhotons) {
+  std::vector<std::vector<double>> photons(N);
+  for (int i = 0; i < N; ++i) {
+    photons[i] = std::vector<double>(i % 10, 20);
+  }
+  SiPMBatchRunner runner(properties, 3);
+  runner.run(photons);
+  for (int i = 0; i < N; ++i) {
+    EXPECT_EQ(runner.debug(i).nPhotons, i % 10);
+  }
+}
+
+// Seeded runs must not depend on threads or placement
+TEST_F(TestSiPMBatchRunner, Reproducible) {
+  SiPMBatchRunner a(properties, 1);
+  SiPMBatchRunner b(properties, 5);
+  a.setSeed(1234);
+  b.setSeed(1234);
+  b.setPlacement(false);
+  a.run(SiPMPulseSource(20, 20, 1), N);
+  b.run(SiPMPulseSource(20, 20, 1), N);
+  for (int i = 0; i < N; ++i) {
+    const float* wa = a.waveform(i);
+    const float* wb = b.waveform(i);
+    for (uint32_t j = 0; j < a.nSignalPoints(); ++j) {
+      ASSERT_EQ(wa[j], wb[j]);
+    }
+  }
+}
+
+// Close seeds must not share events (seed + index would make event 1 of seed 1 equal to event 0 of seed 2)
+TEST_F(TestSiPMBatchRunner, CloseSeeds) {
+  SiPMBatchRunner a(properties, 1);
+  SiPMBatchRunner b(properties, 1);
+  a.setSeed(1);
+  b.setSeed(2);
+  a.run(SiPMPulseSource(20, 20, 1), 2);
+  b.run(SiPMPulseSource(20, 20, 1), 2);
+  EXPECT_FALSE(std::equal(a.waveform(1), a.waveform(1) + a.nSignalPoints(), b.waveform(0)));
+}
+
+TEST_F(TestSiPMBatchRunner, Latency) {
+  SiPMBatchRunner runner(properties, 3);
+  runner.run(SiPMPulseSource(20, 20), N);
+  runner.run(SiPMPulseSource(20, 20), N);
+  EXPECT_EQ(runner.latency().count(), 2 * N);
+  EXPECT_GT(runner.latency().min(), 0);
+  EXPECT_LE(runner.latency().quantile(0.5), runner.latency().max());
+  EXPECT_TRUE(runner.slowEvents().empty());
+  runner.resetLatency();
+  EXPECT_EQ(runner.latency().count(), 0);
+}
+
+// Captured events must give the same waveform when replayed
+TEST_F(TestSiPMBatchRunner, SlowEvents) {
+  properties.setSptr(0.2);
+  SiPMBatchRunner runner(properties, 3);
+  runner.setSeed(42);
+  runner.setSlowEventThreshold(1);
+  runner.run(SiPMPulseSource(20, 20, 1), N);
+  const std::vector<SiPMSlowEvent>& events = runner.slowEvents();
+  ASSERT_EQ(events.size(), N);
+
+  SiPMSensor sensor(properties);
+  for (int i = 0; i < N; ++i) {
+    EXPECT_EQ(events[i].event, i);
+    EXPECT_EQ(events[i].channel, -1);
+    EXPECT_GT(events[i].latency, 1);
+    ASSERT_TRUE(SiPMReplay::replay(sensor, events[i]));
+    const SiPMAnalogSignal signal = sensor.signal();
+    EXPECT_EQ(sensor.debug().nPhotoelectrons, runner.debug(i).nPhotoelectrons);
+    const float* w = runner.waveform(i);
+    for (uint32_t j = 0; j < signal.size(); ++j) {
+      ASSERT_EQ(signal[j], w[j]);
+    }
+  }
+}
+
+TEST_F(TestSiPMBatchRunner, Metrics) {
+  auto metrics = std::make_shared<SiPMMetrics>();
+  SiPMBatchRunner runner(properties, 3);
+  runner.setMetrics(metrics);
+  runner.run(SiPMPulseSource(20, 20), N);
+  EXPECT_EQ(metrics->value(metrics->find("sipm_events_total")), N);
+  EXPECT_EQ(metrics->value(metrics->find("sipm_waveforms_written_total")), N);
+  EXPECT_EQ(metrics->gaugeValue(metrics->find("sipm_batch_pending_slices")), 0);
+  uint64_t nPhotons = 0, nDcr = 0, nHits = 0;
+  for (int i = 0; i < N; ++i) {
+    nPhotons += runner.debug(i).nPhotons;
+    nDcr += runner.debug(i).nDcr;
+    nHits += runner.debug(i).nPhotoelectrons + runner.debug(i).nAp;
+  }
+  EXPECT_EQ(metrics->value(metrics->find("sipm_photons_total")), nPhotons);
+  EXPECT_EQ(metrics->value(metrics->find("sipm_hits_total{type=\"dcr\"}")), nDcr);
+  uint64_t sumHits = 0;
+  for (const char* type : {"photoelectron", "dcr", "xt", "dxt", "ap"}) {
+    sumHits += metrics->value(metrics->find(std::string("sipm_hits_total{type=\"") + type + "\"}"));
+  }
+  EXPECT_EQ(sumHits, nHits);
+  EXPECT_EQ(metrics->count(metrics->find("sipm_stage_seconds{stage=\"event\"}")), N);
+}
+
+TEST_F(TestSiPMBatchRunner, MemoryBudget) {
+  SiPMBatchRunner reference(properties, 3);
+  reference.setSeed(42);
+  reference.run(SiPMPulseSource(20, 20), N);
+  EXPECT_FALSE(reference.spilled());
+  EXPECT_GE(reference.memoryUsage(), static_cast<size_t>(N) * reference.nSignalPoints() * sizeof(float));
+
+  // Waveforms do not fit in half of the budget: they are written to a file
+  SiPMBatchRunner runner(properties, 3);
+  runner.setSeed(42);
+  runner.setMemoryBudget(static_cast<size_t>(N) * reference.nSignalPoints() * sizeof(float));
+  runner.run(SiPMPulseSource(20, 20), N);
+  EXPECT_TRUE(runner.spilled());
+  EXPECT_EQ(runner.nDegradedEvents(), 0);
+  EXPECT_LE(runner.peakMemoryUsage(), runner.memoryBudget());
+  for (int i = 0; i < N; ++i) {
+    EXPECT_EQ(runner.debug(i).nPhotoelectrons, reference.debug(i).nPhotoelectrons);
+    for (uint32_t j = 0; j < runner.nSignalPoints(); ++j) {
+      ASSERT_EQ(runner.waveform(i)[j], reference.waveform(i)[j]);
+    }
+  }
+
+  // Large events do not fit: they are run with fewer hits
+  runner.setMemoryBudget(256 * 1024);
+  runner.resetPeakMemoryUsage();
+  runner.run(SiPMPulseSource(20000, 20), 20);
+  EXPECT_GT(runner.nDegradedEvents(), 0);
+  EXPECT_LE(runner.peakMemoryUsage(), runner.memoryBudget());
+  EXPECT_LT(runner.debug(0).nPhotoelectrons, 20000);
+}
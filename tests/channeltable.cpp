@@ -0,0 +1,136 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <cstdio>
+
+using namespace sipm;
+
+struct TestSiPMChannelTable : public ::testing::Test {
+  static constexpr int N = 100000;
+  SiPMProperties properties;
+};
+
+TEST_F(TestSiPMChannelTable, Constructor) {
+  SiPMChannelTable table(N, properties);
+  EXPECT_EQ(table.size(), N);
+  EXPECT_FALSE(table.isMapped());
+  for (int i = 0; i < N; ++i) {
+    EXPECT_FLOAT_EQ(table.dcr(i), properties.dcr());
+    EXPECT_FLOAT_EQ(table.gain(i), properties.gain());
+  }
+}
+
+TEST_F(TestSiPMChannelTable, EffectiveGain) {
+  SiPMChannelTable table(2, properties);
+  table.set(1, 1.2, 100e3, 0.1, 0.02, 0.5);
+  EXPECT_DOUBLE_EQ(table.effectiveGain(1), table.gain(1));
+  table.setOvervoltage(5);
+  EXPECT_NEAR(table.effectiveGain(1), 1.2 * 0.9, 1e-6);
+}
+
+TEST_F(TestSiPMChannelTable, WriteAndOpen) {
+  const std::string fname = "test_channel_table.bin";
+  SiPMChannelTable table(N, properties);
+  table.setOvervoltage(4);
+  for (int i = 0; i < N; ++i) {
+    table.set(i, 1 + i * 1e-6, i, 0.01 + i * 1e-7, 0.02, 0.001 * (i % 10));
+  }
+  ASSERT_TRUE(table.write(fname));
+
+  SiPMChannelTable mapped = SiPMChannelTable::open(fname);
+  ASSERT_EQ(mapped.size(), N);
+  EXPECT_DOUBLE_EQ(mapped.overvoltage(), 4);
+  for (int i = 0; i < N; ++i) {
+    EXPECT_EQ(mapped.gain(i), table.gain(i));
+    EXPECT_EQ(mapped.dcr(i), table.dcr(i));
+    EXPECT_EQ(mapped.xt(i), table.xt(i));
+    EXPECT_EQ(mapped.breakdownOffset(i), table.breakdownOffset(i));
+  }
+  // Moving keeps the mapping alive
+  SiPMChannelTable moved = std::move(mapped);
+  EXPECT_EQ(moved.dcr(N - 1), N - 1);
+  EXPECT_EQ(mapped.size(), 0);
+  std::remove(fname.c_str());
+}
+
+TEST_F(TestSiPMChannelTable, OpenInvalid) {
+  const SiPMChannelTable table = SiPMChannelTable::open("this_file_does_not_exist.bin");
+  EXPECT_EQ(table.size(), 0);
+}
+
+TEST_F(TestSiPMChannelTable, SensorChannel) {
+  properties.setDcrOff();
+  properties.setXtOff();
+  properties.setApOff();
+  properties.setSnr(100);
+  properties.setCcgv(0);
+  SiPMChannelTable table(2, properties);
+  table.set(1, 2, 1e9, 0.5, 0.5);
+
+  SiPMSensor sensor(properties);
+  const uint64_t baseHash = sensor.hash();
+  sensor.setChannel(table, 1);
+  EXPECT_EQ(sensor.channel(), 1);
+  // Properties are not modified, noise stays off
+  EXPECT_FALSE(sensor.properties().hasDcr());
+  EXPECT_EQ(sensor.properties().hash(), properties.hash());
+  // Hash depends on the channel only
+  const uint64_t hash1 = sensor.hash();
+  EXPECT_NE(hash1, baseHash);
+  sensor.setChannel(table, 0);
+  EXPECT_NE(sensor.hash(), hash1);
+  sensor.setChannel(table, 1);
+  EXPECT_EQ(sensor.hash(), hash1);
+
+  sensor.resetState();
+  sensor.addPhoton(10);
+  sensor.runEvent();
+  const double peak2 = sensor.signal().peak(0, 100, 0.5);
+  sensor.setChannel(table, 0);
+  sensor.resetState();
+  sensor.addPhoton(10);
+  sensor.runEvent();
+  const double peak1 = sensor.signal().peak(0, 100, 0.5);
+  EXPECT_NEAR(peak2 / peak1, 2, 0.01);
+
+  // Channels outside of the table are ignored
+  sensor.setChannel(table, 2);
+  EXPECT_EQ(sensor.channel(), 0);
+
+  // Setting a property keeps the channel and its gain
+  sensor.setChannel(table, 1);
+  sensor.setProperty("Snr", 80);
+  EXPECT_EQ(sensor.channel(), 1);
+  sensor.resetState();
+  sensor.addPhoton(10);
+  sensor.runEvent();
+  EXPECT_NEAR(sensor.signal().peak(0, 100, 0.5) / peak1, 2, 0.02);
+
+  // Setting properties removes the channel
+  sensor.setProperties(properties);
+  EXPECT_EQ(sensor.channel(), -1);
+  EXPECT_EQ(sensor.hash(), baseHash);
+}
+
+// Parameters of the channel are used instead of the ones of the properties
+TEST_F(TestSiPMChannelTable, SensorChannelNoise) {
+  properties.setDcrOff();
+  properties.setApOff();
+  properties.setXt(0.01);
+  properties.setPdeType(SiPMProperties::PdeType::kNoPde);
+  SiPMChannelTable table(1, properties);
+  table.set(0, properties.gain(), properties.dcr(), 0.5, 0);
+  SiPMSensor sensor(properties);
+  sensor.setChannel(table, 0);
+  uint32_t nXt = 0;
+  for (int i = 0; i < 1000; ++i) {
+    sensor.resetState();
+    sensor.addPhotons(std::vector<double>(10, 20));
+    sensor.runEvent();
+    nXt += sensor.debug().nXt;
+  }
+  EXPECT_DOUBLE_EQ(sensor.properties().xt(), 0.01);
+  EXPECT_GT(nXt, 1000);
+}
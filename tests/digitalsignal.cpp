@@ -0,0 +1,109 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace sipm;
+
+struct TestSiPMDigitalSignal : public ::testing::Test {
+  static constexpr int N = 1000;
+  SiPMRandom rng;
+
+  static SiPMDigitalSignal makeSignal(const std::vector<float>& t) {
+    SiPMVector<float> times(t.begin(), t.end());
+    SiPMVector<uint32_t> cells(t.size());
+    for (uint32_t i = 0; i < t.size(); ++i) {
+      cells[i] = i;
+    }
+    return SiPMDigitalSignal(times, cells, 100);
+  }
+};
+
+TEST_F(TestSiPMDigitalSignal, Features) {
+  const SiPMDigitalSignal signal = makeSignal({5, 12, 13, 14, 40, 41, 90});
+  EXPECT_EQ(signal.size(), 7);
+  EXPECT_EQ(signal.count(0, 100), 7);
+  EXPECT_EQ(signal.count(10, 5), 3);
+  EXPECT_EQ(signal.count(14, 26), 1);
+  EXPECT_FLOAT_EQ(signal.firstTime(6, 10), 12);
+  EXPECT_EQ(signal.firstTime(50, 30), -1);
+  EXPECT_FLOAT_EQ(signal.triggerTime(0, 100, 3), 13);
+  EXPECT_EQ(signal.triggerTime(30, 50, 3), -1);
+}
+
+TEST_F(TestSiPMDigitalSignal, Frames) {
+  const SiPMDigitalSignal signal = makeSignal({5, 12, 13, 14, 40, 41, 90});
+  // Trigger on 2nd cell, validate with 3 cells in 5 ns, integrate 20 ns
+  const std::vector<SiPMDigitalFrame> frames = signal.frames(25, 2, 5, 3, 20);
+  ASSERT_EQ(frames.size(), 4);
+
+  EXPECT_EQ(frames[0].count, 4);
+  EXPECT_FLOAT_EQ(frames[0].firstTime, 5);
+  EXPECT_FLOAT_EQ(frames[0].triggerTime, 12);
+  EXPECT_TRUE(frames[0].validated);
+  EXPECT_EQ(frames[0].integral, 3);
+
+  EXPECT_EQ(frames[1].count, 2);
+  EXPECT_FLOAT_EQ(frames[1].triggerTime, 41);
+  EXPECT_FALSE(frames[1].validated);
+  EXPECT_EQ(frames[1].integral, 0);
+
+  EXPECT_EQ(frames[2].count, 0);
+  EXPECT_EQ(frames[2].firstTime, -1);
+
+  EXPECT_EQ(frames[3].count, 1);
+  EXPECT_EQ(frames[3].triggerTime, -1);
+  EXPECT_FALSE(frames[3].validated);
+}
+
+TEST_F(TestSiPMDigitalSignal, SensorReadout) {
+  SiPMProperties properties;
+  properties.setDcrOff();
+  properties.setXtOff();
+  properties.setApOff();
+  SiPMSensor sensor(properties);
+  sensor.setReadout(SiPMSensor::Readout::kDigital);
+  for (int i = 0; i < N; ++i) {
+    sensor.resetState();
+    sensor.addPhotons(rng.randGaussian(100, 1, 20));
+    sensor.runEvent();
+    const SiPMDigitalSignal signal = sensor.digitalSignal();
+    // Each photon fires a cell with no dead time
+    EXPECT_EQ(signal.size(), sensor.hits().size());
+    const SiPMVector<float> times = signal.times();
+    EXPECT_TRUE(std::is_sorted(times.begin(), times.end()));
+    // Amplitudes are not computed
+    for (const SiPMHit& hit : sensor.hits()) {
+      EXPECT_EQ(hit.amplitude(), 1);
+    }
+  }
+}
+
+TEST_F(TestSiPMDigitalSignal, DeadTime) {
+  SiPMProperties properties;
+  properties.setDcrOff();
+  properties.setXtOff();
+  properties.setApOff();
+  properties.setSize(0.1);
+  properties.setPitch(50); // 4 cells
+  properties.setDeadTime(20);
+  SiPMSensor sensor(properties);
+  sensor.setReadout(SiPMSensor::Readout::kDigital);
+  for (int i = 0; i < N; ++i) {
+    sensor.resetState();
+    sensor.addPhotons(rng.randGaussian(100, 30, 50));
+    sensor.runEvent();
+    const SiPMDigitalSignal signal = sensor.digitalSignal();
+    EXPECT_LT(signal.size(), sensor.hits().size());
+    // Accepted hits of a cell are separated by at least the dead time
+    std::vector<float> last(1 << 17, -1e9);
+    for (uint32_t j = 0; j < signal.size(); ++j) {
+      const uint32_t cell = signal.row(j) * 256 + signal.col(j);
+      EXPECT_GE(signal.time(j) - last[cell], 20);
+      last[cell] = signal.time(j);
+    }
+  }
+}
@@ -0,0 +1,109 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <stdexcept>
+
+using namespace sipm;
+
+struct TestSiPMDistribution : public ::testing::Test {
+  static constexpr int N = 1000000;
+  SiPMRandom rng;
+};
+
+TEST_F(TestSiPMDistribution, Constructor) { SiPMDistribution dist; }
+
+TEST_F(TestSiPMDistribution, InvalidWeights) {
+  EXPECT_THROW(SiPMDistribution::fromPdf({0}, {1}), std::invalid_argument);
+  EXPECT_THROW(SiPMDistribution::fromPdf({0, 1, 2}, {0, 0, 0}), std::invalid_argument);
+  EXPECT_THROW(SiPMDistribution::fromPdf({0, 1}, {-1, -2}), std::invalid_argument);
+  EXPECT_THROW(SiPMDistribution::fromHistogram({0}, {}), std::invalid_argument);
+  EXPECT_THROW(SiPMDistribution::fromHistogram({0, 1, 2}, {0, 0}), std::invalid_argument);
+  EXPECT_NO_THROW(SiPMDistribution::fromHistogram({0, 1, 2}, {0, 1}));
+  // Sizes must match
+  EXPECT_THROW(SiPMDistribution::fromPdf({0, 1, 2}, {1, 1}), std::invalid_argument);
+  EXPECT_THROW(SiPMDistribution::fromHistogram({0, 1, 2, 3}, {1, 1}), std::invalid_argument);
+  // Points must be strictly increasing
+  EXPECT_THROW(SiPMDistribution::fromPdf({0, 2, 1}, {1, 1, 1}), std::invalid_argument);
+  EXPECT_THROW(SiPMDistribution::fromPdf({0, 1, 1}, {1, 1, 1}), std::invalid_argument);
+  EXPECT_THROW(SiPMDistribution::fromHistogram({0, 2, 1}, {1, 1}), std::invalid_argument);
+  // Negative values are rejected even if the total is positive
+  EXPECT_THROW(SiPMDistribution::fromPdf({0, 1, 2}, {-1, 3, 1}), std::invalid_argument);
+  EXPECT_THROW(SiPMDistribution::fromHistogram({0, 1, 2}, {-1, 3}), std::invalid_argument);
+}
+
+TEST_F(TestSiPMDistribution, HistogramRange) {
+  const SiPMDistribution dist = SiPMDistribution::fromHistogram({0, 1, 2, 3}, {1, 0, 3});
+  EXPECT_EQ(dist.size(), 3);
+  for (int i = 0; i < N; ++i) {
+    const double x = dist.sample(rng);
+    EXPECT_GE(x, 0);
+    EXPECT_LT(x, 3);
+    // Empty bin
+    EXPECT_FALSE(x >= 1 && x < 2);
+  }
+}
+
+TEST_F(TestSiPMDistribution, HistogramFrequencies) {
+  const SiPMDistribution dist = SiPMDistribution::fromHistogram({0, 1, 2, 3, 4}, {1, 2, 3, 4});
+  const std::vector<double> x = dist.sample(rng, N);
+  double counts[4] = {0, 0, 0, 0};
+  for (const double v : x) {
+    counts[static_cast<int>(v)] += 1;
+  }
+  for (int i = 0; i < 4; ++i) {
+    const double p = (i + 1) / 10.0;
+    EXPECT_NEAR(counts[i] / N, p, 5 * std::sqrt(p * (1 - p) / N));
+  }
+}
+
+TEST_F(TestSiPMDistribution, PdfMean) {
+  // Triangular distribution in [0,1]: mean is 2/3
+  const SiPMDistribution dist = SiPMDistribution::fromPdf({0, 1}, {0, 2});
+  EXPECT_NEAR(dist.mean(), 2.0 / 3.0, 1e-9);
+  double mean = 0;
+  for (int i = 0; i < N; ++i) {
+    mean += dist.sample(rng);
+  }
+  mean /= N;
+  EXPECT_NEAR(mean, 2.0 / 3.0, 5 * std::sqrt(1.0 / 18 / N));
+}
+
+TEST_F(TestSiPMDistribution, ExponentialPdf) {
+  std::vector<double> x(1000);
+  std::vector<double> y(1000);
+  for (int i = 0; i < 1000; ++i) {
+    x[i] = i * 0.1;
+    y[i] = std::exp(-x[i] / 10);
+  }
+  const SiPMDistribution dist = SiPMDistribution::fromPdf(x, y);
+  const SiPMVector<double> s = dist.sample<SiPMVector<double>>(rng, N);
+  double mean = 0;
+  for (const double v : s) {
+    mean += v;
+  }
+  mean /= N;
+  EXPECT_NEAR(mean, dist.mean(), 0.05);
+  EXPECT_NEAR(mean, 10, 0.1);
+}
+
+TEST_F(TestSiPMDistribution, SensorApDelay) {
+  SiPMSensor sensor;
+  sensor.properties().setDcrOff();
+  sensor.properties().setXtOff();
+  sensor.properties().setAp(0.5);
+  sensor.setApDelayDistribution(SiPMDistribution::fromHistogram({100, 101}, {1}));
+  for (int i = 0; i < 1000; ++i) {
+    sensor.resetState();
+    sensor.addPhoton(10);
+    sensor.runEvent();
+    for (const SiPMHit& hit : sensor.hits()) {
+      if (hit.hitType() == SiPMHit::HitType::kSlowAfterPulse) {
+        // Afterpulses can generate other afterpulses
+        EXPECT_GE(hit.time(), 110);
+      }
+      EXPECT_NE(hit.hitType(), SiPMHit::HitType::kFastAfterPulse);
+    }
+  }
+}
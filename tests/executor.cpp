@@ -0,0 +1,107 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace sipm;
+
+struct TestSiPMExecutor : public ::testing::Test {
+  static constexpr int N = 10000;
+};
+
+TEST_F(TestSiPMExecutor, Topology) {
+  const SiPMTopology topology = SiPMTopology::detect();
+  EXPECT_GT(topology.nNodes(), 0);
+  EXPECT_GT(topology.nCpus(), 0);
+  EXPECT_FALSE(topology.toString().empty());
+}
+
+TEST_F(TestSiPMExecutor, ThreadPool) {
+  SiPMThreadPool pool(4);
+  EXPECT_EQ(pool.concurrency(), 4);
+  std::vector<int> counts(N, 0);
+  pool.parallelFor(N, [&counts](const uint32_t i) { counts[i]++; });
+  for (int i = 0; i < N; ++i) {
+    EXPECT_EQ(counts[i], 1);
+  }
+  // Empty loop must return
+  pool.parallelFor(0, [](const uint32_t) {});
+}
+
+// An exception thrown by a task is rethrown in the caller and the pool is still usable
+TEST_F(TestSiPMExecutor, Exception) {
+  SiPMThreadPool pool(4);
+  std::atomic<int> count{0};
+  EXPECT_THROW(pool.parallelFor(100,
+                                [&count](const uint32_t i) {
+                                  count++;
+                                  if (i == 37) {
+                                    throw std::runtime_error("task");
+                                  }
+                                }),
+               std::runtime_error);
+  EXPECT_EQ(count, 100);
+  count = 0;
+  for (int i = 0; i < 100; ++i) {
+    pool.parallelFor(64, [&count](const uint32_t) { count++; });
+  }
+  EXPECT_EQ(count, 6400);
+}
+
+// The library does not pin threads unless asked to
+TEST_F(TestSiPMExecutor, DefaultExecutorNotPinned) {
+  SiPMExecutor::setDefaultExecutor(nullptr);
+  const auto pool = std::dynamic_pointer_cast<SiPMThreadPool>(SiPMExecutor::defaultExecutor());
+  ASSERT_TRUE(pool != nullptr);
+  EXPECT_FALSE(pool->pinned());
+}
+
+TEST_F(TestSiPMExecutor, Nested) {
+  SiPMThreadPool pool(2);
+  std::atomic<int> count{0};
+  pool.parallelFor(8, [&](const uint32_t) { pool.parallelFor(100, [&](const uint32_t) { count++; }); });
+  EXPECT_EQ(count, 800);
+}
+
+// Minimal host pool: one thread per task
+TEST_F(TestSiPMExecutor, HostExecutor) {
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  auto exec = std::make_shared<SiPMHostExecutor>(
+    [&](std::function<void()> task) {
+      std::lock_guard<std::mutex> lock(mutex);
+      threads.emplace_back(std::move(task));
+    },
+    2);
+  EXPECT_EQ(exec->concurrency(), 2);
+  std::atomic<int> count{0};
+  exec->parallelFor(16, [&count](const uint32_t i) { count += i; });
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(count, 120);
+}
+
+TEST_F(TestSiPMExecutor, DefaultExecutor) {
+  std::atomic<int> submitted{0};
+  auto host = std::make_shared<SiPMHostExecutor>(
+    [&submitted](std::function<void()> task) {
+      submitted++;
+      task();
+    },
+    1);
+  SiPMExecutor::setDefaultExecutor(host);
+  EXPECT_EQ(SiPMExecutor::defaultExecutor(), host);
+
+  SiPMBatchRunner runner(SiPMProperties{});
+  runner.run(SiPMPulseSource(10, 20), 10);
+  EXPECT_GT(submitted, 0);
+
+  SiPMExecutor::setDefaultExecutor(nullptr);
+  EXPECT_NE(SiPMExecutor::defaultExecutor(), host);
+}
@@ -0,0 +1,61 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace sipm;
+
+struct TestSiPMLatency : public ::testing::Test {
+  static constexpr int N = 100000;
+  SiPMRandom rng;
+};
+
+TEST_F(TestSiPMLatency, Quantiles) {
+  SiPMLatency latency;
+  std::vector<uint64_t> values(N);
+  for (int i = 0; i < N; ++i) {
+    values[i] = rng.randExponential(1e4) + 1;
+    latency.record(values[i]);
+  }
+  std::sort(values.begin(), values.end());
+  EXPECT_EQ(latency.count(), N);
+  EXPECT_EQ(latency.min(), values.front());
+  EXPECT_EQ(latency.max(), values.back());
+  for (const double q : {0.5, 0.9, 0.99, 0.999}) {
+    const uint64_t exact = values[std::ceil(q * N) - 1];
+    // Upper edge of the bucket: never below and within resolution
+    EXPECT_GE(latency.quantile(q), exact);
+    EXPECT_LE(latency.quantile(q), exact * (1 + 1. / SiPMLatency::nSubBuckets));
+  }
+  EXPECT_EQ(latency.quantile(1), values.back());
+}
+
+TEST_F(TestSiPMLatency, SmallValues) {
+  SiPMLatency latency;
+  for (uint64_t i = 0; i < 64; ++i) {
+    latency.record(i);
+  }
+  EXPECT_EQ(latency.quantile(0.5), 31);
+  EXPECT_EQ(latency.quantile(0), 0);
+}
+
+TEST_F(TestSiPMLatency, Merge) {
+  SiPMLatency a, b, all;
+  for (int i = 0; i < N; ++i) {
+    const uint64_t x = rng.randInteger(1000000);
+    (i % 2 ? a : b).record(x);
+    all.record(x);
+  }
+  a.merge(b);
+  EXPECT_EQ(a.count(), all.count());
+  EXPECT_EQ(a.max(), all.max());
+  EXPECT_EQ(a.min(), all.min());
+  EXPECT_DOUBLE_EQ(a.mean(), all.mean());
+  EXPECT_EQ(a.quantile(0.99), all.quantile(0.99));
+  a.reset();
+  EXPECT_EQ(a.count(), 0);
+  EXPECT_EQ(a.quantile(0.5), 0);
+}
@@ -0,0 +1,183 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sipm;
+
+struct TestSiPMMetrics : public ::testing::Test {
+  static constexpr int N = 100000;
+  SiPMRandom rng;
+};
+
+// Updates from many threads are summed over all shards
+TEST_F(TestSiPMMetrics, Counter) {
+  SiPMMetrics metrics;
+  const uint32_t a = metrics.counter("a_total", "Counter a");
+  const uint32_t b = metrics.counter("b_total");
+  EXPECT_EQ(metrics.counter("a_total"), a);
+  EXPECT_EQ(metrics.nMetrics(), 2);
+  EXPECT_EQ(metrics.find("b_total"), b);
+  EXPECT_EQ(metrics.find("c_total"), -1);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < N; ++i) {
+        metrics.add(a);
+        metrics.add(b, 2);
+      }
+    });
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(metrics.value(a), 4 * N);
+  EXPECT_EQ(metrics.value(b), 8 * N);
+}
+
+TEST_F(TestSiPMMetrics, Histogram) {
+  SiPMMetrics metrics;
+  const uint32_t h = metrics.histogram("h", {1, 2, 4});
+  double sum = 0;
+  for (int i = 0; i < N; ++i) {
+    const double x = rng.Rand() * 5;
+    metrics.observe(h, x);
+    sum += x;
+  }
+  const std::vector<uint64_t> counts = metrics.bucketCounts(h);
+  ASSERT_EQ(counts.size(), 4);
+  EXPECT_EQ(metrics.count(h), N);
+  EXPECT_NEAR(metrics.sum(h), sum, 1e-6 * sum);
+  EXPECT_NEAR(counts[0], N / 5., 5 * sqrt(N / 5.));
+  EXPECT_NEAR(counts[1], N / 5., 5 * sqrt(N / 5.));
+  EXPECT_NEAR(counts[2], 2 * N / 5., 5 * sqrt(2 * N / 5.));
+  EXPECT_NEAR(counts[3], N / 5., 5 * sqrt(N / 5.));
+
+  const std::vector<double> bounds = SiPMMetrics::exponentialBounds(1, 2, 4);
+  EXPECT_EQ(bounds, std::vector<double>({1, 2, 4, 8}));
+}
+
+TEST_F(TestSiPMMetrics, Gauge) {
+  SiPMMetrics metrics;
+  const uint32_t g = metrics.gauge("queue_depth");
+  metrics.set(g, 10);
+  EXPECT_EQ(metrics.gaugeValue(g), 10);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 1000; ++i) {
+        metrics.addGauge(g, 1);
+        metrics.addGauge(g, -0.5);
+      }
+    });
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(metrics.gaugeValue(g), 2010);
+}
+
+// Metrics beyond the capacity get an invalid id that is ignored
+TEST_F(TestSiPMMetrics, Overflow) {
+  SiPMMetrics metrics;
+  const uint32_t first = metrics.counter("first_total");
+  for (uint32_t i = 1; i < SiPMMetrics::maxMetrics; ++i) {
+    metrics.gauge("g" + std::to_string(i));
+  }
+  const uint32_t c = metrics.counter("overflow_total");
+  const uint32_t h = metrics.histogram("overflow", {1, 2});
+  EXPECT_EQ(c, SiPMMetrics::invalidId);
+  EXPECT_EQ(h, SiPMMetrics::invalidId);
+  EXPECT_EQ(metrics.nMetrics(), SiPMMetrics::maxMetrics);
+  metrics.add(c);
+  metrics.observe(h, 1);
+  metrics.set(c, 1);
+  metrics.addGauge(c, 1);
+  EXPECT_EQ(metrics.value(first), 0);
+  EXPECT_EQ(metrics.value(c), 0);
+  EXPECT_TRUE(metrics.bucketCounts(h).empty());
+}
+
+// A thread alternating between registries updates each one
+TEST_F(TestSiPMMetrics, Registries) {
+  std::vector<std::unique_ptr<SiPMMetrics>> registries;
+  for (int i = 0; i < 6; ++i) {
+    registries.emplace_back(new SiPMMetrics);
+    registries.back()->counter("events_total");
+  }
+  for (int i = 0; i < 1000; ++i) {
+    for (auto& m : registries) {
+      m->add(0);
+    }
+  }
+  for (auto& m : registries) {
+    EXPECT_EQ(m->value(0), 1000);
+  }
+}
+
+TEST_F(TestSiPMMetrics, Prometheus) {
+  SiPMMetrics metrics;
+  const uint32_t dcr = metrics.counter("hits_total{type=\"dcr\"}", "Hits by type");
+  const uint32_t xt = metrics.counter("hits_total{type=\"xt\"}", "Hits by type");
+  const uint32_t h = metrics.histogram("time_seconds{stage=\"event\"}", {0.5, 1});
+  metrics.add(dcr, 3);
+  metrics.add(xt, 4);
+  metrics.observe(h, 0.2);
+  metrics.observe(h, 2);
+  std::stringstream ss;
+  metrics.writePrometheus(ss);
+  const std::string out = ss.str();
+  EXPECT_NE(out.find("# HELP hits_total Hits by type\n# TYPE hits_total counter\n"), std::string::npos);
+  // HELP and TYPE are written once for each family
+  EXPECT_EQ(out.find("# TYPE hits_total"), out.rfind("# TYPE hits_total"));
+  EXPECT_NE(out.find("hits_total{type=\"dcr\"} 3\n"), std::string::npos);
+  EXPECT_NE(out.find("hits_total{type=\"xt\"} 4\n"), std::string::npos);
+  EXPECT_NE(out.find("# TYPE time_seconds histogram\n"), std::string::npos);
+  EXPECT_NE(out.find("time_seconds_bucket{stage=\"event\",le=\"0.5\"} 1\n"), std::string::npos);
+  EXPECT_NE(out.find("time_seconds_bucket{stage=\"event\",le=\"1\"} 1\n"), std::string::npos);
+  EXPECT_NE(out.find("time_seconds_bucket{stage=\"event\",le=\"+Inf\"} 2\n"), std::string::npos);
+  EXPECT_NE(out.find("time_seconds_sum{stage=\"event\"} 2.2"), std::string::npos);
+  EXPECT_NE(out.find("time_seconds_count{stage=\"event\"} 2\n"), std::string::npos);
+}
+
+TEST_F(TestSiPMMetrics, Json) {
+  SiPMMetrics metrics;
+  metrics.add(metrics.counter("events_total"), 5);
+  metrics.set(metrics.gauge("depth"), 2);
+  metrics.observe(metrics.histogram("h", {1}), 0.5);
+  std::stringstream ss;
+  metrics.writeJson(ss);
+  const std::string out = ss.str();
+  EXPECT_EQ(out.front(), '{');
+  EXPECT_NE(out.find("\"events_total\": 5"), std::string::npos);
+  EXPECT_NE(out.find("\"depth\": 2"), std::string::npos);
+  EXPECT_NE(out.find("\"h\": {\"bounds\": [1], \"counts\": [1, 0], \"count\": 1, \"sum\": 0.5}"), std::string::npos);
+}
+
+TEST_F(TestSiPMMetrics, Export) {
+  const std::string fname = "TestSiPMMetrics.prom";
+  std::remove(fname.c_str());
+  SiPMMetrics metrics;
+  const uint32_t c = metrics.counter("events_total");
+  metrics.startExport(fname, 0.01);
+  for (int i = 0; i < 10; ++i) {
+    metrics.add(c);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  metrics.stopExport();
+  std::ifstream file(fname);
+  ASSERT_TRUE(file.is_open());
+  std::stringstream ss;
+  ss << file.rdbuf();
+  EXPECT_NE(ss.str().find("events_total 10\n"), std::string::npos);
+  std::remove(fname.c_str());
+}
@@ -0,0 +1,176 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <complex>
+#include <math.h>
+#include <stdint.h>
+
+using namespace sipm;
+
+struct TestSiPMNoiseModel : public ::testing::Test {
+  static constexpr double sampling = 1;
+  SiPMRandom rng;
+
+  // Averaged periodogram (Hann window) of n samples at frequency f
+  double periodogram(const SiPMNoiseModel& model, const double f, const uint32_t n, const uint32_t nWindows) {
+    const double dt = sampling * 1e-9;
+    double sum = 0;
+    for (uint32_t w = 0; w < nWindows; ++w) {
+      const SiPMVector<float> x = model.generate(rng, n);
+      std::complex<double> dft = 0;
+      double norm = 0;
+      for (uint32_t i = 0; i < n; ++i) {
+        const double hann = 0.5 - 0.5 * std::cos(2 * M_PI * i / n);
+        dft += hann * x[i] * std::polar(1.0, -2 * M_PI * f * dt * i);
+        norm += hann * hann;
+      }
+      sum += 2 * dt * std::norm(dft) / norm;
+    }
+    return sum / nWindows;
+  }
+};
+
+TEST_F(TestSiPMNoiseModel, Constructor) {
+  SiPMNoiseModel model;
+  EXPECT_TRUE(model.empty());
+  EXPECT_EQ(model.sigma(), 0);
+}
+
+TEST_F(TestSiPMNoiseModel, Components) {
+  SiPMNoiseModel model;
+  model.addWhite(0.03);
+  model.addPink(0.04, 1e5, 1e8);
+  model.addBand(0.12, 1e6, 1e7);
+  // Invalid components are ignored
+  model.addPink(0.1, 1e7, 1e6);
+  model.addBand(-1, 1e6, 1e7);
+  EXPECT_EQ(model.nComponents(), 3);
+  EXPECT_NEAR(model.sigma(), 0.13, 1e-9);
+  model.prepare(sampling);
+  // Three decades with two poles each and two poles of CR-RC
+  EXPECT_EQ(model.nPoles(), 8);
+}
+
+TEST_F(TestSiPMNoiseModel, StationaryVariance) {
+  SiPMNoiseModel model;
+  model.addPink(0.1, 1e5, 1e8);
+  model.addBand(0.05, 1e6, 2e7);
+  model.prepare(sampling);
+  const uint32_t n = 500;
+  const uint32_t nWindows = 4000;
+  double first = 0, last = 0;
+  for (uint32_t w = 0; w < nWindows; ++w) {
+    const SiPMVector<float> x = model.generate(rng, n);
+    first += x[0] * x[0];
+    last += x[n - 1] * x[n - 1];
+  }
+  const double variance = model.sigma() * model.sigma();
+  EXPECT_NEAR(first / nWindows, variance, 0.1 * variance);
+  EXPECT_NEAR(last / nWindows, variance, 0.1 * variance);
+}
+
+TEST_F(TestSiPMNoiseModel, PinkSpectrum) {
+  SiPMNoiseModel model;
+  model.addPink(0.1, 1e5, 1e8);
+  model.prepare(sampling);
+  // 1/f inside the band
+  EXPECT_NEAR(model.psd(1e6) / model.psd(1e7), 10, 3);
+  // Generated noise has the spectrum of the model
+  for (const double f : {1e6, 4e6, 1.6e7, 6.4e7}) {
+    EXPECT_NEAR(periodogram(model, f, 4096, 400) / model.psd(f), 1, 0.2) << "f = " << f;
+  }
+}
+
+TEST_F(TestSiPMNoiseModel, BandSpectrum) {
+  SiPMNoiseModel model;
+  model.addBand(0.1, 1e6, 1e7);
+  model.prepare(sampling);
+  // Peak between the two corners
+  const double peak = model.psd(std::sqrt(1e13));
+  EXPECT_GT(peak, 5 * model.psd(1e5));
+  EXPECT_GT(peak, 5 * model.psd(1e8));
+  EXPECT_NEAR(periodogram(model, std::sqrt(1e13), 4096, 400) / peak, 1, 0.2);
+}
+
+TEST_F(TestSiPMNoiseModel, AboveNyquist) {
+  // Nyquist frequency is 500 MHz
+  for (const double fLow : {1e5, 1e8, 2e9}) {
+    SiPMNoiseModel model;
+    model.addPink(0.1, fLow, 1e11);
+    model.prepare(sampling);
+    EXPECT_TRUE(std::isfinite(model.sigma())) << "fLow = " << fLow;
+    double sum2 = 0;
+    const uint32_t nWindows = 200;
+    for (uint32_t w = 0; w < nWindows; ++w) {
+      const SiPMVector<float> x = model.generate(rng, 100);
+      for (const float v : x) {
+        ASSERT_TRUE(std::isfinite(v)) << "fLow = " << fLow;
+        sum2 += v * v;
+      }
+    }
+    EXPECT_NEAR(sum2 / (100 * nWindows), 0.01, 0.002) << "fLow = " << fLow;
+  }
+  // A band above Nyquist frequency is flat: same as white noise
+  SiPMNoiseModel model;
+  model.addPink(0.1, 1e9, 1e11);
+  model.prepare(sampling);
+  EXPECT_EQ(model.nPoles(), 0);
+}
+
+TEST_F(TestSiPMNoiseModel, FromPsd) {
+  SiPMNoiseModel truth;
+  truth.addWhite(0.02);
+  truth.addPink(0.1, 1e5, 4e8);
+  truth.addBand(0.05, 5e6, 2e7);
+  truth.prepare(sampling);
+  std::vector<double> freqs, psd;
+  for (double f = 1e5; f <= 4e8; f *= 1.15) {
+    freqs.push_back(f);
+    psd.push_back(truth.psd(f));
+  }
+
+  const SiPMNoiseModel fit = SiPMNoiseModel::fromPsd(freqs, psd, sampling);
+  EXPECT_FALSE(fit.empty());
+  EXPECT_LE(fit.nComponents(), 4);
+  for (uint32_t i = 0; i < freqs.size(); ++i) {
+    EXPECT_NEAR(fit.psd(freqs[i]) / psd[i], 1, 0.25) << "f = " << freqs[i];
+  }
+  EXPECT_NEAR(fit.sigma(), truth.sigma(), 0.1 * truth.sigma());
+
+  // Wrong sizes give an empty model
+  EXPECT_TRUE(SiPMNoiseModel::fromPsd({1e6, 1e7}, {1}, sampling).empty());
+}
+
+TEST_F(TestSiPMNoiseModel, Sensor) {
+  SiPMProperties properties;
+  properties.setDcrOff();
+  // Negligible white noise
+  properties.setSnr(80);
+  SiPMNoiseModel model;
+  model.addPink(0.1, 1e5, 1e8);
+
+  for (const uint32_t maxHits : {0u, 100u}) {
+    SiPMSensor sensor(properties);
+    sensor.setRealTime(maxHits);
+    sensor.setNoiseModel(model);
+    EXPECT_EQ(sensor.noiseModel().nComponents(), 1);
+    double sum = 0, sum2 = 0, n = 0;
+    for (uint32_t i = 0; i < 500; ++i) {
+      sensor.resetState();
+      sensor.runEvent();
+      const SiPMAnalogSignal& signal = sensor.signal();
+      for (uint32_t j = 0; j < signal.size(); ++j) {
+        const double x = signal[j];
+        sum += x;
+        sum2 += x * x;
+        n += 1;
+      }
+    }
+    EXPECT_NEAR(sum2 / n - (sum / n) * (sum / n), 0.01, 0.002);
+
+    // Changing sampling prepares the model again
+    sensor.setProperty("sampling", 0.5);
+    EXPECT_EQ(sensor.noiseModel().sampling(), 0.5);
+    sensor.setNoiseModel(SiPMNoiseModel());
+    EXPECT_TRUE(sensor.noiseModel().empty());
+  }
+}
@@ -0,0 +1,107 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace sipm;
+
+struct TestSiPMOccupancy : public ::testing::Test {
+  static constexpr int N = 1000;
+  SiPMRandom rng;
+};
+
+TEST_F(TestSiPMOccupancy, Fill) {
+  SiPMProperties properties;
+  SiPMSensor sensor(properties);
+  SiPMOccupancy occupancy(properties);
+  EXPECT_EQ(occupancy.nSideCells(), properties.nSideCells());
+
+  std::vector<uint64_t> expected(SiPMOccupancy::nHitTypes, 0);
+  for (int i = 0; i < N; ++i) {
+    sensor.resetState();
+    sensor.addPhotons(rng.randGaussian(100, 5, 50));
+    sensor.runEvent();
+    occupancy.fill(sensor);
+    for (const SiPMHit& hit : sensor.hits()) {
+      ++expected[static_cast<uint32_t>(hit.hitType())];
+    }
+  }
+  EXPECT_EQ(occupancy.nEvents(), N);
+
+  const uint32_t n = occupancy.nSideCells();
+  for (uint32_t t = 0; t < SiPMOccupancy::nHitTypes; ++t) {
+    const uint64_t* grid = occupancy.grid(static_cast<SiPMHit::HitType>(t));
+    uint64_t sum = 0;
+    for (uint32_t j = 0; j < n * n; ++j) {
+      sum += grid[j];
+    }
+    EXPECT_EQ(sum, expected[t]);
+  }
+}
+
+TEST_F(TestSiPMOccupancy, Position) {
+  SiPMProperties properties;
+  properties.setDcrOff();
+  properties.setXtOff();
+  properties.setApOff();
+  SiPMSensor sensor(properties);
+  SiPMOccupancy occupancy(properties);
+  for (int i = 0; i < N; ++i) {
+    sensor.resetState();
+    sensor.addPhoton(10, 0.001, 0.001);
+    sensor.runEvent();
+    occupancy.fill(sensor);
+  }
+  const uint32_t center = properties.nSideCells() / 2;
+  EXPECT_EQ(occupancy.count(SiPMHit::HitType::kPhotoelectron, center, center), N);
+  EXPECT_EQ(occupancy.count(center, center), N);
+  EXPECT_EQ(occupancy.count(0, 0), 0);
+}
+
+TEST_F(TestSiPMOccupancy, Merge) {
+  SiPMProperties properties;
+  SiPMSensor sensor(properties);
+  SiPMOccupancy a(properties), b(properties), all(properties);
+  for (int i = 0; i < N; ++i) {
+    sensor.resetState();
+    sensor.addPhotons(rng.randGaussian(100, 5, 20));
+    sensor.runEvent();
+    (i % 2 ? a : b).fill(sensor);
+    all.fill(sensor);
+  }
+  a.merge(b);
+  EXPECT_EQ(a.nEvents(), all.nEvents());
+  const size_t size = SiPMOccupancy::nHitTypes * properties.nSideCells() * properties.nSideCells();
+  EXPECT_TRUE(std::equal(a.data(), a.data() + size, all.data()));
+
+  a.reset();
+  EXPECT_EQ(a.nEvents(), 0);
+  EXPECT_TRUE(std::all_of(a.data(), a.data() + size, [](const uint64_t c) { return c == 0; }));
+}
+
+TEST_F(TestSiPMOccupancy, BatchRunner) {
+  SiPMProperties properties;
+  SiPMBatchRunner runner(properties, 4);
+  runner.setOccupancy(true);
+  runner.setSeed(42);
+  SiPMPulseSource source(50, 20, 1);
+  runner.run(source, N);
+  const SiPMOccupancy& occupancy = runner.occupancy();
+  EXPECT_EQ(occupancy.nEvents(), N);
+
+  // Same events run serially with the per-event seeds of the runner
+  SiPMSensor sensor(properties);
+  SiPMOccupancy serial(properties);
+  for (uint32_t i = 0; i < N; ++i) {
+    sensor.rng().rng().seed(splitmix64(splitmix64(42) + i));
+    sensor.resetState();
+    sensor.addPhotons(source);
+    sensor.runEvent();
+    serial.fill(sensor);
+  }
+  const size_t size = SiPMOccupancy::nHitTypes * properties.nSideCells() * properties.nSideCells();
+  EXPECT_TRUE(std::equal(occupancy.data(), occupancy.data() + size, serial.data()));
+}
@@ -0,0 +1,93 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace sipm;
+
+struct TestSiPMOutputWriter : public ::testing::Test {
+  // ctest runs each test in its own process in the same directory: one file per test
+  const std::string fname =
+    std::string("TestSiPMOutputWriter.") + ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".bin";
+
+  void SetUp() override { std::remove(fname.c_str()); }
+  void TearDown() override { std::remove(fname.c_str()); }
+
+  std::vector<char> readFile() const {
+    std::ifstream file(fname, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+};
+
+TEST_F(TestSiPMOutputWriter, Write) {
+  // Small buffers and writes of odd sizes across buffer boundaries
+  std::vector<char> data(100000);
+  for (uint32_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>(i * 7 + 3);
+  }
+  SiPMOutputWriter writer(fname, 8192, 3);
+  ASSERT_TRUE(writer.good());
+  size_t pos = 0;
+  for (size_t n = 1; pos < data.size(); n = (n * 5 + 11) % 20000) {
+    n = std::min(n, data.size() - pos);
+    writer.write(data.data() + pos, n);
+    pos += n;
+  }
+  writer.flush();
+  EXPECT_EQ(writer.bytesWritten(), data.size());
+  EXPECT_EQ(readFile(), data);
+
+  writer.write(data.data(), 10);
+  writer.close();
+  EXPECT_EQ(writer.size(), data.size() + 10);
+  EXPECT_EQ(readFile().size(), data.size() + 10);
+  EXPECT_GT(writer.bandwidth(), 0);
+}
+
+TEST_F(TestSiPMOutputWriter, Direct) {
+  // Falls back to buffered I/O if the file system does not support it
+  std::vector<float> data(12345);
+  for (uint32_t i = 0; i < data.size(); ++i) {
+    data[i] = i;
+  }
+  {
+    SiPMOutputWriter writer(fname, 16384, 2, true);
+    ASSERT_TRUE(writer.good());
+    writer.write(data.data(), 1000 * sizeof(float));
+    writer.flush();
+    writer.write(data.data() + 1000, (data.size() - 1000) * sizeof(float));
+  }
+  const std::vector<char> file = readFile();
+  ASSERT_EQ(file.size(), data.size() * sizeof(float));
+  EXPECT_EQ(std::memcmp(file.data(), data.data(), file.size()), 0);
+}
+
+TEST_F(TestSiPMOutputWriter, Allocation) {
+  // Buffers larger than the address space
+  EXPECT_THROW(SiPMOutputWriter(fname, size_t(1) << 60), std::bad_alloc);
+}
+
+TEST_F(TestSiPMOutputWriter, BatchRunner) {
+  SiPMProperties properties;
+  SiPMBatchRunner runner(properties, 2);
+  SiPMOutputWriter writer(fname, 1 << 16);
+  std::vector<float> expected;
+  for (int batch = 0; batch < 3; ++batch) {
+    runner.run(SiPMPulseSource(20, 20), 50);
+    writer.write(runner);
+    expected.insert(expected.end(), runner.waveform(0), runner.waveform(0) + 50 * runner.nSignalPoints());
+  }
+  writer.close();
+  EXPECT_EQ(writer.bytesWritten(), expected.size() * sizeof(float));
+  const std::vector<char> file = readFile();
+  ASSERT_EQ(file.size(), expected.size() * sizeof(float));
+  EXPECT_EQ(std::memcmp(file.data(), expected.data(), file.size()), 0);
+}
@@ -0,0 +1,94 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+using namespace sipm;
+
+struct TestSiPMPhotonSource : public ::testing::Test {
+  static constexpr int N = 10000;
+  SiPMRandom rng;
+};
+
+TEST_F(TestSiPMPhotonSource, PulseMean) {
+  SiPMPulseSource source(100, 25, 0.1);
+  double n = 0;
+  double t = 0;
+  for (int i = 0; i < N; ++i) {
+    const std::vector<double> times = source.generate(rng);
+    n += times.size();
+    for (const double x : times) {
+      t += x;
+    }
+  }
+  t /= n;
+  n /= N;
+  EXPECT_NEAR(n, 100, 3 * std::sqrt(100.0 / N));
+  EXPECT_NEAR(t, 25, 0.01);
+}
+
+TEST_F(TestSiPMPhotonSource, DeltaPulse) {
+  SiPMPulseSource source(10, 12.5);
+  for (int i = 0; i < N; ++i) {
+    for (const double x : source.generate(rng)) {
+      EXPECT_DOUBLE_EQ(x, 12.5);
+    }
+  }
+}
+
+TEST_F(TestSiPMPhotonSource, ScintillatorMean) {
+  // Average time of bi-exponential emission is t0 + rise + decay
+  SiPMScintillatorSource source(1e5, 10, 0.5, 40);
+  const std::vector<double> times = source.generate(rng);
+  double t = 0;
+  for (const double x : times) {
+    EXPECT_GE(x, 10);
+    t += x;
+  }
+  t /= times.size();
+  EXPECT_NEAR(t, 50.5, 0.5);
+}
+
+TEST_F(TestSiPMPhotonSource, BackgroundInWindow) {
+  SiPMBackgroundSource source(1e9, 0, 500);
+  EXPECT_DOUBLE_EQ(source.mean(), 500);
+  for (int i = 0; i < 100; ++i) {
+    for (const double x : source.generate(rng)) {
+      EXPECT_GE(x, 0);
+      EXPECT_LT(x, 500);
+    }
+  }
+}
+
+TEST_F(TestSiPMPhotonSource, LaserPulses) {
+  SiPMLaserSource source(5, 10, 100, 4);
+  for (int i = 0; i < N; ++i) {
+    for (const double x : source.generate(rng)) {
+      const double k = (x - 10) / 100;
+      EXPECT_DOUBLE_EQ(k, std::round(k));
+      EXPECT_LT(k, 4);
+    }
+  }
+}
+
+TEST_F(TestSiPMPhotonSource, AppendToBuffer) {
+  SiPMPulseSource source(50, 0);
+  std::vector<double> times = {1, 2, 3};
+  const uint32_t n = source.generate(rng, times);
+  EXPECT_EQ(times.size(), n + 3);
+  EXPECT_DOUBLE_EQ(times[0], 1);
+}
+
+TEST_F(TestSiPMPhotonSource, SensorInput) {
+  SiPMSensor sensor;
+  sensor.properties().setDcrOff();
+  sensor.properties().setXtOff();
+  sensor.properties().setApOff();
+  SiPMPulseSource source(20, 50, 0.1);
+  for (int i = 0; i < 100; ++i) {
+    sensor.resetState();
+    sensor.addPhotons(source);
+    sensor.runEvent();
+    EXPECT_EQ(sensor.debug().nPhotons, sensor.debug().nPhotoelectrons);
+  }
+}
@@ -0,0 +1,97 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace sipm;
+
+struct TestSiPMPileUp : public ::testing::Test {
+  static constexpr int N = 10000;
+  SiPMRandom rng;
+};
+
+TEST_F(TestSiPMPileUp, Empty) {
+  SiPMPileUp pileUp;
+  EXPECT_TRUE(pileUp.generate(rng).empty());
+  EXPECT_EQ(pileUp.nInteractions(), 0);
+}
+
+TEST_F(TestSiPMPileUp, Sorted) {
+  SiPMPileUp pileUp;
+  pileUp.setCrossings(25, -4, 2);
+  pileUp.addSource(std::make_shared<SiPMPulseSource>(20, 10, 2), 0, 3);
+  pileUp.addSource(std::make_shared<SiPMScintillatorSource>(50, 0, 0.1, 40), 5, 1, true);
+  for (int i = 0; i < 1000; ++i) {
+    const std::vector<double> times = pileUp.generate(rng);
+    EXPECT_TRUE(std::is_sorted(times.begin(), times.end()));
+  }
+}
+
+// Average number of photons is sources mean * multiplicity * crossings
+TEST_F(TestSiPMPileUp, Mean) {
+  SiPMPileUp pileUp;
+  pileUp.setCrossings(25, -2, 2);
+  pileUp.addSource(std::make_shared<SiPMPulseSource>(10, 0), 0, 0.5);
+  pileUp.addSource(std::make_shared<SiPMPulseSource>(100, 0), 0, 1, true);
+  double n = 0;
+  double nInteractions = 0;
+  for (int i = 0; i < N; ++i) {
+    n += pileUp.generate(rng).size();
+    nInteractions += pileUp.nInteractions();
+  }
+  EXPECT_NEAR(n / N, 10 * 0.5 * 5 + 100, 5);
+  EXPECT_NEAR(nInteractions / N, 0.5 * 5 + 1, 0.05);
+}
+
+TEST_F(TestSiPMPileUp, CrossingTimes) {
+  SiPMPileUp pileUp;
+  pileUp.setCrossings(25, -1, 1);
+  pileUp.addSource(std::make_shared<SiPMPulseSource>(1, 0), 3, 5);
+  for (int i = 0; i < 100; ++i) {
+    for (const double t : pileUp.generate(rng)) {
+      EXPECT_TRUE(t == -22 || t == 3 || t == 28);
+    }
+  }
+}
+
+TEST_F(TestSiPMPileUp, Pool) {
+  SiPMPileUp pileUp;
+  pileUp.setCrossings(25, -3, 0);
+  const uint32_t i = pileUp.addSource(std::make_shared<SiPMScintillatorSource>(30, 0, 0.1, 40), 0, 2);
+  pileUp.fillPool(i, rng, 1000);
+  EXPECT_EQ(pileUp.poolSize(i), 1000);
+  double n = 0;
+  for (int j = 0; j < N; ++j) {
+    const std::vector<double> times = pileUp.generate(rng);
+    EXPECT_TRUE(std::is_sorted(times.begin(), times.end()));
+    n += times.size();
+  }
+  EXPECT_NEAR(n / N, 30 * 2 * 4, 10);
+  pileUp.clearPool(i);
+  EXPECT_EQ(pileUp.poolSize(i), 0);
+}
+
+TEST_F(TestSiPMPileUp, PoolIndex) {
+  SiPMPileUp pileUp;
+  EXPECT_THROW(pileUp.fillPool(0, rng, 10), std::out_of_range);
+  const uint32_t i = pileUp.addSource(std::make_shared<SiPMPulseSource>(10, 20), 0, 1);
+  EXPECT_NO_THROW(pileUp.fillPool(i, rng, 10));
+  EXPECT_THROW(pileUp.poolSize(i + 1), std::out_of_range);
+  EXPECT_THROW(pileUp.clearPool(i + 1), std::out_of_range);
+  EXPECT_EQ(pileUp.poolSize(i), 10);
+}
+
+TEST_F(TestSiPMPileUp, Sensor) {
+  SiPMPileUp pileUp;
+  pileUp.setCrossings(25, -2, 0);
+  pileUp.addSource(std::make_shared<SiPMPulseSource>(100, 20), 0, 3);
+  SiPMSensor sensor;
+  sensor.resetState();
+  sensor.addPhotons(pileUp);
+  sensor.runEvent();
+  EXPECT_GT(sensor.debug().nPhotons, 0);
+  EXPECT_GT(sensor.debug().nPhotoelectrons, 0);
+}
@@ -187,6 +187,29 @@ TEST_F(TestSiPMRandom, NormalAverageBig) {
   EXPECT_LE(x, 3 * muBig);
 }
 
+TEST_F(TestSiPMRandom, NormalBoxMuller) {
+  sipm::SiPMRandom rng;
+  double sum = 0;
+  double sum2 = 0;
+  for (int i = 0; i < N; ++i) {
+    const double x = rng.randGaussianBoxMuller(1, 2);
+    sum += x;
+    sum2 += x * x;
+  }
+  const double mean = sum / N;
+  EXPECT_NEAR(mean, 1, 0.01);
+  EXPECT_NEAR(std::sqrt(sum2 / N - mean * mean), 2, 0.01);
+
+  std::vector<float> buffer(1001);
+  rng.randGaussianBoxMuller(0, 1, buffer.data(), buffer.size());
+  float sumF = 0;
+  for (const float x : buffer) {
+    EXPECT_TRUE(std::isfinite(x));
+    sumF += x;
+  }
+  EXPECT_NEAR(sumF / buffer.size(), 0, 0.2);
+}
+
 TEST_F(TestSiPMRandom, RandomCorrelation) {
   sipm::SiPMRandom rng;
   double cov = 0;
@@ -0,0 +1,177 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace sipm;
+
+struct TestSiPMReplay : public ::testing::Test {
+  static constexpr int N = 10;
+  SiPMProperties properties;
+  SiPMRandom rng;
+  // ctest runs each test in its own process in the same directory: one file per test
+  const std::string fname =
+    std::string("TestSiPMReplay.") + ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".bin";
+
+  void SetUp() override { std::remove(fname.c_str()); }
+  void TearDown() override { std::remove(fname.c_str()); }
+};
+
+TEST_F(TestSiPMReplay, PropertiesHash) {
+  SiPMProperties other = properties;
+  EXPECT_EQ(properties.hash(), other.hash());
+  other.setDcr(properties.dcr() * 2);
+  EXPECT_NE(properties.hash(), other.hash());
+  other.setDcr(properties.dcr());
+  EXPECT_EQ(properties.hash(), other.hash());
+  other.setPdeSpectrum({400, 500}, {0.2, 0.3});
+  EXPECT_NE(properties.hash(), other.hash());
+}
+
+// All settings that change the hits are in the hash of the sensor
+TEST_F(TestSiPMReplay, SensorHash) {
+  SiPMSensor sensor(properties);
+  std::vector<uint64_t> hashes = {sensor.hash()};
+  sensor.setApDelayDistribution(SiPMDistribution::fromPdf({0, 10, 20}, {1, 2, 1}));
+  hashes.push_back(sensor.hash());
+  sensor.setDXtDelayDistribution(SiPMDistribution::fromPdf({0, 10, 20}, {1, 2, 1}));
+  hashes.push_back(sensor.hash());
+  SiPMNoiseModel model;
+  model.addPink(0.1, 1e5, 1e8);
+  sensor.setNoiseModel(model);
+  hashes.push_back(sensor.hash());
+  sensor.setReadout(SiPMSensor::Readout::kDigital);
+  hashes.push_back(sensor.hash());
+  sensor.setPrecision(SiPMSensor::Precision::kSingle);
+  hashes.push_back(sensor.hash());
+  sensor.setRealTime(1000);
+  hashes.push_back(sensor.hash());
+  sensor.setMemoryBudget(1 << 20);
+  hashes.push_back(sensor.hash());
+  std::sort(hashes.begin(), hashes.end());
+  EXPECT_EQ(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+  // Same settings give the same hash
+  SiPMSensor other(properties);
+  other.setApDelayDistribution(SiPMDistribution::fromPdf({0, 10, 20}, {1, 2, 1}));
+  other.setDXtDelayDistribution(SiPMDistribution::fromPdf({0, 10, 20}, {1, 2, 1}));
+  other.setNoiseModel(model);
+  other.setReadout(SiPMSensor::Readout::kDigital);
+  other.setPrecision(SiPMSensor::Precision::kSingle);
+  other.setRealTime(1000);
+  other.setMemoryBudget(1 << 20);
+  EXPECT_EQ(other.hash(), sensor.hash());
+}
+
+TEST_F(TestSiPMReplay, WriteRead) {
+  std::vector<SiPMSlowEvent> events(N);
+  for (int i = 0; i < N; ++i) {
+    events[i].event = i;
+    events[i].channel = i - 1;
+    events[i].latency = rng.randInteger(100000);
+    events[i].sensorHash = properties.hash();
+    events[i].memoryBudget = i * 1000;
+    for (int j = 0; j < 4; ++j) {
+      events[i].rngState[j] = rng.rng()();
+    }
+    events[i].photonTimes = rng.randGaussian(20, 1, i + 1);
+    events[i].photonWavelengths = std::vector<double>(i % 2 ? i + 1 : 0, 450);
+    events[i].photonCells = std::vector<uint32_t>(i % 3 ? 0 : i + 1, i);
+  }
+  // Events are appended
+  ASSERT_TRUE(SiPMReplay::write(fname, std::vector<SiPMSlowEvent>(events.begin(), events.begin() + 4)));
+  ASSERT_TRUE(SiPMReplay::write(fname, std::vector<SiPMSlowEvent>(events.begin() + 4, events.end())));
+
+  const std::vector<SiPMSlowEvent> read = SiPMReplay::read(fname);
+  ASSERT_EQ(read.size(), N);
+  for (int i = 0; i < N; ++i) {
+    EXPECT_EQ(read[i].event, events[i].event);
+    EXPECT_EQ(read[i].channel, events[i].channel);
+    EXPECT_EQ(read[i].latency, events[i].latency);
+    EXPECT_EQ(read[i].sensorHash, events[i].sensorHash);
+    EXPECT_EQ(read[i].memoryBudget, events[i].memoryBudget);
+    for (int j = 0; j < 4; ++j) {
+      EXPECT_EQ(read[i].rngState[j], events[i].rngState[j]);
+    }
+    EXPECT_EQ(read[i].photonTimes, events[i].photonTimes);
+    EXPECT_EQ(read[i].photonWavelengths, events[i].photonWavelengths);
+    EXPECT_EQ(read[i].photonCells, events[i].photonCells);
+  }
+}
+
+TEST_F(TestSiPMReplay, ReplayFile) {
+  SiPMBatchRunner runner(properties, 2);
+  runner.setSlowEventThreshold(1);
+  runner.setReplayFile(fname);
+  runner.run(SiPMPulseSource(30, 20, 1), N);
+
+  const std::vector<SiPMSlowEvent> events = SiPMReplay::read(fname);
+  ASSERT_EQ(events.size(), N);
+  SiPMSensor sensor(properties);
+  for (int i = 0; i < N; ++i) {
+    ASSERT_TRUE(SiPMReplay::replay(sensor, events[i]));
+    const SiPMDebugInfo debug = runner.debug(events[i].event);
+    EXPECT_EQ(sensor.debug().nPhotons, debug.nPhotons);
+    EXPECT_EQ(sensor.debug().nPhotoelectrons, debug.nPhotoelectrons);
+    EXPECT_EQ(sensor.debug().nDcr, debug.nDcr);
+    EXPECT_EQ(sensor.debug().nXt, debug.nXt);
+    EXPECT_EQ(sensor.debug().nAp, debug.nAp);
+  }
+}
+
+TEST_F(TestSiPMReplay, WrongProperties) {
+  SiPMSlowEvent ev;
+  ev.sensorHash = SiPMSensor(properties).hash();
+  ev.photonTimes = {10, 20};
+  SiPMProperties other = properties;
+  other.setXt(0.2);
+  SiPMSensor sensor(other);
+  EXPECT_FALSE(SiPMReplay::replay(sensor, ev));
+  sensor.setProperties(properties);
+  EXPECT_TRUE(SiPMReplay::replay(sensor, ev));
+  EXPECT_EQ(sensor.debug().nPhotons, 2);
+}
+
+// Sizes larger than the rest of the file are rejected before allocating
+TEST_F(TestSiPMReplay, CorruptedSize) {
+  SiPMSlowEvent ev;
+  ev.photonTimes = {10, 20};
+  ASSERT_TRUE(SiPMReplay::write(fname, {ev, ev}));
+  std::fstream file(fname, std::ios::binary | std::ios::in | std::ios::out);
+  // Size of the photon times of the second event: magic, event, channel, latency, hash, budget and state
+  const std::streamoff recordSize = 8 + 4 + 4 + 8 + 8 + 8 + 32 + 3 * 4 + 2 * sizeof(double);
+  file.seekp(recordSize + 8 + 4 + 4 + 8 + 8 + 8 + 32);
+  const uint32_t n = 0xffffffff;
+  file.write(reinterpret_cast<const char*>(&n), sizeof(n));
+  file.close();
+
+  const std::vector<SiPMSlowEvent> read = SiPMReplay::read(fname);
+  ASSERT_EQ(read.size(), 1);
+  EXPECT_EQ(read[0].photonTimes, ev.photonTimes);
+}
+
+// Budget of the sensors of the batch is applied by the replay
+TEST_F(TestSiPMReplay, MemoryBudget) {
+  SiPMBatchRunner runner(properties, 2);
+  runner.setMemoryBudget(1 << 18);
+  runner.setSlowEventThreshold(1);
+  runner.setReplayFile(fname);
+  runner.run(SiPMPulseSource(2000, 20, 1), N);
+  EXPECT_GT(runner.nDegradedEvents(), 0);
+
+  const std::vector<SiPMSlowEvent> events = SiPMReplay::read(fname);
+  ASSERT_EQ(events.size(), N);
+  SiPMSensor sensor(properties);
+  for (int i = 0; i < N; ++i) {
+    EXPECT_GT(events[i].memoryBudget, 0);
+    ASSERT_TRUE(SiPMReplay::replay(sensor, events[i]));
+    EXPECT_EQ(sensor.memoryBudget(), events[i].memoryBudget);
+    EXPECT_EQ(sensor.debug().nPhotoelectrons, runner.debug(events[i].event).nPhotoelectrons);
+  }
+}
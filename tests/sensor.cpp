@@ -2,6 +2,8 @@
 #include <gtest/gtest.h>
 #include <stdint.h>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 using namespace sipm;
@@ -68,6 +70,45 @@ TEST_F(TestSiPMSensor, AddDcr) {
   EXPECT_LE(rate, sensor.properties().dcr() * 1.05);
 }
 
+TEST_F(TestSiPMSensor, CrosstalkNeighbours) {
+  // In a 2x2 sensor every cell is a corner: crosstalk stays in the sensor and reaches the first row and column
+  SiPMProperties properties;
+  properties.setXt(0.5);
+  properties.setDcrOff();
+  properties.setApOff();
+  properties.setSize(0.05);
+  const uint32_t n = properties.nSideCells();
+  SiPMSensor sensor(properties);
+  uint32_t nFirstRowCol = 0;
+  for (int i = 0; i < 1000; ++i) {
+    sensor.resetState();
+    sensor.addPhoton(10);
+    sensor.runEvent();
+    for (const SiPMHit& hit : sensor.hits()) {
+      ASSERT_LT(hit.row(), n);
+      ASSERT_LT(hit.col(), n);
+      if (hit.hitType() == SiPMHit::HitType::kOpticalCrosstalk) {
+        nFirstRowCol += (hit.row() == 0) != (hit.col() == 0);
+      }
+    }
+  }
+  EXPECT_EQ(n, 2);
+  EXPECT_GT(nFirstRowCol, 0);
+
+  // A single cell has no neighbours: crosstalk fires the same cell
+  properties.setSize(0.025);
+  sensor.setProperties(properties);
+  for (int i = 0; i < 100; ++i) {
+    sensor.resetState();
+    sensor.addPhotons(std::vector<double>(5, 10));
+    sensor.runEvent();
+    for (const SiPMHit& hit : sensor.hits()) {
+      ASSERT_EQ(hit.row(), 0);
+      ASSERT_EQ(hit.col(), 0);
+    }
+  }
+}
+
 TEST_F(TestSiPMSensor, SignalGeneration) {
   static constexpr int N = 25;
   static constexpr int R = 10000;
@@ -93,3 +134,555 @@ TEST_F(TestSiPMSensor, SignalGeneration) {
     EXPECT_LE(avg_max - 0.5, i);
   }
 }
+
+TEST_F(TestSiPMSensor, SinglePrecision) {
+  static constexpr int N = 1000;
+  SiPMSensor sensorDouble;
+  SiPMSensor sensorSingle;
+  sensorSingle.setPrecision(SiPMSensor::Precision::kSingle);
+  EXPECT_EQ(sensorDouble.precision(), SiPMSensor::Precision::kDouble);
+  sensorDouble.rng().rng().seed(1234567890ULL);
+  sensorSingle.rng().rng().seed(1234567890ULL);
+  for (int i = 0; i < N; ++i) {
+    std::vector<double> t = rng.randGaussian(10, 0.1, 100);
+    sensorDouble.resetState();
+    sensorSingle.resetState();
+    sensorDouble.addPhotons(t);
+    sensorSingle.addPhotons(t);
+    sensorDouble.runEvent();
+    sensorSingle.runEvent();
+    const double a = sensorDouble.signal().integral(0, 250, -1);
+    const double b = sensorSingle.signal().integral(0, 250, -1);
+    EXPECT_NEAR(a, b, 1e-3 * std::abs(a));
+  }
+}
+
+TEST_F(TestSiPMSensor, DoubleAccumulation) {
+  SiPMProperties properties;
+  properties.setDcrOff();
+  properties.setXtOff();
+  properties.setApOff();
+  properties.setCcgv(0);
+  // Negligible white noise
+  properties.setSnr(300);
+  SiPMSensor sensor(properties);
+  sensor.addPhoton(0);
+  sensor.runEvent();
+  const SiPMAnalogSignal single = sensor.signal();
+
+  // Many piled-up pulses compared with the sum of single pulses
+  const std::vector<double> photons = rng.randGaussian(30, 3, 20000);
+  double error[2] = {};
+  for (const SiPMSensor::Precision precision : {SiPMSensor::Precision::kDouble, SiPMSensor::Precision::kSingle}) {
+    sensor.setPrecision(precision);
+    sensor.rng().rng().seed(1234567890ULL);
+    sensor.resetState();
+    sensor.addPhotons(photons);
+    sensor.runEvent();
+    const SiPMAnalogSignal& signal = sensor.signal();
+    std::vector<double> expected(signal.size(), 0);
+    for (const SiPMHit& hit : sensor.hits()) {
+      const int64_t start = std::round(hit.time() / properties.sampling());
+      for (int64_t j = std::max<int64_t>(start, 0); j < signal.size(); ++j) {
+        expected[j] += hit.amplitude() * single[j - start];
+      }
+    }
+    const double peak = *std::max_element(expected.begin(), expected.end());
+    double& e = error[precision == SiPMSensor::Precision::kSingle];
+    for (uint32_t j = 0; j < signal.size(); ++j) {
+      e = std::max(e, std::abs(signal[j] - expected[j]) / peak);
+    }
+  }
+  // Double accumulation only rounds the result to float
+  EXPECT_LT(error[0], 1e-6);
+  EXPECT_GT(error[1], error[0]);
+}
+
+TEST_F(TestSiPMSensor, LazySignal) {
+  SiPMSensor sensor;
+  std::vector<double> t = rng.randGaussian(10, 0.1, 10);
+  sensor.resetState();
+  sensor.addPhotons(t);
+  sensor.runEvent();
+  // Hits and MC-Truth do not need the waveform
+  EXPECT_FALSE(sensor.isSignalBuilt());
+  EXPECT_GT(sensor.hits().size(), 0);
+  EXPECT_FALSE(sensor.isSignalBuilt());
+  const SiPMAnalogSignal signal = sensor.signal();
+  EXPECT_TRUE(sensor.isSignalBuilt());
+  EXPECT_EQ(signal.size(), sensor.properties().nSignalPoints());
+  // Signal is built only once
+  const SiPMAnalogSignal again = sensor.signal();
+  for (uint32_t i = 0; i < signal.size(); ++i) {
+    EXPECT_EQ(signal[i], again[i]);
+  }
+}
+
+// Requesting the waveform must not change the following events
+TEST_F(TestSiPMSensor, LazySignalStream) {
+  SiPMSensor a, b;
+  a.rng().rng().seed(42);
+  b.rng().rng().seed(42);
+  const std::vector<double> t = rng.randGaussian(10, 0.1, 10);
+  for (int i = 0; i < 10; ++i) {
+    a.resetState();
+    b.resetState();
+    a.addPhotons(t);
+    b.addPhotons(t);
+    a.runEvent();
+    b.runEvent();
+    // Waveform of a is built at every event, the one of b only at the last one
+    const SiPMAnalogSignal signal = a.signal();
+    const std::vector<SiPMHit> hits = a.hits();
+    const std::vector<SiPMHit> other = b.hits();
+    ASSERT_EQ(hits.size(), other.size());
+    for (uint32_t j = 0; j < hits.size(); ++j) {
+      EXPECT_EQ(hits[j].time(), other[j].time());
+      EXPECT_EQ(hits[j].amplitude(), other[j].amplitude());
+    }
+    if (i == 9) {
+      const SiPMAnalogSignal last = b.signal();
+      for (uint32_t j = 0; j < signal.size(); ++j) {
+        EXPECT_EQ(signal[j], last[j]);
+      }
+    }
+  }
+}
+
+// Buffer input and signal view must give the same event as vectors and copies
+TEST_F(TestSiPMSensor, BufferInputSignalView) {
+  SiPMSensor a, b;
+  for (int i = 0; i < 100; ++i) {
+    const int n = rng.randInteger(100) + 1;
+    const std::vector<double> t = rng.randGaussian(50, 1, n);
+    const std::vector<double> w = rng.randGaussian(450, 20, n);
+    a.rng().rng().seed(i);
+    b.rng().rng().seed(i);
+    a.resetState();
+    b.resetState();
+    if (i % 2) {
+      a.addPhotons(t);
+      b.addPhotons(t.data(), n);
+    } else {
+      a.addPhotons(t, w);
+      b.addPhotons(t.data(), w.data(), n);
+    }
+    a.runEvent();
+    b.runEvent();
+    const SiPMAnalogSignal signal = a.signal();
+    const SiPMAnalogSignal& view = b.signalView();
+    ASSERT_EQ(signal.size(), view.size());
+    for (uint32_t j = 0; j < signal.size(); ++j) {
+      ASSERT_EQ(signal[j], view[j]);
+    }
+    EXPECT_EQ(signal.integral(20, 250, 0), view.integral(20, 250, 0));
+  }
+}
+
+// Waveform buffer is reused between events with the same number of samples
+TEST_F(TestSiPMSensor, SignalViewBuffer) {
+  SiPMSensor sensor;
+  sensor.addPhotons({10, 20, 30});
+  sensor.runEvent();
+  const float* data = sensor.signalView().data();
+  for (const uint32_t n : {0u, 1000u}) {
+    sensor.resetState();
+    sensor.addPhotons(std::vector<double>(n, 40));
+    sensor.runEvent();
+    EXPECT_EQ(sensor.signalView().data(), data);
+  }
+}
+
+// Waveform of a resumed event must match the sum of pulses of its hits
+TEST_F(TestSiPMSensor, ResumeEvent) {
+  SiPMProperties properties;
+  properties.setDcrOff();
+  properties.setSnr(200);
+  properties.setSize(1);
+  properties.setXt(0.3);
+  properties.setAp(0.3);
+
+  SiPMProperties shapeProperties = properties;
+  shapeProperties.setXtOff();
+  shapeProperties.setApOff();
+  shapeProperties.setCcgv(0);
+  SiPMSensor shapeSensor(shapeProperties);
+  shapeSensor.addPhoton(0);
+  shapeSensor.runEvent();
+  const SiPMAnalogSignal shape = shapeSensor.signal();
+
+  for (const bool buildFirst : {true, false}) {
+    SiPMSensor sensor(properties);
+    sensor.resetState();
+    sensor.addPhotons(rng.randGaussian(50, 10, 300));
+    sensor.runEvent();
+    const uint32_t nHits = sensor.hits().size();
+    if (buildFirst) {
+      sensor.signal();
+    }
+    sensor.appendPhotons(rng.randGaussian(20, 10, 300));
+    sensor.runEvent();
+    EXPECT_GT(sensor.hits().size(), nHits);
+    EXPECT_EQ(sensor.isSignalBuilt(), buildFirst);
+
+    const std::vector<SiPMHit> hits = sensor.hits();
+    EXPECT_TRUE(std::is_sorted(hits.begin(), hits.end()));
+    const SiPMAnalogSignal signal = sensor.signal();
+    std::vector<double> expected(signal.size(), 0);
+    for (const SiPMHit& hit : hits) {
+      const int32_t start = std::round(hit.time() / properties.sampling());
+      // Hits before the start of the window are not in the waveform
+      if (start < 0) {
+        continue;
+      }
+      for (int32_t j = start; j < (int32_t)signal.size(); ++j) {
+        expected[j] += hit.amplitude() * shape[j - start];
+      }
+    }
+    for (uint32_t j = 0; j < signal.size(); ++j) {
+      EXPECT_NEAR(signal[j], expected[j], 1e-2);
+    }
+  }
+}
+
+// Real-time events are not resumed with the other recovery model
+TEST_F(TestSiPMSensor, ResumeRealTime) {
+  SiPMSensor sensor;
+  sensor.setRealTime(1000);
+  sensor.addPhotons(rng.randGaussian(20, 1, 50));
+  sensor.runEvent();
+  const uint32_t nHits = sensor.hits().size();
+  sensor.appendPhotons(rng.randGaussian(30, 1, 50));
+  sensor.runEvent();
+  EXPECT_EQ(sensor.hits().size(), nHits);
+
+  // Turning real-time mode off does not change the model of an event already run
+  sensor.setRealTime(0);
+  sensor.appendPhotons(rng.randGaussian(40, 1, 50));
+  sensor.runEvent();
+  EXPECT_EQ(sensor.hits().size(), nHits);
+}
+
+// Resumed events with spectrum PDE need the wavelength of every photon
+TEST_F(TestSiPMSensor, ResumeSpectrumPde) {
+  SiPMProperties properties;
+  properties.setDcrOff();
+  properties.setXtOff();
+  properties.setApOff();
+  properties.setPdeSpectrum({300, 400, 500, 600}, {0.9, 0.9, 0.9, 0.9});
+  SiPMSensor sensor(properties);
+  sensor.addPhotons(rng.randGaussian(20, 1, 50), std::vector<double>(50, 450));
+  sensor.runEvent();
+  const uint32_t nPe = sensor.debug().nPhotoelectrons;
+
+  // Photons without wavelength or with a wavelength missing are rejected
+  sensor.appendPhotons(rng.randGaussian(30, 1, 50));
+  sensor.appendPhotons(rng.randGaussian(30, 1, 50), std::vector<double>(49, 450));
+  sensor.runEvent();
+  EXPECT_EQ(sensor.debug().nPhotons, 50);
+  EXPECT_EQ(sensor.debug().nPhotoelectrons, nPe);
+
+  sensor.appendPhotons(rng.randGaussian(30, 1, 50), std::vector<double>(50, 450));
+  sensor.runEvent();
+  EXPECT_EQ(sensor.debug().nPhotons, 100);
+  EXPECT_GT(sensor.debug().nPhotoelectrons, nPe);
+
+  // Wavelengths can not be appended to photons without them
+  sensor.resetState();
+  sensor.addPhotons(rng.randGaussian(20, 1, 50));
+  sensor.appendPhotons(rng.randGaussian(30, 1, 50), std::vector<double>(50, 450));
+  EXPECT_EQ(sensor.debug().nPhotons, 50);
+}
+
+TEST_F(TestSiPMSensor, OrderStatistic) {
+  SiPMSensor sensor;
+  sensor.setReadout(SiPMSensor::Readout::kTiming);
+  for (int i = 0; i < 1000; ++i) {
+    sensor.resetState();
+    sensor.addPhotons(rng.randGaussian(100, 5, 50));
+    sensor.runEvent();
+    std::vector<double> times;
+    for (const SiPMHit& hit : sensor.hits()) {
+      if (hit.time() >= 0 && hit.time() < sensor.properties().signalLength()) {
+        times.push_back(hit.time());
+      }
+    }
+    std::sort(times.begin(), times.end());
+    for (const uint32_t k : {1u, 5u, 20u}) {
+      EXPECT_EQ(sensor.orderStatistic(k), times[k - 1]);
+    }
+    EXPECT_EQ(sensor.orderStatistic(times.size() + 1), -1);
+    const std::vector<double> first = sensor.orderStatistics(10);
+    EXPECT_TRUE(std::equal(first.begin(), first.end(), times.begin()));
+  }
+}
+
+TEST_F(TestSiPMSensor, Sptr) {
+  SiPMProperties properties;
+  properties.setDcrOff();
+  properties.setXtOff();
+  properties.setApOff();
+  properties.setSptr(0.2);
+  SiPMSensor sensor(properties);
+  sensor.setReadout(SiPMSensor::Readout::kTiming);
+  double sum = 0, sum2 = 0;
+  for (int i = 0; i < 1000; ++i) {
+    sensor.resetState();
+    sensor.addPhoton(100);
+    sensor.runEvent();
+    const double t = sensor.orderStatistic(1);
+    sum += t;
+    sum2 += t * t;
+  }
+  const double mean = sum / 1000;
+  EXPECT_NEAR(mean, 100, 0.05);
+  EXPECT_NEAR(std::sqrt(sum2 / 1000 - mean * mean), 0.2, 0.02);
+}
+
+TEST_F(TestSiPMSensor, PhotonPosition) {
+  SiPMProperties properties;
+  properties.setDcrOff();
+  properties.setXtOff();
+  properties.setApOff();
+  properties.setSize(1);
+  properties.setPitch(25); // 40x40 cells
+  SiPMSensor sensor(properties);
+
+  // Center of the sensor and corners of first and last cell
+  sensor.resetState();
+  sensor.addPhoton(10, 0.001, 0.001);
+  sensor.addPhoton(20, -0.4999, -0.4999);
+  sensor.addPhoton(30, 0.4999, -0.4999);
+  sensor.addPhoton(40, 0.6, 0); // Outside
+  sensor.runEvent();
+  std::vector<SiPMHit> hits = sensor.hits();
+  ASSERT_EQ(hits.size(), 3);
+  EXPECT_EQ(hits[0].row(), 20);
+  EXPECT_EQ(hits[0].col(), 20);
+  EXPECT_EQ(hits[1].row(), 0);
+  EXPECT_EQ(hits[1].col(), 0);
+  EXPECT_EQ(hits[2].row(), 0);
+  EXPECT_EQ(hits[2].col(), 39);
+
+  // All photons in the same cell saturate it
+  const uint32_t n = 100;
+  sensor.resetState();
+  sensor.addPhotons(std::vector<double>(n, 10), std::vector<double>(n, 0.1), std::vector<double>(n, -0.2));
+  sensor.runEvent();
+  hits = sensor.hits();
+  ASSERT_EQ(hits.size(), n);
+  double sum = 0;
+  for (const SiPMHit& hit : hits) {
+    EXPECT_EQ(hit.row(), 12);
+    EXPECT_EQ(hit.col(), 24);
+    sum += hit.amplitude();
+  }
+  EXPECT_LT(sum, 1.5);
+
+  // Photons without position are spread on the sensor
+  sensor.resetState();
+  sensor.addPhoton(10);
+  sensor.addPhoton(10, 0, 0);
+  sensor.addPhoton(10);
+  sensor.runEvent();
+  EXPECT_EQ(sensor.hits().size(), 3);
+}
+
+TEST_F(TestSiPMSensor, RealTime) {
+  static constexpr int N = 1000;
+  static constexpr uint32_t kMaxHits = 200;
+  SiPMProperties properties;
+  properties.setXt(0.3);
+  properties.setAp(0.1);
+  properties.setHitDistribution(SiPMProperties::HitDistribution::kCircle);
+  SiPMSensor sensor(properties);
+  sensor.setRealTime(kMaxHits);
+  EXPECT_EQ(sensor.maxHits(), kMaxHits);
+
+  const uint32_t n = properties.nSideCells();
+  uint64_t nHits = 0;
+  uint64_t nInCircle = 0;
+  for (int i = 0; i < N; ++i) {
+    sensor.resetState();
+    const uint32_t nPhotons = rng.randInteger(300) + 1;
+    sensor.addPhotons(rng.randGaussian(100, 1, nPhotons));
+    sensor.runEvent();
+    // Waveform is built by runEvent
+    EXPECT_TRUE(sensor.isSignalBuilt());
+    const std::vector<SiPMHit> hits = sensor.hits();
+    EXPECT_LE(hits.size(), kMaxHits);
+    if (sensor.nDroppedHits() > 0) {
+      EXPECT_EQ(hits.size(), kMaxHits);
+    }
+    for (uint32_t j = 0; j < hits.size(); ++j) {
+      ASSERT_LT(hits[j].row(), n);
+      ASSERT_LT(hits[j].col(), n);
+      if (hits[j].hitType() == SiPMHit::HitType::kPhotoelectron) {
+        const double x = (hits[j].row() + 0.5) * 2. / n - 1;
+        const double y = (hits[j].col() + 0.5) * 2. / n - 1;
+        nInCircle += x * x + y * y <= 1;
+        ++nHits;
+      }
+    }
+  }
+  // 90% of photoelectrons in the circle
+  EXPECT_NEAR(static_cast<double>(nInCircle) / nHits, 0.9, 0.01);
+  EXPECT_EQ(sensor.latency().count(), N);
+  EXPECT_LE(sensor.latency().quantile(0.5), sensor.latency().quantile(0.999));
+
+  // Lazy waveform is restored when real-time mode is turned off
+  sensor.setRealTime(0);
+  sensor.resetState();
+  sensor.runEvent();
+  EXPECT_FALSE(sensor.isSignalBuilt());
+  EXPECT_EQ(sensor.latency().count(), N);
+}
+
+TEST_F(TestSiPMSensor, RealTimeCrosstalk) {
+  // Crosstalk hits are always in a neighbour cell
+  SiPMProperties properties;
+  properties.setXt(0.5);
+  properties.setDcrOff();
+  properties.setApOff();
+  properties.setSize(0.1);
+  SiPMSensor sensor(properties);
+  sensor.setRealTime(10000);
+  for (int i = 0; i < 1000; ++i) {
+    sensor.resetState();
+    sensor.addPhotons(std::vector<double>(20, 10));
+    sensor.runEvent();
+    const std::vector<SiPMHit> hits = sensor.hits();
+    for (uint32_t j = 0; j < hits.size(); ++j) {
+      if (hits[j].hitType() != SiPMHit::HitType::kOpticalCrosstalk) {
+        continue;
+      }
+      // Parent is in one of the neighbour cells
+      bool hasNeighbour = false;
+      for (const SiPMHit& other : hits) {
+        const int32_t dr = std::abs(static_cast<int32_t>(other.row()) - static_cast<int32_t>(hits[j].row()));
+        const int32_t dc = std::abs(static_cast<int32_t>(other.col()) - static_cast<int32_t>(hits[j].col()));
+        hasNeighbour |= (dr <= 1 && dc <= 1 && (dr || dc));
+      }
+      EXPECT_TRUE(hasNeighbour);
+    }
+  }
+}
+
+TEST_F(TestSiPMSensor, MemoryBudget) {
+  SiPMSensor sensor;
+  sensor.addPhotons(rng.randGaussian(20, 1, 20000));
+  // Budget leaves room for a few hundred hits besides input and waveform
+  const size_t budget = sensor.memoryUsage() + 16384;
+  sensor.setMemoryBudget(budget);
+  EXPECT_EQ(sensor.memoryBudget(), budget);
+  sensor.runEvent();
+  sensor.signal();
+  EXPECT_GT(sensor.nDroppedHits(), 0);
+  EXPECT_GT(sensor.debug().nPhotoelectrons, 0);
+  EXPECT_LT(sensor.debug().nPhotoelectrons + sensor.debug().nAp, 1000);
+  EXPECT_LE(sensor.memoryUsage(), budget);
+  EXPECT_LE(sensor.peakMemoryUsage(), budget);
+
+  // Same event without budget
+  sensor.setMemoryBudget(0);
+  sensor.resetState();
+  sensor.addPhotons(rng.randGaussian(20, 1, 20000));
+  sensor.runEvent();
+  EXPECT_EQ(sensor.nDroppedHits(), 0);
+  EXPECT_GT(sensor.memoryUsage(), budget);
+  EXPECT_GE(sensor.peakMemoryUsage(), sensor.memoryUsage());
+
+  const size_t peak = sensor.peakMemoryUsage();
+  sensor.releaseMemory();
+  EXPECT_LT(sensor.memoryUsage(), peak);
+  sensor.resetPeakMemoryUsage();
+  EXPECT_EQ(sensor.peakMemoryUsage(), sensor.memoryUsage());
+}
+
+// Photoelectrons kept by the budget are a uniform sample, not the first photons given
+TEST_F(TestSiPMSensor, MemoryBudgetSampling) {
+  SiPMProperties properties;
+  properties.setDcrOff();
+  properties.setXt(0.1);
+  properties.setApOff();
+  properties.setPdeType(SiPMProperties::PdeType::kNoPde);
+  SiPMSensor sensor(properties);
+  // Photons in increasing time: truncation would keep only the earliest ones
+  std::vector<double> t(20000);
+  for (uint32_t i = 0; i < t.size(); ++i) {
+    t[i] = 10 + 400. * i / t.size();
+  }
+  sensor.addPhotons(t);
+  sensor.setMemoryBudget(sensor.memoryUsage() + 65536);
+  sensor.runEvent();
+  EXPECT_GT(sensor.nDroppedHits(), 0);
+  double sum = 0;
+  uint32_t nPe = 0, nXt = 0;
+  for (const SiPMHit& hit : sensor.hits()) {
+    if (hit.hitType() == SiPMHit::HitType::kPhotoelectron) {
+      sum += hit.time();
+      ++nPe;
+    }
+    nXt += hit.hitType() == SiPMHit::HitType::kOpticalCrosstalk;
+  }
+  // Dropped hits also count correlated noise that did not fit
+  EXPECT_GE(nPe + sensor.nDroppedHits(), t.size());
+  EXPECT_NEAR(sum / nPe, 210, 20);
+  // Crosstalk is not left out by the photoelectrons
+  EXPECT_NEAR(static_cast<double>(nXt) / nPe, 0.1, 0.05);
+}
+
+// Resumed events update the peak memory and respect the budget
+TEST_F(TestSiPMSensor, MemoryBudgetResume) {
+  SiPMSensor sensor;
+  sensor.addPhotons(rng.randGaussian(20, 1, 100));
+  sensor.runEvent();
+  sensor.resetPeakMemoryUsage();
+  const size_t peak = sensor.peakMemoryUsage();
+  sensor.appendPhotons(rng.randGaussian(30, 1, 20000));
+  sensor.runEvent();
+  EXPECT_GT(sensor.peakMemoryUsage(), peak);
+  EXPECT_GE(sensor.peakMemoryUsage(), sensor.memoryUsage());
+}
+
+TEST_F(TestSiPMSensor, RecursiveSynthesis) {
+  SiPMProperties properties;
+  properties.setSnr(40);
+  for (const bool slow : {false, true}) {
+    if (slow) {
+      properties.setSlowComponentFraction(0.3);
+      properties.setFallTimeSlow(80);
+    }
+    for (const SiPMSensor::Precision precision : {SiPMSensor::Precision::kDouble, SiPMSensor::Precision::kSingle}) {
+      SiPMSensor direct(properties);
+      SiPMSensor recursive(properties);
+      direct.setPrecision(precision);
+      recursive.setPrecision(precision);
+      recursive.setSynthesis(SiPMSensor::Synthesis::kRecursive);
+      for (const uint32_t nPhotons : {1, 10, 1000}) {
+        const std::vector<double> photons = rng.randGaussian(50, 20, nPhotons);
+        for (SiPMSensor* sensor : {&direct, &recursive}) {
+          sensor->rng().rng().seed(nPhotons);
+          sensor->resetState();
+          sensor->addPhotons(photons);
+          sensor->runEvent();
+        }
+        const SiPMAnalogSignal& a = direct.signalView();
+        const SiPMAnalogSignal& b = recursive.signalView();
+        ASSERT_EQ(a.size(), b.size());
+        for (uint32_t i = 0; i < a.size(); ++i) {
+          ASSERT_NEAR(a[i], b[i], 1e-4 * (1 + std::abs(a[i])));
+        }
+      }
+    }
+  }
+
+  // Auto selects the algorithm from the number of hits
+  SiPMSensor sensor(properties);
+  sensor.setSynthesis(SiPMSensor::Synthesis::kAuto);
+  sensor.setSynthesisThreshold(100);
+  EXPECT_EQ(sensor.synthesisThreshold(), 100);
+  sensor.addPhotons(rng.randGaussian(50, 20, 1000));
+  sensor.runEvent();
+  EXPECT_GT(sensor.signal().peak(0, 500, 0), 0);
+}
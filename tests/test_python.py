@@ -251,3 +251,94 @@ class TestProperties:
         for p in range(1000):
             prop.setPde(p/1000)
             assert prop.pde() == p/1000
+
+
+class TestSensor:
+    def test_NumpyInput(self):
+        sensor = SiPM.SiPMSensor()
+        t = np.random.normal(20, 0.1, 100)
+        sensor.addPhotons(t)
+        sensor.runEvent()
+        assert sensor.debug().nPhotons == 100
+        sensor.resetState()
+        sensor.addPhotons(t.astype(np.float32), np.full(100, 450.0))
+        sensor.runEvent()
+        assert sensor.debug().nPhotons == 100
+
+    def test_SignalView(self):
+        sensor = SiPM.SiPMSensor()
+        sensor.addPhotons(np.random.normal(20, 0.1, 100))
+        sensor.runEvent()
+        view = sensor.signalView()
+        signal = sensor.signal()
+        assert view.shape == (len(signal),)
+        assert np.array_equal(view, np.asarray(signal))
+        assert np.array_equal(view, np.array(signal.waveform(), dtype=np.float32))
+
+    def test_SignalViewAcrossEvents(self):
+        sensor = SiPM.SiPMSensor()
+        sensor.addPhotons(np.random.normal(20, 0.1, 100))
+        sensor.runEvent()
+        view = sensor.signalView()
+        copy = sensor.signalCopy()
+        first = np.array(view)
+        assert np.array_equal(copy, first)
+        assert not view.flags.writeable
+        # The view shows the samples of the next event, the copy keeps its own
+        sensor.resetState()
+        sensor.addPhotons(np.random.normal(50, 0.1, 1000))
+        sensor.runEvent()
+        signal = sensor.signal()
+        assert np.array_equal(view, np.asarray(signal))
+        assert np.array_equal(copy, first)
+        # The view keeps the sensor alive
+        del sensor
+        assert view.shape == copy.shape
+
+    def test_RunAndExtract(self):
+        sensor = SiPM.SiPMSensor()
+        events = [np.random.normal(20, 0.1, n) for n in range(1, 50)]
+        features = sensor.runAndExtract(events, 10, 250, 0.5)
+        assert features.shape == (len(events), 5)
+        integral, peak, toa, tot, top = sensor.runAndExtract(events[-1], 10, 250, 0.5)
+        assert integral == sensor.signal().integral(10, 250, 0.5)
+        assert peak == sensor.signal().peak(10, 250, 0.5)
+
+
+class TestBindings:
+    def test_PileUpSource(self):
+        pileup = SiPM.SiPMPileUp()
+        pileup.setCrossings(25, -2, 0)
+        assert pileup.addSource(SiPM.SiPMPulseSource(10, 20), 0, 1) == 0
+        assert pileup.nSources() == 1
+        times = pileup.generate(SiPM.SiPMRandom())
+        assert isinstance(times, list)
+
+    def test_BatchRunnerChannels(self):
+        prop = SiPM.SiPMProperties()
+        table = SiPM.SiPMChannelTable(4, prop)
+        runner = SiPM.SiPMBatchRunner(prop, 1)
+        runner.setChannelTable(table)
+        runner.setSeed(1)
+        runner.run([list(np.random.normal(20, 0.1, 10)) for _ in range(8)])
+        assert runner.nEvents() == 8
+        assert len(runner.signal(7)) == runner.nSignalPoints()
+
+    def test_MetricsFormat(self, tmp_path):
+        metrics = SiPM.SiPMMetrics()
+        counter = metrics.counter("events")
+        metrics.add(counter)
+        assert metrics.value(counter) == 1
+        assert metrics.write(str(tmp_path / "metrics.prom"))
+        assert metrics.write(str(tmp_path / "metrics.json"), SiPM.SiPMMetrics.Format.kJson)
+
+    def test_OccupancyBuffer(self):
+        prop = SiPM.SiPMProperties()
+        sensor = SiPM.SiPMSensor(prop)
+        occupancy = SiPM.SiPMOccupancy(prop)
+        sensor.addPhotons(np.random.normal(20, 0.1, 100))
+        sensor.runEvent()
+        occupancy.fill(sensor)
+        counts = np.asarray(occupancy)
+        assert counts.shape[1:] == (occupancy.nSideCells(), occupancy.nSideCells())
+        assert counts.sum() == len(sensor.hits())
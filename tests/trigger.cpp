@@ -0,0 +1,145 @@
+#include "SiPM.h"
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace sipm;
+
+struct TestSiPMTrigger : public ::testing::Test {
+  static constexpr int N = 100;
+  SiPMRandom rng;
+
+  // Adds a triangular pulse starting at sample t0
+  static void addPulse(std::vector<float>& stream, const uint32_t t0, const float amplitude) {
+    for (uint32_t i = 0; i < 20 && t0 + i < stream.size(); ++i) {
+      stream[t0 + i] += amplitude * (i < 4 ? i / 4. : (20 - i) / 16.);
+    }
+  }
+};
+
+TEST_F(TestSiPMTrigger, LeadingEdge) {
+  std::vector<float> stream(1000, 0);
+  addPulse(stream, 100, 2);
+  addPulse(stream, 498, 2); // Across two blocks
+  addPulse(stream, 800, 0.3); // Below threshold
+
+  SiPMTrigger trigger(1, 1);
+  trigger.setLeadingEdge(0.5);
+  trigger.setWindow(10, 30);
+  for (uint32_t b = 0; b < 2; ++b) {
+    const float* data = stream.data() + b * 500;
+    trigger.process(&data, 500);
+  }
+  EXPECT_EQ(trigger.nSamples(), 1000);
+  EXPECT_EQ(trigger.nTriggers(), 2);
+  const std::vector<SiPMTriggerWindow> windows = trigger.takeWindows();
+  ASSERT_EQ(windows.size(), 2);
+  EXPECT_EQ(trigger.nWindows(), 0);
+
+  // Threshold is crossed at 1/4 of the rising edge
+  EXPECT_DOUBLE_EQ(windows[0].time, 101);
+  EXPECT_DOUBLE_EQ(windows[1].time, 499);
+  for (const SiPMTriggerWindow& window : windows) {
+    EXPECT_EQ(window.length, 40);
+    ASSERT_EQ(window.channels.size(), 1);
+    EXPECT_EQ(window.firstSample, std::lround(window.time) + 1 - 10);
+    for (uint32_t i = 0; i < window.length; ++i) {
+      EXPECT_EQ(window.channel(0)[i], stream[window.firstSample + i]);
+    }
+  }
+}
+
+TEST_F(TestSiPMTrigger, Majority) {
+  std::vector<std::vector<float>> streams(3, std::vector<float>(1000, 0));
+  // Two channels in coincidence
+  addPulse(streams[0], 100, 2);
+  addPulse(streams[2], 102, 2);
+  // Two channels out of coincidence
+  addPulse(streams[0], 400, 2);
+  addPulse(streams[1], 420, 2);
+  // Three channels in coincidence
+  addPulse(streams[0], 700, 2);
+  addPulse(streams[1], 701, 2);
+  addPulse(streams[2], 703, 2);
+
+  SiPMTrigger trigger(3, 1);
+  trigger.setLeadingEdge(0.5);
+  trigger.setCoincidence(5, 2);
+  trigger.setDeadTime(50);
+  trigger.setWindow(5, 20);
+  const float* data[3] = {streams[0].data(), streams[1].data(), streams[2].data()};
+  trigger.process(data, 1000);
+
+  const std::vector<SiPMTriggerWindow> windows = trigger.takeWindows();
+  ASSERT_EQ(windows.size(), 2);
+  EXPECT_EQ(windows[0].channels, (std::vector<uint32_t>{0, 2}));
+  EXPECT_NEAR(windows[0].time, 103, 1e-6);
+  // Third channel of the last coincidence is in dead time
+  EXPECT_EQ(windows[1].channels, (std::vector<uint32_t>{0, 1}));
+  EXPECT_NEAR(windows[1].time, 702, 1e-6);
+}
+
+TEST_F(TestSiPMTrigger, ConstantFraction) {
+  // Time of CFD does not depend on amplitude
+  std::vector<float> stream(2000, 0);
+  for (uint32_t i = 0; i < 10; ++i) {
+    addPulse(stream, 100 + 150 * i, 1 + i);
+  }
+  SiPMTrigger trigger(1, 1);
+  trigger.setConstantFraction(0.5, 0.5, 4);
+  trigger.setWindow(5, 20);
+  const float* data = stream.data();
+  trigger.process(&data, stream.size());
+  const std::vector<SiPMTriggerWindow> windows = trigger.takeWindows();
+  ASSERT_EQ(windows.size(), 10);
+  for (uint32_t i = 0; i < 10; ++i) {
+    EXPECT_NEAR(windows[i].time - 150 * i, windows[0].time, 1e-3);
+  }
+}
+
+TEST_F(TestSiPMTrigger, Flush) {
+  std::vector<float> stream(100, 0);
+  addPulse(stream, 90, 2);
+  SiPMTrigger trigger(1, 1);
+  trigger.setWindow(5, 50);
+  const float* data = stream.data();
+  trigger.process(&data, stream.size());
+  EXPECT_EQ(trigger.nWindows(), 0);
+  trigger.flush();
+  const std::vector<SiPMTriggerWindow> windows = trigger.takeWindows();
+  ASSERT_EQ(windows.size(), 1);
+  EXPECT_EQ(windows[0].channel(0)[windows[0].length - 1], 0);
+}
+
+TEST_F(TestSiPMTrigger, SensorStream) {
+  SiPMProperties properties;
+  properties.setDcr(1e6);
+  std::vector<SiPMSensor> sensors(4, SiPMSensor(properties));
+  SiPMTrigger trigger(4, properties.sampling());
+  trigger.setLeadingEdge(3.5);
+  trigger.setCoincidence(10, 3);
+  trigger.setDeadTime(200);
+  trigger.setWindow(20, 100);
+  std::vector<SiPMAnalogSignal> signals(4);
+  for (int i = 0; i < N; ++i) {
+    // A light pulse every 10 blocks, noise only otherwise
+    for (uint32_t c = 0; c < 4; ++c) {
+      sensors[c].resetState();
+      if (i % 10 == 0) {
+        sensors[c].addPhotons(rng.randGaussian(200, 1, 20));
+      }
+      sensors[c].runEvent();
+      signals[c] = sensors[c].signal();
+    }
+    trigger.process(signals);
+  }
+  const std::vector<SiPMTriggerWindow> windows = trigger.takeWindows();
+  EXPECT_EQ(windows.size(), N / 10);
+  for (const SiPMTriggerWindow& window : windows) {
+    EXPECT_GE(window.channels.size(), 3);
+    EXPECT_NEAR(std::fmod(window.time, 10 * properties.signalLength()), 200, 5);
+  }
+}
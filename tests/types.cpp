@@ -0,0 +1,65 @@
+#include "SiPMAnalogSignal.h"
+#include "SiPMPrecision.h"
+#include "SiPMTypes.h"
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <numeric>
+#include <type_traits>
+
+using namespace sipm;
+
+namespace {
+template <MemoryPolicy P> void fillAndCheck(const uint32_t n) {
+  SiPMMappedVector<double, P> v(n);
+  std::iota(v.begin(), v.end(), 0);
+  // Growth reallocates and copies data
+  v.resize(2 * n, 1);
+  EXPECT_EQ(v.size(), 2 * n);
+  EXPECT_EQ(v[n - 1], n - 1);
+  EXPECT_EQ(v[2 * n - 1], 1);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(v.data()) % 64, 0);
+}
+} // namespace
+
+struct TestSiPMTypes : public ::testing::Test {};
+
+TEST_F(TestSiPMTypes, Aligned) { fillAndCheck<MemoryPolicy::kAligned>(1000); }
+
+TEST_F(TestSiPMTypes, TransparentHugePages) {
+  fillAndCheck<MemoryPolicy::kTransparentHugePages>(1000000);
+  SiPMMappedVector<float, MemoryPolicy::kTransparentHugePages> v(10);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(v.data()) % MappedMemory::hugePageSize, 0);
+}
+
+TEST_F(TestSiPMTypes, HugePages) {
+  // Falls back to transparent huge pages if no huge page is reserved
+  fillAndCheck<MemoryPolicy::kHugePages>(1000000);
+  SiPMMappedVector<float, MemoryPolicy::kHugePages> v(10);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(v.data()) % MappedMemory::hugePageSize, 0);
+}
+
+TEST_F(TestSiPMTypes, FileBacked) {
+  fillAndCheck<MemoryPolicy::kFileBacked>(1000000);
+  MappedMemory::setDirectory("/this/directory/does/not/exist");
+  EXPECT_THROW((SiPMMappedVector<double, MemoryPolicy::kFileBacked>(10)), std::bad_alloc);
+  MappedMemory::setDirectory("/tmp");
+}
+
+TEST_F(TestSiPMTypes, Buffers) {
+  using Times = decltype(SiPMHitBuffer<DoublePrecision>::times);
+  EXPECT_TRUE((std::is_same<Times::allocator_type, MappedAllocator<double, BufferMemory::hits>>::value));
+
+  // Hit buffers can use any policy
+  SiPMHitBuffer<SinglePrecision, MemoryPolicy::kTransparentHugePages> buffer;
+  buffer.resize(100);
+  EXPECT_EQ(buffer.size(), 100);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.times.data()) % MappedMemory::hugePageSize, 0);
+
+  // Waveform is copied in and out of the buffer of the signal
+  SiPMVector<float> wav(1000);
+  std::iota(wav.begin(), wav.end(), 0);
+  const SiPMAnalogSignal signal(wav, 0.1);
+  EXPECT_EQ(signal.waveform(), wav);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(signal.data()) % 64, 0);
+}